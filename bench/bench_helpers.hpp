@@ -0,0 +1,75 @@
+#ifndef BENCH_HELPERS_INCLUDE_GUARD
+#define BENCH_HELPERS_INCLUDE_GUARD
+
+#include "../infra/types.hpp"
+#include "../infra/minos/minos.hpp"
+#include "../infra/print/print.hpp"
+
+#include <cstring>
+#include <vector>
+
+struct BenchResult
+{
+	const char8* bench;
+
+	const char8* module;
+
+	u8 subbench_chars;
+
+	char8 subbench[63];
+
+	u64 duration;
+
+	u64 iterations;
+
+	u64 bytes;
+
+	u64 items;
+
+	const char8* item_unit;
+};
+
+extern const char8* g_curr_module;
+
+extern std::vector<BenchResult> g_bench_results;
+
+void bench_record(const char8* bench, Range<char8> subbench, u64 duration, u64 iterations, u64 bytes, u64 items, const char8* item_unit) noexcept;
+
+// Begins timing a benchmark named after the enclosing function, optionally
+// qualified by `name`. Must be followed by a matching `BENCH_END` in the same
+// scope. Everything between the two is timed.
+#define BENCH_BEGIN_NAMED(name) \
+		const Range<char8> bench_name_ = name; \
+		const u64 bench_start_ = minos::exact_timestamp()
+
+#define BENCH_BEGIN BENCH_BEGIN_NAMED(Range<char8>{})
+
+// Ends timing of the benchmark begun by the preceding `BENCH_BEGIN` or
+// `BENCH_BEGIN_NAMED`. `iterations` is the number of times the measured
+// operation was repeated, `bytes` and `items` are the total number of bytes
+// and items processed across all iterations, and are used to report
+// throughput. `items` is reported in terms of `item_unit`. Either may be `0`
+// if there is no meaningful value.
+#define BENCH_END(iterations, bytes, items, item_unit) \
+		bench_record(__FUNCTION__, bench_name_, minos::exact_timestamp() - bench_start_, (iterations), (bytes), (items), (item_unit))
+
+#define BENCH_MODULE_BEGIN \
+		g_curr_module = __FUNCTION__
+
+#define BENCH_MODULE_END \
+		ASSERT_OR_IGNORE(g_curr_module != nullptr && strcmp(g_curr_module, __FUNCTION__) == 0); \
+		g_curr_module = nullptr
+
+// Prevents the compiler from optimizing away computations whose results are
+// otherwise unused by a benchmark.
+template<typename T>
+static inline void bench_do_not_optimize(const T& value) noexcept
+{
+	#if defined(COMPILER_MSVC)
+		(void) *static_cast<const volatile T*>(&value);
+	#else
+		asm volatile("" : : "r,m"(value) : "memory");
+	#endif
+}
+
+#endif // BENCH_HELPERS_INCLUDE_GUARD
@@ -0,0 +1,188 @@
+#include "bench_helpers.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/assert.hpp"
+#include "../infra/panic.hpp"
+#include "../infra/range.hpp"
+#include "../infra/minos/minos.hpp"
+
+#include <vector>
+#include <cstdlib>
+
+std::vector<BenchResult> g_bench_results;
+
+const char8* g_curr_module;
+
+void shadow_store_bench() noexcept;
+
+void interpreter_bench() noexcept;
+
+void compiler_bench() noexcept;
+
+void hash_bench() noexcept;
+
+void comp_heap_bench() noexcept;
+
+void bench_record(const char8* bench, Range<char8> subbench, u64 duration, u64 iterations, u64 bytes, u64 items, const char8* item_unit) noexcept
+{
+	ASSERT_OR_IGNORE(g_curr_module != nullptr);
+
+	BenchResult result{};
+	result.bench = bench;
+	result.module = g_curr_module;
+	result.subbench_chars = static_cast<u8>(subbench.count() < sizeof(result.subbench) ? subbench.count() : sizeof(result.subbench));
+	result.duration = duration;
+	result.iterations = iterations;
+	result.bytes = bytes;
+	result.items = items;
+	result.item_unit = item_unit;
+
+	memcpy(result.subbench, subbench.begin(), result.subbench_chars);
+
+	g_bench_results.push_back(result);
+}
+
+
+
+struct BenchModule
+{
+	const char8* name;
+
+	void (*run)() noexcept;
+};
+
+static constexpr BenchModule BENCH_MODULES[] = {
+	{ "shadow-store", &shadow_store_bench },
+	{ "interpreter",  &interpreter_bench  },
+	{ "compiler",     &compiler_bench     },
+	{ "hash",         &hash_bench         },
+	{ "comp-heap",    &comp_heap_bench    },
+};
+
+struct ReadableQuantity
+{
+	const char8* unit;
+
+	f64 count;
+};
+
+static ReadableQuantity readable_time(f64 seconds) noexcept
+{
+	if (seconds > 1.0)
+		return { "s", seconds };
+	else if (seconds * 1'000.0 > 1.0)
+		return { "ms", seconds * 1'000.0 };
+	else if (seconds * 1'000'000.0 > 1.0)
+		return { "us", seconds * 1'000'000.0 };
+	else
+		return { "ns", seconds * 1'000'000'000.0 };
+}
+
+static ReadableQuantity readable_rate(f64 per_second, bool is_bytes) noexcept
+{
+	const f64 base = is_bytes ? 1024.0 : 1000.0;
+
+	if (per_second > base * base * base)
+		return { is_bytes ? "GiB" : "G", per_second / (base * base * base) };
+	else if (per_second > base * base)
+		return { is_bytes ? "MiB" : "M", per_second / (base * base) };
+	else if (per_second > base)
+		return { is_bytes ? "KiB" : "K", per_second / base };
+	else
+		return { is_bytes ? "B" : "", per_second };
+}
+
+static void print_result(const BenchResult* result, u64 ticks_per_second) noexcept
+{
+	const minos::FileHandle out = minos::standard_file_handle(minos::StdFileName::StdOut);
+
+	const f64 seconds = static_cast<f64>(result->duration) / static_cast<f64>(ticks_per_second);
+
+	const u64 iterations = result->iterations == 0 ? 1 : result->iterations;
+
+	const ReadableQuantity per_iteration = readable_time(seconds / static_cast<f64>(iterations));
+
+	char8 label_buf[256];
+
+	const s64 label_chars = print(print_make_sink(MutRange{ label_buf }), "%[]%[]%",
+		result->bench,
+		result->subbench_chars == 0 ? "" : "@", Range<char8>{ result->subbench, result->subbench_chars }
+	);
+
+	const Range<char8> label{ label_buf, label_chars < 0 || label_chars > static_cast<s64>(sizeof(label_buf)) ? sizeof(label_buf) : static_cast<u64>(label_chars) };
+
+	print(out, "%[< 64] %[> 10] iters %[> 9|.2] %[< 2]/iter",
+		label,
+		result->iterations,
+		per_iteration.count, per_iteration.unit
+	);
+
+	if (result->bytes != 0 && seconds > 0.0)
+	{
+		const ReadableQuantity rate = readable_rate(static_cast<f64>(result->bytes) / seconds, true);
+
+		print(out, " %[> 9|.2] %/s", rate.count, rate.unit);
+	}
+
+	if (result->items != 0 && seconds > 0.0)
+	{
+		const ReadableQuantity rate = readable_rate(static_cast<f64>(result->items) / seconds, false);
+
+		print(out, " %[> 9|.2] % %/s", rate.count, rate.unit, result->item_unit);
+	}
+
+	print(out, "\n");
+}
+
+s32 main(s32 argc, const char8** argv) noexcept
+{
+	Range<char8> only{};
+
+	if (argc == 3 && strcmp(argv[1], "--only") == 0)
+	{
+		only = range::from_cstring(argv[2]);
+	}
+	else if (argc != 1)
+	{
+		print(minos::standard_file_handle(minos::StdFileName::StdErr), "Usage: % [ --only <MODULE> ]\nAvailable modules are:\n", argv[0]);
+
+		for (const BenchModule& module : BENCH_MODULES)
+			print(minos::standard_file_handle(minos::StdFileName::StdErr), "    %\n", module.name);
+
+		return EXIT_FAILURE;
+	}
+
+	const u64 ticks_per_second = minos::exact_timestamp_ticks_per_second();
+
+	bool ran_any = false;
+
+	for (const BenchModule& module : BENCH_MODULES)
+	{
+		const Range<char8> module_name = range::from_cstring(module.name);
+
+		if (only.begin() != nullptr && !(only.count() == module_name.count() && range::mem_equal(only, module_name)))
+			continue;
+
+		ran_any = true;
+
+		const u64 results_begin = g_bench_results.size();
+
+		module.run();
+
+		print(minos::standard_file_handle(minos::StdFileName::StdOut), "[%]\n", module_name);
+
+		for (u64 i = results_begin; i != g_bench_results.size(); ++i)
+			print_result(&g_bench_results[i], ticks_per_second);
+
+		print(minos::standard_file_handle(minos::StdFileName::StdOut), "\n");
+	}
+
+	if (!ran_any)
+	{
+		print(minos::standard_file_handle(minos::StdFileName::StdErr), "Unknown benchmark module %\n", only);
+
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+#include "bench_helpers.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/panic.hpp"
+#include "../core/core.hpp"
+
+#include <vector>
+
+struct MarkedHeapShape
+{
+	u64 allocation_size;
+
+	u64 heap_bytes;
+};
+
+// Larger allocations get a larger heap, as they are cheap to set up.
+static constexpr MarkedHeapShape MARKED_HEAP_SHAPES[] = {
+	{ 64,      1 << 26 },
+	{ 1 << 12, 1 << 26 },
+	{ 1 << 20, 1 << 29 },
+};
+
+// Collectable allocations are preceded by a header of this size.
+static constexpr u64 COLLECTABLE_HEADER_BYTES = 16;
+
+static constexpr u64 FRAGMENTED_ALLOCATION_SIZE = 32;
+
+static constexpr u64 FRAGMENTED_HEAP_BYTES = 1 << 26;
+
+static constexpr u64 GC_CYCLE_ITERATIONS = 16;
+
+static constexpr u64 CHURN_LIVE_COUNT = 1 << 12;
+
+static constexpr u64 CHURN_ITERATIONS = 1 << 22;
+
+static constexpr u64 LOOKUP_ALLOCATION_SIZES[] = { 1 << 10, 1 << 16, 1 << 22, 1 << 26 };
+
+static constexpr u64 LOOKUP_ITERATIONS = 1 << 20;
+
+static CoreData* create_bench_core() noexcept
+{
+	Config config = config_defaults();
+
+	// Never collect implicitly, so that the benchmarks control what is alive.
+	config.heap.nursery_size = static_cast<u64>(1) << 31;
+
+	return create_core_data(&config);
+}
+
+static Range<char8> size_name(u64 size, MutRange<char8> buf) noexcept
+{
+	const s64 count = size >= (1 << 20)
+		? print(print_make_sink(buf), "%MiB", size >> 20)
+		: size >= (1 << 10)
+		? print(print_make_sink(buf), "%KiB", size >> 10)
+		: print(print_make_sink(buf), "%B", size);
+
+	return Range<char8>{ buf.begin(), static_cast<u64>(count) };
+}
+
+// Runs collection cycles over a heap filled with collectable allocations of
+// a single size that are all kept alive. This covers clearing the
+// allocations' bits when beginning a collection, marking them, and finding
+// that no memory is free when ending it.
+static void gc_cycle_all_marked(u64 allocation_size, u64 heap_bytes) noexcept
+{
+	CoreData* const core = create_bench_core();
+
+	std::vector<MutRange<byte>> allocations;
+
+	allocations.reserve(heap_bytes / allocation_size);
+
+	for (u64 i = 0; i != heap_bytes / (allocation_size + COLLECTABLE_HEADER_BYTES); ++i)
+	{
+		const Maybe<void*> allocation = comp_heap_alloc_collectable(core, allocation_size, 16);
+
+		if (is_none(allocation))
+			panic("Could not allocate % bytes for compile-time heap benchmark.\n", allocation_size);
+
+		allocations.push_back(MutRange<byte>{ static_cast<byte*>(get(allocation)), allocation_size });
+	}
+
+	char8 name_buf[64];
+
+	BENCH_BEGIN_NAMED(size_name(allocation_size, MutRange{ name_buf }));
+
+	for (u64 i = 0; i != GC_CYCLE_ITERATIONS; ++i)
+	{
+		comp_heap_gc_begin(core);
+
+		for (const MutRange<byte> allocation : allocations)
+			(void) comp_heap_gc_mark(core, allocation);
+
+		comp_heap_gc_end(core);
+	}
+
+	BENCH_END(GC_CYCLE_ITERATIONS, GC_CYCLE_ITERATIONS * heap_bytes, GC_CYCLE_ITERATIONS * allocations.size(), "allocs");
+
+	release_core_data(core);
+}
+
+// Runs collection cycles over a heap in which every other allocation has
+// been freed, so that it consists of alternating short runs of used and free
+// memory.
+static void gc_cycle_fragmented() noexcept
+{
+	CoreData* const core = create_bench_core();
+
+	const u64 allocation_count = FRAGMENTED_HEAP_BYTES / FRAGMENTED_ALLOCATION_SIZE;
+
+	std::vector<byte*> allocations;
+
+	allocations.reserve(allocation_count);
+
+	for (u64 i = 0; i != allocation_count; ++i)
+	{
+		const Maybe<void*> allocation = comp_heap_alloc(core, FRAGMENTED_ALLOCATION_SIZE, 16);
+
+		if (is_none(allocation))
+			panic("Could not allocate % bytes for compile-time heap benchmark.\n", FRAGMENTED_ALLOCATION_SIZE);
+
+		allocations.push_back(static_cast<byte*>(get(allocation)));
+	}
+
+	// Keep the last allocation, so that the free runs do not end up shrinking
+	// the heap.
+	for (u64 i = 0; i < allocation_count - 1; i += 2)
+		comp_heap_dealloc(core, MutRange<byte>{ allocations[i], FRAGMENTED_ALLOCATION_SIZE });
+
+	BENCH_BEGIN;
+
+	for (u64 i = 0; i != GC_CYCLE_ITERATIONS; ++i)
+	{
+		comp_heap_gc_begin(core);
+
+		comp_heap_gc_end(core);
+	}
+
+	BENCH_END(GC_CYCLE_ITERATIONS, GC_CYCLE_ITERATIONS * FRAGMENTED_HEAP_BYTES, GC_CYCLE_ITERATIONS * allocation_count / 2, "runs");
+
+	release_core_data(core);
+}
+
+// Repeatedly frees a pseudo-randomly chosen one of a fixed number of live
+// allocations and replaces it with a new one, with sizes spread between 8
+// and 512 bytes like those of types, closures and shadow layouts.
+static void alloc_dealloc_churn() noexcept
+{
+	CoreData* const core = create_bench_core();
+
+	MutRange<byte> live[CHURN_LIVE_COUNT];
+
+	u64 rng = 0x9E37'79B9'7F4A'7C15;
+
+	const auto next_random = [&rng]() noexcept
+	{
+		rng = rng * 6364136223846793005 + 1442695040888963407;
+
+		return rng >> 33;
+	};
+
+	const auto alloc_random = [core, &next_random]() noexcept
+	{
+		const u64 size = 8 + (next_random() % 64) * 8;
+
+		const Maybe<void*> allocation = comp_heap_alloc(core, size, 8);
+
+		if (is_none(allocation))
+			panic("Could not allocate % bytes for compile-time heap benchmark.\n", size);
+
+		return MutRange<byte>{ static_cast<byte*>(get(allocation)), size };
+	};
+
+	for (MutRange<byte>& allocation : live)
+		allocation = alloc_random();
+
+	BENCH_BEGIN;
+
+	for (u64 i = 0; i != CHURN_ITERATIONS; ++i)
+	{
+		MutRange<byte>* const victim = live + next_random() % CHURN_LIVE_COUNT;
+
+		comp_heap_dealloc(core, *victim);
+
+		*victim = alloc_random();
+	}
+
+	BENCH_END(CHURN_ITERATIONS, 0, CHURN_ITERATIONS, "allocs");
+
+	release_core_data(core);
+}
+
+// Looks up the type of a global member from pseudo-random addresses inside
+// of it, which requires finding its header.
+static void global_member_type_lookup(u64 allocation_size) noexcept
+{
+	CoreData* const core = create_bench_core();
+
+	const TypeId type_id = type_create_simple(core, TypeTag::Void);
+
+	const Maybe<void*> allocation = comp_heap_alloc_global_member(core, allocation_size, 16, type_id);
+
+	if (is_none(allocation))
+		panic("Could not allocate % bytes for compile-time heap benchmark.\n", allocation_size);
+
+	byte* const begin = static_cast<byte*>(get(allocation));
+
+	u64 rng = 0x9E37'79B9'7F4A'7C15;
+
+	char8 name_buf[64];
+
+	BENCH_BEGIN_NAMED(size_name(allocation_size, MutRange{ name_buf }));
+
+	for (u64 i = 0; i != LOOKUP_ITERATIONS; ++i)
+	{
+		rng = rng * 6364136223846793005 + 1442695040888963407;
+
+		bench_do_not_optimize(comp_heap_global_member_type(core, begin + (rng >> 33) % allocation_size));
+	}
+
+	BENCH_END(LOOKUP_ITERATIONS, 0, LOOKUP_ITERATIONS, "lookups");
+
+	release_core_data(core);
+}
+
+void comp_heap_bench() noexcept
+{
+	BENCH_MODULE_BEGIN;
+
+	for (const MarkedHeapShape shape : MARKED_HEAP_SHAPES)
+		gc_cycle_all_marked(shape.allocation_size, shape.heap_bytes);
+
+	gc_cycle_fragmented();
+
+	alloc_dealloc_churn();
+
+	for (const u64 size : LOOKUP_ALLOCATION_SIZES)
+		global_member_type_lookup(size);
+
+	BENCH_MODULE_END;
+}
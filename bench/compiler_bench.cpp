@@ -0,0 +1,357 @@
+#include "bench_helpers.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/panic.hpp"
+#include "../infra/range.hpp"
+#include "../infra/minos/minos.hpp"
+#include "../infra/print/print.hpp"
+#include "../core/core.hpp"
+
+// Directory into which the benchmark programs are generated, relative to the
+// `bench` directory the benchmarks are run from.
+static constexpr Range<char8> GENERATED_SOURCES_DIRECTORY = range::from_literal_string("generated-bench-sources");
+
+static constexpr u32 COMPILE_REPETITIONS = 3;
+
+// Number of definitions in each file generated by `generate_definitions`.
+// This stays clear of the maximum number of definitions in a single scope.
+static constexpr u32 DEFINITIONS_PER_FILE = 25000;
+
+static constexpr u32 DEFINITION_FILE_COUNT = 4;
+
+// Number of binary operators in each expression generated by
+// `generate_expression_chains`. Expressions nest one level deeper per
+// operator, so this must stay below `MAX_AST_DEPTH`.
+static constexpr u32 CHAIN_TERM_COUNT = 100;
+
+static constexpr u32 CHAIN_COUNT = 2000;
+
+static constexpr u32 WIDE_COMPOSITE_COUNT = 100;
+
+static constexpr u32 WIDE_COMPOSITE_MEMBER_COUNT = 100;
+
+static constexpr u32 TRAIT_COUNT = 2000;
+
+static constexpr u32 CALL_LOOP_ITERATIONS = 1000000;
+
+// File being written by one of the `generate_*` functions.
+struct GeneratedFile
+{
+	minos::FileHandle handle;
+
+	u64 bytes;
+};
+
+// Sizes of the sources of a generated program, as reported by the
+// `generate_*` functions.
+struct GeneratedProgram
+{
+	u64 source_bytes;
+
+	u64 definition_count;
+};
+
+struct CompilerBenchProgram
+{
+	const char8* name;
+
+	// Writes the program to `entrypoint`, placing any further files it
+	// imports into `directory`, which is an absolute path.
+	GeneratedProgram (*generate)(Range<char8> directory, Range<char8> entrypoint) noexcept;
+
+	// Unit of `GeneratedProgram::definition_count`.
+	const char8* definition_unit;
+};
+
+static GeneratedFile generated_file_create(Range<char8> filepath) noexcept
+{
+	GeneratedFile file;
+
+	if (!minos::file_create(filepath, minos::Access::Write, minos::ExistsMode::Truncate, minos::NewMode::Create, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file.handle))
+		panic("Could not create generated benchmark source `%` (0x%[|X]).\n", filepath, minos::last_error());
+
+	file.bytes = 0;
+
+	return file;
+}
+
+template<typename... Inserts>
+static void generated_file_print(GeneratedFile* file, const char8* format, Inserts... inserts) noexcept
+{
+	const s64 written = print(file->handle, format, inserts...);
+
+	if (written < 0)
+		panic("Could not write generated benchmark source (0x%[|X]).\n", minos::last_error());
+
+	file->bytes += static_cast<u64>(written);
+}
+
+static u64 generated_file_close(GeneratedFile* file) noexcept
+{
+	minos::file_close(file->handle);
+
+	return file->bytes;
+}
+
+// Formats a path into `out`, panicking if it does not fit.
+template<typename... Inserts>
+static Range<char8> format_path(MutRange<char8> out, const char8* format, Inserts... inserts) noexcept
+{
+	const s64 chars = print(print_make_sink(out), format, inserts...);
+
+	if (chars < 0 || static_cast<u64>(chars) >= out.count())
+		panic("Path of generated benchmark source is too long.\n");
+
+	return Range<char8>{ out.begin(), static_cast<u64>(chars) };
+}
+
+// Many top-level definitions, each referring to an earlier one, split across
+// several files imported by the entrypoint.
+static GeneratedProgram generate_definitions(Range<char8> directory, Range<char8> entrypoint) noexcept
+{
+	GeneratedProgram program{};
+
+	GeneratedFile main = generated_file_create(entrypoint);
+
+	for (u32 i = 0; i != DEFINITION_FILE_COUNT; ++i)
+	{
+		char8 part_path_buf[minos::MAX_PATH_CHARS];
+
+		const Range<char8> part_path = format_path(MutRange{ part_path_buf }, "%/definitions-%.evl", directory, i);
+
+		GeneratedFile part = generated_file_create(part_path);
+
+		generated_file_print(&part, "let d0: u64 = 0\n");
+
+		for (u32 j = 1; j != DEFINITIONS_PER_FILE; ++j)
+			generated_file_print(&part, "\nlet d%: u64 = d% + %\n", j, j / 2, j);
+
+		program.source_bytes += generated_file_close(&part);
+
+		generated_file_print(&main, "let part% = import(\"%\"[..])\n\n", i, part_path);
+	}
+
+	generated_file_print(&main, "let x = std.assert(part0.d% == part%.d%)\n", DEFINITIONS_PER_FILE - 1, DEFINITION_FILE_COUNT - 1, DEFINITIONS_PER_FILE - 1);
+
+	program.source_bytes += generated_file_close(&main);
+
+	program.definition_count = DEFINITION_FILE_COUNT * DEFINITIONS_PER_FILE;
+
+	return program;
+}
+
+// Definitions initialized by long chains of arithmetic on literals.
+static GeneratedProgram generate_expression_chains([[maybe_unused]] Range<char8> directory, Range<char8> entrypoint) noexcept
+{
+	GeneratedFile main = generated_file_create(entrypoint);
+
+	for (u32 i = 0; i != CHAIN_COUNT; ++i)
+	{
+		generated_file_print(&main, "let c%: u64 = %", i, i);
+
+		for (u32 j = 0; j != CHAIN_TERM_COUNT; j += 2)
+			generated_file_print(&main, " + % * %", (i + j) % 7, (i + j) % 5);
+
+		generated_file_print(&main, "\n\n");
+	}
+
+	generated_file_print(&main, "let x = std.assert(c% >= %)\n", CHAIN_COUNT - 1, CHAIN_COUNT - 1);
+
+	return { generated_file_close(&main), CHAIN_COUNT };
+}
+
+// Composite types with many members, built through a type builder, along
+// with a value of each type.
+static GeneratedProgram generate_wide_composites([[maybe_unused]] Range<char8> directory, Range<char8> entrypoint) noexcept
+{
+	GeneratedFile main = generated_file_create(entrypoint);
+
+	for (u32 i = 0; i != WIDE_COMPOSITE_COUNT; ++i)
+	{
+		generated_file_print(&main, "let Wide% = {\n\tlet builder = std.create_type_builder()\n\n", i);
+
+		for (u32 j = 0; j != WIDE_COMPOSITE_MEMBER_COUNT; ++j)
+			generated_file_print(&main, "\tstd.add_type_member(builder, m%: u32, %)\n", j, j * 4);
+
+		generated_file_print(&main, "\n\tstd.complete_type(.builder = builder, .size = %, .stride = %, .align = 4)\n}\n\nlet wide%: Wide% = .{", WIDE_COMPOSITE_MEMBER_COUNT * 4, WIDE_COMPOSITE_MEMBER_COUNT * 4, i, i);
+
+		for (u32 j = 0; j != WIDE_COMPOSITE_MEMBER_COUNT; ++j)
+			generated_file_print(&main, "% .m% = %", j == 0 ? "" : ",", j, i + j);
+
+		generated_file_print(&main, " }\n\nlet check% = std.assert(wide%.m% == %)\n\n", i, i, WIDE_COMPOSITE_MEMBER_COUNT - 1, i + WIDE_COMPOSITE_MEMBER_COUNT - 1);
+	}
+
+	generated_file_print(&main, "let x = 0\n");
+
+	return { generated_file_close(&main), WIDE_COMPOSITE_COUNT * WIDE_COMPOSITE_MEMBER_COUNT };
+}
+
+// Many traits, each with a single implementation that is looked up once.
+static GeneratedProgram generate_traits([[maybe_unused]] Range<char8> directory, Range<char8> entrypoint) noexcept
+{
+	GeneratedFile main = generated_file_create(entrypoint);
+
+	for (u32 i = 0; i != TRAIT_COUNT; ++i)
+		generated_file_print(&main, "let Tr% = trait(A) {\n\tlet x: u64\n}\n\nlet Im% = u32 impl Tr%(self) {\n\tlet x = %\n}\n\nlet x% = Tr%(Im%).x\n\n", i, i, i, i, i, i, i);
+
+	generated_file_print(&main, "let x = std.assert(x% == %)\n", TRAIT_COUNT - 1, TRAIT_COUNT - 1);
+
+	return { generated_file_close(&main), TRAIT_COUNT };
+}
+
+// A loop calling a small function on each iteration.
+static GeneratedProgram generate_loop_calls([[maybe_unused]] Range<char8> directory, Range<char8> entrypoint) noexcept
+{
+	GeneratedFile main = generated_file_create(entrypoint);
+
+	generated_file_print(&main,
+		"let step = func(x: u64) -> u64 => x * 3 + 1\n"
+		"\n"
+		"let x = {\n"
+		"\tmut sum: u64 = 0\n"
+		"\n"
+		"\tfor i != %, i += 1 where mut i: u64 = 0 {\n"
+		"\t\tsum += step(i) - i * 3\n"
+		"\t}\n"
+		"\n"
+		"\tstd.assert(sum == %)\n"
+		"\n"
+		"\tsum\n"
+		"}\n",
+		CALL_LOOP_ITERATIONS, CALL_LOOP_ITERATIONS
+	);
+
+	return { generated_file_close(&main), 2 };
+}
+
+static constexpr CompilerBenchProgram PROGRAMS[] = {
+	{ "definitions",       &generate_definitions,       "defs"    },
+	{ "expression-chains", &generate_expression_chains, "chains"  },
+	{ "wide-composites",   &generate_wide_composites,   "members" },
+	{ "traits",            &generate_traits,            "traits"  },
+	{ "loop-calls",        &generate_loop_calls,        "defs"    },
+};
+
+struct CompilerBenchPhase
+{
+	const char8* name;
+
+	InstrumentationPhase phase;
+};
+
+// Phases reported separately. Whatever is not covered by these, such as
+// reading sources and setting up the `CoreData`, only shows up in the total.
+static constexpr CompilerBenchPhase PHASES[] = {
+	{ "parse",         InstrumentationPhase::Parse        },
+	{ "resolve-names", InstrumentationPhase::ResolveNames },
+	{ "emit-opcodes",  InstrumentationPhase::EmitOpcodes  },
+	{ "interpret",     InstrumentationPhase::Interpret    },
+};
+
+static u64 print_sink_write_discard([[maybe_unused]] void* attach, Range<char8> data) noexcept
+{
+	return data.count();
+}
+
+// Generates the given program and compiles it with `compile_all` set,
+// recording the time spent in each of `PHASES` as well as in total. Phase
+// times are taken from the instrumentation enabled through `logging.stats`,
+// whose report is discarded. Parsing and name resolution are reported in terms
+// of source bytes, emitting opcodes in terms of the program's definitions,
+// and interpretation in terms of executed opcodes.
+static void compile_program(const CompilerBenchProgram& program, Range<char8> directory) noexcept
+{
+	char8 entrypoint_buf[minos::MAX_PATH_CHARS];
+
+	const Range<char8> entrypoint = format_path(MutRange{ entrypoint_buf }, "%/%.evl", directory, range::from_cstring(program.name));
+
+	const GeneratedProgram generated = program.generate(directory, entrypoint);
+
+	PrintSink discard_sink{};
+	discard_sink.write_func = print_sink_write_discard;
+
+	Config config = config_defaults();
+	config.compile_all = true;
+	config.std.prelude.filepath = range::from_literal_string("../sample/std/prelude.evl");
+	config.entrypoint.filepath = entrypoint;
+	config.logging.stats_sink = ConfigPrintSink{ { range::from_literal_string("discard"), true }, discard_sink };
+
+	u64 phase_ticks[static_cast<u8>(InstrumentationPhase::MAX)]{};
+
+	u64 total_ticks = 0;
+
+	u64 opcode_count = 0;
+
+	u64 type_intern_count = 0;
+
+	for (u32 i = 0; i != COMPILE_REPETITIONS; ++i)
+	{
+		const u64 begin = minos::exact_timestamp();
+
+		CoreData* const core = create_core_data(&config);
+
+		if (!run_compilation(core, false))
+			panic("Generated compiler benchmark source `%` failed to compile.\n", entrypoint);
+
+		const InstrumentationSummary summary = instrumentation_summary(core);
+
+		release_core_data(core);
+
+		total_ticks += minos::exact_timestamp() - begin;
+
+		for (u8 j = 0; j != static_cast<u8>(InstrumentationPhase::MAX); ++j)
+			phase_ticks[j] += summary.phase_wall_ticks[j];
+
+		opcode_count += summary.opcode_count;
+
+		type_intern_count += summary.type_intern_hits + summary.type_intern_misses;
+	}
+
+	for (const CompilerBenchPhase& phase : PHASES)
+	{
+		char8 name_buf[64];
+
+		const s64 name_chars = print(print_make_sink(MutRange{ name_buf }), "%/%", program.name, phase.name);
+
+		const Range<char8> name{ name_buf, static_cast<u64>(name_chars) };
+
+		const u64 ticks = phase_ticks[static_cast<u8>(phase.phase)];
+
+		if (phase.phase == InstrumentationPhase::Parse || phase.phase == InstrumentationPhase::ResolveNames)
+			bench_record(__FUNCTION__, name, ticks, COMPILE_REPETITIONS, COMPILE_REPETITIONS * generated.source_bytes, 0, nullptr);
+		else if (phase.phase == InstrumentationPhase::EmitOpcodes)
+			bench_record(__FUNCTION__, name, ticks, COMPILE_REPETITIONS, 0, COMPILE_REPETITIONS * generated.definition_count, program.definition_unit);
+		else
+			bench_record(__FUNCTION__, name, ticks, COMPILE_REPETITIONS, 0, opcode_count, "ops");
+	}
+
+	char8 name_buf[64];
+
+	const s64 name_chars = print(print_make_sink(MutRange{ name_buf }), "%/total", program.name);
+
+	bench_record(__FUNCTION__, Range<char8>{ name_buf, static_cast<u64>(name_chars) }, total_ticks, COMPILE_REPETITIONS, COMPILE_REPETITIONS * generated.source_bytes, type_intern_count, "type-interns");
+}
+
+void compiler_bench() noexcept
+{
+	BENCH_MODULE_BEGIN;
+
+	// Imports between the generated files are resolved relative to the
+	// prelude's directory, so the generated programs refer to each other
+	// through absolute paths.
+	(void) minos::directory_create(GENERATED_SOURCES_DIRECTORY);
+
+	char8 directory_buf[minos::MAX_PATH_CHARS];
+
+	const u32 directory_chars = minos::path_to_absolute(GENERATED_SOURCES_DIRECTORY, MutRange{ directory_buf });
+
+	if (directory_chars == 0 || directory_chars > minos::MAX_PATH_CHARS)
+		panic("Could not determine absolute path of `%` (0x%[|X]).\n", GENERATED_SOURCES_DIRECTORY, minos::last_error());
+
+	const Range<char8> directory{ directory_buf, directory_chars };
+
+	for (const CompilerBenchProgram& program : PROGRAMS)
+		compile_program(program, directory);
+
+	BENCH_MODULE_END;
+}
@@ -0,0 +1,190 @@
+#include "bench_helpers.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/panic.hpp"
+#include "../infra/range.hpp"
+#include "../infra/hash.hpp"
+#include "../infra/minos/minos.hpp"
+
+#include <vector>
+
+// Sources from which the identifiers hashed by `hash_identifiers` are taken,
+// so that their lengths and contents follow those of real programs.
+static constexpr const char8* IDENTIFIER_SOURCES[] = {
+	"../sample/full-source.evl",
+	"../sample/source.evl",
+	"../sample/import.evl",
+	"../sample/std/prelude.evl",
+	"../sample/std/std.evl",
+	"../sample/std/vec.evl",
+};
+
+static constexpr u32 IDENTIFIER_REPETITIONS = 20000;
+
+static constexpr u32 FIXED_LENGTHS[] = { 2, 4, 8, 16, 32, 64 };
+
+static constexpr u64 FIXED_LENGTH_BYTES = 1 << 28;
+
+struct HashFunction
+{
+	const char8* name;
+
+	u32 (*hash)(Range<byte> data) noexcept;
+};
+
+static u32 fnv1a_of(Range<byte> data) noexcept
+{
+	return fnv1a(data);
+}
+
+static u32 wyhash_of(Range<byte> data) noexcept
+{
+	return wyhash(data);
+}
+
+static constexpr HashFunction HASH_FUNCTIONS[] = {
+	{ "fnv1a",  &fnv1a_of  },
+	{ "wyhash", &wyhash_of },
+};
+
+static bool is_identifier_char(char8 c) noexcept
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static void read_file(const char8* filepath, std::vector<char8>* out) noexcept
+{
+	minos::FileHandle file;
+
+	if (!minos::file_create(range::from_cstring(filepath), minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+		panic("Could not open hash benchmark source `%` (0x%[|X]).\n", range::from_cstring(filepath), minos::last_error());
+
+	minos::FileInfo info;
+
+	if (!minos::file_get_info(file, &info))
+		panic("Could not get size of hash benchmark source `%` (0x%[|X]).\n", range::from_cstring(filepath), minos::last_error());
+
+	out->resize(info.bytes);
+
+	u32 bytes_read;
+
+	if (!minos::file_read(file, MutRange{ out->data(), out->size() }.as_mut_byte_range(), 0, &bytes_read) || bytes_read != info.bytes)
+		panic("Could not read hash benchmark source `%` (0x%[|X]).\n", range::from_cstring(filepath), minos::last_error());
+
+	minos::file_close(file);
+}
+
+// Collects everything that looks like an identifier or keyword from
+// `IDENTIFIER_SOURCES`. This is cruder than the lexer, but yields the same
+// distribution of lengths.
+static std::vector<Range<byte>> collect_identifiers(std::vector<std::vector<char8>>* sources) noexcept
+{
+	std::vector<Range<byte>> identifiers;
+
+	for (const char8* filepath : IDENTIFIER_SOURCES)
+	{
+		sources->emplace_back();
+
+		std::vector<char8>* const source = &sources->back();
+
+		read_file(filepath, source);
+
+		u64 i = 0;
+
+		while (i != source->size())
+		{
+			const char8 c = (*source)[i];
+
+			if (!is_identifier_char(c) || (c >= '0' && c <= '9'))
+			{
+				i += 1;
+
+				continue;
+			}
+
+			const u64 begin = i;
+
+			while (i != source->size() && is_identifier_char((*source)[i]))
+				i += 1;
+
+			identifiers.push_back(Range<char8>{ source->data() + begin, i - begin }.as_byte_range());
+		}
+	}
+
+	return identifiers;
+}
+
+// Hashes the identifiers occurring in the sample sources, as the
+// `IdentifierPool` does for every identifier the lexer encounters.
+static void hash_identifiers(const HashFunction& function, Range<Range<byte>> identifiers) noexcept
+{
+	u64 identifier_bytes = 0;
+
+	for (const Range<byte> identifier : identifiers)
+		identifier_bytes += identifier.count();
+
+	BENCH_BEGIN_NAMED(range::from_cstring(function.name));
+
+	u32 combined = 0;
+
+	for (u32 i = 0; i != IDENTIFIER_REPETITIONS; ++i)
+	{
+		for (const Range<byte> identifier : identifiers)
+			combined ^= function.hash(identifier);
+	}
+
+	bench_do_not_optimize(combined);
+
+	BENCH_END(IDENTIFIER_REPETITIONS, IDENTIFIER_REPETITIONS * identifier_bytes, IDENTIFIER_REPETITIONS * identifiers.count(), "ids");
+}
+
+// Hashes keys of a single length, to show how each function scales.
+static void hash_fixed_length(const HashFunction& function, Range<byte> data, u32 length) noexcept
+{
+	char8 name_buf[64];
+
+	const s64 name_chars = print(print_make_sink(MutRange{ name_buf }), "%-%B", function.name, length);
+
+	const u64 key_count = FIXED_LENGTH_BYTES / length;
+
+	BENCH_BEGIN_NAMED((Range<char8>{ name_buf, static_cast<u64>(name_chars) }));
+
+	u32 combined = 0;
+
+	for (u64 i = 0; i != key_count; ++i)
+	{
+		// Vary the offset, so that consecutive keys differ.
+		const u64 offset = i & 255;
+
+		combined ^= function.hash(data.subrange(offset, length));
+	}
+
+	bench_do_not_optimize(combined);
+
+	BENCH_END(1, key_count * length, key_count, "keys");
+}
+
+void hash_bench() noexcept
+{
+	BENCH_MODULE_BEGIN;
+
+	std::vector<std::vector<char8>> sources;
+
+	const std::vector<Range<byte>> identifiers = collect_identifiers(&sources);
+
+	for (const HashFunction& function : HASH_FUNCTIONS)
+		hash_identifiers(function, Range{ identifiers.data(), identifiers.size() });
+
+	byte fixed_length_data[512];
+
+	for (u32 i = 0; i != sizeof(fixed_length_data); ++i)
+		fixed_length_data[i] = static_cast<byte>('a' + i % 26);
+
+	for (const u32 length : FIXED_LENGTHS)
+	{
+		for (const HashFunction& function : HASH_FUNCTIONS)
+			hash_fixed_length(function, Range{ fixed_length_data }, length);
+	}
+
+	BENCH_MODULE_END;
+}
@@ -0,0 +1,60 @@
+#include "bench_helpers.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/panic.hpp"
+#include "../infra/range.hpp"
+#include "../core/core.hpp"
+
+struct InterpreterBenchSource
+{
+	const char8* name;
+
+	const char8* filepath;
+
+	u64 loop_iterations;
+};
+
+// Each of these runs a single loop with a fixed number of iterations, so the
+// reported rate is in loop iterations per second. Parsing and type checking
+// of the sources is included in the timing, but is negligible compared to
+// the loops themselves.
+static constexpr InterpreterBenchSource LOOP_SOURCES[] = {
+	{ "loop-count",      "interpreter-bench-sources/loop-count.evl",      1000000 },
+	{ "loop-arithmetic", "interpreter-bench-sources/loop-arithmetic.evl", 1000000 },
+	{ "loop-compare",    "interpreter-bench-sources/loop-compare.evl",    1000000 },
+};
+
+static constexpr u32 LOOP_REPETITIONS = 5;
+
+// Evaluates the given source with `compile_all` set.
+static void interpret_loop(const InterpreterBenchSource& source) noexcept
+{
+	Config config = config_defaults();
+	config.compile_all = true;
+	config.std.prelude.filepath = range::from_literal_string("../sample/std/prelude.evl");
+	config.entrypoint.filepath = range::from_cstring(source.filepath);
+
+	BENCH_BEGIN_NAMED(range::from_cstring(source.name));
+
+	for (u32 i = 0; i != LOOP_REPETITIONS; ++i)
+	{
+		CoreData* const core = create_core_data(&config);
+
+		if (!run_compilation(core, false))
+			panic("Interpreter benchmark source `%` failed to compile.\n", config.entrypoint.filepath);
+
+		release_core_data(core);
+	}
+
+	BENCH_END(LOOP_REPETITIONS, 0, LOOP_REPETITIONS * source.loop_iterations, "loops");
+}
+
+void interpreter_bench() noexcept
+{
+	BENCH_MODULE_BEGIN;
+
+	for (const InterpreterBenchSource& source : LOOP_SOURCES)
+		interpret_loop(source);
+
+	BENCH_MODULE_END;
+}
@@ -0,0 +1,163 @@
+#include "bench_helpers.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/panic.hpp"
+#include "../infra/math.hpp"
+#include "../core/core.hpp"
+
+static constexpr u64 COPY_SIZES[] = { 1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20 };
+
+static constexpr u64 COPY_BYTES_PER_SIZE = 1 << 28;
+
+static constexpr u64 POPULATED_ENTRY_DISTANCE = 1 << 10;
+
+static CoreData* create_bench_core() noexcept
+{
+	Config config = config_defaults();
+
+	return create_core_data(&config);
+}
+
+static MutRange<byte> alloc_bench_buffer(CoreData* core, u64 size) noexcept
+{
+	const Maybe<void*> allocation = comp_heap_alloc(core, size, 16);
+
+	if (is_none(allocation))
+		panic("Could not allocate % bytes for shadow store benchmark buffer.\n", size);
+
+	return MutRange<byte>{ static_cast<byte*>(get(allocation)), size };
+}
+
+static ShadowLayoutId create_bench_layout(CoreData* core) noexcept
+{
+	// Signatures are the only types that are shadow-allocated, so use an
+	// argumentless one as the layout's single member.
+	const TypeId signature_type = type_create_signature(core, true, 0);
+
+	SignatureSealInfo seal{};
+	seal.closure_id = none<ClosureId>();
+	seal.return_type.complete.type_id = type_create_simple(core, TypeTag::Void);
+	seal.has_templated_return_type = false;
+	seal.is_variadic = false;
+
+	const ShadowLayoutMemberInitializer member{ 0, 0, type_seal_signature(core, signature_type, seal) };
+
+	return shadow_create_layout(core, Range{ &member, 1 });
+}
+
+static Range<char8> size_name(u64 size, const char8* suffix, MutRange<char8> buf) noexcept
+{
+	const s64 count = size >= (1 << 20)
+		? print(print_make_sink(buf), "%MiB%", size >> 20, suffix)
+		: print(print_make_sink(buf), "%KiB%", size >> 10, suffix);
+
+	return Range<char8>{ buf.begin(), static_cast<u64>(count) };
+}
+
+// Copies ranges when there are no shadow entries at all. This is the case for
+// the vast majority of temporary values pushed by the interpreter.
+static void shadow_copy_empty_store() noexcept
+{
+	CoreData* const core = create_bench_core();
+
+	for (const u64 size : COPY_SIZES)
+	{
+		const MutRange<byte> src = alloc_bench_buffer(core, size);
+
+		const MutRange<byte> dst = alloc_bench_buffer(core, size);
+
+		const u64 iterations = COPY_BYTES_PER_SIZE / size;
+
+		char8 name_buf[64];
+
+		BENCH_BEGIN_NAMED(size_name(size, "", MutRange{ name_buf }));
+
+		for (u64 i = 0; i != iterations; ++i)
+			shadow_copy(core, dst, src);
+
+		BENCH_END(iterations, iterations * size, 0, nullptr);
+	}
+
+	release_core_data(core);
+}
+
+// Copies ranges that do not contain any shadow entries while other parts of
+// the heap have entries densely populating them.
+static void shadow_copy_range_without_entries() noexcept
+{
+	CoreData* const core = create_bench_core();
+
+	const ShadowLayoutId layout = create_bench_layout(core);
+
+	const MutRange<byte> populated = alloc_bench_buffer(core, COPY_SIZES[array_count(COPY_SIZES) - 1]);
+
+	for (u64 i = 0; i < populated.count(); i += 64)
+		(void) shadow_get(core, populated.begin() + i, layout, 0);
+
+	for (const u64 size : COPY_SIZES)
+	{
+		const MutRange<byte> src = alloc_bench_buffer(core, size);
+
+		const MutRange<byte> dst = alloc_bench_buffer(core, size);
+
+		const u64 iterations = COPY_BYTES_PER_SIZE / size;
+
+		char8 name_buf[64];
+
+		BENCH_BEGIN_NAMED(size_name(size, "", MutRange{ name_buf }));
+
+		for (u64 i = 0; i != iterations; ++i)
+			shadow_copy(core, dst, src);
+
+		BENCH_END(iterations, iterations * size, 0, nullptr);
+	}
+
+	release_core_data(core);
+}
+
+// Copies ranges containing a shadow entry every `POPULATED_ENTRY_DISTANCE`
+// bytes.
+static void shadow_copy_range_with_entries() noexcept
+{
+	CoreData* const core = create_bench_core();
+
+	const ShadowLayoutId layout = create_bench_layout(core);
+
+	for (const u64 size : COPY_SIZES)
+	{
+		const MutRange<byte> src = alloc_bench_buffer(core, size);
+
+		const MutRange<byte> dst = alloc_bench_buffer(core, size);
+
+		for (u64 i = 0; i < size; i += POPULATED_ENTRY_DISTANCE)
+			(void) shadow_get(core, src.begin() + i, layout, 0);
+
+		const u64 iterations = COPY_BYTES_PER_SIZE / size / 16;
+
+		const u64 entries_per_iteration = (size + POPULATED_ENTRY_DISTANCE - 1) / POPULATED_ENTRY_DISTANCE;
+
+		char8 name_buf[64];
+
+		BENCH_BEGIN_NAMED(size_name(size, "", MutRange{ name_buf }));
+
+		for (u64 i = 0; i != iterations; ++i)
+			shadow_copy(core, dst, src);
+
+		BENCH_END(iterations, iterations * size, iterations * entries_per_iteration, "entries");
+	}
+
+	release_core_data(core);
+}
+
+void shadow_store_bench() noexcept
+{
+	BENCH_MODULE_BEGIN;
+
+	shadow_copy_empty_store();
+
+	shadow_copy_range_without_entries();
+
+	shadow_copy_range_with_entries();
+
+	BENCH_MODULE_END;
+}
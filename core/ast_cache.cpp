@@ -0,0 +1,636 @@
+#include "core.hpp"
+#include "structure.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/assert.hpp"
+#include "../infra/panic.hpp"
+#include "../infra/range.hpp"
+#include "../infra/minos/minos.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+
+// Layout of an AST cache file:
+//
+// - `AstCacheHeader`
+// - `node_qwords` qwords of `AstNode`s in preorder, as produced by `parse`.
+//   `IdentifierId`s are replaced by indices into the file's identifier
+//   table, and the `type_id` of `AstLitStringData` by an index into its
+//   string table.
+// - `node_count` `u32`s, holding the `SourceId` of each node relative to the
+//   file's `source_id_base`.
+// - `identifier_count` `u32`s, holding the end offset of each identifier in
+//   the identifier character table.
+// - `string_count` `u32`s, holding the end offset of each string in the
+//   string character table.
+// - `identifier_bytes` bytes of identifier characters.
+// - `string_bytes` bytes of string characters.
+//
+// `magic` is written only after the rest of the file is complete, so that
+// partially written files are not mistaken for valid ones.
+struct AstCacheHeader
+{
+	u32 magic;
+
+	u32 version;
+
+	u64 content_hash;
+
+	u32 content_bytes;
+
+	u32 is_std;
+
+	u32 node_qwords;
+
+	u32 node_count;
+
+	u32 identifier_count;
+
+	u32 identifier_bytes;
+
+	u32 string_count;
+
+	u32 string_bytes;
+};
+
+static_assert(sizeof(AstCacheHeader) % sizeof(u64) == 0);
+
+static constexpr u32 AST_CACHE_MAGIC = 0x54534145; // "EAST"
+
+// Must be incremented whenever the AST layout or the parser's output changes.
+static constexpr u32 AST_CACHE_VERSION = 1;
+
+struct AstCacheLayout
+{
+	u64 nodes_offset;
+
+	u64 sources_offset;
+
+	u64 identifier_ends_offset;
+
+	u64 string_ends_offset;
+
+	u64 identifier_chars_offset;
+
+	u64 string_chars_offset;
+
+	u64 total_bytes;
+};
+
+struct AstCacheIdentifierSlot
+{
+	IdentifierId id;
+
+	u32 local_index;
+};
+
+static AstCacheLayout layout_from_header(const AstCacheHeader* header) noexcept
+{
+	AstCacheLayout layout;
+	layout.nodes_offset = sizeof(AstCacheHeader);
+	layout.sources_offset = layout.nodes_offset + static_cast<u64>(header->node_qwords) * sizeof(u64);
+	layout.identifier_ends_offset = layout.sources_offset + static_cast<u64>(header->node_count) * sizeof(u32);
+	layout.string_ends_offset = layout.identifier_ends_offset + static_cast<u64>(header->identifier_count) * sizeof(u32);
+	layout.identifier_chars_offset = layout.string_ends_offset + static_cast<u64>(header->string_count) * sizeof(u32);
+	layout.string_chars_offset = layout.identifier_chars_offset + header->identifier_bytes;
+	layout.total_bytes = layout.string_chars_offset + header->string_bytes;
+
+	return layout;
+}
+
+static bool is_identifier_carrying_tag(AstTag tag) noexcept
+{
+	return tag == AstTag::Identifier
+	    || tag == AstTag::Member
+	    || tag == AstTag::ImpliedMember
+	    || tag == AstTag::Definition
+	    || tag == AstTag::Parameter;
+}
+
+// All identifier-carrying attachments store their `IdentifierId` as their
+// first member, which allows treating them uniformly here.
+static IdentifierId* identifier_of(AstNode* node) noexcept
+{
+	static_assert(offsetof(AstIdentifierData, identifier_id) == 0);
+	static_assert(offsetof(AstMemberData, identifier_id) == 0);
+	static_assert(offsetof(AstImpliedMemberData, identifier_id) == 0);
+	static_assert(offsetof(AstDefinitionData, identifier_id) == 0);
+	static_assert(offsetof(AstParameterData, identifier_id) == 0);
+
+	ASSERT_OR_IGNORE(is_identifier_carrying_tag(node->tag));
+
+	return reinterpret_cast<IdentifierId*>(node + 1);
+}
+
+static u32 build_cache_path(CoreData* core, u64 content_hash, bool is_std, MutRange<char8> out) noexcept
+{
+	const Range<char8> directory = core->config->ast_cache.directory;
+
+	// '/' + 16 hex digits + '-' + 1 digit + '-v' + 8 hex digits + ".ast"
+	//
+	// Including `AST_CACHE_VERSION` in the name means that files written in
+	// an older format are never even opened, instead of shadowing the entry
+	// that would replace them.
+	constexpr u32 name_bytes = 33;
+
+	if (directory.count() + name_bytes > out.count())
+		return 0;
+
+	memcpy(out.begin(), directory.begin(), directory.count());
+
+	char8* curr = out.begin() + directory.count();
+
+	*curr++ = '/';
+
+	for (u32 i = 0; i != 16; ++i)
+		*curr++ = "0123456789abcdef"[(content_hash >> (60 - i * 4)) & 0xF];
+
+	*curr++ = '-';
+	*curr++ = is_std ? '1' : '0';
+
+	*curr++ = '-';
+	*curr++ = 'v';
+
+	for (u32 i = 0; i != 8; ++i)
+		*curr++ = "0123456789abcdef"[(AST_CACHE_VERSION >> (28 - i * 4)) & 0xF];
+
+	memcpy(curr, ".ast", 4);
+	curr += 4;
+
+	return static_cast<u32>(curr - out.begin());
+}
+
+static Range<char8> without_terminator(Range<char8> content) noexcept
+{
+	ASSERT_OR_IGNORE(content.count() != 0 && content.end()[-1] == '\0');
+
+	return Range<char8>{ content.begin(), content.count() - 1 };
+}
+
+static bool validate_nodes(const AstCacheHeader* header, const AstNode* nodes) noexcept
+{
+	const AstNode* curr = nodes;
+
+	const AstNode* const end = nodes + header->node_qwords;
+
+	u32 node_count = 0;
+
+	while (curr != end)
+	{
+		if (curr->own_qwords == 0 || curr->own_qwords > static_cast<u64>(end - curr))
+			return false;
+
+		if (is_identifier_carrying_tag(curr->tag))
+		{
+			if (curr->own_qwords < 2 || *reinterpret_cast<const u32*>(curr + 1) >= header->identifier_count)
+				return false;
+		}
+		else if (curr->tag == AstTag::LitString)
+		{
+			if (curr->own_qwords != 1 + sizeof(AstLitStringData) / sizeof(u64) || static_cast<u32>(attachment_of<AstLitStringData>(curr)->type_id) >= header->string_count)
+				return false;
+		}
+
+		node_count += 1;
+
+		curr += curr->own_qwords;
+	}
+
+	return node_count == header->node_count;
+}
+
+static bool validate_ends(const u32* ends, u32 count, u32 total_bytes) noexcept
+{
+	u32 prev_end = 0;
+
+	for (u32 i = 0; i != count; ++i)
+	{
+		if (ends[i] < prev_end)
+			return false;
+
+		prev_end = ends[i];
+	}
+
+	return prev_end == total_bytes;
+}
+
+static AstNode* load_from_mapping(CoreData* core, const byte* file, u64 file_bytes, u64 content_hash, u32 content_bytes, SourceId source_id_base, bool is_std) noexcept
+{
+	if (file_bytes < sizeof(AstCacheHeader))
+		return nullptr;
+
+	const AstCacheHeader* const header = reinterpret_cast<const AstCacheHeader*>(file);
+
+	if (header->magic != AST_CACHE_MAGIC
+	 || header->version != AST_CACHE_VERSION
+	 || header->content_hash != content_hash
+	 || header->content_bytes != content_bytes
+	 || header->is_std != static_cast<u32>(is_std)
+	 || header->node_qwords == 0)
+		return nullptr;
+
+	const AstCacheLayout layout = layout_from_header(header);
+
+	if (layout.total_bytes != file_bytes)
+		return nullptr;
+
+	const AstNode* const src_nodes = reinterpret_cast<const AstNode*>(file + layout.nodes_offset);
+
+	const u32* const src_sources = reinterpret_cast<const u32*>(file + layout.sources_offset);
+
+	const u32* const identifier_ends = reinterpret_cast<const u32*>(file + layout.identifier_ends_offset);
+
+	const u32* const string_ends = reinterpret_cast<const u32*>(file + layout.string_ends_offset);
+
+	const char8* const identifier_chars = reinterpret_cast<const char8*>(file + layout.identifier_chars_offset);
+
+	const byte* const string_chars = file + layout.string_chars_offset;
+
+	if (!validate_nodes(header, src_nodes)
+	 || !validate_ends(identifier_ends, header->identifier_count, header->identifier_bytes)
+	 || !validate_ends(string_ends, header->string_count, header->string_bytes))
+		return nullptr;
+
+	IdentifierId* const identifier_ids = static_cast<IdentifierId*>(malloc((header->identifier_count + header->string_count + 1) * sizeof(u32)));
+
+	if (identifier_ids == nullptr)
+		return nullptr;
+
+	u32 identifier_begin = 0;
+
+	for (u32 i = 0; i != header->identifier_count; ++i)
+	{
+		identifier_ids[i] = id_from_identifier(core, Range<char8>{ identifier_chars + identifier_begin, identifier_chars + identifier_ends[i] });
+
+		identifier_begin = identifier_ends[i];
+	}
+
+	TypeId* const string_type_ids = reinterpret_cast<TypeId*>(identifier_ids + header->identifier_count);
+
+	AstNode* const dst_nodes = static_cast<AstNode*>(core->asts.nodes.reserve_exact(header->node_qwords * sizeof(u64)));
+
+	SourceId* const dst_sources = static_cast<SourceId*>(core->asts.sources.reserve_exact(header->node_qwords * sizeof(SourceId)));
+
+	memcpy(dst_nodes, src_nodes, header->node_qwords * sizeof(u64));
+
+	u32 string_begin = 0;
+
+	for (u32 i = 0; i != header->string_count; ++i)
+	{
+		const u32 string_bytes = string_ends[i] - string_begin;
+
+		string_type_ids[i] = type_create_array(core, TypeTag::Array, ArrayType{ string_bytes, some(core->parser.u8_type_id) });
+
+		string_begin = string_ends[i];
+	}
+
+	AstNode* curr = dst_nodes;
+
+	u32 node_index = 0;
+
+	while (curr != dst_nodes + header->node_qwords)
+	{
+		dst_sources[curr - dst_nodes] = static_cast<SourceId>(static_cast<u32>(source_id_base) + src_sources[node_index]);
+
+		if (is_identifier_carrying_tag(curr->tag))
+		{
+			IdentifierId* const identifier_id = identifier_of(curr);
+
+			*identifier_id = identifier_ids[static_cast<u32>(*identifier_id)];
+		}
+		else if (curr->tag == AstTag::LitString)
+		{
+			AstLitStringData* const string = attachment_of<AstLitStringData>(curr);
+
+			const u32 string_index = static_cast<u32>(string->type_id);
+
+			const u32 begin = string_index == 0 ? 0 : string_ends[string_index - 1];
+
+			const u32 bytes = string_ends[string_index] - begin;
+
+			const Maybe<void*> allocation = comp_heap_alloc(core, bytes, 1);
+
+			if (is_none(allocation))
+				panic("Failed to allocate % bytes of compile-time heap memory for cached string literal.\n", bytes);
+
+			memcpy(get(allocation), string_chars + begin, bytes);
+
+			string->value_begin = get(allocation);
+			string->value_size = bytes;
+			string->type_id = string_type_ids[string_index];
+		}
+
+		node_index += 1;
+
+		curr += curr->own_qwords;
+	}
+
+	free(identifier_ids);
+
+	return dst_nodes;
+}
+
+
+
+bool cache_file_write(Range<char8> filepath, Range<byte> image, u64 magic_offset, u32 magic) noexcept
+{
+	// The image is written to a uniquely named sibling of `filepath` first
+	// and only renamed into place once it is complete. This way concurrent
+	// readers never observe a torn file, and a stale or corrupt file already
+	// at `filepath` gets replaced instead of blocking the entry for good.
+
+	// '.' + 16 hex digits + ".tmp"
+	constexpr u32 suffix_bytes = 21;
+
+	char8 temp_path_buf[4096];
+
+	if (filepath.count() + suffix_bytes > array_count(temp_path_buf))
+		return false;
+
+	memcpy(temp_path_buf, filepath.begin(), filepath.count());
+
+	char8* curr = temp_path_buf + filepath.count();
+
+	const u64 nonce = minos::exact_timestamp();
+
+	*curr++ = '.';
+
+	for (u32 i = 0; i != 16; ++i)
+		*curr++ = "0123456789abcdef"[(nonce >> (60 - i * 4)) & 0xF];
+
+	memcpy(curr, ".tmp", 4);
+	curr += 4;
+
+	const Range<char8> temp_path{ temp_path_buf, curr };
+
+	minos::FileHandle file;
+
+	if (!minos::file_create(temp_path, minos::Access::Write, minos::ExistsMode::Fail, minos::NewMode::Create, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+		return false;
+
+	const bool written = minos::file_write_at(file, image, 0)
+	                  && minos::file_write_at(file, Range<byte>{ reinterpret_cast<const byte*>(&magic), sizeof(magic) }, magic_offset);
+
+	minos::file_close(file);
+
+	if (written && minos::path_rename(temp_path, filepath))
+		return true;
+
+	(void) minos::path_remove_file(temp_path);
+
+	return false;
+}
+
+Maybe<AstNode*> ast_cache_load(CoreData* core, Range<char8> content, u64 content_hash, SourceId source_id_base, bool is_std) noexcept
+{
+	if (!core->config->ast_cache.enabled)
+		return none<AstNode*>();
+
+	const Range<char8> source = without_terminator(content);
+
+	char8 path_buf[4096];
+
+	const u32 path_bytes = build_cache_path(core, content_hash, is_std, MutRange{ path_buf });
+
+	AstNode* root = nullptr;
+
+	minos::FileHandle file;
+
+	if (path_bytes != 0 && minos::file_create(Range{ path_buf, path_bytes }, minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+	{
+		minos::FileInfo fileinfo;
+
+		if (minos::file_get_info(file, &fileinfo) && !fileinfo.is_directory && fileinfo.bytes >= sizeof(AstCacheHeader))
+		{
+			const void* const mapping = minos::file_map_readonly(file, fileinfo.bytes);
+
+			if (mapping != nullptr)
+			{
+				root = load_from_mapping(core, static_cast<const byte*>(mapping), fileinfo.bytes, content_hash, static_cast<u32>(source.count()), source_id_base, is_std);
+
+				minos::file_unmap(mapping, fileinfo.bytes);
+			}
+		}
+
+		minos::file_close(file);
+	}
+
+	instrumentation_count_ast_cache_load(core, root != nullptr);
+
+	return root == nullptr ? none<AstNode*>() : some(root);
+}
+
+void ast_cache_store(CoreData* core, Range<char8> content, u64 content_hash, bool is_std, AstNode* root) noexcept
+{
+	if (!core->config->ast_cache.enabled)
+		return;
+
+	const Range<char8> source = without_terminator(content);
+
+	ASSERT_OR_IGNORE(root >= core->asts.nodes.begin() && root < core->asts.nodes.end());
+
+	const u32 node_qwords = static_cast<u32>(core->asts.nodes.end() - root);
+
+	const SourceId* const sources = core->asts.sources.begin() + (root - core->asts.nodes.begin());
+
+	const u32 source_id_base = static_cast<u32>(sources[0]);
+
+	// Count nodes, identifier references and string bytes to size the
+	// serialized image.
+
+	u32 node_count = 0;
+
+	u32 identifier_reference_count = 0;
+
+	u32 string_count = 0;
+
+	u32 string_bytes = 0;
+
+	for (AstNode* curr = root; curr != root + node_qwords; curr += curr->own_qwords)
+	{
+		node_count += 1;
+
+		if (is_identifier_carrying_tag(curr->tag))
+		{
+			identifier_reference_count += 1;
+		}
+		else if (curr->tag == AstTag::LitString)
+		{
+			string_count += 1;
+
+			string_bytes += attachment_of<AstLitStringData>(curr)->value_size;
+		}
+	}
+
+	u32 slot_count = 16;
+
+	while (slot_count < identifier_reference_count * 2)
+		slot_count *= 2;
+
+	AstCacheIdentifierSlot* const slots = static_cast<AstCacheIdentifierSlot*>(calloc(slot_count, sizeof(AstCacheIdentifierSlot)));
+
+	IdentifierId* const local_identifiers = static_cast<IdentifierId*>(malloc((identifier_reference_count + 1) * sizeof(IdentifierId)));
+
+	if (slots == nullptr || local_identifiers == nullptr)
+	{
+		free(slots);
+
+		free(local_identifiers);
+
+		return;
+	}
+
+	// Deduplicate identifiers, assigning local indices in order of first
+	// occurrence. `IdentifierId::INVALID` marks empty slots.
+
+	static_assert(static_cast<u32>(IdentifierId::INVALID) == 0);
+
+	u32 identifier_count = 0;
+
+	u32 identifier_bytes = 0;
+
+	for (AstNode* curr = root; curr != root + node_qwords; curr += curr->own_qwords)
+	{
+		if (!is_identifier_carrying_tag(curr->tag))
+			continue;
+
+		const IdentifierId id = *identifier_of(curr);
+
+		u32 slot_index = (static_cast<u32>(id) * 2654435761u) & (slot_count - 1);
+
+		while (slots[slot_index].id != IdentifierId::INVALID && slots[slot_index].id != id)
+			slot_index = (slot_index + 1) & (slot_count - 1);
+
+		if (slots[slot_index].id == IdentifierId::INVALID)
+		{
+			slots[slot_index].id = id;
+			slots[slot_index].local_index = identifier_count;
+
+			local_identifiers[identifier_count] = id;
+
+			identifier_count += 1;
+
+			identifier_bytes += static_cast<u32>(identifier_name_from_id(core, id).count());
+		}
+	}
+
+	AstCacheHeader header;
+	header.magic = 0;
+	header.version = AST_CACHE_VERSION;
+	header.content_hash = content_hash;
+	header.content_bytes = static_cast<u32>(source.count());
+	header.is_std = static_cast<u32>(is_std);
+	header.node_qwords = node_qwords;
+	header.node_count = node_count;
+	header.identifier_count = identifier_count;
+	header.identifier_bytes = identifier_bytes;
+	header.string_count = string_count;
+	header.string_bytes = string_bytes;
+
+	const AstCacheLayout layout = layout_from_header(&header);
+
+	byte* const image = static_cast<byte*>(malloc(layout.total_bytes));
+
+	if (image == nullptr)
+	{
+		free(slots);
+
+		free(local_identifiers);
+
+		return;
+	}
+
+	memcpy(image, &header, sizeof(header));
+
+	AstNode* const dst_nodes = reinterpret_cast<AstNode*>(image + layout.nodes_offset);
+
+	u32* const dst_sources = reinterpret_cast<u32*>(image + layout.sources_offset);
+
+	u32* const identifier_ends = reinterpret_cast<u32*>(image + layout.identifier_ends_offset);
+
+	u32* const string_ends = reinterpret_cast<u32*>(image + layout.string_ends_offset);
+
+	char8* const identifier_chars = reinterpret_cast<char8*>(image + layout.identifier_chars_offset);
+
+	byte* const string_chars = image + layout.string_chars_offset;
+
+	memcpy(dst_nodes, root, node_qwords * sizeof(u64));
+
+	u32 identifier_end = 0;
+
+	for (u32 i = 0; i != identifier_count; ++i)
+	{
+		const Range<char8> name = identifier_name_from_id(core, local_identifiers[i]);
+
+		memcpy(identifier_chars + identifier_end, name.begin(), name.count());
+
+		identifier_end += static_cast<u32>(name.count());
+
+		identifier_ends[i] = identifier_end;
+	}
+
+	u32 node_index = 0;
+
+	u32 string_index = 0;
+
+	u32 string_end = 0;
+
+	for (AstNode* curr = dst_nodes; curr != dst_nodes + node_qwords; curr += curr->own_qwords)
+	{
+		dst_sources[node_index] = static_cast<u32>(sources[curr - dst_nodes]) - source_id_base;
+
+		if (is_identifier_carrying_tag(curr->tag))
+		{
+			IdentifierId* const identifier_id = identifier_of(curr);
+
+			u32 slot_index = (static_cast<u32>(*identifier_id) * 2654435761u) & (slot_count - 1);
+
+			while (slots[slot_index].id != *identifier_id)
+				slot_index = (slot_index + 1) & (slot_count - 1);
+
+			*identifier_id = static_cast<IdentifierId>(slots[slot_index].local_index);
+
+			// Bindings are only established by `resolve_names` after parsing,
+			// so they carry no information here. Clear them anyway to keep
+			// cache files deterministic.
+			if (curr->tag == AstTag::Identifier)
+				attachment_of<AstIdentifierData>(curr)->binding = NameBinding{};
+		}
+		else if (curr->tag == AstTag::LitString)
+		{
+			AstLitStringData* const string = attachment_of<AstLitStringData>(curr);
+
+			memcpy(string_chars + string_end, string->value_begin, string->value_size);
+
+			string_end += string->value_size;
+
+			string_ends[string_index] = string_end;
+
+			string->value_begin = nullptr;
+			string->type_id = static_cast<TypeId>(string_index);
+
+			string_index += 1;
+		}
+
+		node_index += 1;
+	}
+
+	free(slots);
+
+	free(local_identifiers);
+
+	// Failing to write the cache is not an error, as it only costs us the
+	// parse on the next run.
+
+	(void) minos::directory_create(core->config->ast_cache.directory);
+
+	char8 path_buf[4096];
+
+	const u32 path_bytes = build_cache_path(core, header.content_hash, is_std, MutRange{ path_buf });
+
+	if (path_bytes != 0)
+		(void) cache_file_write(Range{ path_buf, path_bytes }, Range<byte>{ image, layout.total_bytes }, offsetof(AstCacheHeader, magic), AST_CACHE_MAGIC);
+
+	free(image);
+}
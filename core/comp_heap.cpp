@@ -6,248 +6,1272 @@
 #include "../infra/math.hpp"
 #include "../infra/inplace_sort.hpp"
 
+#if COMPILER_MSVC
+	#include <csetjmp>
+
+	#define GC_NOINLINE __declspec(noinline)
+	#define GC_NO_SANITIZE_ADDRESS __declspec(no_sanitize_address)
+#else
+	#define GC_NOINLINE __attribute__((noinline))
+	#define GC_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#endif
+
 static constexpr u64 BYTES_PER_BITMAP_BYTE = 8 * COMP_HEAP_MIN_ALLOCATION_SIZE;
 
-struct alignas(8) CompHeapAllocationHeader
+// Maximum number of separately committed ranges of `CoreData`'s memory that
+// can be scanned for garbage collection roots.
+static constexpr u32 COMP_HEAP_GC_MAX_ROOT_RANGE_COUNT = 1024;
+
+// Minimum number of bytes covered by a card, which is the unit at which
+// writes to the old generation are tracked. Cards are at least a page in
+// size, but larger cards keep the number of separately protected ranges
+// small.
+static constexpr u64 COMP_HEAP_MIN_CARD_SIZE = static_cast<u64>(1) << 16;
+
+struct alignas(8) CompHeapAllocationHeader
+{
+	TypeId type_id;
+
+	u64 size;
+};
+
+
+
+static u64 calc_commit_increment(const Config* config, u64 page_size) noexcept
+{
+	const u64 min_size = page_size * BYTES_PER_BITMAP_BYTE;
+
+	return config->heap.commit_increment < min_size
+		? min_size
+		: next_pow2(config->heap.commit_increment);
+}
+
+static u64 calc_bitmap_reserve(u64 page_size, u64 heap_size) noexcept
+{
+	const u64 page_mask = page_size - 1;
+
+	return (heap_size / BYTES_PER_BITMAP_BYTE + page_mask) & ~page_mask;
+}
+
+// Allocate one extra byte so that we can fit a trailing `0` bit to ease
+// scanning of the bitmap.
+static u64 calc_gc_bitmap_commit(u64 used, u64 page_size) noexcept
+{
+	const u64 page_mask = page_size - 1;
+
+	return ((used + BYTES_PER_BITMAP_BYTE - 1) / BYTES_PER_BITMAP_BYTE + 1 + page_mask) & ~page_mask;
+}
+
+static u64 calc_card_size(u64 page_size) noexcept
+{
+	return page_size < COMP_HEAP_MIN_CARD_SIZE ? COMP_HEAP_MIN_CARD_SIZE : page_size;
+}
+
+static u64 calc_card_bitmap_reserve(u64 page_size, u64 heap_size) noexcept
+{
+	const u64 page_mask = page_size - 1;
+
+	const u64 card_count = heap_size / calc_card_size(page_size);
+
+	return (((card_count + 63) >> 6) * sizeof(u64) + page_mask) & ~page_mask;
+}
+
+// Returns the number of qwords in the given level of `begin_summaries`,
+// counting from `1`, for a `begin_bitmap` of `bitmap_size` bytes.
+static u64 calc_begin_summary_qwords(u64 bitmap_size, u32 level) noexcept
+{
+	u64 qwords = bitmap_size / sizeof(u64);
+
+	for (u32 i = 0; i != level; ++i)
+		qwords = (qwords + 63) >> 6;
+
+	return qwords;
+}
+
+static u64 calc_begin_summary_reserve(u64 page_size, u64 bitmap_size) noexcept
+{
+	const u64 page_mask = page_size - 1;
+
+	u64 qwords = 0;
+
+	for (u32 level = 1; level <= COMP_HEAP_BEGIN_SUMMARY_LEVEL_COUNT; ++level)
+		qwords += calc_begin_summary_qwords(bitmap_size, level);
+
+	return (qwords * sizeof(u64) + page_mask) & ~page_mask;
+}
+
+static u64 calc_memory_reserve(const Config* config, u64 commit_increment) noexcept
+{
+	const u64 commit_increment_mask = commit_increment - 1;
+
+	return (config->heap.reserve + commit_increment_mask) & ~commit_increment_mask;
+}
+
+
+
+// Returns the number of bytes in entries of the size class `index`.
+static u64 comp_heap_size_class_bytes(u32 index) noexcept
+{
+	if (index < COMP_HEAP_DENSE_SIZE_CLASS_COUNT)
+		return (static_cast<u64>(index) + 1) * COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	const u32 sparse_index = index - COMP_HEAP_DENSE_SIZE_CLASS_COUNT;
+
+	const u32 doubling = sparse_index >> COMP_HEAP_SIZE_CLASS_STEPS_LOG2;
+
+	const u64 step = (sparse_index & ((1 << COMP_HEAP_SIZE_CLASS_STEPS_LOG2) - 1)) + 1;
+
+	const u64 base = COMP_HEAP_DENSE_SIZE_CLASS_LIMIT << doubling;
+
+	return base + step * (base >> COMP_HEAP_SIZE_CLASS_STEPS_LOG2);
+}
+
+// Returns the largest size class whose entries are no larger than `bytes`,
+// which must be a non-zero multiple of `COMP_HEAP_MIN_ALLOCATION_SIZE`.
+static u32 comp_heap_size_class_floor(u64 bytes) noexcept
+{
+	ASSERT_OR_IGNORE(bytes != 0 && (bytes & COMP_HEAP_ZERO_ADDRESS_MASK) == 0);
+
+	if (bytes < COMP_HEAP_DENSE_SIZE_CLASS_LIMIT)
+		return static_cast<u32>(bytes / COMP_HEAP_MIN_ALLOCATION_SIZE - 1);
+
+	if (bytes >= COMP_HEAP_MAX_FREELIST_SIZE)
+		return COMP_HEAP_SIZE_CLASS_COUNT - 1;
+
+	const u8 base_log2 = 63 - count_leading_zeros_assume_one(bytes);
+
+	const u32 doubling = base_log2 - COMP_HEAP_DENSE_SIZE_CLASS_LIMIT_LOG2;
+
+	const u32 step = static_cast<u32>((bytes - (static_cast<u64>(1) << base_log2)) >> (base_log2 - COMP_HEAP_SIZE_CLASS_STEPS_LOG2));
+
+	// A power of two itself is the last step of the previous doubling.
+	return COMP_HEAP_DENSE_SIZE_CLASS_COUNT + (doubling << COMP_HEAP_SIZE_CLASS_STEPS_LOG2) + step - 1;
+}
+
+// Returns the smallest size class whose entries can hold `bytes` bytes,
+// which must not exceed `COMP_HEAP_MAX_FREELIST_SIZE`.
+static u32 comp_heap_size_class_ceil(u64 bytes) noexcept
+{
+	ASSERT_OR_IGNORE(bytes != 0 && bytes <= COMP_HEAP_MAX_FREELIST_SIZE);
+
+	const u64 rounded_bytes = (bytes + COMP_HEAP_ZERO_ADDRESS_MASK) & ~COMP_HEAP_ZERO_ADDRESS_MASK;
+
+	const u32 floor = comp_heap_size_class_floor(rounded_bytes);
+
+	return comp_heap_size_class_bytes(floor) < rounded_bytes ? floor + 1 : floor;
+}
+
+static void comp_heap_push_freelist(CoreData* core, u32 index, byte* entry_begin) noexcept
+{
+	*reinterpret_cast<u32*>(entry_begin) = core->heap.freelists[index];
+
+	core->heap.freelists[index] = static_cast<u32>((entry_begin - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE);
+
+	core->heap.nonempty_freelists[index >> 6] |= static_cast<u64>(1) << (index & 63);
+}
+
+static byte* comp_heap_pop_freelist(CoreData* core, u32 index) noexcept
+{
+	const u32 head = core->heap.freelists[index];
+
+	ASSERT_OR_IGNORE(head != 0);
+
+	byte* const entry_begin = core->heap.memory + static_cast<u64>(head) * COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	const u32 next = *reinterpret_cast<const u32*>(entry_begin);
+
+	core->heap.freelists[index] = next;
+
+	if (next == 0)
+		core->heap.nonempty_freelists[index >> 6] &= ~(static_cast<u64>(1) << (index & 63));
+
+	return entry_begin;
+}
+
+// Returns the smallest size class at or above `index` whose freelist is not
+// empty, or `COMP_HEAP_SIZE_CLASS_COUNT` if there is none.
+static u32 comp_heap_find_nonempty_freelist(const CoreData* core, u32 index) noexcept
+{
+	const u64* const nonempty = core->heap.nonempty_freelists;
+
+	u32 i = index >> 6;
+
+	u64 curr = nonempty[i] & (~static_cast<u64>(0) << (index & 63));
+
+	while (curr == 0)
+	{
+		i += 1;
+
+		if (i == array_count(core->heap.nonempty_freelists))
+			return COMP_HEAP_SIZE_CLASS_COUNT;
+
+		curr = nonempty[i];
+	}
+
+	return i * 64 + count_trailing_zeros_assume_one(curr);
+}
+
+static void comp_heap_add_to_freelist(CoreData* core, MutRange<byte> memory) noexcept
+{
+	ASSERT_OR_IGNORE(memory.begin() >= core->heap.memory);
+
+	ASSERT_OR_IGNORE(memory.end() <= core->heap.memory + core->heap.used);
+
+	ASSERT_OR_IGNORE((reinterpret_cast<u64>(memory.begin()) & COMP_HEAP_ZERO_ADDRESS_MASK) == 0);
+
+	ASSERT_OR_IGNORE(memory.count() != 0 && (memory.count() & COMP_HEAP_ZERO_ADDRESS_MASK) == 0);
+
+	// Split the memory into entries of the largest size classes that fit, so
+	// that each freelist only holds entries of a single size. The garbage
+	// collector relies on this to tell free memory apart from allocations.
+	// As size classes are spaced at most a quarter of their size apart, this
+	// takes few entries unless the memory exceeds the largest size class.
+
+	u64 size = memory.count();
+
+	byte* curr = memory.begin();
+
+	while (size != 0)
+	{
+		const u32 index = comp_heap_size_class_floor(size);
+
+		const u64 entry_size = comp_heap_size_class_bytes(index);
+
+		comp_heap_push_freelist(core, index, curr);
+
+		curr += entry_size;
+
+		size -= entry_size;
+	}
+}
+
+static bool comp_heap_ensure_commit(CoreData* core, u64 required) noexcept
+{
+	if (required <= core->heap.commit)
+		return true;
+
+	if (required > core->heap.reserve)
+		return false;
+
+	const u64 old_commit = core->heap.commit;
+
+	const u64 new_commit = (required + core->heap.commit_increment - 1) & ~(core->heap.commit_increment - 1);
+
+	ASSERT_OR_IGNORE(new_commit <= core->heap.reserve);
+
+	const u64 commit_difference = new_commit - old_commit;
+
+	if (!minos::mem_commit(core->heap.memory + old_commit, commit_difference))
+		return false;
+
+	const u64 old_bitmap_commit = old_commit / BYTES_PER_BITMAP_BYTE;
+
+	const u64 new_bitmap_commit = new_commit / BYTES_PER_BITMAP_BYTE;
+
+	ASSERT_OR_IGNORE(new_bitmap_commit != old_bitmap_commit);
+
+	if (!minos::mem_commit(reinterpret_cast<byte*>(core->heap.leak_bitmap) + old_bitmap_commit, new_bitmap_commit - old_bitmap_commit))
+		return false;
+
+	if (!minos::mem_commit(reinterpret_cast<byte*>(core->heap.begin_bitmap) + old_bitmap_commit, new_bitmap_commit - old_bitmap_commit))
+		return false;
+
+	if (!minos::mem_commit(reinterpret_cast<byte*>(core->heap.header_bitmap) + old_bitmap_commit, new_bitmap_commit - old_bitmap_commit))
+		return false;
+
+	if (!minos::mem_commit(reinterpret_cast<byte*>(core->heap.collectable_bitmap) + old_bitmap_commit, new_bitmap_commit - old_bitmap_commit))
+		return false;
+
+	core->heap.commit = new_commit;
+
+	return true;
+}
+
+// Sets the bits of the slots from `begin` up to `end` in `bitmap`. The
+// partially covered qwords at either end are masked, while all qwords in
+// between are filled at once.
+static void comp_heap_set_bitmap_range(u64* bitmap, u64 begin, u64 end) noexcept
+{
+	if (begin == end)
+		return;
+
+	const u64 begin_qword = begin >> 6;
+
+	const u64 last_qword = (end - 1) >> 6;
+
+	const u64 begin_mask = ~static_cast<u64>(0) << (begin & 63);
+
+	const u64 end_mask = ~static_cast<u64>(0) >> (63 - ((end - 1) & 63));
+
+	if (begin_qword == last_qword)
+	{
+		bitmap[begin_qword] |= begin_mask & end_mask;
+
+		return;
+	}
+
+	bitmap[begin_qword] |= begin_mask;
+
+	memset(bitmap + begin_qword + 1, 0xFF, (last_qword - begin_qword - 1) * sizeof(u64));
+
+	bitmap[last_qword] |= end_mask;
+}
+
+// Clears the bits of the slots from `begin` up to `end` in `bitmap`. See
+// `comp_heap_set_bitmap_range`.
+static void comp_heap_clear_bitmap_range(u64* bitmap, u64 begin, u64 end) noexcept
+{
+	if (begin == end)
+		return;
+
+	const u64 begin_qword = begin >> 6;
+
+	const u64 last_qword = (end - 1) >> 6;
+
+	const u64 begin_mask = ~static_cast<u64>(0) << (begin & 63);
+
+	const u64 end_mask = ~static_cast<u64>(0) >> (63 - ((end - 1) & 63));
+
+	if (begin_qword == last_qword)
+	{
+		bitmap[begin_qword] &= ~(begin_mask & end_mask);
+
+		return;
+	}
+
+	bitmap[begin_qword] &= ~begin_mask;
+
+	memset(bitmap + begin_qword + 1, 0, (last_qword - begin_qword - 1) * sizeof(u64));
+
+	bitmap[last_qword] &= ~end_mask;
+}
+
+// Returns the first slot at or after `slot` whose bit in `bitmap` is set.
+// Such a slot must exist, so callers rely on a sentinel bit.
+static u64 comp_heap_find_set_bit(const u64* bitmap, u64 slot) noexcept
+{
+	u64 i = slot >> 6;
+
+	u64 curr = bitmap[i] & (~static_cast<u64>(0) << (slot & 63));
+
+	while (curr == 0)
+	{
+		i += 1;
+
+		curr = bitmap[i];
+	}
+
+	return i * 64 + count_trailing_zeros_assume_one(curr);
+}
+
+// Returns the first slot at or after `slot` whose bit in `bitmap` is clear.
+// Such a slot must exist, so callers rely on a sentinel bit.
+static u64 comp_heap_find_clear_bit(const u64* bitmap, u64 slot) noexcept
+{
+	u64 i = slot >> 6;
+
+	u64 curr = ~bitmap[i] & (~static_cast<u64>(0) << (slot & 63));
+
+	while (curr == 0)
+	{
+		i += 1;
+
+		curr = ~bitmap[i];
+	}
+
+	return i * 64 + count_trailing_zeros_assume_one(curr);
+}
+
+static void comp_heap_mark_bitmap_bits(CoreData* core, u64* bitmap, MutRange<byte> memory) noexcept
+{
+	const u64 begin = (memory.begin() - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	const u64 end = (memory.end() + COMP_HEAP_ZERO_ADDRESS_MASK - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	comp_heap_set_bitmap_range(bitmap, begin, end);
+}
+
+static void comp_heap_clear_bitmap_bits(CoreData* core, u64* bitmap, MutRange<byte> memory) noexcept
+{
+	const u64 begin = (memory.begin() - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	const u64 end = (memory.end() + COMP_HEAP_ZERO_ADDRESS_MASK - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	comp_heap_clear_bitmap_range(bitmap, begin, end);
+}
+
+static bool comp_heap_test_bitmap_bit(const u64* bitmap, u64 slot) noexcept
+{
+	return (bitmap[slot >> 6] & (static_cast<u64>(1) << (slot & 63))) != 0;
+}
+
+static void comp_heap_mark_bitmap_bit(CoreData* core, u64* bitmap, byte* memory) noexcept
+{
+	const u64 byte_offset = memory - core->heap.memory;
+
+	const u64 slot_offset = byte_offset / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	ASSERT_OR_IGNORE((bitmap[slot_offset >> 6] & (static_cast<u64>(1) << (slot_offset & 63))) == 0);
+
+	bitmap[slot_offset >> 6] |= static_cast<u64>(1) << (slot_offset & 63);
+}
+
+static u64* comp_heap_begin_level(const CoreData* core, u32 level) noexcept
+{
+	return level == 0 ? core->heap.begin_bitmap : core->heap.begin_summaries[level - 1];
+}
+
+// Marks `slot` as beginning an allocation in `begin_bitmap`, keeping its
+// summaries up to date.
+static void comp_heap_set_begin_bit(CoreData* core, u64 slot) noexcept
+{
+	u64 index = slot;
+
+	for (u32 level = 0; level <= COMP_HEAP_BEGIN_SUMMARY_LEVEL_COUNT; ++level)
+	{
+		u64* const qword = comp_heap_begin_level(core, level) + (index >> 6);
+
+		const u64 old_qword = *qword;
+
+		*qword = old_qword | (static_cast<u64>(1) << (index & 63));
+
+		// Higher levels already reflect the non-zero qword.
+		if (old_qword != 0)
+			return;
+
+		index >>= 6;
+	}
+}
+
+// Unmarks `slot` as beginning an allocation in `begin_bitmap`, keeping its
+// summaries up to date.
+static void comp_heap_clear_begin_bit(CoreData* core, u64 slot) noexcept
+{
+	u64 index = slot;
+
+	for (u32 level = 0; level <= COMP_HEAP_BEGIN_SUMMARY_LEVEL_COUNT; ++level)
+	{
+		u64* const qword = comp_heap_begin_level(core, level) + (index >> 6);
+
+		*qword &= ~(static_cast<u64>(1) << (index & 63));
+
+		// Higher levels still need to reflect the non-zero qword.
+		if (*qword != 0)
+			return;
+
+		index >>= 6;
+	}
+}
+
+// Recomputes the summaries of the qwords of `begin_bitmap` from
+// `begin_qword` up to `end_qword` after they have been modified directly.
+static void comp_heap_rebuild_begin_summaries(CoreData* core, u64 begin_qword, u64 end_qword) noexcept
+{
+	const u64 bitmap_size = reinterpret_cast<byte*>(core->heap.header_bitmap) - reinterpret_cast<byte*>(core->heap.begin_bitmap);
+
+	u64 begin = begin_qword;
+
+	u64 end = end_qword;
+
+	for (u32 level = 1; level <= COMP_HEAP_BEGIN_SUMMARY_LEVEL_COUNT && begin != end; ++level)
+	{
+		const u64* const lower = comp_heap_begin_level(core, level - 1);
+
+		u64* const upper = comp_heap_begin_level(core, level);
+
+		const u64 lower_qwords = calc_begin_summary_qwords(bitmap_size, level - 1);
+
+		begin >>= 6;
+
+		end = (end + 63) >> 6;
+
+		// Summarise all of the lower qwords covered by the upper ones, even
+		// those outside the modified range, as they are consistent anyway.
+		for (u64 i = begin; i != end; ++i)
+		{
+			const u64 lower_end = (i + 1) * 64 < lower_qwords ? (i + 1) * 64 : lower_qwords;
+
+			u64 summary = 0;
+
+			for (u64 j = i * 64; j != lower_end; ++j)
+				summary |= static_cast<u64>(lower[j] != 0) << (j & 63);
+
+			upper[i] = summary;
+		}
+	}
+}
+
+// Returns the closest slot at or before `slot` that begins an allocation, or
+// `UINT64_MAX` if there is none. This ascends the summaries of
+// `begin_bitmap` until one of them has a set bit at or before the one
+// covering `slot` in the same qword, and then descends along the highest set
+// bits, touching at most two qwords per level.
+static u64 comp_heap_find_begin_slot(const CoreData* core, u64 slot) noexcept
+{
+	u64 index = slot;
+
+	u32 level = 0;
+
+	u64 curr;
+
+	while (true)
+	{
+		const u64* const bitmap = comp_heap_begin_level(core, level);
+
+		curr = bitmap[index >> 6] & ((~static_cast<u64>(0)) >> (63 - (index & 63)));
+
+		if (curr != 0)
+			break;
+
+		u64 i = index >> 6;
+
+		if (i == 0)
+			return UINT64_MAX;
+
+		if (level != COMP_HEAP_BEGIN_SUMMARY_LEVEL_COUNT)
+		{
+			// Continue with the bits for all preceding qwords.
+			index = i - 1;
+
+			level += 1;
+
+			continue;
+		}
+
+		// The top level spans at most a few qwords, so just search it.
+		do
+		{
+			if (i == 0)
+				return UINT64_MAX;
+
+			i -= 1;
+
+			curr = bitmap[i];
+		}
+		while (curr == 0);
+
+		index = i * 64;
+
+		break;
+	}
+
+	index = (index & ~static_cast<u64>(63)) + 63 - count_leading_zeros_assume_one(curr);
+
+	while (level != 0)
+	{
+		level -= 1;
+
+		curr = comp_heap_begin_level(core, level)[index];
+
+		ASSERT_OR_IGNORE(curr != 0);
+
+		index = index * 64 + 63 - count_leading_zeros_assume_one(curr);
+	}
+
+	return index;
+}
+
+static Maybe<void*> comp_heap_try_alloc(CoreData* core, u64 size, u64 align, bool needs_header, bool use_freelists) noexcept
+{
+	const u64 header_size = needs_header ? COMP_HEAP_MIN_ALLOCATION_SIZE : 0;
+
+	const u64 allocation_size = size + header_size;
+
+	// Try satisfying allocations with a suitable alignment and size from the
+	// smallest non-empty freelist whose entries are large enough, returning
+	// any excess to the freelists.
+	if (use_freelists && align <= COMP_HEAP_MIN_ALLOCATION_SIZE && allocation_size <= COMP_HEAP_MAX_FREELIST_SIZE)
+	{
+		const u32 index = comp_heap_find_nonempty_freelist(core, comp_heap_size_class_ceil(allocation_size));
+
+		if (index != COMP_HEAP_SIZE_CLASS_COUNT)
+		{
+			byte* const entry_begin = comp_heap_pop_freelist(core, index);
+
+			const u64 entry_size = comp_heap_size_class_bytes(index);
+
+			const u64 used_size = (allocation_size + COMP_HEAP_ZERO_ADDRESS_MASK) & ~COMP_HEAP_ZERO_ADDRESS_MASK;
+
+			if (entry_size != used_size)
+				comp_heap_add_to_freelist(core, MutRange<byte>{ entry_begin + used_size, entry_begin + entry_size });
+
+			comp_heap_set_begin_bit(core, (entry_begin - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE);
+
+			return some<void*>(entry_begin + header_size);
+		}
+	}
+
+	const u64 unaligned_begin = core->heap.used + header_size;
+
+	const u64 aligned_begin = (unaligned_begin + align - 1) & ~(align - 1);
+
+	const u64 new_used = (aligned_begin + size + COMP_HEAP_ZERO_ADDRESS_MASK) & ~COMP_HEAP_ZERO_ADDRESS_MASK;
+
+	if (!comp_heap_ensure_commit(core, new_used))
+		return none<void*>();
+
+	core->heap.used = new_used;
+
+	// If we had to insert padding to achieve the requested alignment, add it
+	// to the relevant freelist. The header, if any, directly precedes the
+	// aligned allocation, so the padding comes before it.
+	if (unaligned_begin != aligned_begin)
+		comp_heap_add_to_freelist(core, MutRange<byte>{ core->heap.memory + unaligned_begin - header_size, core->heap.memory + aligned_begin - header_size });
+
+	byte* const begin = core->heap.memory + aligned_begin;
+
+	comp_heap_set_begin_bit(core, (begin - header_size - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE);
+
+	return some<void*>(begin);
+}
+
+static Maybe<CompHeapAllocationHeader*> comp_heap_find_header(CoreData* core, byte* address) noexcept
+{
+	ASSERT_OR_IGNORE(address > core->heap.memory);
+
+	ASSERT_OR_IGNORE(address < core->heap.memory + core->heap.used);
+
+	const u64 slot_offset = (address - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	const u64 begin_slot = comp_heap_find_begin_slot(core, slot_offset);
+
+	ASSERT_OR_IGNORE(begin_slot != UINT64_MAX);
+
+	if (!comp_heap_test_bitmap_bit(core->heap.header_bitmap, begin_slot))
+		return none<CompHeapAllocationHeader*>();
+
+	return some<>(reinterpret_cast<CompHeapAllocationHeader*>(core->heap.memory + begin_slot * COMP_HEAP_MIN_ALLOCATION_SIZE));
+}
+
+static u64 comp_heap_card_bitmap_qwords(const CoreData* core) noexcept
+{
+	return (core->heap.write_watch.bytes / core->heap.write_watch.granule_bytes + 63) >> 6;
+}
+
+// Write-protects all cards of the old generation, which ends at
+// `nursery_begin`, that are not protected already, and forgets which cards
+// have been written. Cards below `protected_end` are still protected unless
+// they have been written. Memory from `protected_end` onwards was not
+// protected at all, and has thus been considered written.
+// Should protecting fail, the old generation is instead left unprotected, so
+// that minor collections fall back to scanning all of it.
+static void comp_heap_protect_old_generation(CoreData* core) noexcept
+{
+	if (!core->heap.is_write_watched)
+		return;
+
+	const u64 card_bytes = core->heap.write_watch.granule_bytes;
+
+	const u64 old_card_end = core->heap.protected_end / card_bytes;
+
+	const u64 new_card_end = core->heap.nursery_begin / card_bytes;
+
+	ASSERT_OR_IGNORE(old_card_end <= new_card_end);
+
+	const u64* const card_bitmap = core->heap.card_bitmap;
+
+	bool is_ok = true;
+
+	u64 card = 0;
+
+	while (card != new_card_end)
+	{
+		if (card < old_card_end && !comp_heap_test_bitmap_bit(card_bitmap, card))
+		{
+			card += 1;
+
+			continue;
+		}
+
+		const u64 run_begin = card;
+
+		while (card != new_card_end && (card >= old_card_end || comp_heap_test_bitmap_bit(card_bitmap, card)))
+			card += 1;
+
+		if (!minos::write_watch_protect(&core->heap.write_watch, core->heap.memory + run_begin * card_bytes, (card - run_begin) * card_bytes))
+		{
+			is_ok = false;
+
+			break;
+		}
+	}
+
+	memset(core->heap.card_bitmap, 0, comp_heap_card_bitmap_qwords(core) * sizeof(u64));
+
+	if (is_ok)
+	{
+		core->heap.protected_end = new_card_end * card_bytes;
+	}
+	else
+	{
+		// Memory that is still protected keeps having its writes recorded,
+		// which is harmless.
+		(void) minos::write_watch_unprotect(&core->heap.write_watch);
+
+		core->heap.protected_end = 0;
+	}
+}
+
+
+
+// State of a collection in progress.
+// Allocations that have been marked but not yet scanned are kept on a
+// worklist holding the slots of their headers. The worklist lives on the
+// `TempStack`, since the heap itself cannot be allocated from while
+// collecting.
+struct CompHeapGcState
+{
+	// `CoreId` of the heap's first slot.
+	u64 heap_id_begin;
+
+	// Slot before which collectable allocations are not considered for
+	// marking. This is the beginning of the nursery during minor collections,
+	// where old allocations are known to be alive, and `0` otherwise.
+	u64 young_begin_slot;
+
+	u32* worklist;
+
+	u64 worklist_mark;
+
+	u32 worklist_count;
+};
+
+static void comp_heap_gc_mark_collectable(CoreData* core, CompHeapGcState* state, u64 header_slot) noexcept
+{
+	byte* const header_begin = core->heap.memory + header_slot * COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	const CompHeapAllocationHeader* const header = reinterpret_cast<const CompHeapAllocationHeader*>(header_begin);
+
+	if (!comp_heap_gc_mark(core, MutRange<byte>{ header_begin + COMP_HEAP_MIN_ALLOCATION_SIZE, header->size }))
+		return;
+
+	*static_cast<u32*>(temp_stack_alloc(core, sizeof(u32), alignof(u32))) = static_cast<u32>(header_slot);
+
+	state->worklist_count += 1;
+}
+
+// Treats `id` as a potential `CoreId`. Since `CoreId`s are only ever created
+// from the beginning of an allocation, it only counts as a reference if it
+// refers to the slot right after a collectable allocation's header.
+static void comp_heap_gc_consider_id(CoreData* core, CompHeapGcState* state, u32 id) noexcept
+{
+	const u64 header_slot = static_cast<u64>(id) - state->heap_id_begin - 1;
+
+	if (header_slot >= core->heap.used / COMP_HEAP_MIN_ALLOCATION_SIZE || header_slot < state->young_begin_slot)
+		return;
+
+	if (!comp_heap_test_bitmap_bit(core->heap.collectable_bitmap, header_slot))
+		return;
+
+	comp_heap_gc_mark_collectable(core, state, header_slot);
+}
+
+// Treats `address` as a potential pointer. Unlike `CoreId`s, pointers may
+// refer to any byte of a collectable allocation, so the allocation is found
+// via the closest preceding allocation beginning.
+static void comp_heap_gc_consider_address(CoreData* core, CompHeapGcState* state, u64 address) noexcept
+{
+	const u64 offset = address - reinterpret_cast<u64>(core->heap.memory);
+
+	if (offset >= core->heap.used)
+		return;
+
+	const u64 slot = offset / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	if (slot < state->young_begin_slot)
+		return;
+
+	const u64 header_slot = comp_heap_find_begin_slot(core, slot);
+
+	// The first slot is reserved, so there might not be any allocation
+	// beginning before `address`.
+	if (header_slot == UINT64_MAX)
+		return;
+
+	if (header_slot < state->young_begin_slot || !comp_heap_test_bitmap_bit(core->heap.collectable_bitmap, header_slot))
+		return;
+
+	const CompHeapAllocationHeader* const header = reinterpret_cast<const CompHeapAllocationHeader*>(core->heap.memory + header_slot * COMP_HEAP_MIN_ALLOCATION_SIZE);
+
+	// `address` might be in free memory following the allocation.
+	if (offset >= (header_slot + 1) * COMP_HEAP_MIN_ALLOCATION_SIZE + header->size)
+		return;
+
+	comp_heap_gc_mark_collectable(core, state, header_slot);
+}
+
+// Conservatively scans the 8-byte aligned memory from `begin` to `end` for
+// references to collectable allocations, considering every aligned `u32` a
+// potential `CoreId` and every aligned `u64` a potential pointer.
+// This also scans the native stack, so it must not be instrumented by
+// AddressSanitizer, which would otherwise report the redzones between stack
+// frames.
+GC_NO_SANITIZE_ADDRESS static void comp_heap_gc_scan(CoreData* core, CompHeapGcState* state, const byte* begin, const byte* end) noexcept
+{
+	ASSERT_OR_IGNORE((reinterpret_cast<u64>(begin) & 7) == 0 && (reinterpret_cast<u64>(end) & 7) == 0);
+
+	for (const u64* curr = reinterpret_cast<const u64*>(begin); curr != reinterpret_cast<const u64*>(end); ++curr)
+	{
+		const u64 value = *curr;
+
+		comp_heap_gc_consider_id(core, state, static_cast<u32>(value));
+
+		comp_heap_gc_consider_id(core, state, static_cast<u32>(value >> 32));
+
+		comp_heap_gc_consider_address(core, state, value);
+	}
+}
+
+// Scans the allocations on the worklist until it is empty.
+static void comp_heap_gc_trace(CoreData* core, CompHeapGcState* state) noexcept
+{
+	while (state->worklist_count != 0)
+	{
+		state->worklist_count -= 1;
+
+		const u64 header_slot = state->worklist[state->worklist_count];
+
+		temp_stack_release(core, state->worklist_mark + state->worklist_count * sizeof(u32));
+
+		const byte* const begin = core->heap.memory + (header_slot + 1) * COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+		const u64 size = reinterpret_cast<const CompHeapAllocationHeader*>(begin - COMP_HEAP_MIN_ALLOCATION_SIZE)->size;
+
+		// Round up to include a trailing `u32` in allocations whose size is
+		// not a multiple of 8. The rest of the slot is still ours to read.
+		comp_heap_gc_scan(core, state, begin, begin + ((size + 7) & ~static_cast<u64>(7)));
+	}
+}
+
+// Scans all heap memory that is alive regardless of being referenced, that
+// is, everything except for free memory and collectable allocations.
+static void comp_heap_gc_scan_pinned(CoreData* core, CompHeapGcState* state) noexcept
+{
+	const u64* const gc_bitmap = core->heap.gc_bitmap;
+
+	const u64 end_slot = core->heap.used / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	u64 slot = 0;
+
+	while (true)
+	{
+		// The `1` sentinel bit at the bitmap's end stops the search.
+		const u64 run_begin = comp_heap_find_set_bit(gc_bitmap, slot);
+
+		if (run_begin >= end_slot)
+			break;
+
+		// The `0` sentinel bit right after the bitmap's end stops the search,
+		// leaving the run one slot too long if it reaches the sentinels.
+		slot = comp_heap_find_clear_bit(gc_bitmap, run_begin);
+
+		if (slot > end_slot)
+			slot = end_slot;
+
+		comp_heap_gc_scan(core, state, core->heap.memory + run_begin * COMP_HEAP_MIN_ALLOCATION_SIZE, core->heap.memory + slot * COMP_HEAP_MIN_ALLOCATION_SIZE);
+
+		comp_heap_gc_trace(core, state);
+	}
+}
+
+static void comp_heap_gc_scan_excluding(CoreData* core, CompHeapGcState* state, const byte* begin, const byte* end, Range<Range<byte>> excluded) noexcept
+{
+	if (excluded.count() == 0)
+	{
+		comp_heap_gc_scan(core, state, begin, end);
+
+		comp_heap_gc_trace(core, state);
+
+		return;
+	}
+
+	const Range<byte> first = excluded[0];
+
+	const Range<Range<byte>> rest = excluded.subrange(1);
+
+	if (first.end() <= begin || first.begin() >= end)
+	{
+		comp_heap_gc_scan_excluding(core, state, begin, end, rest);
+
+		return;
+	}
+
+	if (begin < first.begin())
+		comp_heap_gc_scan_excluding(core, state, begin, first.begin(), rest);
+
+	if (first.end() < end)
+		comp_heap_gc_scan_excluding(core, state, first.end(), end, rest);
+}
+
+static void comp_heap_gc_scan_committed(CoreData* core, CompHeapGcState* state, byte* begin, byte* end, Range<Range<byte>> excluded) noexcept
 {
-	TypeId type_id;
+	if (begin == end)
+		return;
 
-	u64 size;
-};
+	MutRange<byte> committed[COMP_HEAP_GC_MAX_ROOT_RANGE_COUNT];
 
+	u32 committed_count;
 
+	if (!minos::mem_query_committed(begin, end - begin, MutRange{ committed }, &committed_count))
+		panic("Could not query committed memory for compile-time heap garbage collection (0x%[|X]).\n", minos::last_error());
 
-static void comp_heap_add_to_freelist(CoreData* core, MutRange<byte> memory) noexcept
+	for (u32 i = 0; i != committed_count; ++i)
+		comp_heap_gc_scan_excluding(core, state, committed[i].begin(), committed[i].end(), excluded);
+}
+
+// Scans all committed memory of `core` outside of the heap. This covers the
+// interpreter's stacks, scopes and closures, as well as all other state
+// that might refer to heap memory.
+static void comp_heap_gc_scan_core(CoreData* core, CompHeapGcState* state) noexcept
 {
-	ASSERT_OR_IGNORE(memory.begin() >= core->heap.memory);
+	const u64 bitmap_size = reinterpret_cast<byte*>(core->heap.begin_bitmap) - reinterpret_cast<byte*>(core->heap.leak_bitmap);
 
-	ASSERT_OR_IGNORE(memory.end() <= core->heap.memory + core->heap.used);
+	const byte* const bitmaps_end = reinterpret_cast<const byte*>(core->heap.begin_summaries[0]) + calc_begin_summary_reserve(minos::page_bytes(), bitmap_size);
 
-	ASSERT_OR_IGNORE((reinterpret_cast<u64>(memory.begin()) & COMP_HEAP_ZERO_ADDRESS_MASK) == 0);
+	// Its bitmaps do not hold any references. Neither do the keys of the
+	// shadow store's address entries, as shadow data must not keep the
+	// addresses it is attached to alive.
+	const Range<byte> excluded[] = {
+		Range<byte>{ reinterpret_cast<byte*>(core->heap.leak_bitmap), bitmaps_end },
+		shadow_address_entry_memory(core),
+	};
 
-	u64 size = memory.count();
+	byte* const core_begin = reinterpret_cast<byte*>(core);
+
+	// The heap itself is scanned separately. Rather than being excluded, it
+	// is not queried at all, since its write protection splits it into more
+	// separately committed ranges than can be reported.
+	comp_heap_gc_scan_committed(core, state, core_begin, core->heap.memory, Range{ excluded });
 
-	u64 mask = COMP_HEAP_MIN_ALLOCATION_SIZE;
+	comp_heap_gc_scan_committed(core, state, core->heap.memory + core->heap.reserve, core_begin + core->allocation_size, Range{ excluded });
+}
 
-	u8 index = 0;
+// Scans the native stack above the caller's frame. This must not be inlined
+// into `comp_heap_gc_scan_registers_and_stack`, as the registers spilled
+// there would otherwise end up below `stack_top`.
+GC_NOINLINE static void comp_heap_gc_scan_stack(CoreData* core, CompHeapGcState* state) noexcept
+{
+	MutRange<byte> stack;
 
-	byte* curr = memory.begin();
+	if (!minos::thread_stack_bounds(&stack))
+		panic("Could not get stack bounds for compile-time heap garbage collection (0x%[|X]).\n", minos::last_error());
 
-	ASSERT_OR_IGNORE(size >= mask);
+	const byte* const stack_top = reinterpret_cast<const byte*>(reinterpret_cast<u64>(&stack) & ~static_cast<u64>(7));
 
-	while (size != 0 && index != array_count(core->heap.freelists))
-	{
-		if ((size & mask) != 0)
-		{
-			*reinterpret_cast<u32*>(curr) = core->heap.freelists[index];
+	comp_heap_gc_scan(core, state, stack_top, reinterpret_cast<const byte*>(reinterpret_cast<u64>(stack.end()) & ~static_cast<u64>(7)));
 
-			core->heap.freelists[index] = static_cast<u32>((curr - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE);
+	comp_heap_gc_trace(core, state);
+}
 
-			curr += mask;
+// Scans the native stack, including references that only live in
+// callee-saved registers. These are spilled to the stack first.
+GC_NOINLINE static void comp_heap_gc_scan_registers_and_stack(CoreData* core, CompHeapGcState* state) noexcept
+{
+	#if COMPILER_MSVC
+		jmp_buf registers;
 
-			size -= mask;
-		}
+		(void) setjmp(registers);
+	#else
+		__builtin_unwind_init();
+	#endif
 
-		mask <<= 1;
+	comp_heap_gc_scan_stack(core, state);
+}
 
-		index += 1;
-	}
+// Collects garbage. If `clear_shadows` is `false`, the shadow store is left
+// untouched, and unreachable allocations that still have shadow data are kept
+// alive instead of being freed. This allows collecting from inside the shadow
+// store.
+static void comp_heap_collect_internal(CoreData* core, bool clear_shadows) noexcept
+{
+	// Freeing memory writes freelist entries into it, and shrinking the heap
+	// decommits it, neither of which works on protected memory.
+	comp_heap_unprotect(core);
 
-	while (size != 0)
+	comp_heap_gc_begin(core);
+
+	const u64 temp_mark = temp_stack_mark(core);
+
+	CompHeapGcState state;
+	state.heap_id_begin = static_cast<u64>(core->heap.memory - reinterpret_cast<byte*>(core)) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+	state.young_begin_slot = 0;
+	state.worklist = static_cast<u32*>(temp_stack_alloc(core, 0, alignof(u32)));
+	state.worklist_mark = temp_stack_mark(core);
+	state.worklist_count = 0;
+
+	comp_heap_gc_scan_pinned(core, &state);
+
+	comp_heap_gc_scan_core(core, &state);
+
+	comp_heap_gc_scan_registers_and_stack(core, &state);
+
+	const u64 bitmap_qwords = (core->heap.used / COMP_HEAP_MIN_ALLOCATION_SIZE + 63) >> 6;
+
+	const u64* const collectable_bitmap = core->heap.collectable_bitmap;
+
+	const u64* const gc_bitmap = core->heap.gc_bitmap;
+
+	if (!clear_shadows)
 	{
-		ASSERT_OR_IGNORE(size >= COMP_HEAP_MAX_FREELIST_SIZE);
+		for (u64 i = 0; i != bitmap_qwords; ++i)
+		{
+			u64 unmarked = collectable_bitmap[i] & ~gc_bitmap[i];
+
+			while (unmarked != 0)
+			{
+				const u64 header_slot = i * 64 + count_trailing_zeros_assume_one(unmarked);
+
+				unmarked &= unmarked - 1;
 
-		*reinterpret_cast<u32*>(curr) = core->heap.freelists[array_count(core->heap.freelists) - 1]; 
-		
-		core->heap.freelists[array_count(core->heap.freelists) - 1] = static_cast<u32>((curr - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE);
+				// Tracing a previous allocation might have marked this one.
+				if (comp_heap_test_bitmap_bit(gc_bitmap, header_slot))
+					continue;
 
-		size -= COMP_HEAP_MAX_FREELIST_SIZE;
+				byte* const begin = core->heap.memory + (header_slot + 1) * COMP_HEAP_MIN_ALLOCATION_SIZE;
 
-		curr += COMP_HEAP_MAX_FREELIST_SIZE;
+				const u64 size = reinterpret_cast<const CompHeapAllocationHeader*>(begin - COMP_HEAP_MIN_ALLOCATION_SIZE)->size;
+
+				// The shadow store treats the end of a range as part of it, so
+				// exclude it to avoid hitting an adjacent allocation.
+				if (!shadow_contains(core, MutRange<byte>{ begin, size - 1 }))
+					continue;
+
+				comp_heap_gc_mark_collectable(core, &state, header_slot);
+
+				comp_heap_gc_trace(core, &state);
+			}
+		}
 	}
-}
 
-static bool comp_heap_ensure_commit(CoreData* core, u64 required) noexcept
-{
-	if (required <= core->heap.commit)
-		return true;
+	u64 collected_bytes = 0;
 
-	if (required > core->heap.reserve)
-		return false;
+	for (u64 i = 0; i != bitmap_qwords; ++i)
+	{
+		u64 unmarked = collectable_bitmap[i] & ~gc_bitmap[i];
 
-	const u64 old_commit = core->heap.commit;
+		while (unmarked != 0)
+		{
+			const u64 header_slot = i * 64 + count_trailing_zeros_assume_one(unmarked);
 
-	const u64 new_commit = (required + core->heap.commit_increment - 1) & ~(core->heap.commit_increment - 1);
+			unmarked &= unmarked - 1;
 
-	ASSERT_OR_IGNORE(new_commit <= core->heap.reserve);
+			byte* const begin = core->heap.memory + (header_slot + 1) * COMP_HEAP_MIN_ALLOCATION_SIZE;
 
-	const u64 commit_difference = new_commit - old_commit;
+			const u64 size = reinterpret_cast<const CompHeapAllocationHeader*>(begin - COMP_HEAP_MIN_ALLOCATION_SIZE)->size;
 
-	if (!minos::mem_commit(core->heap.memory + old_commit, commit_difference))
-		return false;
+			if (clear_shadows)
+				shadow_clear(core, MutRange<byte>{ begin, size - 1 });
 
-	const u64 old_bitmap_commit = old_commit / BYTES_PER_BITMAP_BYTE;
+			collected_bytes += size;
+		}
+	}
 
-	const u64 new_bitmap_commit = new_commit / BYTES_PER_BITMAP_BYTE;
+	temp_stack_release(core, temp_mark);
 
-	ASSERT_OR_IGNORE(new_bitmap_commit != old_bitmap_commit);
+	comp_heap_gc_end(core);
 
-	if (!minos::mem_commit(reinterpret_cast<byte*>(core->heap.leak_bitmap) + old_bitmap_commit, new_bitmap_commit - old_bitmap_commit))
-		return false;
+	// All survivors are now part of the old generation.
+	core->heap.nursery_begin = core->heap.used;
 
-	if (!minos::mem_commit(reinterpret_cast<byte*>(core->heap.begin_bitmap) + old_bitmap_commit, new_bitmap_commit - old_bitmap_commit))
-		return false;
+	core->heap.nursery_allocated = 0;
 
-	if (!minos::mem_commit(reinterpret_cast<byte*>(core->heap.header_bitmap) + old_bitmap_commit, new_bitmap_commit - old_bitmap_commit))
-		return false;
+	core->heap.promoted = 0;
 
-	core->heap.commit = new_commit;
+	comp_heap_protect_old_generation(core);
 
-	return true;
+	instrumentation_count_heap_gc(core, false, collected_bytes);
 }
 
-static void comp_heap_mark_bitmap_bits(CoreData* core, u64* bitmap, MutRange<byte> memory) noexcept
+// Collects garbage in the young generation only. Surviving allocations are
+// promoted to the old generation in place, as conservatively found
+// references do not allow moving them.
+// Old allocations are assumed to be alive. Of the old generation's memory,
+// only the cards written since the last collection are scanned for
+// references to young allocations, since these are the only ones that can
+// hold such references.
+static void comp_heap_collect_young(CoreData* core) noexcept
 {
-	const u64 begin = (memory.begin() - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+	instrumentation_enter_phase(core, InstrumentationPhase::GC);
 
-	const u64 end = (memory.end() + COMP_HEAP_ZERO_ADDRESS_MASK - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+	const u64 gc_bitmap_commit = calc_gc_bitmap_commit(core->heap.used, minos::page_bytes());
 
-	for (u64 i = begin; i != end; ++i)
-		bitmap[i >> 6] |= static_cast<u64>(1) << (i & 63);
-}
+	if (!minos::mem_commit(core->heap.gc_bitmap, gc_bitmap_commit))
+		panic("Could not allocate % bytes for compile-time heap GC bitmap (0x%[|X]).\n", gc_bitmap_commit, minos::last_error());
 
-static void comp_heap_mark_bitmap_bit(CoreData* core, u64* bitmap, byte* memory) noexcept
-{
-	const u64 byte_offset = memory - core->heap.memory;
+	const u64 young_begin_slot = core->heap.nursery_begin / COMP_HEAP_MIN_ALLOCATION_SIZE;
 
-	const u64 slot_offset = byte_offset / COMP_HEAP_MIN_ALLOCATION_SIZE;
+	const u64 end_slot = core->heap.used / COMP_HEAP_MIN_ALLOCATION_SIZE;
 
-	ASSERT_OR_IGNORE((bitmap[slot_offset >> 6] & (static_cast<u64>(1) << (slot_offset & 63))) == 0);
+	const u64 young_begin_qword = young_begin_slot >> 6;
 
-	bitmap[slot_offset >> 6] |= static_cast<u64>(1) << (slot_offset & 63);
-}
+	const u64 end_qword = (end_slot + 63) >> 6;
 
-static Maybe<void*> comp_heap_alloc_internal(CoreData* core, u64 size, u64 align, bool needs_header) noexcept
-{
-	ASSERT_OR_IGNORE(align != 0 && is_pow2(align));
+	// Only marks of young allocations are ever looked at, so only clear
+	// those. Decommitted memory may retain its previous contents.
+	memset(core->heap.gc_bitmap + young_begin_qword, 0, (end_qword - young_begin_qword) * sizeof(u64));
 
-	if (size == 0 && !needs_header)
-		size = 1;
+	const u64 temp_mark = temp_stack_mark(core);
 
-	const u64 header_size = needs_header ? COMP_HEAP_MIN_ALLOCATION_SIZE : 0;
+	CompHeapGcState state;
+	state.heap_id_begin = static_cast<u64>(core->heap.memory - reinterpret_cast<byte*>(core)) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+	state.young_begin_slot = young_begin_slot;
+	state.worklist = static_cast<u32*>(temp_stack_alloc(core, 0, alignof(u32)));
+	state.worklist_mark = temp_stack_mark(core);
+	state.worklist_count = 0;
 
-	const u64 allocation_size = size + header_size;
+	u64* const collectable_bitmap = core->heap.collectable_bitmap;
 
-	// Try satisfying allocations with a suitable alignment and size from the
-	// relevant freelist.
-	if (align <= COMP_HEAP_MIN_ALLOCATION_SIZE && size + header_size <= COMP_HEAP_MAX_FREELIST_SIZE_LOG2)
-	{
-		const u8 size_log2_ceil = log2_ceil(allocation_size);
+	const u64 young_begin_mask = ~static_cast<u64>(0) << (young_begin_slot & 63);
 
-		const u8 index = size_log2_ceil < COMP_HEAP_MIN_ALLOCATION_SIZE_LOG2
-			? 0
-			: size_log2_ceil - COMP_HEAP_MIN_ALLOCATION_SIZE_LOG2;
+	// Young memory between collectable allocations holds other allocations
+	// made since the last collection, which may refer to young ones.
 
-		u32 const head = core->heap.freelists[index];
+	u64 gap_begin = young_begin_slot;
 
-		if (head != 0)
-		{
-			byte* const entry_begin = core->heap.memory + head * COMP_HEAP_MIN_ALLOCATION_SIZE;
+	for (u64 i = young_begin_qword; i != end_qword; ++i)
+	{
+		u64 collectable = i == young_begin_qword ? collectable_bitmap[i] & young_begin_mask : collectable_bitmap[i];
 
-			core->heap.freelists[index] = *reinterpret_cast<u32*>(entry_begin);
+		while (collectable != 0)
+		{
+			const u64 header_slot = i * 64 + count_trailing_zeros_assume_one(collectable);
 
-			const u64 entry_size = static_cast<u64>(1) << size_log2_ceil;
+			collectable &= collectable - 1;
 
-			if (entry_size - allocation_size >= COMP_HEAP_MIN_ALLOCATION_SIZE)
-				comp_heap_add_to_freelist(core, MutRange<byte>{ entry_begin + allocation_size, entry_begin + entry_size });
+			if (header_slot != gap_begin)
+				comp_heap_gc_scan(core, &state, core->heap.memory + gap_begin * COMP_HEAP_MIN_ALLOCATION_SIZE, core->heap.memory + header_slot * COMP_HEAP_MIN_ALLOCATION_SIZE);
 
-			comp_heap_mark_bitmap_bit(core, core->heap.begin_bitmap, entry_begin);
+			const u64 size = reinterpret_cast<const CompHeapAllocationHeader*>(core->heap.memory + header_slot * COMP_HEAP_MIN_ALLOCATION_SIZE)->size;
 
-			return some<void*>(entry_begin + header_size);
+			gap_begin = header_slot + 1 + (size + COMP_HEAP_ZERO_ADDRESS_MASK) / COMP_HEAP_MIN_ALLOCATION_SIZE;
 		}
 	}
 
-	const u64 unaligned_begin = core->heap.used + header_size;
+	comp_heap_gc_scan(core, &state, core->heap.memory + gap_begin * COMP_HEAP_MIN_ALLOCATION_SIZE, core->heap.memory + end_slot * COMP_HEAP_MIN_ALLOCATION_SIZE);
 
-	const u64 aligned_begin = (unaligned_begin + align - 1) & ~(align - 1);
+	comp_heap_gc_trace(core, &state);
 
-	const u64 new_used = (aligned_begin + size + COMP_HEAP_ZERO_ADDRESS_MASK) & ~COMP_HEAP_ZERO_ADDRESS_MASK;
+	// Scan the old generation's written cards, as well as its unprotected
+	// remainder.
 
-	if (!comp_heap_ensure_commit(core, new_used))
-		return none<void*>();
+	const u64 card_bytes = core->heap.write_watch.granule_bytes;
 
-	core->heap.used = new_used;
+	const u64 protected_end = core->heap.protected_end;
 
-	// If we had to insert padding to achieve the requested alignment, add it
-	// to the relevant freelist.
-	if (unaligned_begin != aligned_begin)
-		comp_heap_add_to_freelist(core, MutRange<byte>{ core->heap.memory + unaligned_begin, core->heap.memory + aligned_begin });
+	for (u64 card = 0; card != protected_end / card_bytes; ++card)
+	{
+		if (!comp_heap_test_bitmap_bit(core->heap.card_bitmap, card))
+			continue;
 
-	byte* const begin = core->heap.memory + aligned_begin;
+		comp_heap_gc_scan(core, &state, core->heap.memory + card * card_bytes, core->heap.memory + (card + 1) * card_bytes);
 
-	comp_heap_mark_bitmap_bit(core, core->heap.begin_bitmap, begin - header_size);
+		comp_heap_gc_trace(core, &state);
+	}
 
-	return some<void*>(begin);
-}
+	comp_heap_gc_scan(core, &state, core->heap.memory + protected_end, core->heap.memory + core->heap.nursery_begin);
 
-static Maybe<CompHeapAllocationHeader*> comp_heap_find_header(CoreData* core, byte* address) noexcept
-{
-	ASSERT_OR_IGNORE(address > core->heap.memory);
+	comp_heap_gc_trace(core, &state);
 
-	ASSERT_OR_IGNORE(address < core->heap.memory + core->heap.used);
+	comp_heap_gc_scan_core(core, &state);
 
-	const u64 slot_offset = (address - core->heap.memory) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+	comp_heap_gc_scan_registers_and_stack(core, &state);
 
-	const u64* const begin_bitmap = core->heap.begin_bitmap;
+	// Free unmarked young allocations, coalescing adjacent ones. A free run
+	// at the very end is instead returned by shrinking the used memory.
 
-	const u64 lower_slots_mask = (~static_cast<u64>(0)) >> (63 - (slot_offset & 63));
+	const u64* const gc_bitmap = core->heap.gc_bitmap;
 
-	u64 i = slot_offset >> 6;
+	u64 collected_bytes = 0;
 
-	u64 curr = begin_bitmap[i] & lower_slots_mask;
+	u64 promoted_bytes = 0;
 
-	while (curr == 0)
+	u64 free_begin = 0;
+
+	u64 free_end = 0;
+
+	for (u64 i = young_begin_qword; i != end_qword; ++i)
 	{
-		ASSERT_OR_IGNORE(i != 0);
+		u64 collectable = i == young_begin_qword ? collectable_bitmap[i] & young_begin_mask : collectable_bitmap[i];
+
+		while (collectable != 0)
+		{
+			const u64 header_slot = i * 64 + count_trailing_zeros_assume_one(collectable);
+
+			collectable &= collectable - 1;
+
+			byte* const begin = core->heap.memory + (header_slot + 1) * COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+			const u64 size = reinterpret_cast<const CompHeapAllocationHeader*>(begin - COMP_HEAP_MIN_ALLOCATION_SIZE)->size;
+
+			if (comp_heap_test_bitmap_bit(gc_bitmap, header_slot))
+			{
+				promoted_bytes += size;
+
+				continue;
+			}
+
+			shadow_clear(core, MutRange<byte>{ begin, size - 1 });
+
+			comp_heap_clear_begin_bit(core, header_slot);
 
-		i -= 1;
+			collectable_bitmap[header_slot >> 6] &= ~(static_cast<u64>(1) << (header_slot & 63));
 
-		curr = begin_bitmap[i];
+			collected_bytes += size;
+
+			if (header_slot != free_end)
+			{
+				if (free_begin != free_end)
+					comp_heap_add_to_freelist(core, MutRange<byte>{ core->heap.memory + free_begin * COMP_HEAP_MIN_ALLOCATION_SIZE, core->heap.memory + free_end * COMP_HEAP_MIN_ALLOCATION_SIZE });
+
+				free_begin = header_slot;
+			}
+
+			free_end = header_slot + 1 + (size + COMP_HEAP_ZERO_ADDRESS_MASK) / COMP_HEAP_MIN_ALLOCATION_SIZE;
+		}
 	}
 
-	const u8 offset_in_qword = 63 - count_leading_zeros_assume_one(curr);
+	if (free_end == end_slot)
+		core->heap.used = free_begin * COMP_HEAP_MIN_ALLOCATION_SIZE;
+	else if (free_begin != free_end)
+		comp_heap_add_to_freelist(core, MutRange<byte>{ core->heap.memory + free_begin * COMP_HEAP_MIN_ALLOCATION_SIZE, core->heap.memory + free_end * COMP_HEAP_MIN_ALLOCATION_SIZE });
 
-	if ((core->heap.header_bitmap[i] & (static_cast<u64>(1) << offset_in_qword)) == 0)
-		return none<CompHeapAllocationHeader*>();
+	temp_stack_release(core, temp_mark);
 
-	const u64 begin_byte_offset = i * BYTES_PER_BITMAP_BYTE * sizeof(u64) + offset_in_qword * COMP_HEAP_MIN_ALLOCATION_SIZE;
+	minos::mem_decommit(core->heap.gc_bitmap, gc_bitmap_commit);
 
-	return some<>(reinterpret_cast<CompHeapAllocationHeader*>(core->heap.memory + begin_byte_offset));
-}
+	// All survivors are now part of the old generation.
+	core->heap.nursery_begin = core->heap.used;
 
+	core->heap.nursery_allocated = 0;
 
+	core->heap.promoted += promoted_bytes;
 
-static u64 calc_commit_increment(const Config* config, u64 page_size) noexcept
-{
-	const u64 min_size = page_size * BYTES_PER_BITMAP_BYTE;
+	comp_heap_protect_old_generation(core);
 
-	return config->heap.commit_increment < min_size
-		? min_size
-		: next_pow2(config->heap.commit_increment);
+	instrumentation_leave_phase(core);
+
+	instrumentation_count_heap_gc(core, true, collected_bytes);
 }
 
-static u64 calc_bitmap_reserve(u64 page_size, u64 heap_size) noexcept
+static Maybe<void*> comp_heap_alloc_internal(CoreData* core, u64 size, u64 align, bool needs_header, bool use_freelists) noexcept
 {
-	const u64 page_mask = page_size - 1;
+	ASSERT_OR_IGNORE(align != 0 && is_pow2(align));
 
-	return (heap_size / BYTES_PER_BITMAP_BYTE + page_mask) & ~page_mask;
-}
+	instrumentation_count_heap_alloc(core, size);
 
-static u64 calc_memory_reserve(const Config* config, u64 commit_increment) noexcept
-{
-	const u64 commit_increment_mask = commit_increment - 1;
+	if (size == 0 && !needs_header)
+		size = 1;
 
-	return (config->heap.reserve + commit_increment_mask) & ~commit_increment_mask;
+	const Maybe<void*> allocation = comp_heap_try_alloc(core, size, align, needs_header, use_freelists);
+
+	if (is_some(allocation))
+		return allocation;
+
+	// We ran out of memory, so try again after collecting garbage. As we might
+	// be inside the shadow store, leave its entries alone.
+	comp_heap_collect_internal(core, false);
+
+	return comp_heap_try_alloc(core, size, align, needs_header, use_freelists);
 }
 
 
@@ -274,11 +1298,15 @@ MemoryRequirements comp_heap_memory_requirements(const Config* config) noexcept
 
 	const u64 bitmap_size = calc_bitmap_reserve(page_size, heap_size);
 
+	const u64 card_bitmap_size = calc_card_bitmap_reserve(page_size, heap_size);
+
+	const u64 begin_summary_size = calc_begin_summary_reserve(page_size, bitmap_size);
+
 	MemoryRequirements reqs{};
 	reqs.count = 2;
 	reqs.ranges[0].size = heap_size;
 	reqs.ranges[0].max_offset = static_cast<u64>(UINT32_MAX) * COMP_HEAP_MIN_ALLOCATION_SIZE;
-	reqs.ranges[1].size = 4 * bitmap_size + page_size; // Overallocate a page for gc bitmap end sentinels.
+	reqs.ranges[1].size = 5 * bitmap_size + page_size + card_bitmap_size + begin_summary_size; // Overallocate a page for gc bitmap end sentinels.
 	reqs.ranges[1].max_offset = UINT64_MAX;
 
 	return reqs;
@@ -296,7 +1324,13 @@ void comp_heap_init(CoreData* core, MemoryAllocation allocation) noexcept
 
 	const u64 bitmap_size = calc_bitmap_reserve(page_size, heap_size);
 
-	ASSERT_OR_IGNORE(allocation.ranges[1].count() == 4 * bitmap_size + page_size);
+	const u64 card_bitmap_size = calc_card_bitmap_reserve(page_size, heap_size);
+
+	const u64 begin_summary_size = calc_begin_summary_reserve(page_size, bitmap_size);
+
+	ASSERT_OR_IGNORE(allocation.ranges[1].count() == 5 * bitmap_size + page_size + card_bitmap_size + begin_summary_size);
+
+	ASSERT_OR_IGNORE((reinterpret_cast<u64>(allocation.ranges[0].begin()) & (page_size - 1)) == 0);
 
 	const u64 bitmap_commit = commit_increment / BYTES_PER_BITMAP_BYTE;
 
@@ -312,6 +1346,17 @@ void comp_heap_init(CoreData* core, MemoryAllocation allocation) noexcept
 	if (!minos::mem_commit(allocation.ranges[1].begin() + 2 * bitmap_size, bitmap_commit))
 		panic("Could not commit % bytes of memory for compile-time heap header bitmap (0x%[|X]).\n", bitmap_commit, minos::last_error());
 
+	if (!minos::mem_commit(allocation.ranges[1].begin() + 4 * bitmap_size, bitmap_commit))
+		panic("Could not commit % bytes of memory for compile-time heap collectable bitmap (0x%[|X]).\n", bitmap_commit, minos::last_error());
+
+	if (!minos::mem_commit(allocation.ranges[1].begin() + 5 * bitmap_size + page_size, card_bitmap_size))
+		panic("Could not commit % bytes of memory for compile-time heap card bitmap (0x%[|X]).\n", card_bitmap_size, minos::last_error());
+
+	byte* const begin_summaries = allocation.ranges[1].begin() + 5 * bitmap_size + page_size + card_bitmap_size;
+
+	if (!minos::mem_commit(begin_summaries, begin_summary_size))
+		panic("Could not commit % bytes of memory for compile-time heap allocation begin summaries (0x%[|X]).\n", begin_summary_size, minos::last_error());
+
 	core->heap.memory = allocation.ranges[0].begin();
 	core->heap.used = COMP_HEAP_MIN_ALLOCATION_SIZE; // Reserve the slot as a pseudo-null value for indices.
 	core->heap.commit = commit_increment;
@@ -321,22 +1366,105 @@ void comp_heap_init(CoreData* core, MemoryAllocation allocation) noexcept
 	core->heap.begin_bitmap = reinterpret_cast<u64*>(allocation.ranges[1].begin() + bitmap_size);
 	core->heap.header_bitmap = reinterpret_cast<u64*>(allocation.ranges[1].begin() + 2 * bitmap_size);
 	core->heap.gc_bitmap = reinterpret_cast<u64*>(allocation.ranges[1].begin() + 3 * bitmap_size);
+	core->heap.collectable_bitmap = reinterpret_cast<u64*>(allocation.ranges[1].begin() + 4 * bitmap_size);
+
+	u64* begin_summary = reinterpret_cast<u64*>(begin_summaries);
+
+	for (u32 level = 1; level <= COMP_HEAP_BEGIN_SUMMARY_LEVEL_COUNT; ++level)
+	{
+		core->heap.begin_summaries[level - 1] = begin_summary;
+
+		begin_summary += calc_begin_summary_qwords(bitmap_size, level);
+	}
+
+	core->heap.nursery_begin = core->heap.used;
+	core->heap.nursery_size = core->config->heap.nursery_size;
+	core->heap.nursery_allocated = 0;
+	core->heap.full_gc_threshold = core->config->heap.full_gc_threshold;
+	core->heap.promoted = 0;
+	core->heap.protected_end = 0;
+	core->heap.write_watch.begin = allocation.ranges[0].begin();
+	core->heap.write_watch.bytes = heap_size;
+	core->heap.write_watch.granule_bytes = calc_card_size(page_size);
+	core->heap.write_watch.dirty_bitmap = reinterpret_cast<u64*>(allocation.ranges[1].begin() + 5 * bitmap_size + page_size);
+	core->heap.write_watch.protected_bytes = 0;
+	core->heap.card_bitmap = core->heap.write_watch.dirty_bitmap;
+
+	// Without a write watch, minor collections have to scan the entire old
+	// generation, but still work.
+	core->heap.is_write_watched = minos::write_watch_register(&core->heap.write_watch);
 
 	memset(core->heap.freelists, 0, sizeof(core->heap.freelists));
+
+	memset(core->heap.nonempty_freelists, 0, sizeof(core->heap.nonempty_freelists));
+}
+
+void comp_heap_release(CoreData* core) noexcept
+{
+	if (core->heap.is_write_watched)
+		minos::write_watch_unregister(&core->heap.write_watch);
+}
+
+void comp_heap_restore(CoreData* core) noexcept
+{
+	// Snapshots are only taken after `comp_heap_unprotect`, and the watch is
+	// not registered in this process yet.
+	ASSERT_OR_IGNORE(core->heap.write_watch.protected_bytes == 0 && core->heap.protected_end == 0);
+
+	core->heap.is_write_watched = minos::write_watch_register(&core->heap.write_watch);
 }
 
 
 
 Maybe<void*> comp_heap_alloc(CoreData* core, u64 size, u64 align) noexcept
 {
-	return comp_heap_alloc_internal(core, size, align, false);
+	return comp_heap_alloc_internal(core, size, align, false, true);
+}
+
+Maybe<void*> comp_heap_alloc_collectable(CoreData* core, u64 size, u64 align) noexcept
+{
+	static_assert(sizeof(CompHeapAllocationHeader) <= COMP_HEAP_MIN_ALLOCATION_SIZE);
+
+	if (core->heap.nursery_allocated > core->heap.nursery_size)
+	{
+		if (core->heap.promoted > core->heap.full_gc_threshold)
+			comp_heap_collect_internal(core, true);
+		else
+			comp_heap_collect_young(core);
+	}
+
+	// Zero-sized allocations are padded to 1 byte, so that their address lies
+	// inside of them. This allows shadow data to function properly.
+	if (size == 0)
+		size = 1;
+
+	// Young allocations are bump-allocated from the end of the heap, keeping
+	// them above `nursery_begin`.
+	const Maybe<void*> allocation = comp_heap_alloc_internal(core, size, align, true, false);
+
+	if (is_none(allocation))
+		return none<void*>();
+
+	byte* const header_begin = static_cast<byte*>(get(allocation)) - COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	// The header only records the size. It is not marked in `header_bitmap`,
+	// which is reserved for global members.
+	CompHeapAllocationHeader* const header = reinterpret_cast<CompHeapAllocationHeader*>(header_begin);
+	header->type_id = TypeId::INVALID;
+	header->size = size;
+
+	comp_heap_mark_bitmap_bit(core, core->heap.collectable_bitmap, header_begin);
+
+	core->heap.nursery_allocated += size;
+
+	return allocation;
 }
 
 Maybe<void*> comp_heap_alloc_global_member(CoreData* core, u64 size, u64 align, TypeId type_id) noexcept
 {
 	static_assert(sizeof(CompHeapAllocationHeader) <= COMP_HEAP_MIN_ALLOCATION_SIZE);
 
-	const Maybe<void*> allocation = comp_heap_alloc_internal(core, size, align, true);
+	const Maybe<void*> allocation = comp_heap_alloc_internal(core, size, align, true, true);
 
 	if (is_none(allocation))
 		return none<void*>();
@@ -417,11 +1545,19 @@ void comp_heap_dealloc(CoreData* core, MutRange<byte> memory) noexcept
 
 	ASSERT_OR_IGNORE((core->heap.leak_bitmap[begin_slot >> 6] & (static_cast<u64>(1) << (begin_slot & 63))) == 0);
 
-	core->heap.begin_bitmap[begin_slot >> 6] &= ~(static_cast<u64>(1) << (begin_slot & 63));
+	ASSERT_OR_IGNORE((core->heap.collectable_bitmap[begin_slot >> 6] & (static_cast<u64>(1) << (begin_slot & 63))) == 0);
+
+	comp_heap_clear_begin_bit(core, begin_slot);
+
+	// Allocations occupy whole slots, so the rest of the last one is freed
+	// as well.
+	memory = MutRange<byte>{ memory.begin(), reinterpret_cast<byte*>((reinterpret_cast<u64>(memory.end()) + COMP_HEAP_ZERO_ADDRESS_MASK) & ~COMP_HEAP_ZERO_ADDRESS_MASK) };
 
 	const u64 end_index = memory.end() - core->heap.memory;
 
-	if (core->heap.used - end_index < COMP_HEAP_MIN_ALLOCATION_SIZE)
+	// Shrinking the used memory below `nursery_begin` would make the old
+	// generation overlap with future young allocations.
+	if (core->heap.used - end_index < COMP_HEAP_MIN_ALLOCATION_SIZE && static_cast<u64>(memory.begin() - core->heap.memory) >= core->heap.nursery_begin)
 		core->heap.used = memory.begin() - core->heap.memory;
 	else
 		comp_heap_add_to_freelist(core, memory);
@@ -429,31 +1565,86 @@ void comp_heap_dealloc(CoreData* core, MutRange<byte> memory) noexcept
 
 
 
+void comp_heap_collect(CoreData* core) noexcept
+{
+	comp_heap_collect_internal(core, true);
+}
+
+void comp_heap_unprotect(CoreData* core) noexcept
+{
+	if (!minos::write_watch_unprotect(&core->heap.write_watch))
+		panic("Could not lift write protection from compile-time heap (0x%[|X]).\n", minos::last_error());
+
+	core->heap.protected_end = 0;
+}
+
 void comp_heap_gc_begin(CoreData* core) noexcept
 {
-	const u64 page_mask = minos::page_bytes() - 1;
+	instrumentation_enter_phase(core, InstrumentationPhase::GC);
 
-	// Allocate one extra byte so that we can fit a trailing `0` bit to ease
-	// scanning of the bitmap.
-	const u64 gc_bitmap_commit = ((core->heap.used + BYTES_PER_BITMAP_BYTE - 1) / BYTES_PER_BITMAP_BYTE + 1 + page_mask) & ~page_mask;
+	const u64 gc_bitmap_commit = calc_gc_bitmap_commit(core->heap.used, minos::page_bytes());
 
 	if (!minos::mem_commit(core->heap.gc_bitmap, gc_bitmap_commit))
 		panic("Could not allocate % bytes for compile-time heap GC bitmap (0x%[|X]).\n", gc_bitmap_commit, minos::last_error());
 
+	u64* const gc_bitmap = core->heap.gc_bitmap;
+
+	const u64 end_slot = core->heap.used / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	// Start out with all used memory being alive, which includes the first
+	// slot acting as a `null` for ids. Everything beyond it is cleared
+	// explicitly, as decommitted memory may retain its previous contents.
+	memset(gc_bitmap, 0xFF, (end_slot >> 6) * sizeof(u64));
+
+	memset(gc_bitmap + (end_slot >> 6), 0, gc_bitmap_commit - (end_slot >> 6) * sizeof(u64));
+
+	gc_bitmap[end_slot >> 6] = (static_cast<u64>(1) << (end_slot & 63)) - 1;
+
 	// Insert a `1` sentinel bit right after the end of the gc bitmap. A `0`
 	// sentinel right after it is implied by the over-allocation by at least
 	// one byte.
-	// Since this is effectively just past the used small heap memory, we need
-	// to explicitly mark it via the small heap marking function, as it would
-	// otherwise not be recognized as part of the normal heap.
-	comp_heap_mark_bitmap_bits(core, core->heap.gc_bitmap, MutRange<byte>{ core->heap.memory + core->heap.used, 1 });
+	gc_bitmap[end_slot >> 6] |= static_cast<u64>(1) << (end_slot & 63);
+
+	// Free memory is not alive. Forget our old freelists, as their contents
+	// will be collected and coalesced by `comp_heap_gc_end`.
+	for (u32 i = 0; i != COMP_HEAP_SIZE_CLASS_COUNT; ++i)
+	{
+		const u64 entry_size = comp_heap_size_class_bytes(i);
 
-	// Preserve the first slot, since it acts as a `null` for ids.
-	comp_heap_mark_bitmap_bits(core, core->heap.gc_bitmap, MutRange<byte>{ core->heap.memory, 1 });
+		u32 entry = core->heap.freelists[i];
+
+		while (entry != 0)
+		{
+			byte* const entry_begin = core->heap.memory + entry * COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+			comp_heap_clear_bitmap_bits(core, gc_bitmap, MutRange<byte>{ entry_begin, entry_size });
+
+			entry = *reinterpret_cast<u32*>(entry_begin);
+		}
+	}
 
-	// Forget our old freelists. Their contents will be collected and coalesced
-	// by the GC.
 	memset(core->heap.freelists, 0, sizeof(core->heap.freelists));
+
+	memset(core->heap.nonempty_freelists, 0, sizeof(core->heap.nonempty_freelists));
+
+	// Collectable allocations are only alive once marked.
+	const u64* const collectable_bitmap = core->heap.collectable_bitmap;
+
+	for (u64 i = 0; i != (end_slot + 63) >> 6; ++i)
+	{
+		u64 collectable = collectable_bitmap[i];
+
+		while (collectable != 0)
+		{
+			byte* const header_begin = core->heap.memory + (i * 64 + count_trailing_zeros_assume_one(collectable)) * COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+			collectable &= collectable - 1;
+
+			const u64 size = reinterpret_cast<const CompHeapAllocationHeader*>(header_begin)->size;
+
+			comp_heap_clear_bitmap_bits(core, gc_bitmap, MutRange<byte>{ header_begin, COMP_HEAP_MIN_ALLOCATION_SIZE + size });
+		}
+	}
 }
 
 bool comp_heap_gc_mark(CoreData* core, MutRange<byte> memory) noexcept
@@ -479,7 +1670,7 @@ bool comp_heap_gc_mark(CoreData* core, MutRange<byte> memory) noexcept
 
 		ASSERT_OR_IGNORE((core->heap.begin_bitmap[(begin - 1) >> 6] & (static_cast<u64>(1) << ((begin - 1) & 63))) != 0);
 
-		ASSERT_OR_IGNORE((core->heap.header_bitmap[(begin - 1) >> 6] & (static_cast<u64>(1) << ((begin - 1) & 63))) != 0);
+		ASSERT_OR_IGNORE(((core->heap.header_bitmap[(begin - 1) >> 6] | core->heap.collectable_bitmap[(begin - 1) >> 6]) & (static_cast<u64>(1) << ((begin - 1) & 63))) != 0);
 	}
 	else if (memory.count() == 0)
 	{
@@ -498,36 +1689,39 @@ bool comp_heap_gc_mark(CoreData* core, MutRange<byte> memory) noexcept
 
 void comp_heap_gc_end(CoreData* core) noexcept
 {
-	const u64 page_mask = minos::page_bytes() - 1;
-
-	const u64 gc_bitmap_commit = (core->heap.used / BYTES_PER_BITMAP_BYTE + page_mask) & ~page_mask;
+	const u64 gc_bitmap_commit = calc_gc_bitmap_commit(core->heap.used, minos::page_bytes());
 
 	u64* const gc_bitmap = core->heap.gc_bitmap;
 
-	// Remove allocation begin bitmap entries that have been collected.
+	const u64 end_index = core->heap.used / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+	// Remove allocation begin and collectable bitmap entries that have been
+	// collected.
 
 	u64* const begin_bitmap = core->heap.begin_bitmap;
 
-	for (u64 i = 0; i != gc_bitmap_commit / sizeof(u64); ++i)
+	u64* const collectable_bitmap = core->heap.collectable_bitmap;
+
+	for (u64 i = 0; i != (end_index + 63) >> 6; ++i)
+	{
 		begin_bitmap[i] &= gc_bitmap[i];
 
-	// Collect free runs into freelists.
+		collectable_bitmap[i] &= gc_bitmap[i];
+	}
 
-	const u64 end_index = core->heap.used / COMP_HEAP_MIN_ALLOCATION_SIZE;
+	comp_heap_rebuild_begin_summaries(core, 0, (end_index + 63) >> 6);
 
-	u64 bit_index = 0;
+	// Collect free runs into freelists. A free run at the very end is instead
+	// returned by shrinking the used memory.
 
-	u64 last_alive_index;
+	u64 bit_index = 0;
 
 	while (true)
 	{
 		// Skip alive segment.
 		// No need to check for overrun here thanks to the `0` sentinel bit
 		// just after the bitmap's end.
-		while ((gc_bitmap[bit_index >> 6] & (static_cast<u64>(1) << (bit_index & 63))) != 0)
-			bit_index += 1;
-
-		last_alive_index = bit_index * COMP_HEAP_MIN_ALLOCATION_SIZE;
+		bit_index = comp_heap_find_clear_bit(gc_bitmap, bit_index);
 
 		if (bit_index >= end_index)
 			break;
@@ -536,12 +1730,15 @@ void comp_heap_gc_end(CoreData* core) noexcept
 
 		// Skip dead segment.
 		// Since there is a `1` sentinel bit right after the bitmap's end, we
-		// don't need to check for running off its end. If we got here.
-		// We still process the last free segment though. On the next time
-		// through the loop, we break upon encountering the following `0`
-		// sentinel bit.
-		while ((gc_bitmap[bit_index >> 6] & (static_cast<u64>(1) << (bit_index & 63))) == 0)
-			bit_index += 1;
+		// don't need to check for running off its end.
+		bit_index = comp_heap_find_set_bit(gc_bitmap, bit_index);
+
+		if (bit_index == end_index)
+		{
+			core->heap.used = free_begin;
+
+			break;
+		}
 
 		const u64 free_end = bit_index * COMP_HEAP_MIN_ALLOCATION_SIZE;
 
@@ -550,25 +1747,34 @@ void comp_heap_gc_end(CoreData* core) noexcept
 		comp_heap_add_to_freelist(core, free);
 	}
 
-	// Shrink commit to fit last marked address.
+	// Shrink commit to fit the remaining used memory.
 
-	const u64 new_commit = (core->heap.commit + core->heap.commit_increment - 1) & ~(core->heap.commit_increment - 1);
+	const u64 new_commit = (core->heap.used + core->heap.commit_increment - 1) & ~(core->heap.commit_increment - 1);
 
-	if (new_commit != core->heap.commit)
+	if (new_commit < core->heap.commit)
 	{
 		const u64 commit_difference = core->heap.commit - new_commit;
 
+		const u64 bitmap_offset = new_commit / BYTES_PER_BITMAP_BYTE;
+
+		const u64 bitmap_difference = commit_difference / BYTES_PER_BITMAP_BYTE;
+
 		minos::mem_decommit(core->heap.memory + new_commit, commit_difference);
 
-		minos::mem_decommit(core->heap.leak_bitmap + new_commit / BYTES_PER_BITMAP_BYTE, commit_difference / BYTES_PER_BITMAP_BYTE);
+		minos::mem_decommit(reinterpret_cast<byte*>(core->heap.leak_bitmap) + bitmap_offset, bitmap_difference);
 
-		minos::mem_decommit(core->heap.begin_bitmap + new_commit / BYTES_PER_BITMAP_BYTE, commit_difference / BYTES_PER_BITMAP_BYTE);
-	}
+		minos::mem_decommit(reinterpret_cast<byte*>(core->heap.begin_bitmap) + bitmap_offset, bitmap_difference);
 
-	core->heap.commit = new_commit;
-	core->heap.used = last_alive_index;
+		minos::mem_decommit(reinterpret_cast<byte*>(core->heap.header_bitmap) + bitmap_offset, bitmap_difference);
+
+		minos::mem_decommit(reinterpret_cast<byte*>(core->heap.collectable_bitmap) + bitmap_offset, bitmap_difference);
+
+		core->heap.commit = new_commit;
+	}
 
 	minos::mem_decommit(core->heap.gc_bitmap, gc_bitmap_commit);
+
+	instrumentation_leave_phase(core);
 }
 
 bool comp_heap_next_leak(CoreData* core, Maybe<byte*> prev, MutRange<byte>* out_memory, TypeId* out_type_id) noexcept
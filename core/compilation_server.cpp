@@ -0,0 +1,242 @@
+#include "core.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/range.hpp"
+#include "../infra/minos/minos.hpp"
+#include "../infra/print/print.hpp"
+
+#include <cstdlib>
+
+// Request sent by `request_compilation` to a server started with
+// `run_compilation_server`.
+// This is immediately followed by `config_filepath_bytes` bytes holding the
+// absolute path of the requested configuration file. The client's standard
+// output and error handles are attached to the header, in that order.
+struct CompilationRequestHeader
+{
+	u32 magic;
+
+	u32 config_filepath_bytes;
+};
+
+// Response sent back by the server once the requested compilation has
+// finished.
+struct CompilationResponse
+{
+	u32 exit_code;
+};
+
+static constexpr u32 COMPILATION_REQUEST_MAGIC = 0x5643'5345; // "ESCV"
+
+static constexpr u32 REQUEST_HANDLE_COUNT = 2;
+
+
+
+static u32 compile_and_report(CoreData* core) noexcept
+{
+	const minos::FileHandle stderr_handle = minos::standard_file_handle(minos::StdFileName::StdErr);
+
+	if (run_compilation(core, false))
+	{
+		print(stderr_handle, "Success\n");
+
+		return EXIT_SUCCESS;
+	}
+	else
+	{
+		print_errors(core);
+
+		print(stderr_handle, "\nFailure\n");
+
+		return EXIT_FAILURE;
+	}
+}
+
+static u32 serve_request_with_config(CoreData* core, Config* server_config, const Config* request_config) noexcept
+{
+	// The snapshot can only be reused if it holds the prelude the request
+	// asks for. Anything else gets a fresh `CoreData`, which is no faster
+	// than a standalone run but still gives the correct result.
+	if (!range::mem_equal(request_config->std.prelude.filepath, server_config->std.prelude.filepath))
+	{
+		CoreData* const request_core = create_core_data(request_config);
+
+		return compile_and_report(request_core);
+	}
+
+	// `core->config` refers to `server_config`, which is this process's
+	// private copy by now. Only the entrypoint is taken from the request, as
+	// all other settings have already shaped the snapshot.
+	server_config->entrypoint = request_config->entrypoint;
+
+	server_config->compile_all = request_config->compile_all;
+
+	return compile_and_report(core);
+}
+
+NORETURN static void serve_request(CoreData* core, Config* server_config, minos::SocketHandle connection) noexcept
+{
+	CompilationRequestHeader header;
+
+	minos::FileHandle handles[REQUEST_HANDLE_COUNT];
+
+	u32 handle_count;
+
+	if (!minos::local_socket_receive(connection, MutRange{ &header, 1 }.as_mut_byte_range(), MutRange{ handles }, &handle_count))
+		minos::exit_process(EXIT_FAILURE);
+
+	if (header.magic != COMPILATION_REQUEST_MAGIC || header.config_filepath_bytes == 0 || header.config_filepath_bytes > minos::MAX_PATH_CHARS || handle_count != REQUEST_HANDLE_COUNT)
+		minos::exit_process(EXIT_FAILURE);
+
+	char8 config_filepath_buf[minos::MAX_PATH_CHARS];
+
+	u32 unused_handle_count;
+
+	if (!minos::local_socket_receive(connection, MutRange<byte>{ reinterpret_cast<byte*>(config_filepath_buf), header.config_filepath_bytes }, MutRange<minos::FileHandle>{}, &unused_handle_count))
+		minos::exit_process(EXIT_FAILURE);
+
+	// From here on, all output of the compilation - including that of sinks
+	// referring to `$stdout` and `$stderr` - goes to the client.
+	if (!minos::standard_file_handle_redirect(minos::StdFileName::StdOut, handles[0])
+	 || !minos::standard_file_handle_redirect(minos::StdFileName::StdErr, handles[1]))
+		minos::exit_process(EXIT_FAILURE);
+
+	minos::file_close(handles[0]);
+
+	minos::file_close(handles[1]);
+
+	Config request_config;
+
+	TreeSchemaAllocator ts_alloc;
+
+	const Range<char8> config_filepath{ config_filepath_buf, header.config_filepath_bytes };
+
+	const u32 exit_code = config_from_toml_file(config_filepath, print_make_sink(minos::standard_file_handle(minos::StdFileName::StdErr)), &request_config, &ts_alloc)
+		? serve_request_with_config(core, server_config, &request_config)
+		: EXIT_FAILURE;
+
+	const CompilationResponse response{ exit_code };
+
+	(void) minos::local_socket_send(connection, Range{ &response, 1 }.as_byte_range(), Range<minos::FileHandle>{});
+
+	minos::exit_process(exit_code);
+}
+
+bool run_compilation_server(const Config* config, Range<char8> socket_path) noexcept
+{
+	const minos::FileHandle stderr_handle = minos::standard_file_handle(minos::StdFileName::StdErr);
+
+	// Forking only carries over the calling thread, so prefetch threads
+	// started for the snapshot would be missing in the processes serving the
+	// requests.
+	Config server_config = *config;
+
+	server_config.sources.prefetch_threads = 0;
+
+	CoreData* const core = create_core_data(&server_config);
+
+	if (!import_prelude(core, server_config.std.prelude.filepath))
+	{
+		print_errors(core);
+
+		print(stderr_handle, "\nFailed to import prelude for compilation server\n");
+
+		release_core_data(core);
+
+		return false;
+	}
+
+	minos::SocketHandle listener;
+
+	if (!minos::local_socket_listen(socket_path, &listener))
+	{
+		print(stderr_handle, "Failed to listen for compilation requests on `%` (0x%[|X])\n", socket_path, minos::last_error());
+
+		release_core_data(core);
+
+		return false;
+	}
+
+	print(stderr_handle, "Listening for compilation requests on `%`\n", socket_path);
+
+	while (true)
+	{
+		minos::SocketHandle connection;
+
+		if (!minos::local_socket_accept(listener, &connection))
+		{
+			print(stderr_handle, "Failed to accept compilation request (0x%[|X])\n", minos::last_error());
+
+			break;
+		}
+
+		// Every request is served by a copy-on-write fork of the state right
+		// after importing the prelude, so requests can neither observe nor
+		// disturb each other.
+		bool is_child;
+
+		if (!minos::process_fork_detached(&is_child))
+			print(stderr_handle, "Failed to fork for compilation request (0x%[|X])\n", minos::last_error());
+		else if (is_child)
+			serve_request(core, &server_config, connection);
+
+		minos::local_socket_close(connection);
+	}
+
+	minos::local_socket_close(listener);
+
+	release_core_data(core);
+
+	return false;
+}
+
+bool request_compilation(Range<char8> socket_path, Range<char8> config_filepath, u32* out_exit_code) noexcept
+{
+	char8 absolute_config_filepath_buf[minos::MAX_PATH_CHARS];
+
+	const u32 absolute_config_filepath_bytes = minos::path_to_absolute(config_filepath, MutRange{ absolute_config_filepath_buf });
+
+	if (absolute_config_filepath_bytes == 0 || absolute_config_filepath_bytes > minos::MAX_PATH_CHARS)
+		return false;
+
+	minos::SocketHandle connection;
+
+	if (!minos::local_socket_connect(socket_path, &connection))
+		return false;
+
+	const CompilationRequestHeader header{ COMPILATION_REQUEST_MAGIC, absolute_config_filepath_bytes };
+
+	const minos::FileHandle handles[REQUEST_HANDLE_COUNT] = {
+		minos::standard_file_handle(minos::StdFileName::StdOut),
+		minos::standard_file_handle(minos::StdFileName::StdErr),
+	};
+
+	if (!minos::local_socket_send(connection, Range{ &header, 1 }.as_byte_range(), Range{ handles })
+	 || !minos::local_socket_send(connection, Range{ absolute_config_filepath_buf, absolute_config_filepath_bytes }.as_byte_range(), Range<minos::FileHandle>{}))
+	{
+		minos::local_socket_close(connection);
+
+		return false;
+	}
+
+	// Once the request has been sent, the server may already have produced
+	// output, so falling back to a local compilation would duplicate it.
+	CompilationResponse response;
+
+	u32 unused_handle_count;
+
+	if (minos::local_socket_receive(connection, MutRange{ &response, 1 }.as_mut_byte_range(), MutRange<minos::FileHandle>{}, &unused_handle_count))
+	{
+		*out_exit_code = response.exit_code;
+	}
+	else
+	{
+		print(minos::standard_file_handle(minos::StdFileName::StdErr), "\nCompilation server closed the connection without reporting a result\n");
+
+		*out_exit_code = EXIT_FAILURE;
+	}
+
+	minos::local_socket_close(connection);
+
+	return true;
+}
@@ -103,6 +103,42 @@ struct ConfigMetadata
 		} prelude;
 	} std;
 
+	struct
+	{
+		ConfigMetadataEntry self_;
+
+		ConfigMetadataEntry map_files;
+
+		ConfigMetadataEntry prefetch_threads;
+	} sources;
+
+	struct
+	{
+		ConfigMetadataEntry self_;
+
+		ConfigMetadataEntry enabled;
+
+		ConfigMetadataEntry directory;
+	} ast_cache;
+
+	struct
+	{
+		ConfigMetadataEntry self_;
+
+		ConfigMetadataEntry enabled;
+
+		ConfigMetadataEntry directory;
+	} opcode_cache;
+
+	struct
+	{
+		ConfigMetadataEntry self_;
+
+		ConfigMetadataEntry enabled;
+
+		ConfigMetadataEntry path;
+	} prelude_snapshot;
+
 	struct
 	{
 		ConfigMetadataEntry self_;
@@ -110,6 +146,10 @@ struct ConfigMetadata
 		ConfigMetadataEntry reserve;
 
 		ConfigMetadataEntry commit_increment;
+
+		ConfigMetadataEntry nursery_size;
+
+		ConfigMetadataEntry full_gc_threshold;
 	} heap;
 
 	struct
@@ -151,8 +191,21 @@ struct ConfigMetadata
 		} imports;
 
 		ConfigMetadataEntry config;
+
+		ConfigMetadataEntry stats;
+
+		ConfigMetadataEntry trace;
 	} logging;
 
+	struct
+	{
+		ConfigMetadataEntry self_;
+
+		ConfigMetadataEntry file;
+
+		ConfigMetadataEntry sample_interval;
+	} profile;
+
 	struct
 	{
 		ConfigMetadataEntry self_;
@@ -198,9 +251,27 @@ static constexpr ConfigMetadata init_metadata() noexcept
 	rst.std.prelude.self_ = META_TABLE("prelude", std.prelude, "Prelude parameters");
 	rst.std.prelude.path = META_PATH("path", std.prelude.filepath, range::from_literal_string("std/prelude.evl"), "Path to the file containing the prelude that is made available to all sources");
 
+	rst.sources.self_ = META_TABLE("sources", sources, "Source file reading configuration");
+	rst.sources.map_files = META_BOOLEAN("map-files", sources.map_files, true, "Whether source files are mapped into memory instead of being copied into a buffer. If this is `true`, source files are parsed directly from the page cache");
+	rst.sources.prefetch_threads = META_INTEGER("prefetch-threads", sources.prefetch_threads, 0, 0, 16, "Number of threads reading imported source files ahead of their evaluation. Imports are discovered by scanning each newly read file for `import(\"...\")` calls. This mostly helps when sources are not yet in the page cache. If this is `0`, all files are read on demand");
+
+	rst.ast_cache.self_ = META_TABLE("ast-cache", ast_cache, "Persistent cache of parsed source files");
+	rst.ast_cache.enabled = META_BOOLEAN("enabled", ast_cache.enabled, false, "Whether parsed ASTs are cached on disk. If this is `true`, source files whose content matches a previous run's are loaded from the cache instead of being parsed");
+	rst.ast_cache.directory = META_PATH("directory", ast_cache.directory, range::from_literal_string(".evl-cache"), "Directory holding the AST cache. It is created if it does not exist yet");
+
+	rst.opcode_cache.self_ = META_TABLE("opcode-cache", opcode_cache, "Persistent cache of interpreter opcodes generated for source files");
+	rst.opcode_cache.enabled = META_BOOLEAN("enabled", opcode_cache.enabled, false, "Whether opcodes generated for top-level definitions are cached on disk. If this is `true`, opcodes for source files whose content and prelude match a previous run's are loaded from the cache instead of being generated");
+	rst.opcode_cache.directory = META_PATH("directory", opcode_cache.directory, range::from_literal_string(".evl-cache"), "Directory holding the opcode cache. It is created if it does not exist yet");
+
+	rst.prelude_snapshot.self_ = META_TABLE("prelude-snapshot", prelude_snapshot, "Snapshot of the compiler's state right after importing the prelude");
+	rst.prelude_snapshot.enabled = META_BOOLEAN("enabled", prelude_snapshot.enabled, false, "Whether compilation starts from a snapshot of the state after importing the prelude. If this is `true` and no usable snapshot exists, the prelude is imported as usual and a snapshot of the result is written");
+	rst.prelude_snapshot.path = META_PATH("path", prelude_snapshot.filepath, range::from_literal_string(".evl-cache/prelude.snapshot"), "File holding the prelude snapshot. Its directory must already exist");
+
 	rst.heap.self_ = META_TABLE("heap", heap, "Managed heap configuration");
 	rst.heap.reserve = META_INTEGER("reserve", heap.reserve, 1 << 30, 1 << 12, static_cast<s64>(1) << 31, "Size the managed heap's small allocation section can grow to, in bytes");
 	rst.heap.commit_increment = META_INTEGER("commit-increment", heap.commit_increment, 1 << 18, 1 << 12, static_cast<s64>(1) << 31, "Number of bytes the managed heap is grown by at a time");
+	rst.heap.nursery_size = META_INTEGER("nursery-size", heap.nursery_size, 1 << 24, 0, static_cast<s64>(1) << 31, "Number of bytes of compile-time values that may be allocated on the managed heap before a minor collection frees the unreachable ones among them. Values surviving a minor collection are promoted to the old generation");
+	rst.heap.full_gc_threshold = META_INTEGER("full-gc-threshold", heap.full_gc_threshold, 1 << 27, 0, static_cast<s64>(1) << 31, "Number of bytes of compile-time values that may be promoted to the old generation before the next collection is a full one, which also frees unreachable old values. Running out of heap memory always triggers a full collection");
 
 	rst.shadow_store.self_ = META_TABLE("shadow-store", shadow_store, "Shadow store configuration for holding zero-sized values");
 	rst.shadow_store.addresses.self_ = META_TABLE("addresses", shadow_store.addresses, "Allocation information for the shadow store address table. This holds association between addresses and their shadow data");
@@ -216,6 +287,12 @@ static constexpr ConfigMetadata init_metadata() noexcept
 	rst.logging.imports.opcodes = META_PRINT_SINK("opcodes", logging.imports.opcodes_sink, range::from_literal_string("$none"), "File interpreter opcodes are written to when files are imported");
 	rst.logging.imports.types = META_PRINT_SINK("types", logging.imports.types_sink, range::from_literal_string("$none"), "File top-level types are written to when files are imported");
 	rst.logging.config = META_PRINT_SINK("config", logging.config_sink, range::from_literal_string("$none"), "File the parsed configuration gets written to");
+	rst.logging.stats = META_PRINT_SINK("stats", logging.stats_sink, range::from_literal_string("$none"), "File a JSON summary of per-phase timings and interpreter, type pool and heap counters gets written to after compilation");
+	rst.logging.trace = META_PRINT_SINK("trace", logging.trace_sink, range::from_literal_string("$none"), "File a Chrome trace of file imports, global initializers, calls and builtins gets written to during compilation");
+
+	rst.profile.self_ = META_TABLE("profile", profile, "Sampling profiler for compile-time execution");
+	rst.profile.file = META_PRINT_SINK("path", profile.sink, range::from_literal_string("$none"), "File the sampled interpreter call stacks get written to after compilation, in the folded format consumed by flamegraph tools");
+	rst.profile.sample_interval = META_INTEGER("sample-interval", profile.sample_interval, 997, 1, static_cast<s64>(1) << 31, "Number of executed interpreter opcodes between two samples. Prefer values that do not evenly divide the length of hot loops, as those would always be sampled at the same point");
 
 	rst.diagnostics.self_ = META_TABLE("diagnostics", diagnostics, "Error message configuration");
 	rst.diagnostics.file = META_PRINT_SINK("path", diagnostics.sink, range::from_literal_string("$stderr"), "File errors generated during compilation are written to");
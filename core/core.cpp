@@ -5,8 +5,12 @@
 #include "../infra/panic.hpp"
 #include "../infra/range.hpp"
 #include "../infra/inplace_sort.hpp"
+#include "../infra/hash.hpp"
+#include "../infra/minos/minos.hpp"
 #include "../diag/diag.hpp"
 
+#include <cstdlib>
+
 struct RangeAllocation
 {
 	u64 begin;
@@ -40,6 +44,8 @@ bool shadow_store_validate_config(const Config* config, PrintSink sink) noexcept
 
 bool temp_stack_validate_config(const Config* config, PrintSink sink) noexcept;
 
+bool instrumentation_validate_config(const Config* config, PrintSink sink) noexcept;
+
 
 
 MemoryRequirements comp_heap_memory_requirements(const Config* config) noexcept;
@@ -66,6 +72,8 @@ MemoryRequirements shadow_store_memory_requirements(const Config* config) noexce
 
 MemoryRequirements temp_stack_memory_requirements(const Config* config) noexcept;
 
+MemoryRequirements instrumentation_memory_requirements(const Config* config) noexcept;
+
 
 
 void comp_heap_init(CoreData* core, MemoryAllocation allocation) noexcept;
@@ -92,6 +100,28 @@ void shadow_store_init(CoreData* core, MemoryAllocation allocation) noexcept;
 
 void temp_stack_init(CoreData* core, MemoryAllocation allocation) noexcept;
 
+void instrumentation_init(CoreData* core, MemoryAllocation allocation) noexcept;
+
+
+
+void source_reader_release(CoreData* core) noexcept;
+
+void comp_heap_release(CoreData* core) noexcept;
+
+
+
+void source_reader_prepare_snapshot(CoreData* core) noexcept;
+
+bool source_reader_restore(CoreData* core) noexcept;
+
+void error_sink_restore(CoreData* core) noexcept;
+
+void interpreter_restore(CoreData* core) noexcept;
+
+void instrumentation_restore(CoreData* core) noexcept;
+
+void comp_heap_restore(CoreData* core) noexcept;
+
 
 
 using validate_config_func = bool (*) (const Config* config, PrintSink sink) noexcept;
@@ -126,61 +156,68 @@ static u32 id_requirements_index_from_ptr(const MemoryRangeRequirement* ptr, con
 
 
 
-CoreData* create_core_data(const Config* config) noexcept
-{
-	static constexpr validate_config_func VALIDATE_CONFIG_FUNCS[] = {
-		&comp_heap_validate_config,
-		&temp_stack_validate_config,
-		&ast_pool_validate_config,
-		&error_sink_validate_config,
-		&identifier_pool_validate_config,
-		&lexical_analyser_validate_config,
-		&opcode_pool_validate_config,
-		&type_pool_validate_config,
-		&parser_validate_config,
-		&source_reader_validate_config,
-		&shadow_store_validate_config,
-		&interpreter_validate_config,
-	};
-
-	static constexpr memory_requirements_func MEMORY_REQUIREMENTS_FUNCS[] = {
-		&comp_heap_memory_requirements,
-		&temp_stack_memory_requirements,
-		&ast_pool_memory_requirements,
-		&error_sink_memory_requirements,
-		&identifier_pool_memory_requirements,
-		&lexical_analyser_memory_requirements,
-		&opcode_pool_memory_requirements,
-		&type_pool_memory_requirements,
-		&parser_memory_requirements,
-		&source_reader_memory_requirements,
-		&shadow_store_memory_requirements,
-		&interpreter_memory_requirements,
-	};
-
-	static constexpr init_func INIT_FUNCS[] = {
-		&comp_heap_init,
-		&temp_stack_init,
-		&ast_pool_init,
-		&error_sink_init,
-		&identifier_pool_init,
-		&lexical_analyser_init,
-		&opcode_pool_init,
-		&type_pool_init,
-		&parser_init,
-		&source_reader_init,
-		&shadow_store_init,
-		&interpreter_init,
-	};
-
-	static_assert(array_count(VALIDATE_CONFIG_FUNCS) == array_count(MEMORY_REQUIREMENTS_FUNCS));
-
-	static_assert(array_count(VALIDATE_CONFIG_FUNCS) == array_count(INIT_FUNCS));
-
-	static constexpr u32 MEMBER_COUNT = static_cast<u32>(array_count(MEMORY_REQUIREMENTS_FUNCS));
+static constexpr validate_config_func VALIDATE_CONFIG_FUNCS[] = {
+	&comp_heap_validate_config,
+	&temp_stack_validate_config,
+	&ast_pool_validate_config,
+	&error_sink_validate_config,
+	&identifier_pool_validate_config,
+	&lexical_analyser_validate_config,
+	&opcode_pool_validate_config,
+	&type_pool_validate_config,
+	&parser_validate_config,
+	&source_reader_validate_config,
+	&shadow_store_validate_config,
+	&interpreter_validate_config,
+	&instrumentation_validate_config,
+};
+
+static constexpr memory_requirements_func MEMORY_REQUIREMENTS_FUNCS[] = {
+	&comp_heap_memory_requirements,
+	&temp_stack_memory_requirements,
+	&ast_pool_memory_requirements,
+	&error_sink_memory_requirements,
+	&identifier_pool_memory_requirements,
+	&lexical_analyser_memory_requirements,
+	&opcode_pool_memory_requirements,
+	&type_pool_memory_requirements,
+	&parser_memory_requirements,
+	&source_reader_memory_requirements,
+	&shadow_store_memory_requirements,
+	&interpreter_memory_requirements,
+	&instrumentation_memory_requirements,
+};
+
+static constexpr init_func INIT_FUNCS[] = {
+	&comp_heap_init,
+	&temp_stack_init,
+	&ast_pool_init,
+	&error_sink_init,
+	&identifier_pool_init,
+	&lexical_analyser_init,
+	&opcode_pool_init,
+	&type_pool_init,
+	&parser_init,
+	&source_reader_init,
+	&shadow_store_init,
+	&interpreter_init,
+	&instrumentation_init,
+};
+
+static_assert(array_count(VALIDATE_CONFIG_FUNCS) == array_count(MEMORY_REQUIREMENTS_FUNCS));
 
+static_assert(array_count(VALIDATE_CONFIG_FUNCS) == array_count(INIT_FUNCS));
 
+static constexpr u32 MEMBER_COUNT = static_cast<u32>(array_count(MEMORY_REQUIREMENTS_FUNCS));
 
+
+
+// Validates `config` and lays out the memory ranges required by the members
+// of `CoreData` within a single reservation, returning its total size.
+// `out_memory_requirements` and `out_range_allocations` receive the
+// requirements of each member and the ranges allocated to them.
+static u64 layout_core_data(const Config* config, MemoryRequirements* out_memory_requirements, RangeAllocation* out_range_allocations) noexcept
+{
 	if (config->logging.config_sink.name_and_enabled.attachment())
 		print_config(config->logging.config_sink.sink, config);
 
@@ -201,22 +238,22 @@ CoreData* create_core_data(const Config* config) noexcept
 
 
 
-	MemoryRequirements memory_requirements[MEMBER_COUNT];
-
 	for (u32 i = 0; i != MEMBER_COUNT; ++i)
-		memory_requirements[i] = MEMORY_REQUIREMENTS_FUNCS[i](config);
+		out_memory_requirements[i] = MEMORY_REQUIREMENTS_FUNCS[i](config);
 
 	MemoryRangeRequirement* range_requirements_buf[MAX_MEMORY_RANGE_REQUIREMENTS_COUNT * MEMBER_COUNT];
 
 	u64 range_requirements_count = 0;
 
-	for (MemoryRequirements& req : memory_requirements)
+	for (u32 i = 0; i != MEMBER_COUNT; ++i)
 	{
-		for (u64 i = 0; i != req.count; ++i)
+		MemoryRequirements& req = out_memory_requirements[i];
+
+		for (u64 j = 0; j != req.count; ++j)
 		{
 			ASSERT_OR_IGNORE(range_requirements_count + req.count < array_count(range_requirements_buf));
 
-			range_requirements_buf[range_requirements_count + i] = &req.ranges[i];
+			range_requirements_buf[range_requirements_count + j] = &req.ranges[j];
 		}
 
 		range_requirements_count += req.count;
@@ -230,15 +267,13 @@ CoreData* create_core_data(const Config* config) noexcept
 
 	u64 total_allocation_size = sizeof(CoreData);
 
-	RangeAllocation range_allocations[MEMBER_COUNT * MAX_MEMORY_RANGE_REQUIREMENTS_COUNT];
-
 	for (const MemoryRangeRequirement* req : id_requirements)
 	{
 		total_allocation_size = (total_allocation_size + page_mask) & ~page_mask;
 
-		const u32 reverse_index = id_requirements_index_from_ptr(req, memory_requirements);
+		const u32 reverse_index = id_requirements_index_from_ptr(req, out_memory_requirements);
 
-		range_allocations[reverse_index] = RangeAllocation{ total_allocation_size, req->size };
+		out_range_allocations[reverse_index] = RangeAllocation{ total_allocation_size, req->size };
 
 		total_allocation_size += req->size;
 
@@ -246,6 +281,19 @@ CoreData* create_core_data(const Config* config) noexcept
 			panic("Could not allocate memory ranges within maximum offset constraints.\n");
 	}
 
+	return total_allocation_size;
+}
+
+CoreData* create_core_data(const Config* config) noexcept
+{
+	MemoryRequirements memory_requirements[MEMBER_COUNT];
+
+	RangeAllocation range_allocations[MEMBER_COUNT * MAX_MEMORY_RANGE_REQUIREMENTS_COUNT];
+
+	const u64 total_allocation_size = layout_core_data(config, memory_requirements, range_allocations);
+
+	const u64 page_mask = minos::page_bytes() - 1;
+
 	void* const memory = minos::mem_reserve(total_allocation_size);
 
 	if (memory == nullptr)
@@ -277,14 +325,456 @@ CoreData* create_core_data(const Config* config) noexcept
 
 void release_core_data(CoreData* core) noexcept
 {
+	source_reader_release(core);
+
+	comp_heap_release(core);
+
 	minos::mem_unreserve(core, core->allocation_size);
 }
 
 
 
-bool run_compilation(CoreData* core, bool main_is_std) noexcept
+// Header of a file written by `core_data_snapshot`. This is followed by
+// `committed_count` `CoreSnapshotRange`s describing the committed parts of the
+// snapshotted reservation, then by `run_count` `CoreSnapshotRange`s describing
+// the parts of these that are not all zeroes, and finally by the contents of
+// these runs, in the same order. Pages outside of the runs are left as they
+// are after committing them, which saves writing and reading the bulk of a
+// snapshot, as most of the memory committed up front is never touched.
+struct CoreSnapshotHeader
+{
+	u32 magic;
+
+	u32 version;
+
+	// Identifies the executable that wrote the snapshot, as the layout of
+	// `CoreData` is only stable within a single build.
+	u64 build_hash;
+
+	// Hash of the settings in `Config` that influence the snapshotted state.
+	// See `snapshot_config_hash`.
+	u64 config_hash;
+
+	// Address of the snapshotted `CoreData`. As its state contains absolute
+	// pointers, it can only be restored at this same address.
+	u64 base_address;
+
+	u64 allocation_size;
+
+	u32 committed_count;
+
+	u32 run_count;
+};
+
+// Range within a snapshotted `CoreData`'s reservation, relative to its start.
+struct CoreSnapshotRange
+{
+	u64 offset;
+
+	u64 bytes;
+};
+
+static constexpr u32 CORE_SNAPSHOT_MAGIC = 0x4E53'4345; // "ECSN"
+
+static constexpr u32 CORE_SNAPSHOT_VERSION = 1;
+
+static constexpr u32 CORE_SNAPSHOT_MAX_RANGE_COUNT = 1024;
+
+static constexpr u64 CORE_SNAPSHOT_IO_CHUNK_BYTES = static_cast<u64>(1) << 30;
+
+static bool snapshot_build_hash(u64* out) noexcept
+{
+	char8 exe_path_buf[minos::MAX_PATH_CHARS];
+
+	const u32 exe_path_chars = minos::executable_path(MutRange{ exe_path_buf });
+
+	if (exe_path_chars == 0 || exe_path_chars > array_count(exe_path_buf))
+		return false;
+
+	minos::FileInfo exe_info;
+
+	if (!minos::path_get_info(Range{ exe_path_buf, exe_path_chars }, &exe_info))
+		return false;
+
+	const u64 core_data_bytes = sizeof(CoreData);
+
+	u64 hash = fnv1a_64(range::from_object_bytes(&exe_info.identity.index));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&exe_info.identity.volume_serial));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&exe_info.bytes));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&exe_info.last_modified_time));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&core_data_bytes));
+
+	*out = hash;
+
+	return true;
+}
+
+static u64 hash_ts_value(u64 hash, const TreeSchemaValue* value) noexcept;
+
+static u64 hash_ts_table(u64 hash, const TreeSchemaTable* table) noexcept
+{
+	TreeSchemaTableIterator it = ts_table_values(table);
+
+	while (has_next(&it))
+		hash = hash_ts_value(hash, next(&it));
+
+	return hash;
+}
+
+static u64 hash_ts_value(u64 hash, const TreeSchemaValue* value) noexcept
+{
+	const TreeSchemaValueTag tag = value->name_and_tag.attachment();
+
+	hash = fnv1a_64_step(hash, value->name_and_tag.as_byte_range());
+
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&tag));
+
+	switch (tag)
+	{
+	case TreeSchemaValueTag::Table:
+		return hash_ts_table(hash, value->value.table);
+
+	case TreeSchemaValueTag::Array:
+	{
+		const u32 count = ts_array_count(value->value.array);
+
+		for (u32 i = 0; i != count; ++i)
+			hash = hash_ts_value(hash, ts_array_at(value->value.array, i));
+
+		return hash;
+	}
+
+	case TreeSchemaValueTag::Integer:
+		return fnv1a_64_step(hash, range::from_object_bytes(&value->value.integer));
+
+	case TreeSchemaValueTag::String:
+		return fnv1a_64_step(hash, value->value.string.as_byte_range());
+
+	case TreeSchemaValueTag::Boolean:
+		return fnv1a_64_step(hash, range::from_object_bytes(&value->value.boolean));
+
+	case TreeSchemaValueTag::INVALID:
+		; // Fallthrough to unreachable.
+	}
+
+	ASSERT_UNREACHABLE;
+}
+
+// Hashes the settings in `config` that shape the state of a `CoreData` after
+// importing the prelude. Settings that are only consulted while compiling,
+// such as the entrypoint or logging sinks, are left out, so that a snapshot
+// can be shared between configurations differing only in these.
+static u64 snapshot_config_hash(const Config* config) noexcept
+{
+	u64 hash = fnv1a_64(config->std.prelude.filepath.as_byte_range());
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&config->opcode_cache.enabled));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&config->heap.reserve));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&config->heap.commit_increment));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&config->shadow_store.addresses.reserve));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&config->shadow_store.addresses.commit_increment));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&config->shadow_store.layouts.reserve));
+	hash = fnv1a_64_step(hash, range::from_object_bytes(&config->shadow_store.layouts.commit_increment));
+
+	if (is_some(config->defines))
+		hash = hash_ts_table(hash, get(config->defines));
+
+	return hash;
+}
+
+static bool is_zero_page(const byte* page, u32 page_bytes) noexcept
+{
+	const u64* const words = reinterpret_cast<const u64*>(page);
+
+	for (u32 i = 0; i != page_bytes / sizeof(u64); ++i)
+	{
+		if (words[i] != 0)
+			return false;
+	}
+
+	return true;
+}
+
+static void snapshot_append_run(const byte* base, const byte* run_begin, const byte* run_end, CoreSnapshotRange* out, u32* inout_count) noexcept
+{
+	if (out != nullptr)
+		out[*inout_count] = CoreSnapshotRange{ static_cast<u64>(run_begin - base), static_cast<u64>(run_end - run_begin) };
+
+	*inout_count += 1;
+}
+
+// Splits `committed` into runs of pages that are not all zeroes. If `out` is
+// `nullptr`, only counts these runs.
+static u32 snapshot_collect_runs(const byte* base, Range<MutRange<byte>> committed, CoreSnapshotRange* out) noexcept
+{
+	const u32 page_bytes = minos::page_bytes();
+
+	u32 run_count = 0;
+
+	for (const MutRange<byte> range : committed)
+	{
+		const byte* run_begin = nullptr;
+
+		for (const byte* page = range.begin(); page != range.end(); page += page_bytes)
+		{
+			if (!is_zero_page(page, page_bytes))
+			{
+				if (run_begin == nullptr)
+					run_begin = page;
+			}
+			else if (run_begin != nullptr)
+			{
+				snapshot_append_run(base, run_begin, page, out, &run_count);
+
+				run_begin = nullptr;
+			}
+		}
+
+		if (run_begin != nullptr)
+			snapshot_append_run(base, run_begin, range.end(), out, &run_count);
+	}
+
+	return run_count;
+}
+
+static bool snapshot_write(minos::FileHandle file, Range<byte> data, u64* inout_offset) noexcept
+{
+	for (u64 done = 0; done != data.count(); )
+	{
+		const u64 chunk_bytes = data.count() - done < CORE_SNAPSHOT_IO_CHUNK_BYTES ? data.count() - done : CORE_SNAPSHOT_IO_CHUNK_BYTES;
+
+		if (!minos::file_write_at(file, data.subrange(done, chunk_bytes), *inout_offset + done))
+			return false;
+
+		done += chunk_bytes;
+	}
+
+	*inout_offset += data.count();
+
+	return true;
+}
+
+static bool snapshot_read(minos::FileHandle file, MutRange<byte> data, u64* inout_offset) noexcept
+{
+	for (u64 done = 0; done != data.count(); )
+	{
+		const u64 chunk_bytes = data.count() - done < CORE_SNAPSHOT_IO_CHUNK_BYTES ? data.count() - done : CORE_SNAPSHOT_IO_CHUNK_BYTES;
+
+		u32 bytes_read;
+
+		if (!minos::file_read(file, data.mut_subrange(done, chunk_bytes), *inout_offset + done, &bytes_read) || bytes_read == 0)
+			return false;
+
+		done += bytes_read;
+	}
+
+	*inout_offset += data.count();
+
+	return true;
+}
+
+bool core_data_snapshot(CoreData* core, Range<char8> filepath) noexcept
+{
+	u64 build_hash;
+
+	if (!snapshot_build_hash(&build_hash))
+		return false;
+
+	// Foreign functions hold addresses into libraries loaded by this process,
+	// which would dangle in the process restoring the snapshot.
+	if (core->interp.foreign_library_count != 0)
+		return false;
+
+	source_reader_prepare_snapshot(core);
+
+	// Write-protected memory does not show up as committed.
+	comp_heap_unprotect(core);
+
+	MutRange<byte> committed[CORE_SNAPSHOT_MAX_RANGE_COUNT];
+
+	u32 committed_count;
+
+	if (!minos::mem_query_committed(core, core->allocation_size, MutRange{ committed }, &committed_count))
+		return false;
+
+	const byte* const base = reinterpret_cast<const byte*>(core);
+
+	CoreSnapshotRange committed_ranges[CORE_SNAPSHOT_MAX_RANGE_COUNT];
+
+	for (u32 i = 0; i != committed_count; ++i)
+		committed_ranges[i] = CoreSnapshotRange{ static_cast<u64>(committed[i].begin() - base), committed[i].count() };
+
+	const Range<MutRange<byte>> committed_used{ committed, committed_count };
+
+	const u32 run_count = snapshot_collect_runs(base, committed_used, nullptr);
+
+	CoreSnapshotRange* const runs = static_cast<CoreSnapshotRange*>(malloc((run_count + 1) * sizeof(CoreSnapshotRange)));
+
+	if (runs == nullptr)
+		return false;
+
+	(void) snapshot_collect_runs(base, committed_used, runs);
+
+	CoreSnapshotHeader header{};
+	header.version = CORE_SNAPSHOT_VERSION;
+	header.build_hash = build_hash;
+	header.config_hash = snapshot_config_hash(core->config);
+	header.base_address = reinterpret_cast<u64>(core);
+	header.allocation_size = core->allocation_size;
+	header.committed_count = committed_count;
+	header.run_count = run_count;
+
+	minos::FileHandle file;
+
+	if (!minos::file_create(filepath, minos::Access::Write, minos::ExistsMode::Truncate, minos::NewMode::Create, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+	{
+		free(runs);
+
+		return false;
+	}
+
+	u64 offset = 0;
+
+	bool is_ok = snapshot_write(file, range::from_object_bytes(&header), &offset)
+	          && snapshot_write(file, Range{ committed_ranges, committed_count }.as_byte_range(), &offset)
+	          && snapshot_write(file, Range{ runs, run_count }.as_byte_range(), &offset);
+
+	for (u32 i = 0; is_ok && i != run_count; ++i)
+		is_ok = snapshot_write(file, Range{ base + runs[i].offset, runs[i].bytes }, &offset);
+
+	free(runs);
+
+	// The magic is written last, so that an incompletely written snapshot is
+	// never mistaken for a valid one.
+	if (is_ok)
+	{
+		const u32 magic = CORE_SNAPSHOT_MAGIC;
+
+		is_ok = minos::file_write_at(file, range::from_object_bytes(&magic), offsetof(CoreSnapshotHeader, magic));
+	}
+
+	minos::file_close(file);
+
+	return is_ok;
+}
+
+CoreData* create_core_data_from_snapshot(const Config* config, Range<char8> filepath) noexcept
 {
-	if (!import_prelude(core, core->config->std.prelude.filepath))
+	MemoryRequirements memory_requirements[MEMBER_COUNT];
+
+	RangeAllocation range_allocations[MEMBER_COUNT * MAX_MEMORY_RANGE_REQUIREMENTS_COUNT];
+
+	const u64 total_allocation_size = layout_core_data(config, memory_requirements, range_allocations);
+
+	u64 build_hash;
+
+	if (!snapshot_build_hash(&build_hash))
+		return nullptr;
+
+	minos::FileHandle file;
+
+	if (!minos::file_create(filepath, minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+		return nullptr;
+
+	u64 offset = 0;
+
+	CoreSnapshotHeader header;
+
+	CoreSnapshotRange committed_ranges[CORE_SNAPSHOT_MAX_RANGE_COUNT];
+
+	const bool is_valid_header = snapshot_read(file, range::from_object_bytes_mut(&header), &offset)
+	                          && header.magic == CORE_SNAPSHOT_MAGIC
+	                          && header.version == CORE_SNAPSHOT_VERSION
+	                          && header.build_hash == build_hash
+	                          && header.config_hash == snapshot_config_hash(config)
+	                          && header.allocation_size == total_allocation_size
+	                          && header.committed_count != 0
+	                          && header.committed_count <= CORE_SNAPSHOT_MAX_RANGE_COUNT
+	                          && snapshot_read(file, MutRange{ committed_ranges, header.committed_count }.as_mut_byte_range(), &offset);
+
+	// The snapshot always contains the `CoreData` itself, which is the first
+	// thing in the reservation.
+	if (!is_valid_header || committed_ranges[0].offset != 0 || committed_ranges[0].bytes < sizeof(CoreData))
+	{
+		minos::file_close(file);
+
+		return nullptr;
+	}
+
+	byte* const memory = static_cast<byte*>(minos::mem_reserve_at(reinterpret_cast<void*>(header.base_address), total_allocation_size));
+
+	if (memory == nullptr)
+	{
+		minos::file_close(file);
+
+		return nullptr;
+	}
+
+	bool is_ok = true;
+
+	for (u32 i = 0; is_ok && i != header.committed_count; ++i)
+	{
+		const CoreSnapshotRange range = committed_ranges[i];
+
+		is_ok = range.offset <= total_allocation_size
+		     && range.bytes <= total_allocation_size - range.offset
+		     && minos::mem_commit(memory + range.offset, range.bytes);
+	}
+
+	CoreSnapshotRange* const runs = is_ok
+		? static_cast<CoreSnapshotRange*>(malloc((header.run_count + 1) * sizeof(CoreSnapshotRange)))
+		: nullptr;
+
+	is_ok = runs != nullptr
+	     && snapshot_read(file, MutRange{ runs, header.run_count }.as_mut_byte_range(), &offset);
+
+	// Runs outside of committed memory make the read fail, so only the bounds
+	// of the reservation itself need checking.
+	for (u32 i = 0; is_ok && i != header.run_count; ++i)
+	{
+		const CoreSnapshotRange run = runs[i];
+
+		is_ok = run.offset <= total_allocation_size
+		     && run.bytes <= total_allocation_size - run.offset
+		     && snapshot_read(file, MutRange{ memory + run.offset, run.bytes }, &offset);
+	}
+
+	free(runs);
+
+	minos::file_close(file);
+
+	CoreData* const core = reinterpret_cast<CoreData*>(memory);
+
+	if (is_ok)
+	{
+		core->config = config;
+
+		error_sink_restore(core);
+
+		interpreter_restore(core);
+
+		instrumentation_restore(core);
+
+		is_ok = source_reader_restore(core);
+
+		if (is_ok)
+			comp_heap_restore(core);
+	}
+
+	if (!is_ok)
+	{
+		minos::mem_unreserve(memory, total_allocation_size);
+
+		return nullptr;
+	}
+
+	return core;
+}
+
+static bool run_compilation_phases(CoreData* core, bool main_is_std) noexcept
+{
+	// The prelude may already be present if `core` is a snapshot taken by
+	// `run_compilation_server`.
+	if (core->lex.prelude_file_id == SourceFileId::INVALID && !import_prelude(core, core->config->std.prelude.filepath))
 		return false;
 
 	const Maybe<TypeId> main_file_type_id = import_file(core, core->config->entrypoint.filepath, main_is_std);
@@ -308,6 +798,15 @@ bool run_compilation(CoreData* core, bool main_is_std) noexcept
 	return true;
 }
 
+bool run_compilation(CoreData* core, bool main_is_std) noexcept
+{
+	const bool is_ok = run_compilation_phases(core, main_is_std);
+
+	instrumentation_report(core);
+
+	return is_ok;
+}
+
 void* address_from_core_id(CoreData* core, CoreId id) noexcept
 {
 	ASSERT_OR_IGNORE((static_cast<u64>(id) << COMP_HEAP_MIN_ALLOCATION_SIZE_LOG2) >= sizeof(CoreData));
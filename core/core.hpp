@@ -123,11 +123,43 @@ struct Config
 		} prelude;
 	} std;
 
+	struct
+	{
+		bool map_files;
+
+		s64 prefetch_threads;
+	} sources;
+
+	struct
+	{
+		bool enabled;
+
+		Range<char8> directory;
+	} ast_cache;
+
+	struct
+	{
+		bool enabled;
+
+		Range<char8> directory;
+	} opcode_cache;
+
+	struct
+	{
+		bool enabled;
+
+		Range<char8> filepath;
+	} prelude_snapshot;
+
 	struct
 	{
 		u64 reserve;
 
 		u64 commit_increment;
+
+		u64 nursery_size;
+
+		u64 full_gc_threshold;
 	} heap;
 
 	struct
@@ -159,8 +191,19 @@ struct Config
 		} imports;
 
 		ConfigPrintSink config_sink;
+
+		ConfigPrintSink stats_sink;
+
+		ConfigPrintSink trace_sink;
 	} logging;
 
+	struct
+	{
+		ConfigPrintSink sink;
+
+		s64 sample_interval;
+	} profile;
+
 	struct
 	{
 		ConfigPrintSink sink;
@@ -199,6 +242,16 @@ void print_config_help(Sink sink, u32 depth = 0) noexcept
 
 Maybe<void*> comp_heap_alloc(CoreData* core, u64 size, u64 align) noexcept;
 
+// Allocates memory that is freed by the garbage collector once it is no
+// longer referenced, rather than by `comp_heap_dealloc`.
+// References are found by conservatively scanning all memory of `core`
+// outside the `CompHeap`, all other `CompHeap` allocations, and the native
+// stack for addresses and `CoreId`s pointing into the allocation. Only
+// `CoreId`s referring to its very beginning are recognized.
+// This may trigger a collection before allocating, and must thus not be
+// called while any `shadow_*` function is in progress.
+Maybe<void*> comp_heap_alloc_collectable(CoreData* core, u64 size, u64 align) noexcept;
+
 Maybe<void*> comp_heap_alloc_global_member(CoreData* core, u64 size, u64 align, TypeId type_id) noexcept;
 
 TypeId comp_heap_global_member_type(CoreData* core, byte* address) noexcept;
@@ -209,6 +262,22 @@ void comp_heap_dealloc(CoreData* core, MutRange<byte> memory) noexcept;
 
 
 
+// Frees all collectable allocations that are no longer referenced, also
+// removing their shadow data. Like `comp_heap_alloc_collectable`, this must
+// not be called while any `shadow_*` function is in progress.
+void comp_heap_collect(CoreData* core) noexcept;
+
+// Lifts the write protection the collector places on the old generation to
+// track references into the young one. This must be called before passing
+// heap memory to code that cannot cope with the protection, such as system
+// calls writing into it. Protection is restored by the next collection.
+void comp_heap_unprotect(CoreData* core) noexcept;
+
+// Building blocks of `comp_heap_collect`.
+// `comp_heap_gc_begin` considers everything except free memory and
+// collectable allocations to be alive. Collectable allocations are kept
+// alive by passing them to `comp_heap_gc_mark`, which returns `false` if they
+// were already marked. `comp_heap_gc_end` then releases everything else.
 void comp_heap_gc_begin(CoreData* core) noexcept;
 
 bool comp_heap_gc_mark(CoreData* core, MutRange<byte> memory) noexcept;
@@ -234,15 +303,14 @@ void temp_stack_release(CoreData* core, u64 mark) noexcept;
 // Identifier Pool.
 // This deduplicates identifiers, making it possible to refer to them with
 // fixed-size `IdentifierId`s.
-// Additionally supports storing an 8-bit attachment for each identifier, which
-// is currently used to distinguish keywords and builtins from other
-// identifiers.
+// Keywords and builtins are recognised by the lexer before reaching the pool,
+// so it only ever holds other identifiers.
 // This is created by `create_identifier_pool` and freed by
 // `release_identifier_pool`.
 struct IdentifierPool;
 
-// Id used to refer to an identifier. Obtained from `id_from_identifier` or
-// `id_and_attachment_from_identifier` and usable with
+// Id used to refer to an identifier. Obtained from `id_from_identifier` and
+// usable with
 // `identifier_name_from_id` to retrieve associated name.
 enum class IdentifierId : u32
 {
@@ -270,22 +338,9 @@ enum class IdentifierId : u32
 // guaranteed to return distinct `IdentifierId`s.
 IdentifierId id_from_identifier(CoreData* core, Range<char8> identifier) noexcept;
 
-// Same as `id_from_identifier`, but additionally sets `*out_attachment` to the
-// value previously set for the given `identifier` by
-// `identifier_set_attachment`, or `0` if no attachment has been set.
-// Note that this call will never return `INVALID_IDENTIFIER_ID`.
-IdentifierId id_and_attachment_from_identifier(CoreData* core, Range<char8> identifier, u8* out_attachment) noexcept;
-
-// Sets the attachment associated with `identifier` in the given
-// `IdentifierPool` to the given `attachment`. The given `identifier` must not
-// have previously had an attachment set.
-// Additionally, `attachment` must not be `0`.
-void identifier_set_attachment(CoreData* core, Range<char8> identifier, u8 attachment) noexcept;
-
 // Returns the byte-sequence corresponding to the given `IdentifierId` in the
 // given `IdentifierPool`. `id` must not be `INVALID_IDENTIFIER_ID` and must
-// have been returned from a previous call to `id_from_identifier` or
-// `id_and_attachment_from_identifier`.
+// have been returned from a previous call to `id_from_identifier`.
 Range<char8> identifier_name_from_id(const CoreData* core, IdentifierId id) noexcept;
 
 
@@ -1632,6 +1687,10 @@ struct SourceFile
 	// `SourceId` of the first byte in this file.
 	SourceId source_id_base;
 
+	// Hash of the file's content, identifying it in the AST and opcode caches.
+	// This is only set if at least one of them is enabled, and `0` otherwise.
+	u64 content_hash;
+
 	bool has_error;
 };
 
@@ -1696,9 +1755,10 @@ struct SourceLocation
 // content is no longer needed.
 SourceFileRead read_source_file(CoreData* core, Range<char8> filepath) noexcept;
 
-// Releases the contents and other associated resources of a `SourceFileRead`.
-// The `SourceFile` pointed to by the `source_file` member is however left
-// untouched.
+// Signals that the contents of a `SourceFileRead` are no longer needed for
+// parsing. The contents themselves stay resident until `core` is released, as
+// they are used to map `SourceId`s to `SourceLocation`s. The `SourceFile`
+// pointed to by the `source_file` member is left untouched.
 void release_read(CoreData* core, SourceFileRead read) noexcept;
 
 // Converts `source_id` to a `SourceLocation`.
@@ -2582,6 +2642,40 @@ Maybe<AstNode*> parse(CoreData* core, Range<char8> content, SourceId source_id_b
 
 
 
+// Persistent cache of parsed ASTs, stored as one file per source file in the
+// directory given by `Config.ast_cache.directory`. Files are keyed by
+// `content_hash` (see `SourceFile::content_hash`) and whether they were parsed
+// as part of the standard library, since the AST produced by `parse` depends
+// on nothing else. Their names additionally include the version of the file
+// format, so that entries written by older builds are simply ignored.
+// Cached ASTs are those returned by `parse`, meaning they still need to go
+// through name resolution.
+// If `Config.ast_cache.enabled` is `false`, all calls are no-ops.
+
+// Attempts to load the AST that `parse` would produce for the given arguments
+// from the cache. On success, the AST is allocated just like by `parse` and
+// its root node is returned. If there is no valid cache entry, `none` is
+// returned.
+Maybe<AstNode*> ast_cache_load(CoreData* core, Range<char8> content, u64 content_hash, SourceId source_id_base, bool is_std) noexcept;
+
+// Atomically replaces the file at `filepath` with `image`, whose `u32` magic
+// number at `magic_offset` is expected to be zero and is only set to `magic`
+// once the rest of the image has been written. Used for persistent cache
+// entries that may be read by concurrent compiler runs.
+// Returns `true` on success and `false` otherwise, in which case `filepath`
+// is left untouched.
+bool cache_file_write(Range<char8> filepath, Range<byte> image, u64 magic_offset, u32 magic) noexcept;
+
+// Stores the AST rooted at `root`, which must have been returned by the most
+// recent call to `parse`, in the cache. `content` and `is_std` must be the
+// arguments passed to that call.
+// Failure to write the cache entry is silently ignored.
+void ast_cache_store(CoreData* core, Range<char8> content, u64 content_hash, bool is_std, AstNode* root) noexcept;
+
+
+
+
+
 struct OpcodePool;
 
 enum class Opcode : u8
@@ -2664,6 +2758,45 @@ enum class Opcode : u8
 	Definition,
 	TypeType,
 	CompleteCircularDefinition,
+
+	// Quickened variants of `BinaryArithmeticOp` and `Compare` on integers of
+	// 8, 16, 32 or 64 bits. These are never emitted directly. Instead, the
+	// interpreter rewrites the generic opcode in place once it has seen the
+	// operand types, storing the operand width in bytes in place of the kind
+	// and the operand `TypeId` in the slot reserved for it.
+	// Execution checks that at least one operand has exactly that type and
+	// that the other either has it too or is a `CompInteger` that fits into
+	// it. If the check fails, the generic operation is performed instead.
+	// The order of these must match `OpcodeBinaryArithmeticOpKind` and
+	// `OpcodeCompareKind` respectively, with the signed variant first.
+	AddS,
+	AddU,
+	SubS,
+	SubU,
+	MulS,
+	MulU,
+	DivS,
+	DivU,
+	AddTCS,
+	AddTCU,
+	SubTCS,
+	SubTCU,
+	MulTCS,
+	MulTCU,
+	ModS,
+	ModU,
+	CmpLtS,
+	CmpLtU,
+	CmpGtS,
+	CmpGtU,
+	CmpLeS,
+	CmpLeU,
+	CmpGeS,
+	CmpGeU,
+	CmpNeS,
+	CmpNeU,
+	CmpEqS,
+	CmpEqU,
 };
 
 enum class OpcodeSliceKind : u8
@@ -2798,6 +2931,27 @@ SourceId source_id_of_opcode(CoreData* core, const Opcode* code) noexcept;
 
 bool return_type_opcodes_equal(CoreData* core, const Opcode* a_code, const Opcode* b_code) noexcept;
 
+// Attempts to load the initializers of all `member_count` top-level members
+// of the file identified by `file_id` from the opcode cache configured by
+// `Config.opcode_cache`, instead of generating them via
+// `opcodes_from_file_member_ast`. The cache is keyed by the `content_hash` of
+// the file and of the prelude, since name resolution binds to the prelude's
+// members, as well as by the version of the cache's file format.
+// On success, `true` is returned and `out_initializer_ids[rank]` holds the
+// initializer of the member with the respective rank. Otherwise, `false` is
+// returned.
+// This must be called before generating the file's initializers, as it also
+// prepares recording the information required by `opcode_cache_store`.
+bool opcode_cache_load(CoreData* core, SourceFileId file_id, u16 member_count, OpcodeId* out_initializer_ids) noexcept;
+
+// Stores the initializers of all `member_count` top-level members of the file
+// identified by `file_id` in the opcode cache. These must have been generated
+// by consecutive calls to `opcodes_from_file_member_ast` after a failed call
+// to `opcode_cache_load` for the same file, with `initializer_ids[rank]`
+// holding their results.
+// Failure to write the cache entry is silently ignored.
+void opcode_cache_store(CoreData* core, SourceFileId file_id, u16 member_count, const OpcodeId* initializer_ids) noexcept;
+
 const char8* tag_name(Opcode op) noexcept;
 
 
@@ -3001,9 +3155,169 @@ byte* shadow_get(CoreData* core, byte* address, ShadowLayoutId layout_id, u16 ra
 
 Maybe<byte*> shadow_try_get(CoreData* core, byte* address, ShadowLayoutId layout_id, u16 rank) noexcept;
 
+// Copies the shadow data of all addresses in `src` to the corresponding
+// addresses in `dst`. `dst` and `src` must have the same count.
+// Note that `src.end()` is considered part of the range, since zero-sized
+// values may be located there.
+// This only touches shadow entries actually located in `src`, meaning that
+// its cost does not scale with the size of `src` if there are none.
 void shadow_copy(CoreData* core, MutRange<byte> dst, MutRange<byte> src) noexcept;
 
-void shadow_clear(CoreData* core, byte* address) noexcept;
+// Removes the shadow data of all addresses in `memory`. As with
+// `shadow_copy`, `memory.end()` is considered part of the range.
+void shadow_clear(CoreData* core, MutRange<byte> memory) noexcept;
+
+// Checks whether any address in `memory` has shadow data. As with
+// `shadow_copy`, `memory.end()` is considered part of the range.
+// This never modifies the shadow store, so unlike the other `shadow_*`
+// functions it may be called while one of them is in progress.
+bool shadow_contains(CoreData* core, MutRange<byte> memory) noexcept;
+
+// Returns the memory reserved for the shadow store's address entries. These
+// only hold the addresses shadow data is attached to, which must not keep
+// anything alive, so the garbage collector skips them when scanning for roots.
+Range<byte> shadow_address_entry_memory(CoreData* core) noexcept;
+
+
+
+
+
+// Phases of compilation that are timed separately by the instrumentation
+// enabled through `logging.stats`. Time spent outside of all other phases is
+// attributed to `Other`.
+enum class InstrumentationPhase : u8
+{
+	Other = 0,
+	Read,
+	Parse,
+	ResolveNames,
+	EmitOpcodes,
+	Interpret,
+	GC,
+	MAX,
+};
+
+// Point in time as seen by the instrumentation. Obtained from
+// `instrumentation_timestamps`.
+struct InstrumentationTimestamps
+{
+	u64 wall;
+
+	u64 cpu;
+};
+
+// Makes `phase` the current phase until the matching call to
+// `instrumentation_leave_phase`. Phases nest, with time always being
+// attributed to the innermost one only.
+// This, as well as the other `instrumentation_*` functions, does nothing if
+// instrumentation is disabled.
+void instrumentation_enter_phase(CoreData* core, InstrumentationPhase phase) noexcept;
+
+// Ends the phase entered by the latest call to `instrumentation_enter_phase`.
+void instrumentation_leave_phase(CoreData* core) noexcept;
+
+// Returns the current wall and thread CPU time, for passing to
+// `instrumentation_record_import` later on. If instrumentation is disabled,
+// both are `0`.
+InstrumentationTimestamps instrumentation_timestamps(CoreData* core) noexcept;
+
+// Records the import of the file whose first byte is `source_id_base`, which
+// began at `begin`. The recorded time includes that of any imports
+// triggered while importing the file.
+void instrumentation_record_import(CoreData* core, SourceId source_id_base, InstrumentationTimestamps begin) noexcept;
+
+// Counts a lookup of a type structure in the `TypePool`'s interning map,
+// which is a hit if an equal structure was already present.
+void instrumentation_count_type_intern(CoreData* core, bool is_hit) noexcept;
+
+// Counts an attempt to load a parsed AST from the AST cache, which is a hit
+// if a valid entry was found.
+void instrumentation_count_ast_cache_load(CoreData* core, bool is_hit) noexcept;
+
+// Counts an attempt to load the initializers of a file from the opcode cache,
+// which is a hit if a valid entry was found.
+void instrumentation_count_opcode_cache_load(CoreData* core, bool is_hit) noexcept;
+
+// Counts an allocation of `bytes` bytes from the `CompHeap`.
+void instrumentation_count_heap_alloc(CoreData* core, u64 bytes) noexcept;
+
+// Counts a garbage collection of the `CompHeap` that freed `bytes` bytes.
+// `is_minor` indicates whether it only collected the young generation.
+void instrumentation_count_heap_gc(CoreData* core, bool is_minor, u64 bytes) noexcept;
+
+// Counts the execution of the opcode at `code`, and samples the interpreter's
+// call stack every `profile.sample-interval` executed opcodes if the profiler
+// is enabled through `profile.path`.
+// Unlike the other `instrumentation_*` functions, this must only be called if
+// at least one of `Instrumentation::enabled` and `Instrumentation::profiling`
+// is set, so that the interpreter's dispatch loop gets away with a single
+// check when neither is.
+void instrumentation_count_opcode(CoreData* core, const Opcode* code) noexcept;
+
+// Kinds of spans recorded in the trace enabled through `logging.trace`.
+enum class InstrumentationTraceKind : u8
+{
+	Import,
+	Initializer,
+	Call,
+	Builtin,
+};
+
+// Begins a span of kind `kind` in the trace, which lasts until the matching
+// call to `instrumentation_trace_end`. The span is labelled `name`, or the
+// location of `source_id` if `name` is empty, and refers to `source_id` as its
+// origin.
+// As determining `name` may not be free, callers check
+// `Instrumentation::tracing` before calling this.
+void instrumentation_trace_begin(CoreData* core, InstrumentationTraceKind kind, Range<char8> name, SourceId source_id) noexcept;
+
+// Ends the span begun by the latest call to `instrumentation_trace_begin`.
+void instrumentation_trace_end(CoreData* core) noexcept;
+
+// Writes a JSON summary of the times and counts recorded so far to the sink
+// configured as `logging.stats`, terminates the trace written to
+// `logging.trace`, and writes the sampled call stacks as folded stacks to
+// `profile.path`.
+void instrumentation_report(CoreData* core) noexcept;
+
+// Totals recorded by the instrumentation so far, for consumers that want to
+// process them directly rather than parse the output of
+// `instrumentation_report`. Times are in ticks of `minos::exact_timestamp`
+// and `minos::exact_thread_cpu_time` respectively.
+struct InstrumentationSummary
+{
+	u64 phase_wall_ticks[static_cast<u8>(InstrumentationPhase::MAX)];
+
+	u64 phase_cpu_ticks[static_cast<u8>(InstrumentationPhase::MAX)];
+
+	u64 opcode_count;
+
+	u64 type_intern_hits;
+
+	u64 type_intern_misses;
+
+	u64 ast_cache_hits;
+
+	u64 ast_cache_misses;
+
+	u64 opcode_cache_hits;
+
+	u64 opcode_cache_misses;
+
+	u64 heap_alloc_count;
+
+	u64 heap_alloc_bytes;
+
+	u64 heap_gc_count;
+
+	u64 heap_minor_gc_count;
+
+	u64 heap_gc_bytes;
+};
+
+// Retrieves the totals recorded so far, charging time spent in the current
+// phase up to now. If instrumentation is disabled, all of them are `0`.
+InstrumentationSummary instrumentation_summary(CoreData* core) noexcept;
 
 
 
@@ -3068,8 +3382,53 @@ CoreData* create_core_data(const Config* config) noexcept;
 
 void release_core_data(CoreData* core) noexcept;
 
+// Writes the state of `core` to the file at `filepath`, from which
+// `create_core_data_from_snapshot` can later recreate it in a different
+// process. This is intended to be called right after importing the prelude.
+// As the addresses of foreign functions are process-specific, no snapshot is
+// written if any library was loaded through `std.foreign_function` so far.
+// Returns `true` if the snapshot was written successfully.
+bool core_data_snapshot(CoreData* core, Range<char8> filepath) noexcept;
+
+// Recreates a `CoreData` from a snapshot written by `core_data_snapshot`,
+// which takes far less time than `create_core_data` followed by importing the
+// prelude. The result has to be released with `release_core_data` as usual.
+// As the snapshotted state contains absolute addresses, it is restored at the
+// address it was snapshotted from. If that address is unavailable, the
+// snapshot was written by a different build or for a configuration differing
+// in anything other than its entrypoint, diagnostics and logging, or any
+// source file read before the snapshot has since changed, `nullptr` is
+// returned, and the caller has to fall back to `create_core_data`.
+CoreData* create_core_data_from_snapshot(const Config* config, Range<char8> filepath) noexcept;
+
+// Imports the prelude - unless it has already been imported into `core` - and
+// the configured entrypoint, and evaluates either the entrypoint symbol or,
+// with `compile_all` set, all of the entrypoint file's definitions.
+// Afterwards, the instrumentation summary is written to `logging.stats` if
+// that is enabled.
 bool run_compilation(CoreData* core, bool main_is_std) noexcept;
 
+// Runs a compilation server that serves requests sent by
+// `request_compilation` over the local socket at `socket_path`.
+// The server imports the prelude configured in `config` once, and then serves
+// every request from a copy-on-write fork of the resulting state, which saves
+// each request the cost of setting up a `CoreData` and importing the prelude.
+// Requests take their entrypoint and `compile_all` from their own
+// configuration file. All other settings are those of `config`, unless the
+// request's prelude differs from it, in which case the request is compiled
+// from scratch using only its own configuration.
+// This only returns if setting up the server or accepting a connection
+// fails, and is not supported on Windows.
+bool run_compilation_server(const Config* config, Range<char8> socket_path) noexcept;
+
+// Asks the compilation server listening on `socket_path` to compile the
+// program configured by the TOML file at `config_filepath`. Output of the
+// compilation goes to the calling process's standard output and error.
+// If no server could be reached, `false` is returned, and the caller is
+// expected to compile locally instead. Otherwise, the server's exit code for
+// the compilation is stored in `*out_exit_code` and `true` is returned.
+bool request_compilation(Range<char8> socket_path, Range<char8> config_filepath, u32* out_exit_code) noexcept;
+
 void* address_from_core_id(CoreData* core, CoreId id) noexcept;
 
 CoreId core_id_from_address(CoreData* core, const void* memory) noexcept;
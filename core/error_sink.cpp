@@ -209,18 +209,12 @@ MemoryRequirements error_sink_memory_requirements([[maybe_unused]] const Config*
 	return reqs;
 }
 
-void error_sink_init(CoreData* core, MemoryAllocation allocation) noexcept
+static void init_diagnostics_sink(CoreData* core) noexcept
 {
-	ASSERT_OR_IGNORE(allocation.ranges[0].count() == MAX_ERROR_RECORD_COUNT * sizeof(ErrorRecord));
-
 	ErrorSink* const errors = &core->errors;
 
-	errors->error_count = 0;
-
 	errors->source_tab_size = static_cast<u8>(core->config->diagnostics.source_tab_size);
 
-	errors->records.init(allocation.ranges[0], 1024);
-
 	const bool enabled = core->config->diagnostics.sink.name_and_enabled.attachment();
 
 	errors->enabled = enabled;
@@ -229,6 +223,24 @@ void error_sink_init(CoreData* core, MemoryAllocation allocation) noexcept
 		errors->sink = core->config->diagnostics.sink.sink;
 }
 
+void error_sink_init(CoreData* core, MemoryAllocation allocation) noexcept
+{
+	ASSERT_OR_IGNORE(allocation.ranges[0].count() == MAX_ERROR_RECORD_COUNT * sizeof(ErrorRecord));
+
+	ErrorSink* const errors = &core->errors;
+
+	errors->error_count = 0;
+
+	errors->records.init(allocation.ranges[0], 1024);
+
+	init_diagnostics_sink(core);
+}
+
+void error_sink_restore(CoreData* core) noexcept
+{
+	init_diagnostics_sink(core);
+}
+
 
 
 void record_error(CoreData* core, SourceId source_id, CompileError error) noexcept
@@ -7,7 +7,7 @@
 #include "../infra/assert.hpp"
 #include "../infra/range.hpp"
 #include "../infra/hash.hpp"
-#include "../infra/container/id_map.hpp"
+#include "../infra/container/group_id_map.hpp"
 
 #include <cstddef>
 
@@ -17,8 +17,6 @@ struct alignas(8) IdentifierEntry
 
 	u16 m_length;
 
-	u8 m_attachment;
-
 	#if COMPILER_GCC
 		#pragma GCC diagnostic push
 		#pragma GCC diagnostic ignored "-Wpedantic" // ISO C++ forbids flexible array member
@@ -117,7 +115,6 @@ IdentifierEntry* IdentifierAlloc::alloc(Range<char8> key, u32 key_hash) noexcept
 	IdentifierEntry* const result = reinterpret_cast<IdentifierEntry*>(core->identifiers.entries.reserve(size));
 	result->m_hash = key_hash;
 	result->m_length = static_cast<u16>(key.count());
-	result->m_attachment = 0;
 	memcpy(result->m_chars, key.begin(), key.count());
 
 	return result;
@@ -162,29 +159,22 @@ void identifier_pool_init(CoreData* core, MemoryAllocation allocation) noexcept
 
 
 
-IdentifierId id_from_identifier(CoreData* core, Range<char8> identifier) noexcept
-{
-	return static_cast<IdentifierId>(core->identifiers.map.id_from(identifier, fnv1a(identifier.as_byte_range())) + static_cast<u32>(IdentifierId::FirstNatural));
-}
-
-IdentifierId id_and_attachment_from_identifier(CoreData* core, Range<char8> identifier, u8* out_token) noexcept
+// Identifiers are looked up once for every occurrence in the source, so their
+// hash is on the lexer's hot path. The word-wise `wyhash` is only slower than
+// the byte-wise `fnv1a` for identifiers of one or two characters, and well
+// ahead on the mix found in real sources. See `bench/hash_bench.cpp`.
+static u32 identifier_hash(Range<char8> identifier) noexcept
 {
-	const IdentifierEntry* const entry = core->identifiers.map.value_from(identifier, fnv1a(identifier.as_byte_range()));
-
-	*out_token = entry->m_attachment;
-
-	return static_cast<IdentifierId>(core->identifiers.map.id_from(entry) + static_cast<u32>(IdentifierId::FirstNatural));
+	#if IDENTIFIER_POOL_FNV1A_HASH
+		return fnv1a(identifier.as_byte_range());
+	#else
+		return wyhash(identifier.as_byte_range());
+	#endif
 }
 
-void identifier_set_attachment(CoreData* core, Range<char8> identifier, u8 attachment) noexcept
+IdentifierId id_from_identifier(CoreData* core, Range<char8> identifier) noexcept
 {
-	ASSERT_OR_IGNORE(attachment != 0);
-
-	IdentifierEntry* const entry = core->identifiers.map.value_from(identifier, fnv1a(identifier.as_byte_range()));
-
-	ASSERT_OR_IGNORE(entry->m_attachment == 0);
-
-	entry->m_attachment = attachment;
+	return static_cast<IdentifierId>(core->identifiers.map.id_from(identifier, identifier_hash(identifier)) + static_cast<u32>(IdentifierId::FirstNatural));
 }
 
 Range<char8> identifier_name_from_id(const CoreData* core, IdentifierId id) noexcept
@@ -0,0 +1,704 @@
+#include "core.hpp"
+#include "structure.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/assert.hpp"
+#include "../infra/range.hpp"
+#include "../infra/hash.hpp"
+#include "../infra/container/reserved_vec.hpp"
+#include "../infra/container/id_map.hpp"
+#include "../infra/minos/minos.hpp"
+#include "../infra/print/print.hpp"
+
+#include <cstring>
+#include <cstddef>
+
+struct alignas(8) InstrumentationProfileEntry
+{
+	u32 m_hash;
+
+	u32 m_frame_count;
+
+	u64 m_sample_count;
+
+	#if COMPILER_GCC
+		#pragma GCC diagnostic push
+		#pragma GCC diagnostic ignored "-Wpedantic" // ISO C++ forbids flexible array member
+	#endif
+	// Source locations of the sampled call stack's frames, starting with the
+	// outermost call.
+	SourceId m_frames[];
+	#if COMPILER_GCC
+		#pragma GCC diagnostic pop
+	#endif
+
+	u32 hash() const noexcept
+	{
+		return m_hash;
+	}
+
+	bool is_equal_to_key(Range<SourceId> key, u32 key_hash) const noexcept
+	{
+		return m_hash == key_hash && key.count() == m_frame_count && memcmp(key.begin(), m_frames, m_frame_count * sizeof(SourceId)) == 0;
+	}
+};
+
+static constexpr u32 MAX_PHASE_DEPTH = 1 << 16;
+
+static constexpr u32 MAX_IMPORT_COUNT = 1 << 20;
+
+// Samples deeper than this only keep their innermost frames.
+static constexpr u32 MAX_PROFILE_DEPTH = 1 << 14;
+
+static constexpr u64 PROFILE_LOOKUP_RESERVE = decltype(Instrumentation::profile_map)::lookups_memory_size(static_cast<u32>(1) << 20);
+
+static constexpr u32 PROFILE_LOOKUP_INITIAL_COMMIT_COUNT = 512;
+
+static constexpr u64 PROFILE_ENTRY_RESERVE = static_cast<u64>(1) << 26;
+
+static constexpr u64 PROFILE_FRAMES_RESERVE = MAX_PROFILE_DEPTH * sizeof(SourceId);
+
+static constexpr u32 PROFILE_ENTRY_COMMIT_INCREMENT = static_cast<u32>(1) << 16;
+
+
+
+bool InstrumentationProfileIterator::has_next() const noexcept
+{
+	ASSERT_OR_IGNORE(curr <= end);
+
+	return curr != end;
+}
+
+InstrumentationProfileEntry* InstrumentationProfileIterator::next() noexcept
+{
+	ASSERT_OR_IGNORE(curr < end);
+
+	InstrumentationProfileEntry* const result = reinterpret_cast<InstrumentationProfileEntry*>(core->instrumentation.profile_entries.begin() + curr * alignof(InstrumentationProfileEntry));
+
+	const u64 size = (offsetof(InstrumentationProfileEntry, m_frames) + result->m_frame_count * sizeof(SourceId) + alignof(InstrumentationProfileEntry) - 1) & ~(alignof(InstrumentationProfileEntry) - 1);
+
+	curr += static_cast<u32>(size / alignof(InstrumentationProfileEntry));
+
+	return result;
+}
+
+
+
+InstrumentationProfileEntry* InstrumentationProfileAlloc::value_from_id(u32 id) noexcept
+{
+	ASSERT_OR_IGNORE(id * alignof(InstrumentationProfileEntry) < core->instrumentation.profile_entries.used());
+
+	return reinterpret_cast<InstrumentationProfileEntry*>(core->instrumentation.profile_entries.begin() + id * alignof(InstrumentationProfileEntry));
+}
+
+const InstrumentationProfileEntry* InstrumentationProfileAlloc::value_from_id(u32 id) const noexcept
+{
+	ASSERT_OR_IGNORE(id * alignof(InstrumentationProfileEntry) < core->instrumentation.profile_entries.used());
+
+	return reinterpret_cast<InstrumentationProfileEntry*>(core->instrumentation.profile_entries.begin() + id * alignof(InstrumentationProfileEntry));
+}
+
+u32 InstrumentationProfileAlloc::id_from_value(const InstrumentationProfileEntry* value) const noexcept
+{
+	ASSERT_OR_IGNORE(reinterpret_cast<const byte*>(value) >= core->instrumentation.profile_entries.begin());
+
+	ASSERT_OR_IGNORE(reinterpret_cast<const byte*>(value) < core->instrumentation.profile_entries.end());
+
+	return static_cast<u32>((reinterpret_cast<const byte*>(value) - core->instrumentation.profile_entries.begin()) / alignof(InstrumentationProfileEntry));
+}
+
+InstrumentationProfileIterator InstrumentationProfileAlloc::values() noexcept
+{
+	InstrumentationProfileIterator it;
+	it.core = core;
+	it.curr = 0;
+	it.end = core->instrumentation.profile_entries.used() / alignof(InstrumentationProfileEntry);
+
+	return it;
+}
+
+InstrumentationProfileEntry* InstrumentationProfileAlloc::alloc(Range<SourceId> key, u32 key_hash) noexcept
+{
+	const u32 raw_size = static_cast<u32>(offsetof(InstrumentationProfileEntry, m_frames) + key.count() * sizeof(SourceId));
+
+	const u32 size = (raw_size + alignof(InstrumentationProfileEntry) - 1) & ~(alignof(InstrumentationProfileEntry) - 1);
+
+	InstrumentationProfileEntry* const result = reinterpret_cast<InstrumentationProfileEntry*>(core->instrumentation.profile_entries.reserve(size));
+	result->m_hash = key_hash;
+	result->m_frame_count = static_cast<u32>(key.count());
+	result->m_sample_count = 0;
+	memcpy(result->m_frames, key.begin(), key.count() * sizeof(SourceId));
+
+	return result;
+}
+
+void InstrumentationProfileAlloc::dealloc([[maybe_unused]] u32 id) noexcept
+{
+	ASSERT_UNREACHABLE;
+}
+
+
+
+
+static const char8* phase_name(InstrumentationPhase phase) noexcept
+{
+	static constexpr const char8* PHASE_NAMES[] = {
+		"other",
+		"read",
+		"parse",
+		"resolve_names",
+		"emit_opcodes",
+		"interpret",
+		"gc",
+	};
+
+	static_assert(array_count(PHASE_NAMES) == static_cast<u8>(InstrumentationPhase::MAX));
+
+	ASSERT_OR_IGNORE(static_cast<u8>(phase) < array_count(PHASE_NAMES));
+
+	return PHASE_NAMES[static_cast<u8>(phase)];
+}
+
+static const char8* trace_kind_name(InstrumentationTraceKind kind) noexcept
+{
+	static constexpr const char8* TRACE_KIND_NAMES[] = {
+		"import",
+		"initializer",
+		"call",
+		"builtin",
+	};
+
+	ASSERT_OR_IGNORE(static_cast<u8>(kind) < array_count(TRACE_KIND_NAMES));
+
+	return TRACE_KIND_NAMES[static_cast<u8>(kind)];
+}
+
+static u64 nanoseconds_from_ticks(u64 ticks, u64 ticks_per_second) noexcept
+{
+	// Split to avoid overflowing on long runs with high-resolution clocks.
+	return (ticks / ticks_per_second) * 1'000'000'000 + (ticks % ticks_per_second) * 1'000'000'000 / ticks_per_second;
+}
+
+static InstrumentationTimestamps current_timestamps() noexcept
+{
+	return InstrumentationTimestamps{ minos::exact_timestamp(), minos::exact_thread_cpu_time() };
+}
+
+// Attributes the time since the innermost phase was last entered or resumed to
+// that phase, and restarts its measurement.
+static void charge_current_phase(Instrumentation* instrumentation) noexcept
+{
+	ASSERT_OR_IGNORE(instrumentation->phases.used() != 0);
+
+	const InstrumentationTimestamps now = current_timestamps();
+
+	const u8 ordinal = static_cast<u8>(instrumentation->phases.end()[-1]);
+
+	instrumentation->phase_wall_ticks[ordinal] += now.wall - instrumentation->phase_begin.wall;
+
+	instrumentation->phase_cpu_ticks[ordinal] += now.cpu - instrumentation->phase_begin.cpu;
+
+	instrumentation->phase_begin = now;
+}
+
+static void print_json_string(PrintSink sink, Range<char8> string) noexcept
+{
+	print(sink, "\"");
+
+	u64 chunk_begin = 0;
+
+	for (u64 i = 0; i != string.count(); ++i)
+	{
+		const char8 c = string[i];
+
+		if (c != '"' && c != '\\' && static_cast<u8>(c) >= 0x20)
+			continue;
+
+		print(sink, "%", string.subrange(chunk_begin, i - chunk_begin));
+
+		if (c == '"' || c == '\\')
+			print(sink, "\\%", Range<char8>{ &c, 1 });
+		else
+			print(sink, "\\u00%[>02|X]", static_cast<u8>(c));
+
+		chunk_begin = i + 1;
+	}
+
+	print(sink, "%\"", string.subrange(chunk_begin));
+}
+
+// Writes the part of a trace event common to all phases, leaving it open for
+// phase-specific fields to be appended.
+static void print_trace_event_prefix(Instrumentation* instrumentation, char8 phase) noexcept
+{
+	const u64 ns = nanoseconds_from_ticks(minos::exact_timestamp() - instrumentation->trace_begin_wall, minos::exact_timestamp_ticks_per_second());
+
+	print(instrumentation->trace_sink, "%{ \"ph\": \"%\", \"ts\": %.%[>03], \"pid\": 1, \"tid\": 1",
+		instrumentation->has_trace_events ? ",\n" : "[\n",
+		Range<char8>{ &phase, 1 },
+		ns / 1000,
+		ns % 1000
+	);
+
+	instrumentation->has_trace_events = true;
+}
+
+static void init_sinks(CoreData* core) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	const bool enabled = core->config->logging.stats_sink.name_and_enabled.attachment();
+
+	instrumentation->enabled = enabled;
+
+	if (enabled)
+		instrumentation->sink = core->config->logging.stats_sink.sink;
+
+	instrumentation->phase_begin = enabled ? current_timestamps() : InstrumentationTimestamps{};
+
+	const bool tracing = core->config->logging.trace_sink.name_and_enabled.attachment();
+
+	instrumentation->tracing = tracing;
+
+	instrumentation->has_trace_events = false;
+
+	if (tracing)
+		instrumentation->trace_sink = core->config->logging.trace_sink.sink;
+
+	instrumentation->trace_begin_wall = minos::exact_timestamp();
+
+	const bool profiling = core->config->profile.sink.name_and_enabled.attachment();
+
+	instrumentation->profiling = profiling;
+
+	if (profiling)
+		instrumentation->profile_sink = core->config->profile.sink.sink;
+
+	instrumentation->profile_sample_interval = static_cast<u32>(core->config->profile.sample_interval);
+
+	instrumentation->profile_countdown = instrumentation->profile_sample_interval;
+}
+
+// Records the interpreter's current call stack, with `code` being the opcode
+// about to be executed in the innermost frame.
+static void take_profile_sample(CoreData* core, const Opcode* code) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	const u32 call_count = core->interp.call_activation_indices.used();
+
+	const u32 first_call = call_count < MAX_PROFILE_DEPTH ? 0 : call_count - MAX_PROFILE_DEPTH + 1;
+
+	instrumentation->profile_frames.reset();
+
+	// Every call's activation holds the opcode execution resumes at in its
+	// caller. This directly follows the `Call` opcode, so its preceding byte
+	// belongs to the call site.
+	for (u32 i = first_call; i != call_count; ++i)
+	{
+		const u32 activation_index = core->interp.call_activation_indices.begin()[i];
+
+		const Opcode* const activation_code = opcode_from_id(core, core->interp.activations.begin()[activation_index]);
+
+		instrumentation->profile_frames.append(source_id_of_opcode(core, activation_code - 1));
+	}
+
+	instrumentation->profile_frames.append(source_id_of_opcode(core, code));
+
+	const Range<SourceId> frames{ instrumentation->profile_frames.begin(), instrumentation->profile_frames.used() };
+
+	InstrumentationProfileEntry* const entry = instrumentation->profile_map.value_from(frames, fnv1a(frames.as_byte_range()));
+
+	entry->m_sample_count += 1;
+}
+
+// Writes `location` as a frame of a folded stack. As frames are separated by
+// semicolons, these are replaced in the file path.
+static void print_profile_frame(PrintSink sink, SourceLocation location) noexcept
+{
+	const Range<char8> filepath = location.filepath;
+
+	u64 chunk_begin = 0;
+
+	for (u64 i = 0; i != filepath.count(); ++i)
+	{
+		if (filepath[i] != ';')
+			continue;
+
+		print(sink, "%_", filepath.subrange(chunk_begin, i - chunk_begin));
+
+		chunk_begin = i + 1;
+	}
+
+	print(sink, "%:%:%", filepath.subrange(chunk_begin), location.line_number, location.column_number);
+}
+
+
+
+bool instrumentation_validate_config([[maybe_unused]] const Config* config, [[maybe_unused]] PrintSink sink) noexcept
+{
+	return true;
+}
+
+MemoryRequirements instrumentation_memory_requirements([[maybe_unused]] const Config* config) noexcept
+{
+	MemoryRequirements reqs;
+	reqs.count = 3;
+	reqs.ranges[0].size = MAX_PHASE_DEPTH * sizeof(InstrumentationPhase);
+	reqs.ranges[0].max_offset = UINT64_MAX;
+	reqs.ranges[1].size = MAX_IMPORT_COUNT * sizeof(InstrumentationImport);
+	reqs.ranges[1].max_offset = UINT64_MAX;
+	reqs.ranges[2].size = PROFILE_LOOKUP_RESERVE + PROFILE_ENTRY_RESERVE + PROFILE_FRAMES_RESERVE;
+	reqs.ranges[2].max_offset = UINT64_MAX;
+
+	return reqs;
+}
+
+void instrumentation_init(CoreData* core, MemoryAllocation allocation) noexcept
+{
+	ASSERT_OR_IGNORE(allocation.ranges[0].count() == MAX_PHASE_DEPTH * sizeof(InstrumentationPhase));
+
+	ASSERT_OR_IGNORE(allocation.ranges[1].count() == MAX_IMPORT_COUNT * sizeof(InstrumentationImport));
+
+	ASSERT_OR_IGNORE(allocation.ranges[2].count() == PROFILE_LOOKUP_RESERVE + PROFILE_ENTRY_RESERVE + PROFILE_FRAMES_RESERVE);
+
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	instrumentation->phases.init(allocation.ranges[0], 4096);
+
+	instrumentation->phases.append(InstrumentationPhase::Other);
+
+	instrumentation->imports.init(allocation.ranges[1], 1024);
+
+	const MutRange<byte> profile_lookups_memory = allocation.ranges[2].mut_subrange(0, PROFILE_LOOKUP_RESERVE);
+
+	const MutRange<byte> profile_entries_memory = allocation.ranges[2].mut_subrange(PROFILE_LOOKUP_RESERVE, PROFILE_ENTRY_RESERVE);
+
+	const MutRange<byte> profile_frames_memory = allocation.ranges[2].mut_subrange(PROFILE_LOOKUP_RESERVE + PROFILE_ENTRY_RESERVE, PROFILE_FRAMES_RESERVE);
+
+	instrumentation->profile_map.init(profile_lookups_memory, PROFILE_LOOKUP_INITIAL_COMMIT_COUNT, InstrumentationProfileAlloc{ core });
+
+	instrumentation->profile_entries.init(profile_entries_memory, PROFILE_ENTRY_COMMIT_INCREMENT);
+
+	instrumentation->profile_frames.init(profile_frames_memory, 1024);
+
+	init_sinks(core);
+}
+
+void instrumentation_restore(CoreData* core) noexcept
+{
+	// Thread CPU times are not comparable across processes, so measurement
+	// restarts from the point of restoring. The trace starts over as well, as
+	// it goes to a sink of this process.
+	init_sinks(core);
+}
+
+
+
+void instrumentation_enter_phase(CoreData* core, InstrumentationPhase phase) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->enabled)
+		return;
+
+	charge_current_phase(instrumentation);
+
+	instrumentation->phases.append(phase);
+}
+
+void instrumentation_leave_phase(CoreData* core) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->enabled)
+		return;
+
+	ASSERT_OR_IGNORE(instrumentation->phases.used() > 1);
+
+	charge_current_phase(instrumentation);
+
+	instrumentation->phases.pop_by(1);
+}
+
+InstrumentationTimestamps instrumentation_timestamps(CoreData* core) noexcept
+{
+	if (!core->instrumentation.enabled)
+		return InstrumentationTimestamps{};
+
+	return current_timestamps();
+}
+
+void instrumentation_record_import(CoreData* core, SourceId source_id_base, InstrumentationTimestamps begin) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->enabled)
+		return;
+
+	const InstrumentationTimestamps now = current_timestamps();
+
+	instrumentation->imports.append(InstrumentationImport{ source_id_base, now.wall - begin.wall, now.cpu - begin.cpu });
+}
+
+void instrumentation_count_type_intern(CoreData* core, bool is_hit) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->enabled)
+		return;
+
+	if (is_hit)
+		instrumentation->type_intern_hits += 1;
+	else
+		instrumentation->type_intern_misses += 1;
+}
+
+void instrumentation_count_ast_cache_load(CoreData* core, bool is_hit) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->enabled)
+		return;
+
+	if (is_hit)
+		instrumentation->ast_cache_hits += 1;
+	else
+		instrumentation->ast_cache_misses += 1;
+}
+
+void instrumentation_count_opcode_cache_load(CoreData* core, bool is_hit) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->enabled)
+		return;
+
+	if (is_hit)
+		instrumentation->opcode_cache_hits += 1;
+	else
+		instrumentation->opcode_cache_misses += 1;
+}
+
+void instrumentation_count_heap_alloc(CoreData* core, u64 bytes) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->enabled)
+		return;
+
+	instrumentation->heap_alloc_count += 1;
+
+	instrumentation->heap_alloc_bytes += bytes;
+}
+
+void instrumentation_count_heap_gc(CoreData* core, bool is_minor, u64 bytes) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->enabled)
+		return;
+
+	instrumentation->heap_gc_count += 1;
+
+	if (is_minor)
+		instrumentation->heap_minor_gc_count += 1;
+
+	instrumentation->heap_gc_bytes += bytes;
+}
+
+void instrumentation_count_opcode(CoreData* core, const Opcode* code) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	ASSERT_OR_IGNORE(instrumentation->enabled || instrumentation->profiling);
+
+	if (instrumentation->enabled)
+		instrumentation->opcode_counts[static_cast<u8>(*code) & 0x7F] += 1;
+
+	if (!instrumentation->profiling)
+		return;
+
+	instrumentation->profile_countdown -= 1;
+
+	if (instrumentation->profile_countdown != 0)
+		return;
+
+	instrumentation->profile_countdown = instrumentation->profile_sample_interval;
+
+	take_profile_sample(core, code);
+}
+
+void instrumentation_trace_begin(CoreData* core, InstrumentationTraceKind kind, Range<char8> name, SourceId source_id) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->tracing)
+		return;
+
+	const SourceLocation location = source_location_from_source_id(core, source_id);
+
+	char8 source_buf[minos::MAX_PATH_CHARS + 16];
+
+	const s64 source_chars = print(print_make_sink(MutRange{ source_buf }), "%:%", location.filepath, location.line_number);
+
+	const Range<char8> source{ source_buf, source_chars < 0 || source_chars > static_cast<s64>(array_count(source_buf)) ? array_count(source_buf) : static_cast<u64>(source_chars) };
+
+	print_trace_event_prefix(instrumentation, 'B');
+
+	print(instrumentation->trace_sink, ", \"cat\": \"%\", \"name\": ", trace_kind_name(kind));
+
+	print_json_string(instrumentation->trace_sink, name.count() == 0 ? source : name);
+
+	print(instrumentation->trace_sink, ", \"args\": { \"source\": ");
+
+	print_json_string(instrumentation->trace_sink, source);
+
+	print(instrumentation->trace_sink, " } }");
+}
+
+void instrumentation_trace_end(CoreData* core) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (!instrumentation->tracing)
+		return;
+
+	print_trace_event_prefix(instrumentation, 'E');
+
+	print(instrumentation->trace_sink, " }");
+}
+
+void instrumentation_report(CoreData* core) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	if (instrumentation->tracing)
+		print(instrumentation->trace_sink, instrumentation->has_trace_events ? "\n]\n" : "[]\n");
+
+	if (instrumentation->profiling)
+	{
+		InstrumentationProfileIterator it = InstrumentationProfileAlloc{ core }.values();
+
+		while (it.has_next())
+		{
+			const InstrumentationProfileEntry* const entry = it.next();
+
+			for (u32 i = 0; i != entry->m_frame_count; ++i)
+			{
+				if (i != 0)
+					print(instrumentation->profile_sink, ";");
+
+				print_profile_frame(instrumentation->profile_sink, source_location_from_source_id(core, entry->m_frames[i]));
+			}
+
+			print(instrumentation->profile_sink, " %\n", entry->m_sample_count);
+		}
+	}
+
+	if (!instrumentation->enabled)
+		return;
+
+	charge_current_phase(instrumentation);
+
+	const PrintSink sink = instrumentation->sink;
+
+	const u64 wall_ticks_per_second = minos::exact_timestamp_ticks_per_second();
+
+	const u64 cpu_ticks_per_second = minos::exact_thread_cpu_time_ticks_per_second();
+
+	print(sink, "{\n\t\"phases\": [");
+
+	for (u8 i = 0; i != static_cast<u8>(InstrumentationPhase::MAX); ++i)
+	{
+		print(sink, "%\n\t\t{ \"name\": \"%\", \"wall_ns\": %, \"cpu_ns\": % }",
+			i == 0 ? "" : ",",
+			phase_name(static_cast<InstrumentationPhase>(i)),
+			nanoseconds_from_ticks(instrumentation->phase_wall_ticks[i], wall_ticks_per_second),
+			nanoseconds_from_ticks(instrumentation->phase_cpu_ticks[i], cpu_ticks_per_second)
+		);
+	}
+
+	print(sink, "\n\t],\n\t\"imports\": [");
+
+	for (u32 i = 0; i != instrumentation->imports.used(); ++i)
+	{
+		const InstrumentationImport* const import = instrumentation->imports.begin() + i;
+
+		const SourceLocation location = source_location_from_source_id(core, import->source_id_base);
+
+		print(sink, "%\n\t\t{ \"path\": ", i == 0 ? "" : ",");
+
+		print_json_string(sink, location.filepath);
+
+		print(sink, ", \"wall_ns\": %, \"cpu_ns\": % }",
+			nanoseconds_from_ticks(import->wall_ticks, wall_ticks_per_second),
+			nanoseconds_from_ticks(import->cpu_ticks, cpu_ticks_per_second)
+		);
+	}
+
+	print(sink, "\n\t],\n\t\"opcodes\": {");
+
+	bool is_first_opcode = true;
+
+	for (u8 i = 0; i != array_count(instrumentation->opcode_counts); ++i)
+	{
+		if (instrumentation->opcode_counts[i] == 0)
+			continue;
+
+		print(sink, "%\n\t\t\"%\": %", is_first_opcode ? "" : ",", tag_name(static_cast<Opcode>(i)), instrumentation->opcode_counts[i]);
+
+		is_first_opcode = false;
+	}
+
+	print(sink, "\n\t},\n\t\"type_interning\": { \"hits\": %, \"misses\": % },\n", instrumentation->type_intern_hits, instrumentation->type_intern_misses);
+
+	print(sink, "\t\"ast_cache\": { \"hits\": %, \"misses\": % },\n", instrumentation->ast_cache_hits, instrumentation->ast_cache_misses);
+
+	print(sink, "\t\"opcode_cache\": { \"hits\": %, \"misses\": % },\n", instrumentation->opcode_cache_hits, instrumentation->opcode_cache_misses);
+
+	print(sink, "\t\"heap\": { \"allocations\": %, \"allocated_bytes\": %, \"collections\": %, \"minor_collections\": %, \"collected_bytes\": % }\n}\n", instrumentation->heap_alloc_count, instrumentation->heap_alloc_bytes, instrumentation->heap_gc_count, instrumentation->heap_minor_gc_count, instrumentation->heap_gc_bytes);
+}
+
+InstrumentationSummary instrumentation_summary(CoreData* core) noexcept
+{
+	Instrumentation* const instrumentation = &core->instrumentation;
+
+	InstrumentationSummary summary{};
+
+	if (!instrumentation->enabled)
+		return summary;
+
+	charge_current_phase(instrumentation);
+
+	memcpy(summary.phase_wall_ticks, instrumentation->phase_wall_ticks, sizeof(summary.phase_wall_ticks));
+
+	memcpy(summary.phase_cpu_ticks, instrumentation->phase_cpu_ticks, sizeof(summary.phase_cpu_ticks));
+
+	for (const u64 count : instrumentation->opcode_counts)
+		summary.opcode_count += count;
+
+	summary.type_intern_hits = instrumentation->type_intern_hits;
+
+	summary.type_intern_misses = instrumentation->type_intern_misses;
+
+	summary.ast_cache_hits = instrumentation->ast_cache_hits;
+
+	summary.ast_cache_misses = instrumentation->ast_cache_misses;
+
+	summary.opcode_cache_hits = instrumentation->opcode_cache_hits;
+
+	summary.opcode_cache_misses = instrumentation->opcode_cache_misses;
+
+	summary.heap_alloc_count = instrumentation->heap_alloc_count;
+
+	summary.heap_alloc_bytes = instrumentation->heap_alloc_bytes;
+
+	summary.heap_gc_count = instrumentation->heap_gc_count;
+
+	summary.heap_minor_gc_count = instrumentation->heap_minor_gc_count;
+
+	summary.heap_gc_bytes = instrumentation->heap_gc_bytes;
+
+	return summary;
+}
@@ -6,6 +6,7 @@
 #include "../infra/panic.hpp"
 #include "../infra/math.hpp"
 #include "../infra/range.hpp"
+#include "../infra/hash.hpp"
 #include "../infra/container/reserved_vec.hpp"
 #include "../diag/diag.hpp"
 
@@ -322,6 +323,69 @@ static const Opcode* poppush_temporary_value(CoreData* core, const Opcode* code,
 	}
 }
 
+// Loads `size` bytes from `src` into the low bytes of the returned value,
+// zero-extending it. `size` must be one of `1`, `2`, `4` or `8`.
+static u64 load_scalar(const byte* src, u32 size) noexcept
+{
+	switch (size)
+	{
+	case 1: return *reinterpret_cast<const u8*>(src);
+	case 2: return *reinterpret_cast<const u16*>(src);
+	case 4: return *reinterpret_cast<const u32*>(src);
+	case 8: return *reinterpret_cast<const u64*>(src);
+	default: ASSERT_UNREACHABLE;
+	}
+}
+
+// Stores the low `size` bytes of `value` to `dst`. `size` must be one of `1`,
+// `2`, `4` or `8`.
+static void store_scalar(byte* dst, u64 value, u32 size) noexcept
+{
+	switch (size)
+	{
+	case 1: *reinterpret_cast<u8*>(dst) = static_cast<u8>(value); return;
+	case 2: *reinterpret_cast<u16*>(dst) = static_cast<u16>(value); return;
+	case 4: *reinterpret_cast<u32*>(dst) = static_cast<u32>(value); return;
+	case 8: *reinterpret_cast<u64*>(dst) = value; return;
+	default: ASSERT_UNREACHABLE;
+	}
+}
+
+// Variant of `poppush_temporary_value` for scalar results held in the low
+// `size` bytes of `value`. As these cannot have shadow entries, this skips the
+// `shadow_copy`, and writes directly into `write_ctx` if it has exactly the
+// given `type`.
+static const Opcode* poppush_scalar_value(CoreData* core, const Opcode* code, CompValue* write_ctx, u64 value, u32 size, u32 align, TypeId type) noexcept
+{
+	ASSERT_OR_IGNORE(core->interp.values.used() >= 1);
+
+	if (write_ctx != nullptr)
+	{
+		core->interp.values.pop_by(1);
+
+		if (write_ctx->type != type)
+			return convert_into(core, code, CompValue{ MutRange<byte>{ reinterpret_cast<byte*>(&value), size }, align, true, type }, *write_ctx);
+
+		ASSERT_OR_IGNORE(write_ctx->bytes.count() == size);
+
+		store_scalar(write_ctx->bytes.begin(), value, size);
+
+		return code;
+	}
+	else
+	{
+		const CompValue temporary_value = alloc_temporary_value_uninit(core, size, align, type);
+
+		store_scalar(temporary_value.bytes.begin(), value, size);
+
+		CompValue* const top = core->interp.values.end() - 1;
+
+		*top = temporary_value;
+
+		return code;
+	}
+}
+
 static void argument_pack_pop(CoreData* core, ArgumentPack* argument_pack) noexcept
 {
 	core->interp.argument_callbacks.pop_by(argument_pack->argument_count);
@@ -522,10 +586,10 @@ static void prepare_circular_definition_type_indirection_global(CoreData* core,
 
 	const TypeId indirection_type = prepare_circular_definition_type_indirection(core);
 
-	const Maybe<void*> allocation = comp_heap_alloc(core, sizeof(TypeId), alignof(TypeId));
+	const Maybe<void*> allocation = comp_heap_alloc_collectable(core, sizeof(TypeId), alignof(TypeId));
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for circular definition type.\n", sizeof(TypeId));
 
 	memcpy(get(allocation), &indirection_type, sizeof(TypeId));
 
@@ -560,10 +624,10 @@ static Maybe<ClosureId> create_closure(CoreData* core, u32 value_count) noexcept
 		size = ((size + align_mask) & ~align_mask) + value_size;
 	}
 
-	const Maybe<void*> allocation = comp_heap_alloc(core, size, align);
+	const Maybe<void*> allocation = comp_heap_alloc_collectable(core, size, align);
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for closure.\n", size);
 
 	u64* const member_count = static_cast<u64*>(get(allocation));
 	*member_count = value_count;
@@ -1117,12 +1181,10 @@ static CompareResult compare(CoreData* core, TypeId type, MutRange<byte> lhs, Mu
 
 					const bool rhs_is_negative = (rhs_masked & msb_mask) != 0;
 
-					if (lhs_is_negative && rhs_is_negative)
-						lhs_is_greater = lhs_masked < rhs_masked;
-					else if (lhs_is_negative)
-						lhs_is_greater = false;
-					else if (rhs_is_negative)
-						lhs_is_greater = true;
+					// If both have the same sign, their two's complement
+					// representations order like unsigned values.
+					if (lhs_is_negative != rhs_is_negative)
+						lhs_is_greater = rhs_is_negative;
 					else
 						lhs_is_greater = lhs_masked > rhs_masked;
 				}
@@ -1140,19 +1202,18 @@ static CompareResult compare(CoreData* core, TypeId type, MutRange<byte> lhs, Mu
 
 		s64 i = compare_size - 1;
 
-		bool negate_comparison = false;
-
-		if (integer_type.is_signed)
+		// If both have the same sign, their two's complement representations
+		// order like unsigned values. With extra bits, the sign has already
+		// been found equal above.
+		if (integer_type.is_signed && extra_bits == 0)
 		{
 			const bool lhs_is_negative = (lhs[i] & 0x80) != 0;
 
 			const bool rhs_is_negative = (rhs[i] & 0x80) != 0;
 
-			if (lhs_is_negative && rhs_is_negative)
-				negate_comparison = true;
-			else if (lhs_is_negative)
+			if (lhs_is_negative && !rhs_is_negative)
 				return CompareResult{ WeakCompareOrdering::LessThan };
-			else if (rhs_is_negative)
+			else if (rhs_is_negative && !lhs_is_negative)
 				return CompareResult{ WeakCompareOrdering::GreaterThan };
 		}
 
@@ -1168,9 +1229,9 @@ static CompareResult compare(CoreData* core, TypeId type, MutRange<byte> lhs, Mu
 				continue;
 
 			if (lhs_byte < rhs_byte)
-				return CompareResult{ negate_comparison ? WeakCompareOrdering::GreaterThan : WeakCompareOrdering::LessThan };
+				return CompareResult{ WeakCompareOrdering::LessThan };
 			else if (lhs_byte > rhs_byte)
-				return CompareResult{ negate_comparison ? WeakCompareOrdering::LessThan : WeakCompareOrdering::GreaterThan };
+				return CompareResult{ WeakCompareOrdering::GreaterThan };
 		}
 		while (i >= 0);
 
@@ -1938,6 +1999,8 @@ static const Opcode* builtin_foreign_function_import(CoreData* core, const Opcod
 	if (!minos::dynamic_library_create(library_path, &library))
 		return record_interpreter_error(core, code, CompileError::FFILibraryNotFound);
 
+	core->interp.foreign_library_count += 1;
+
 	const void* function_address;
 
 	if (!minos::dynamic_library_load_function(library, symbol, &function_address))
@@ -2048,6 +2111,10 @@ static const Opcode* builtin_foreign_function_call(CoreData* core, const Opcode*
 
 
 
+	// Native code may hand heap memory to system calls, which fail rather
+	// than fault when writing to write-protected memory.
+	comp_heap_unprotect(core);
+
 	FFINativeCallArgs ffi_args;
 
 	ffi_prepare_args_for_native_call(core, arguments, core->interp.scope_data.begin(), return_value_dst.bytes.begin(), return_type, &ffi_args);
@@ -2332,6 +2399,15 @@ static const Opcode* handle_file_member_alloc_prepare(CoreData* core, const Opco
 	init->rank = rank;
 	init->temporary_data_used = core->interp.temporary_data.used();
 
+	// Ended by `handle_file_member_alloc_complete` or
+	// `handle_file_member_alloc_untyped`, whichever finishes the initializer.
+	if (core->instrumentation.tracing)
+	{
+		const Range<char8> name = identifier_name_from_id(core, type_member_name_by_rank(core, file_type, rank));
+
+		instrumentation_trace_begin(core, InstrumentationTraceKind::Initializer, name, source_id_of_opcode(core, code - 1));
+	}
+
 	return code;
 }
 
@@ -2352,6 +2428,9 @@ static const Opcode* handle_file_member_alloc_complete(CoreData* core, const Opc
 	core->interp.temporary_data.pop_to(init.temporary_data_used);
 	core->interp.global_initializations.pop_by(1);
 
+	if (core->instrumentation.tracing)
+		instrumentation_trace_end(core);
+
 	return code;
 }
 
@@ -2387,7 +2466,7 @@ static const Opcode* handle_file_member_alloc_typed(CoreData* core, const Opcode
 	const Maybe<void*> allocation = comp_heap_alloc_global_member(core, member_metrics.size, member_metrics.align, member_type);
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal");
+		panic("Failed to allocate % bytes of compile-time heap memory for global member.\n", member_metrics.size);
 
 	const CoreId value_id = core_id_from_address(core, get(allocation));
 
@@ -2420,7 +2499,7 @@ static const Opcode* handle_file_member_alloc_untyped(CoreData* core, const Opco
 	const Maybe<void*> allocation = comp_heap_alloc_global_member(core, top->bytes.count(), top->align, top->type);
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for global member.\n", top->bytes.count());
 
 	const MutRange<byte> dst_bytes{ static_cast<byte*>(get(allocation)), top->bytes.count() };
 
@@ -2438,6 +2517,9 @@ static const Opcode* handle_file_member_alloc_untyped(CoreData* core, const Opco
 
 	core->interp.values.pop_by(1);
 
+	if (core->instrumentation.tracing)
+		instrumentation_trace_end(core);
+
 	return code;
 }
 
@@ -2770,7 +2852,16 @@ static const Opcode* handle_exec_builtin(CoreData* core, const Opcode* code, Com
 
 	ASSERT_OR_IGNORE(ordinal != 0 && ordinal < array_count(HANDLERS));
 
-	return HANDLERS[ordinal](core, code, write_ctx);
+	if (!core->instrumentation.tracing)
+		return HANDLERS[ordinal](core, code, write_ctx);
+
+	instrumentation_trace_begin(core, InstrumentationTraceKind::Builtin, range::from_cstring(tag_name(static_cast<Builtin>(ordinal))), source_id_of_opcode(core, code - 1));
+
+	const Opcode* const next = HANDLERS[ordinal](core, code, write_ctx);
+
+	instrumentation_trace_end(core);
+
+	return next;
 }
 
 static const Opcode* handle_signature(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
@@ -2823,10 +2914,10 @@ static const Opcode* handle_signature(CoreData* core, const Opcode* code, CompVa
 
 			ASSERT_OR_IGNORE(type_is_equal(core, parameter_type, default_value->type) == TypeEquality::Equal);
 
-			const Maybe<void*> allocation = comp_heap_alloc(core, default_value->bytes.count(), default_value->align);
+			const Maybe<void*> allocation = comp_heap_alloc_collectable(core, default_value->bytes.count(), default_value->align);
 
 			if (is_none(allocation))
-				TODO("Implement GC traversal.");
+				panic("Failed to allocate % bytes of compile-time heap memory for parameter default value.\n", default_value->bytes.count());
 
 			const MutRange<byte> dst_bytes{ static_cast<byte*>(get(allocation)), default_value->bytes.count() };
 
@@ -2861,10 +2952,10 @@ static const Opcode* handle_signature(CoreData* core, const Opcode* code, CompVa
 
 			parameter_type = default_value->type;
 
-			const Maybe<void*> allocation = comp_heap_alloc(core, default_value->bytes.count(), default_value->align);
+			const Maybe<void*> allocation = comp_heap_alloc_collectable(core, default_value->bytes.count(), default_value->align);
 
 			if (is_none(allocation))
-				TODO("Implement GC traversal.");
+				panic("Failed to allocate % bytes of compile-time heap memory for parameter default value.\n", default_value->bytes.count());
 
 			const MutRange<byte> dst_bytes{ static_cast<byte*>(get(allocation)), default_value->bytes.count() };
 
@@ -2996,10 +3087,10 @@ static const Opcode* handle_dyn_signature(CoreData* core, const Opcode* code, Co
 				if (!type_metrics_from_id(core, parameter_type, &parameter_metrics))
 					return record_interpreter_error(core, code, CompileError::IncompleteType);
 
-				const Maybe<void*> allocation = comp_heap_alloc(core, parameter_metrics.size, parameter_metrics.align);
+				const Maybe<void*> allocation = comp_heap_alloc_collectable(core, parameter_metrics.size, parameter_metrics.align);
 
 				if (is_none(allocation))
-					TODO("Implement GC traversal.");
+					panic("Failed to allocate % bytes of compile-time heap memory for parameter default value.\n", parameter_metrics.size);
 
 				const CompValue default_dst{ MutRange<byte>{ static_cast<byte*>(get(allocation)), parameter_metrics.size }, parameter_metrics.align, true, parameter_type };
 
@@ -3031,10 +3122,10 @@ static const Opcode* handle_dyn_signature(CoreData* core, const Opcode* code, Co
 
 				parameter_type = default_value->type;
 
-				const Maybe<void*> allocation = comp_heap_alloc(core, default_value->bytes.count(), default_value->align);
+				const Maybe<void*> allocation = comp_heap_alloc_collectable(core, default_value->bytes.count(), default_value->align);
 
 				if (is_none(allocation))
-					TODO("Implement GC traversal.");
+					panic("Failed to allocate % bytes of compile-time heap memory for parameter default value.\n", default_value->bytes.count());
 
 				const MutRange<byte> dst_bytes{ static_cast<byte*>(get(allocation)), default_value->bytes.count() };
 
@@ -3507,7 +3598,14 @@ static const Opcode* handle_call(CoreData* core, const Opcode* code, CompValue*
 
 		push_activation(core, code);
 
-		return opcode_from_id(core, callee.body_id);
+		const Opcode* const body = opcode_from_id(core, callee.body_id);
+
+		// Ended by the callee's `handle_return`. The span is labelled with the
+		// callee's location, so that calls to the same function line up.
+		if (core->instrumentation.tracing)
+			instrumentation_trace_begin(core, InstrumentationTraceKind::Call, Range<char8>{}, source_id_of_opcode(core, body));
+
+		return body;
 	}
 	else
 	{
@@ -3571,6 +3669,9 @@ static const Opcode* handle_return(CoreData* core, [[maybe_unused]] const Opcode
 
 	core->interp.activations.pop_to(callee_activation + 1);
 
+	if (core->instrumentation.tracing)
+		instrumentation_trace_end(core);
+
 	return nullptr;
 }
 
@@ -3636,10 +3737,10 @@ static const Opcode* handle_complete_param_typed_with_default(CoreData* core, co
 
 	ArgumentPack* const argument_pack = core->interp.argument_packs.end() - 1;
 
-	const Maybe<void*> allocation = comp_heap_alloc(core, parameter_metrics.size, parameter_metrics.align);
+	const Maybe<void*> allocation = comp_heap_alloc_collectable(core, parameter_metrics.size, parameter_metrics.align);
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for parameter default value.\n", parameter_metrics.size);
 
 	const MutRange<byte> bytes{ static_cast<byte*>(get(allocation)), parameter_metrics.size };
 
@@ -3674,10 +3775,10 @@ static const Opcode* handle_complete_param_untyped(CoreData* core, const Opcode*
 
 	ArgumentPack* const argument_pack = core->interp.argument_packs.end() - 1;
 
-	const Maybe<void*> allocation = comp_heap_alloc(core, default_value->bytes.count(), default_value->align);
+	const Maybe<void*> allocation = comp_heap_alloc_collectable(core, default_value->bytes.count(), default_value->align);
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for parameter default value.\n", default_value->bytes.count());
 
 	const MutRange<byte> dst_bytes{ static_cast<byte*>(get(allocation)), default_value->bytes.count() };
 
@@ -4700,12 +4801,201 @@ static const Opcode* handle_index(CoreData* core, const Opcode* code, CompValue*
 	}
 }
 
-static const Opcode* handle_binary_arithmetic_op(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
+// Rewrites the generic `BinaryArithmeticOp` or `Compare` at `op` into the
+// quickened variant starting at `signed_quick_op` if its operands `lhs` and
+// `rhs` are suitable for it. These must not have been unified yet.
+// See `Opcode::AddS` for details on quickened opcodes.
+static void quicken_integer_op(CoreData* core, Opcode* op, Opcode signed_quick_op, const CompValue* lhs, const CompValue* rhs) noexcept
 {
-	ASSERT_OR_IGNORE(core->interp.values.used() >= 2);
+	const TypeId comp_integer_type = type_create_simple(core, TypeTag::CompInteger);
 
-	OpcodeBinaryArithmeticOpKind kind;
-	code = code_attach(code, &kind);
+	const TypeId type = lhs->type == comp_integer_type ? rhs->type : lhs->type;
+
+	if (type == comp_integer_type)
+		return;
+
+	if ((lhs->type != type && lhs->type != comp_integer_type) || (rhs->type != type && rhs->type != comp_integer_type))
+		return;
+
+	if (type_tag_from_id(core, type) != TypeTag::Integer)
+		return;
+
+	const NumericType integer_type = *type_attachment_from_id<NumericType>(core, type);
+
+	if (integer_type.bits < 8 || integer_type.bits > 64 || !is_pow2(integer_type.bits))
+		return;
+
+	const u8 quick_op = static_cast<u8>(static_cast<u8>(signed_quick_op) + (integer_type.is_signed ? 0 : 1));
+
+	const u8 operand_bytes = static_cast<u8>(integer_type.bits / 8);
+
+	op[0] = static_cast<Opcode>(quick_op | (static_cast<u8>(op[0]) & 0x80));
+
+	memcpy(op + 1, &operand_bytes, sizeof(operand_bytes));
+
+	memcpy(op + 2, &type, sizeof(type));
+}
+
+// Extracts the value of an operand of a quickened integer opcode operating on
+// `type` into the low `operand_bytes` bytes of `*out`. Returns `false` if
+// `value` is neither of `type` nor a `CompInteger` that fits into it.
+template<bool is_signed>
+static bool quick_integer_operand(CoreData* core, TypeId type, u8 operand_bytes, CompValue* value, u64* out) noexcept
+{
+	if (value->type == type)
+	{
+		*out = load_scalar(value->bytes.begin(), operand_bytes);
+
+		return true;
+	}
+
+	if (value->type != type_create_simple(core, TypeTag::CompInteger))
+		return false;
+
+	const CompIntegerValue comp_value = *value_as<CompIntegerValue>(value);
+
+	if constexpr (is_signed)
+	{
+		s64 signed_value;
+
+		if (!s64_from_comp_integer(comp_value, static_cast<u8>(operand_bytes * 8), &signed_value))
+			return false;
+
+		*out = static_cast<u64>(signed_value);
+	}
+	else
+	{
+		if (!u64_from_comp_integer(comp_value, static_cast<u8>(operand_bytes * 8), out))
+			return false;
+	}
+
+	return true;
+}
+
+// Checks the guard of a quickened integer opcode operating on `type`, which
+// holds if at least one of `lhs` and `rhs` is of `type` and the other one is
+// either of `type` as well or a `CompInteger` that fits into it. If it holds,
+// `true` is returned and the operand values are stored into `*out_lhs` and
+// `*out_rhs`. Otherwise `false` is returned and the generic operation must be
+// performed instead.
+template<bool is_signed>
+static bool quick_integer_operands(CoreData* core, TypeId type, u8 operand_bytes, CompValue* lhs, CompValue* rhs, u64* out_lhs, u64* out_rhs) noexcept
+{
+	if (lhs->type != type && rhs->type != type)
+		return false;
+
+	return quick_integer_operand<is_signed>(core, type, operand_bytes, lhs, out_lhs)
+	    && quick_integer_operand<is_signed>(core, type, operand_bytes, rhs, out_rhs);
+}
+
+// Performs the arithmetic operation `kind` on integers with a width of `bits`,
+// which must be a power of two no greater than `64`. `lhs_value` and
+// `rhs_value` hold the operands in their low `bits` bits.
+// On success, the result is stored in the low `bits` bits of `*out` and
+// `CompileError::INVALID` is returned. Otherwise, the error to report is
+// returned and `*out` is left in an unspecified state.
+template<bool is_signed>
+static CompileError integer_arithmetic(OpcodeBinaryArithmeticOpKind kind, u16 bits, u64 lhs_value, u64 rhs_value, u64* out) noexcept
+{
+	if constexpr (is_signed)
+	{
+		// Sign extend.
+		const s64 lhs_value_signed = (static_cast<s64>(lhs_value) << (64 - bits)) >> (64 - bits);
+
+		const s64 rhs_value_signed = (static_cast<s64>(rhs_value) << (64 - bits)) >> (64 - bits);
+
+		s64 result_signed;
+
+		if (kind == OpcodeBinaryArithmeticOpKind::Add || kind == OpcodeBinaryArithmeticOpKind::AddTC)
+		{
+			if (!add_checked_s64(lhs_value_signed, rhs_value_signed, &result_signed) && kind == OpcodeBinaryArithmeticOpKind::Add)
+				return CompileError::ArithmeticOverflow;
+		}
+		else if (kind == OpcodeBinaryArithmeticOpKind::Sub || kind == OpcodeBinaryArithmeticOpKind::SubTC)
+		{
+			if (!sub_checked_s64(lhs_value_signed, rhs_value_signed, &result_signed) && kind == OpcodeBinaryArithmeticOpKind::Sub)
+				return CompileError::ArithmeticOverflow;
+		}
+		else if (kind == OpcodeBinaryArithmeticOpKind::Mul || kind == OpcodeBinaryArithmeticOpKind::MulTC)
+		{
+			if (!mul_checked_s64(lhs_value_signed, rhs_value_signed, &result_signed) && kind == OpcodeBinaryArithmeticOpKind::Mul)
+				return CompileError::ArithmeticOverflow;
+		}
+		else if (kind == OpcodeBinaryArithmeticOpKind::Div)
+		{
+			if (rhs_value_signed == 0)
+				return CompileError::DivideByZero;
+
+			result_signed = lhs_value_signed / rhs_value_signed;
+		}
+		else
+		{
+			ASSERT_OR_IGNORE(kind == OpcodeBinaryArithmeticOpKind::Mod);
+
+			if (rhs_value_signed == 0)
+				return CompileError::ModuloByZero;
+
+			result_signed = lhs_value_signed % rhs_value_signed;
+		}
+
+		const s64 max_value = static_cast<s64>((static_cast<u64>(1) << (bits - 1)) - 1);
+
+		const s64 min_value = -max_value - 1;
+
+		if (result_signed > max_value || result_signed < min_value)
+			return CompileError::ArithmeticOverflow;
+
+		*out = static_cast<u64>(result_signed);
+	}
+	else
+	{
+		if (kind == OpcodeBinaryArithmeticOpKind::Add || kind == OpcodeBinaryArithmeticOpKind::AddTC)
+		{
+			if (!add_checked_u64(lhs_value, rhs_value, out) && kind == OpcodeBinaryArithmeticOpKind::Add)
+				return CompileError::ArithmeticOverflow;
+		}
+		else if (kind == OpcodeBinaryArithmeticOpKind::Sub || kind == OpcodeBinaryArithmeticOpKind::SubTC)
+		{
+			if (!sub_checked_u64(lhs_value, rhs_value, out) && kind == OpcodeBinaryArithmeticOpKind::Sub)
+				return CompileError::ArithmeticOverflow;
+		}
+		else if (kind == OpcodeBinaryArithmeticOpKind::Mul || kind == OpcodeBinaryArithmeticOpKind::MulTC)
+		{
+			if (!mul_checked_u64(lhs_value, rhs_value, out) && kind == OpcodeBinaryArithmeticOpKind::Mul)
+				return CompileError::ArithmeticOverflow;
+		}
+		else if (kind == OpcodeBinaryArithmeticOpKind::Div)
+		{
+			if (rhs_value == 0)
+				return CompileError::DivideByZero;
+
+			*out = lhs_value / rhs_value;
+		}
+		else
+		{
+			ASSERT_OR_IGNORE(kind == OpcodeBinaryArithmeticOpKind::Mod);
+
+			if (rhs_value == 0)
+				return CompileError::ModuloByZero;
+
+			*out = lhs_value % rhs_value;
+		}
+
+		if (bits != 64)
+		{
+			const u64 max_value = (static_cast<u64>(1) << bits) - 1;
+
+			if (*out > max_value)
+				return CompileError::ArithmeticOverflow;
+		}
+	}
+
+	return CompileError::INVALID;
+}
+
+static const Opcode* binary_arithmetic_op(CoreData* core, const Opcode* code, CompValue* write_ctx, OpcodeBinaryArithmeticOpKind kind) noexcept
+{
+	ASSERT_OR_IGNORE(core->interp.values.used() >= 2);
 
 	CompValue* const lhs = core->interp.values.end() - 2;
 
@@ -4738,98 +5028,12 @@ static const Opcode* handle_binary_arithmetic_op(CoreData* core, const Opcode* c
 
 			u64 result;
 
-			if (integer_type.is_signed)
-			{
-				// Sign extend.
-				const s64 lhs_value_signed = (static_cast<s64>(lhs_value) << (64 - integer_type.bits)) >> (64 - integer_type.bits);
-
-				const s64 rhs_value_signed = (static_cast<s64>(rhs_value) << (64 - integer_type.bits)) >> (64 - integer_type.bits);
+			const CompileError error = integer_type.is_signed
+				? integer_arithmetic<true>(kind, integer_type.bits, lhs_value, rhs_value, &result)
+				: integer_arithmetic<false>(kind, integer_type.bits, lhs_value, rhs_value, &result);
 
-				s64 result_signed;
-
-				if (kind == OpcodeBinaryArithmeticOpKind::Add || kind == OpcodeBinaryArithmeticOpKind::AddTC)
-				{
-					if (!add_checked_s64(lhs_value_signed, rhs_value_signed, &result_signed) && kind == OpcodeBinaryArithmeticOpKind::Add)
-						return record_interpreter_error(core, code, CompileError::ArithmeticOverflow);
-				}
-				else if (kind == OpcodeBinaryArithmeticOpKind::Sub || kind == OpcodeBinaryArithmeticOpKind::SubTC)
-				{
-					if (!sub_checked_s64(lhs_value_signed, rhs_value_signed, &result_signed) && kind == OpcodeBinaryArithmeticOpKind::Sub)
-						return record_interpreter_error(core, code, CompileError::ArithmeticOverflow);
-				}
-				else if (kind == OpcodeBinaryArithmeticOpKind::Mul || kind == OpcodeBinaryArithmeticOpKind::MulTC)
-				{
-					if (!mul_checked_s64(lhs_value_signed, rhs_value_signed, &result_signed) && kind == OpcodeBinaryArithmeticOpKind::Mul)
-						return record_interpreter_error(core, code, CompileError::ArithmeticOverflow);
-				}
-				else if (kind == OpcodeBinaryArithmeticOpKind::Div)
-				{
-					if (rhs_value_signed == 0)
-						return record_interpreter_error(core, code, CompileError::DivideByZero);
-
-					result_signed = lhs_value_signed / rhs_value_signed;
-				}
-				else
-				{
-					ASSERT_OR_IGNORE(kind == OpcodeBinaryArithmeticOpKind::Mod);
-
-					if (rhs_value_signed == 0)
-						return record_interpreter_error(core, code, CompileError::ModuloByZero);
-
-					result_signed = lhs_value_signed % rhs_value_signed;
-				}
-
-				const s64 max_value = static_cast<s64>((static_cast<u64>(1) << (integer_type.bits - 1)) - 1);
-
-				const s64 min_value = -max_value - 1;
-
-				if (result_signed > max_value || result_signed < min_value)
-					return record_interpreter_error(core, code, CompileError::ArithmeticOverflow);
-
-				result = static_cast<u64>(result_signed);
-			}
-			else
-			{
-				if (kind == OpcodeBinaryArithmeticOpKind::Add || kind == OpcodeBinaryArithmeticOpKind::AddTC)
-				{
-					if (!add_checked_u64(lhs_value, rhs_value, &result) && kind == OpcodeBinaryArithmeticOpKind::Add)
-						return record_interpreter_error(core, code, CompileError::ArithmeticOverflow);
-				}
-				else if (kind == OpcodeBinaryArithmeticOpKind::Sub || kind == OpcodeBinaryArithmeticOpKind::SubTC)
-				{
-					if (!sub_checked_u64(lhs_value, rhs_value, &result) && kind == OpcodeBinaryArithmeticOpKind::Sub)
-						return record_interpreter_error(core, code, CompileError::ArithmeticOverflow);
-				}
-				else if (kind == OpcodeBinaryArithmeticOpKind::Mul || kind == OpcodeBinaryArithmeticOpKind::MulTC)
-				{
-					if (!mul_checked_u64(lhs_value, rhs_value, &result) && kind == OpcodeBinaryArithmeticOpKind::Mul)
-						return record_interpreter_error(core, code, CompileError::ArithmeticOverflow);
-				}
-				else if (kind == OpcodeBinaryArithmeticOpKind::Div)
-				{
-					if (rhs_value == 0)
-						return record_interpreter_error(core, code, CompileError::DivideByZero);
-
-					result = lhs_value / rhs_value;
-				}
-				else
-				{
-					ASSERT_OR_IGNORE(kind == OpcodeBinaryArithmeticOpKind::Mod);
-
-					if (rhs_value == 0)
-						return record_interpreter_error(core, code, CompileError::ModuloByZero);
-
-					result = lhs_value % rhs_value;
-				}
-
-				if (integer_type.bits != 64)
-				{
-					const u64 max_value = (static_cast<u64>(1) << integer_type.bits) - 1;
-
-					if (result > max_value)
-						return record_interpreter_error(core, code, CompileError::ArithmeticOverflow);
-				}
-			}
+			if (error != CompileError::INVALID)
+				return record_interpreter_error(core, code, error);
 
 			const MutRange<byte> bytes{ reinterpret_cast<byte*>(&result), static_cast<u64>(integer_type.bits / 8) };
 
@@ -5025,6 +5229,61 @@ static const Opcode* handle_binary_arithmetic_op(CoreData* core, const Opcode* c
 	}
 }
 
+static const Opcode* handle_binary_arithmetic_op(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
+{
+	ASSERT_OR_IGNORE(core->interp.values.used() >= 2);
+
+	Opcode* const op = const_cast<Opcode*>(code - 1);
+
+	OpcodeBinaryArithmeticOpKind kind;
+	code = code_attach(code, &kind);
+
+	// Skip the slot reserved for quickening.
+	code += sizeof(TypeId);
+
+	const CompValue* const lhs = core->interp.values.end() - 2;
+
+	quicken_integer_op(core, op, static_cast<Opcode>(static_cast<u8>(Opcode::AddS) + 2 * static_cast<u8>(kind)), lhs, lhs + 1);
+
+	return binary_arithmetic_op(core, code, write_ctx, kind);
+}
+
+template<OpcodeBinaryArithmeticOpKind kind, bool is_signed>
+static const Opcode* handle_quick_arithmetic_op(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
+{
+	ASSERT_OR_IGNORE(core->interp.values.used() >= 2);
+
+	u8 operand_bytes;
+	code = code_attach(code, &operand_bytes);
+
+	TypeId type;
+	code = code_attach(code, &type);
+
+	CompValue* const lhs = core->interp.values.end() - 2;
+
+	CompValue* const rhs = lhs + 1;
+
+	u64 lhs_value;
+
+	u64 rhs_value;
+
+	if (!quick_integer_operands<is_signed>(core, type, operand_bytes, lhs, rhs, &lhs_value, &rhs_value))
+		return binary_arithmetic_op(core, code, write_ctx, kind);
+
+	u64 result;
+
+	const CompileError error = integer_arithmetic<is_signed>(kind, static_cast<u16>(operand_bytes * 8), lhs_value, rhs_value, &result);
+
+	if (error != CompileError::INVALID)
+		return record_interpreter_error(core, code, error);
+
+	const u32 align = lhs->type == type ? lhs->align : rhs->align;
+
+	core->interp.values.pop_by(1);
+
+	return poppush_scalar_value(core, code, write_ctx, result, operand_bytes, align, type);
+}
+
 static const Opcode* handle_shift(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
 {
 	ASSERT_OR_IGNORE(core->interp.values.used() >= 2);
@@ -5376,13 +5635,29 @@ static const Opcode* handle_logical_not(CoreData* core, const Opcode* code, Comp
 	return poppush_temporary_value(core, code, write_ctx, CompValue{ bytes, alignof(bool), true, type });
 }
 
-static const Opcode* handle_compare(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
+template<typename T>
+static bool integer_compare(OpcodeCompareKind kind, T lhs, T rhs) noexcept
+{
+	if (kind == OpcodeCompareKind::LessThan)
+		return lhs < rhs;
+	else if (kind == OpcodeCompareKind::GreaterThan)
+		return lhs > rhs;
+	else if (kind == OpcodeCompareKind::LessThanOrEqual)
+		return lhs <= rhs;
+	else if (kind == OpcodeCompareKind::GreaterThanOrEqual)
+		return lhs >= rhs;
+	else if (kind == OpcodeCompareKind::NotEqual)
+		return lhs != rhs;
+	else if (kind == OpcodeCompareKind::Equal)
+		return lhs == rhs;
+	else
+		ASSERT_UNREACHABLE;
+}
+
+static const Opcode* compare_op(CoreData* core, const Opcode* code, CompValue* write_ctx, OpcodeCompareKind kind) noexcept
 {
 	ASSERT_OR_IGNORE(core->interp.values.used() >= 2);
 
-	OpcodeCompareKind kind;
-	code = code_attach(code, &kind);
-
 	CompValue* const lhs = core->interp.values.end() - 2;
 
 	CompValue* const rhs = lhs + 1;
@@ -5435,6 +5710,69 @@ static const Opcode* handle_compare(CoreData* core, const Opcode* code, CompValu
 	return poppush_temporary_value(core, code, write_ctx, CompValue{ bytes, alignof(bool), true, bool_type });
 }
 
+static const Opcode* handle_compare(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
+{
+	ASSERT_OR_IGNORE(core->interp.values.used() >= 2);
+
+	Opcode* const op = const_cast<Opcode*>(code - 1);
+
+	OpcodeCompareKind kind;
+	code = code_attach(code, &kind);
+
+	// Skip the slot reserved for quickening.
+	code += sizeof(TypeId);
+
+	const CompValue* const lhs = core->interp.values.end() - 2;
+
+	quicken_integer_op(core, op, static_cast<Opcode>(static_cast<u8>(Opcode::CmpLtS) + 2 * static_cast<u8>(kind)), lhs, lhs + 1);
+
+	return compare_op(core, code, write_ctx, kind);
+}
+
+template<OpcodeCompareKind kind, bool is_signed>
+static const Opcode* handle_quick_compare(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
+{
+	ASSERT_OR_IGNORE(core->interp.values.used() >= 2);
+
+	u8 operand_bytes;
+	code = code_attach(code, &operand_bytes);
+
+	TypeId type;
+	code = code_attach(code, &type);
+
+	CompValue* const lhs = core->interp.values.end() - 2;
+
+	CompValue* const rhs = lhs + 1;
+
+	u64 lhs_value;
+
+	u64 rhs_value;
+
+	if (!quick_integer_operands<is_signed>(core, type, operand_bytes, lhs, rhs, &lhs_value, &rhs_value))
+		return compare_op(core, code, write_ctx, kind);
+
+	bool result;
+
+	if constexpr (is_signed)
+	{
+		const u8 shift = static_cast<u8>(64 - operand_bytes * 8);
+
+		const s64 lhs_value_signed = (static_cast<s64>(lhs_value) << shift) >> shift;
+
+		const s64 rhs_value_signed = (static_cast<s64>(rhs_value) << shift) >> shift;
+
+		result = integer_compare(kind, lhs_value_signed, rhs_value_signed);
+	}
+	else
+	{
+		result = integer_compare(kind, lhs_value, rhs_value);
+	}
+
+	core->interp.values.pop_by(1);
+
+	return poppush_scalar_value(core, code, write_ctx, result ? 1 : 0, sizeof(bool), alignof(bool), type_create_simple(core, TypeTag::Boolean));
+}
+
 static const Opcode* handle_negate(CoreData* core, const Opcode* code, CompValue* write_ctx) noexcept
 {
 	ASSERT_OR_IGNORE(core->interp.values.used() >= 1);
@@ -6265,10 +6603,10 @@ static const Opcode* handle_definition(CoreData* core, const Opcode* code, CompV
 		if (!type_metrics_from_id(core, definition.type, &metrics))
 			return record_interpreter_error(core, code, CompileError::IncompleteType);
 
-		const Maybe<void*> allocation = comp_heap_alloc(core, metrics.size, metrics.align);
+		const Maybe<void*> allocation = comp_heap_alloc_collectable(core, metrics.size, metrics.align);
 
 		if (is_none(allocation))
-			TODO("Implement GC traversal.");
+			panic("Failed to allocate % bytes of compile-time heap memory for definition value.\n", metrics.size);
 
 		const MutRange<byte> value_bytes{ static_cast<byte*>(get(allocation)), metrics.size };
 
@@ -6330,6 +6668,14 @@ static const Opcode* handle_complete_circular_definition(CoreData* core, const O
 
 static bool type_from_ast(CoreData* core, AstNode* ast, TypeId file_type, SourceFileId file_id) noexcept
 {
+	const u16 member_count = static_cast<u16>(attachment_of<AstFileData>(ast)->member_count);
+
+	const u64 mark = temp_stack_mark(core);
+
+	OpcodeId* const initializer_ids = static_cast<OpcodeId*>(temp_stack_alloc(core, member_count * sizeof(OpcodeId), alignof(OpcodeId)));
+
+	const bool is_cached = opcode_cache_load(core, file_id, member_count, initializer_ids);
+
 	AstDirectChildIterator it = direct_children_of(ast);
 
 	u16 rank = 0;
@@ -6342,20 +6688,25 @@ static bool type_from_ast(CoreData* core, AstNode* ast, TypeId file_type, Source
 
 		ASSERT_OR_IGNORE(node->tag == AstTag::Definition);
 
-		const Maybe<Opcode*> initializer = opcodes_from_file_member_ast(core, node, file_id, rank);
-
-		if (is_none(initializer))
+		if (!is_cached)
 		{
-			is_ok = false;
+			const Maybe<Opcode*> initializer = opcodes_from_file_member_ast(core, node, file_id, rank);
 
-			continue;
+			if (is_none(initializer))
+			{
+				is_ok = false;
+
+				continue;
+			}
+
+			initializer_ids[rank] = id_from_opcode(core, get(initializer));
 		}
 
-		const OpcodeId initializer_id = id_from_opcode(core, get(initializer));
+		const OpcodeId initializer_id = initializer_ids[rank];
 
 		const IdentifierId identifier_id = attachment_of<AstDefinitionData>(node)->identifier_id;
 
-		log_opcodes(core, get(initializer));
+		log_opcodes(core, opcode_from_id(core, initializer_id));
 
 		const bool is_pub = has_flag(node, AstFlag::Definition_IsPub);
 
@@ -6372,24 +6723,32 @@ static bool type_from_ast(CoreData* core, AstNode* ast, TypeId file_type, Source
 		rank += 1;
 	}
 
+	if (is_ok && !is_cached)
+		opcode_cache_store(core, file_id, member_count, initializer_ids);
+
+	temp_stack_release(core, mark);
+
 	return is_ok;
 }
 
-static Maybe<TypeId> import_file_or_prelude(CoreData* core, Range<char8> path, bool is_prelude, bool is_std, SourceFile** out_file) noexcept
+static Maybe<TypeId> import_read_file(CoreData* core, SourceFileRead read, bool is_prelude, bool is_std) noexcept
 {
-	SourceFileRead read = read_source_file(core, path);
+	if (core->config->ast_cache.enabled || core->config->opcode_cache.enabled)
+		read.source_file->content_hash = fnv1a_64(read.content.subrange(0, read.content.count() - 1).as_byte_range());
 
-	if (read.source_file->has_error)
-		return none<TypeId>();
+	instrumentation_enter_phase(core, InstrumentationPhase::Parse);
 
-	if (read.content.begin() == nullptr)
+	Maybe<AstNode*> maybe_ast = ast_cache_load(core, read.content, read.source_file->content_hash, read.source_file->source_id_base, is_std);
+
+	if (is_none(maybe_ast))
 	{
-		*out_file = read.source_file;
+		maybe_ast = parse(core, read.content, read.source_file->source_id_base, is_std);
 
-		return some(read.source_file->type);
+		if (is_some(maybe_ast))
+			ast_cache_store(core, read.content, read.source_file->content_hash, is_std, get(maybe_ast));
 	}
 
-	const Maybe<AstNode*> maybe_ast = parse(core, read.content, read.source_file->source_id_base, is_std);
+	instrumentation_leave_phase(core);
 
 	if (is_none(maybe_ast))
 	{
@@ -6411,23 +6770,19 @@ static Maybe<TypeId> import_file_or_prelude(CoreData* core, Range<char8> path, b
 	read.source_file->ast = id_from_ast_node(core, ast);
 	read.source_file->type = type;
 
-	if (is_prelude)
-	{
-		if (!set_prelude_scope(core, ast, file_id))
-		{
-			read.source_file->has_error = true;
+	instrumentation_enter_phase(core, InstrumentationPhase::ResolveNames);
 
-			return none<TypeId>();
-		}
-	}
-	else
+	const bool names_ok = is_prelude
+		? set_prelude_scope(core, ast, file_id)
+		: resolve_names(core, ast, file_id);
+
+	instrumentation_leave_phase(core);
+
+	if (!names_ok)
 	{
-		if (!resolve_names(core, ast, file_id))
-		{
-			read.source_file->has_error = true;
+		read.source_file->has_error = true;
 
-			return none<TypeId>();
-		}
+		return none<TypeId>();
 	}
 
 	log_ast(core, ast);
@@ -6439,12 +6794,48 @@ static Maybe<TypeId> import_file_or_prelude(CoreData* core, Range<char8> path, b
 		return none<TypeId>();
 	}
 
+	return some(type);
+}
+
+static Maybe<TypeId> import_file_or_prelude(CoreData* core, Range<char8> path, bool is_prelude, bool is_std, SourceFile** out_file) noexcept
+{
+	const InstrumentationTimestamps import_begin = instrumentation_timestamps(core);
+
+	instrumentation_enter_phase(core, InstrumentationPhase::Read);
+
+	SourceFileRead read = read_source_file(core, path);
+
+	instrumentation_leave_phase(core);
+
+	if (read.source_file->has_error)
+		return none<TypeId>();
+
+	if (read.content.begin() == nullptr)
+	{
+		*out_file = read.source_file;
+
+		return some(read.source_file->type);
+	}
+
+	if (core->instrumentation.tracing)
+		instrumentation_trace_begin(core, InstrumentationTraceKind::Import, path, read.source_file->source_id_base);
+
+	const Maybe<TypeId> type = import_read_file(core, read, is_prelude, is_std);
+
+	if (core->instrumentation.tracing)
+		instrumentation_trace_end(core);
+
+	if (is_none(type))
+		return none<TypeId>();
+
+	instrumentation_record_import(core, read.source_file->source_id_base, import_begin);
+
 	*out_file = read.source_file;
 
-	return some(type);
+	return type;
 }
 
-static bool interpret_opcodes(CoreData* core, const Opcode* ops) noexcept
+static bool interpret_opcodes_loop(CoreData* core, const Opcode* ops) noexcept
 {
 	static constexpr OpcodeHandlerFunc HANDLERS[] = {
 		nullptr,                                   // INVALID
@@ -6525,6 +6916,34 @@ static bool interpret_opcodes(CoreData* core, const Opcode* ops) noexcept
 		&handle_definition,                        // Definition
 		&handle_type_type,                         // TypeType
 		&handle_complete_circular_definition,      // CompleteCircularDefinition
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Add, true>,     // AddS
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Add, false>,    // AddU
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Sub, true>,     // SubS
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Sub, false>,    // SubU
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Mul, true>,     // MulS
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Mul, false>,    // MulU
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Div, true>,     // DivS
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Div, false>,    // DivU
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::AddTC, true>,   // AddTCS
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::AddTC, false>,  // AddTCU
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::SubTC, true>,   // SubTCS
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::SubTC, false>,  // SubTCU
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::MulTC, true>,   // MulTCS
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::MulTC, false>,  // MulTCU
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Mod, true>,     // ModS
+		&handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Mod, false>,    // ModU
+		&handle_quick_compare<OpcodeCompareKind::LessThan, true>,                 // CmpLtS
+		&handle_quick_compare<OpcodeCompareKind::LessThan, false>,                // CmpLtU
+		&handle_quick_compare<OpcodeCompareKind::GreaterThan, true>,              // CmpGtS
+		&handle_quick_compare<OpcodeCompareKind::GreaterThan, false>,             // CmpGtU
+		&handle_quick_compare<OpcodeCompareKind::LessThanOrEqual, true>,          // CmpLeS
+		&handle_quick_compare<OpcodeCompareKind::LessThanOrEqual, false>,         // CmpLeU
+		&handle_quick_compare<OpcodeCompareKind::GreaterThanOrEqual, true>,       // CmpGeS
+		&handle_quick_compare<OpcodeCompareKind::GreaterThanOrEqual, false>,      // CmpGeU
+		&handle_quick_compare<OpcodeCompareKind::NotEqual, true>,                 // CmpNeS
+		&handle_quick_compare<OpcodeCompareKind::NotEqual, false>,                // CmpNeU
+		&handle_quick_compare<OpcodeCompareKind::Equal, true>,                    // CmpEqS
+		&handle_quick_compare<OpcodeCompareKind::Equal, false>,                   // CmpEqU
 	};
 
 	static_assert(HANDLERS[static_cast<u8>(Opcode::EndCode)]                       == &handle_end_code);
@@ -6604,9 +7023,39 @@ static bool interpret_opcodes(CoreData* core, const Opcode* ops) noexcept
 	static_assert(HANDLERS[static_cast<u8>(Opcode::Definition)]                    == &handle_definition);
 	static_assert(HANDLERS[static_cast<u8>(Opcode::TypeType)]                      == &handle_type_type);
 	static_assert(HANDLERS[static_cast<u8>(Opcode::CompleteCircularDefinition)]    == &handle_complete_circular_definition);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::AddS)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Add, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::AddU)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Add, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::SubS)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Sub, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::SubU)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Sub, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::MulS)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Mul, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::MulU)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Mul, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::DivS)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Div, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::DivU)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Div, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::AddTCS)]                        == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::AddTC, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::AddTCU)]                        == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::AddTC, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::SubTCS)]                        == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::SubTC, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::SubTCU)]                        == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::SubTC, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::MulTCS)]                        == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::MulTC, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::MulTCU)]                        == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::MulTC, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::ModS)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Mod, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::ModU)]                          == &handle_quick_arithmetic_op<OpcodeBinaryArithmeticOpKind::Mod, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpLtS)]                        == &handle_quick_compare<OpcodeCompareKind::LessThan, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpLtU)]                        == &handle_quick_compare<OpcodeCompareKind::LessThan, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpGtS)]                        == &handle_quick_compare<OpcodeCompareKind::GreaterThan, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpGtU)]                        == &handle_quick_compare<OpcodeCompareKind::GreaterThan, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpLeS)]                        == &handle_quick_compare<OpcodeCompareKind::LessThanOrEqual, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpLeU)]                        == &handle_quick_compare<OpcodeCompareKind::LessThanOrEqual, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpGeS)]                        == &handle_quick_compare<OpcodeCompareKind::GreaterThanOrEqual, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpGeU)]                        == &handle_quick_compare<OpcodeCompareKind::GreaterThanOrEqual, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpNeS)]                        == &handle_quick_compare<OpcodeCompareKind::NotEqual, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpNeU)]                        == &handle_quick_compare<OpcodeCompareKind::NotEqual, false>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpEqS)]                        == &handle_quick_compare<OpcodeCompareKind::Equal, true>);
+	static_assert(HANDLERS[static_cast<u8>(Opcode::CmpEqU)]                        == &handle_quick_compare<OpcodeCompareKind::Equal, false>);
 
 	core->interp.is_ok = true;
 
+	const bool is_instrumented = core->instrumentation.enabled || core->instrumentation.profiling;
+
 	while (true)
 	{
 		const u8 bits = static_cast<u8>(*ops);
@@ -6636,10 +7085,15 @@ static bool interpret_opcodes(CoreData* core, const Opcode* ops) noexcept
 
 		ASSERT_OR_IGNORE(ordinal != 0 && ordinal < array_count(HANDLERS));
 
-		// A crude helper for looking through the opcode emission logs for the
-		// currently executing operation by its id.
-		// This is actually super-duper helpful for debugging.
-		[[maybe_unused]] const OpcodeId debug_op_id = id_from_opcode(core, ops);
+		#ifndef NDEBUG
+			// A crude helper for looking through the opcode emission logs for the
+			// currently executing operation by its id.
+			// This is actually super-duper helpful for debugging.
+			[[maybe_unused]] const OpcodeId debug_op_id = id_from_opcode(core, ops);
+		#endif
+
+		if (is_instrumented)
+			instrumentation_count_opcode(core, ops);
 
 		const OpcodeHandlerFunc handler = HANDLERS[ordinal];
 
@@ -6662,6 +7116,19 @@ static bool interpret_opcodes(CoreData* core, const Opcode* ops) noexcept
 
 
 
+static bool interpret_opcodes(CoreData* core, const Opcode* ops) noexcept
+{
+	instrumentation_enter_phase(core, InstrumentationPhase::Interpret);
+
+	const bool is_ok = interpret_opcodes_loop(core, ops);
+
+	instrumentation_leave_phase(core);
+
+	return is_ok;
+}
+
+
+
 static TypeId type_from_ts_value(CoreData* core, const TreeSchemaValue* value) noexcept;
 
 static void value_from_ts_value(CoreData* core, byte* dst, TypeId type, const TreeSchemaValue* value) noexcept;
@@ -6912,7 +7379,7 @@ static void init_defines(CoreData* core) noexcept
 		if (!type_metrics_from_id(core, defines_type, &metrics))
 			ASSERT_UNREACHABLE;
 
-		const Maybe<void*> allocation = comp_heap_alloc(core, metrics.size, metrics.align);
+		const Maybe<void*> allocation = comp_heap_alloc_collectable(core, metrics.size, metrics.align);
 
 		if (is_none(allocation))
 			panic("Failed to allocate Config's `defines` value in `CompHeap`.\n");
@@ -6932,7 +7399,7 @@ static void init_defines(CoreData* core) noexcept
 
 		defines_type = type_seal_user_composite(core, defines_type, seal_info);
 
-		const Maybe<void*> allocation = comp_heap_alloc(core, 0, 1);
+		const Maybe<void*> allocation = comp_heap_alloc_collectable(core, 0, 1);
 
 		if (is_none(allocation))
 			panic("Failed to allocate Config's `defines` value in `CompHeap`.\n");
@@ -7509,7 +7976,7 @@ MemoryRequirements interpreter_memory_requirements([[maybe_unused]] const Config
 	return reqs;
 }
 
-void interpreter_init(CoreData* core, MemoryAllocation allocation) noexcept
+static void init_import_logging(CoreData* core) noexcept
 {
 	Interpreter* const interp = &core->interp;
 
@@ -7535,6 +8002,13 @@ void interpreter_init(CoreData* core, MemoryAllocation allocation) noexcept
 
 	if (log_imported_types)
 		interp->imported_types_sink = core->config->logging.imports.types_sink.sink;
+}
+
+void interpreter_init(CoreData* core, MemoryAllocation allocation) noexcept
+{
+	Interpreter* const interp = &core->interp;
+
+	init_import_logging(core);
 
 
 
@@ -7584,11 +8058,18 @@ void interpreter_init(CoreData* core, MemoryAllocation allocation) noexcept
 
 	ASSERT_OR_IGNORE(allocation.ranges[0].count() == offset);
 
+	interp->foreign_library_count = 0;
+
 	init_defines(core);
 
 	init_builtin_infos(core);
 }
 
+void interpreter_restore(CoreData* core) noexcept
+{
+	init_import_logging(core);
+}
+
 
 
 bool import_prelude(CoreData* core, Range<char8> path) noexcept
@@ -1056,6 +1056,7 @@ void lexical_analyser_init(CoreData* core, [[maybe_unused]] MemoryAllocation all
 	LexicalAnalyser* const lex = &core->lex;
 	lex->scopes_top = -1;
 	lex->has_error = false;
+	lex->prelude_file_id = SourceFileId::INVALID;
 }
 
 
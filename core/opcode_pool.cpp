@@ -8,6 +8,12 @@
 #include "../infra/range.hpp"
 #include "../infra/container/reserved_vec.hpp"
 #include "../infra/inplace_sort.hpp"
+#include "../infra/hash.hpp"
+#include "../infra/minos/minos.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
 
 static constexpr u32 OPCODES_RESERVE_SIZE = 1 << 26;
 
@@ -21,6 +27,10 @@ static constexpr u32 FIXUPS_RESERVE_SIZE = (1 << 20) * 3;
 
 static constexpr u32 FIXUPS_COMMIT_INCREMENT_COUNT = 1 << 12;
 
+static constexpr u32 RELOCATIONS_RESERVE_SIZE = (1 << 20) * 8;
+
+static constexpr u32 RELOCATIONS_COMMIT_INCREMENT_COUNT = 1 << 12;
+
 enum class FixupKind : u8
 {
 	INVALID = 0,
@@ -72,6 +82,31 @@ struct SourceMapping
 	SourceId source;
 };
 
+enum class OpcodeRelocationKind : u8
+{
+	INVALID = 0,
+	CodeId,
+	Identifier,
+	File,
+	String,
+};
+
+// Location of an attachment in `OpcodePool::codes` whose value is specific to
+// the current compilation, and thus has to be adjusted when the opcodes
+// containing it are written to or loaded from the opcode cache.
+// These are only recorded if `OpcodePool::records_relocations` is `true`.
+struct OpcodeRelocation
+{
+	// Offset of the attachment from the beginning of `OpcodePool::codes`.
+	u32 offset;
+
+	// `CodeId` for `OpcodeId`s, `Identifier` for `IdentifierId`s and `File`
+	// for `SourceFileId`s. `String` marks the `void*` pointing to the value of
+	// an `Opcode::ValueString`, which is followed by its `u32` size and
+	// `TypeId`.
+	OpcodeRelocationKind kind;
+};
+
 struct alignas(8) MemberSortInfo
 {
 	union
@@ -484,6 +519,34 @@ static OpcodeEffects opcode_effects(const Opcode* code) noexcept
 	case Opcode::LogicalAnd:
 	case Opcode::LogicalOr:
 	case Opcode::Compare:
+	case Opcode::AddS:
+	case Opcode::AddU:
+	case Opcode::SubS:
+	case Opcode::SubU:
+	case Opcode::MulS:
+	case Opcode::MulU:
+	case Opcode::DivS:
+	case Opcode::DivU:
+	case Opcode::AddTCS:
+	case Opcode::AddTCU:
+	case Opcode::SubTCS:
+	case Opcode::SubTCU:
+	case Opcode::MulTCS:
+	case Opcode::MulTCU:
+	case Opcode::ModS:
+	case Opcode::ModU:
+	case Opcode::CmpLtS:
+	case Opcode::CmpLtU:
+	case Opcode::CmpGtS:
+	case Opcode::CmpGtU:
+	case Opcode::CmpLeS:
+	case Opcode::CmpLeU:
+	case Opcode::CmpGeS:
+	case Opcode::CmpGeU:
+	case Opcode::CmpNeS:
+	case Opcode::CmpNeU:
+	case Opcode::CmpEqS:
+	case Opcode::CmpEqU:
 	case Opcode::ArrayType:
 	case Opcode::ImplBody:
 	{
@@ -550,6 +613,57 @@ static OpcodeEffects opcode_effects(const Opcode* code) noexcept
 
 
 
+static void record_relocation(CoreData* core, const void* dst, OpcodeRelocationKind kind) noexcept
+{
+	if (!core->opcodes.records_relocations)
+		return;
+
+	const u32 offset = static_cast<u32>(static_cast<const byte*>(dst) - reinterpret_cast<const byte*>(core->opcodes.codes.begin()));
+
+	core->opcodes.relocations.append(OpcodeRelocation{ offset, kind });
+}
+
+static void record_identifier_relocation(CoreData* core, const void* dst, IdentifierId identifier_id) noexcept
+{
+	// Unnamed arguments and initializers are marked by `IdentifierId::INVALID`,
+	// which needs no adjustment.
+	if (identifier_id != IdentifierId::INVALID)
+		record_relocation(core, dst, OpcodeRelocationKind::Identifier);
+}
+
+template<typename Attach>
+static void record_attach_relocation([[maybe_unused]] CoreData* core, [[maybe_unused]] const byte* dst, [[maybe_unused]] Attach attach) noexcept
+{
+	// Base-case is a no-op, since most attachments do not depend on the
+	// compilation they are emitted in.
+}
+
+static void record_attach_relocation(CoreData* core, const byte* dst, OpcodeId attach) noexcept
+{
+	// `OpcodeId::INVALID` is a placeholder that is later overwritten when
+	// completing a `Fixup`, which records the relocation in turn.
+	if (attach != OpcodeId::INVALID)
+		record_relocation(core, dst, OpcodeRelocationKind::CodeId);
+}
+
+static void record_attach_relocation(CoreData* core, const byte* dst, IdentifierId attach) noexcept
+{
+	record_identifier_relocation(core, dst, attach);
+}
+
+static void record_attach_relocation(CoreData* core, const byte* dst, SourceFileId attach) noexcept
+{
+	if (attach != SourceFileId::INVALID)
+		record_relocation(core, dst, OpcodeRelocationKind::File);
+}
+
+static void record_attach_relocation(CoreData* core, const byte* dst, [[maybe_unused]] void* attach) noexcept
+{
+	// Raw pointers are only ever attached as the value of an
+	// `Opcode::ValueString`.
+	record_relocation(core, dst, OpcodeRelocationKind::String);
+}
+
 static byte* emit_opcode_raw(CoreData* core, Opcode code, bool expects_write_ctx, AstNode* node, u32 attach_size) noexcept
 {
 	const OpcodeId opcode_id = static_cast<OpcodeId>(core->opcodes.codes.used());
@@ -567,17 +681,19 @@ static byte* emit_opcode_raw(CoreData* core, Opcode code, bool expects_write_ctx
 	return reinterpret_cast<byte*>(dst + 1);
 }
 
-static void put_opcode_attachs([[maybe_unused]] byte* dst) noexcept
+static void put_opcode_attachs([[maybe_unused]] CoreData* core, [[maybe_unused]] byte* dst) noexcept
 {
 	// Base-case is a no-op
 }
 
 template<typename Attach, typename... Attachs>
-static void put_opcode_attachs(byte* dst, Attach attach, Attachs... attachs) noexcept
+static void put_opcode_attachs(CoreData* core, byte* dst, Attach attach, Attachs... attachs) noexcept
 {
 	memcpy(dst, &attach, sizeof(Attach));
 
-	put_opcode_attachs(dst + sizeof(Attach), attachs...);
+	record_attach_relocation(core, dst, attach);
+
+	put_opcode_attachs(core, dst + sizeof(Attach), attachs...);
 }
 
 template<typename ...Attachs>
@@ -587,7 +703,7 @@ static void emit_opcode(CoreData* core, Opcode code, bool expects_write_ctx, Ast
 
 	byte* const attach_dst = emit_opcode_raw(core, code, expects_write_ctx, node, attach_size);
 
-	put_opcode_attachs(attach_dst, attachs...);
+	put_opcode_attachs(core, attach_dst, attachs...);
 
 	const OpcodeEffects effects = opcode_effects(reinterpret_cast<Opcode*>(attach_dst - 1));
 
@@ -1024,6 +1140,7 @@ static bool opcodes_from_signature(CoreData* core, AstNode* node, bool expects_w
 		for (u8 i = 0; i != parameter_count; ++i)
 		{
 			memcpy(attach, parameter_names + i, sizeof(IdentifierId));
+			record_identifier_relocation(core, attach, parameter_names[i]);
 			attach += sizeof(IdentifierId);
 
 			memcpy(attach, parameter_flags + i, sizeof(OpcodeSignaturePerParameterFlags));
@@ -1111,6 +1228,7 @@ static bool opcodes_from_signature(CoreData* core, AstNode* node, bool expects_w
 		for (u8 i = 0; i != parameter_count; ++i)
 		{
 			memcpy(attach, parameter_names + i, sizeof(IdentifierId));
+			record_identifier_relocation(core, attach, parameter_names[i]);
 			attach += sizeof(IdentifierId);
 
 			memcpy(attach, parameter_flags + i, sizeof(OpcodeSignaturePerParameterFlags));
@@ -1185,6 +1303,8 @@ static bool opcodes_from_arguments(CoreData* core, AstNode* callee) noexcept
 
 			memcpy(names_attach + argument_index * sizeof(IdentifierId), &argument_name, sizeof(IdentifierId));
 
+			record_identifier_relocation(core, names_attach + argument_index * sizeof(IdentifierId), argument_name);
+
 			emit_fixup_for_argument(core, reinterpret_cast<Opcode*>(callbacks_attach + argument_index * sizeof(OpcodeId)), argument_value);
 
 			if (!has_next_sibling(argument))
@@ -1288,6 +1408,8 @@ static bool opcodes_from_expression(CoreData* core, AstNode* node, bool expects_
 
 					memcpy(attach, &attachment_of<AstImpliedMemberData>(implied_member)->identifier_id, sizeof(IdentifierId));
 
+					record_identifier_relocation(core, attach, attachment_of<AstImpliedMemberData>(implied_member)->identifier_id);
+
 					attach += sizeof(IdentifierId);
 
 					following_member_count = 1;
@@ -1373,6 +1495,8 @@ static bool opcodes_from_expression(CoreData* core, AstNode* node, bool expects_
 
 				memcpy(attach, &name, sizeof(IdentifierId));
 
+				record_identifier_relocation(core, attach, name);
+
 				attach += sizeof(IdentifierId);
 			}
 		}
@@ -1747,6 +1871,7 @@ static bool opcodes_from_expression(CoreData* core, AstNode* node, bool expects_
 			const IdentifierId name = attachment_of<AstIdentifierData>(parameter)->identifier_id;
 
 			memcpy(attach, &name, sizeof(IdentifierId));
+			record_identifier_relocation(core, attach, name);
 			attach += sizeof(IdentifierId);
 		}
 
@@ -1774,6 +1899,7 @@ static bool opcodes_from_expression(CoreData* core, AstNode* node, bool expects_
 			const bool is_mut = has_flag(member, AstFlag::Definition_IsMut);
 
 			memcpy(dst, &name, sizeof(IdentifierId));
+			record_identifier_relocation(core, dst, name);
 			dst += sizeof(IdentifierId);
 
 			memcpy(dst, &is_mut, sizeof(bool));
@@ -1907,6 +2033,7 @@ static bool opcodes_from_expression(CoreData* core, AstNode* node, bool expects_
 			const bool is_mut = has_flag(member, AstFlag::Definition_IsMut);
 
 			memcpy(dst, &name_id, sizeof(IdentifierId));
+			record_identifier_relocation(core, dst, name_id);
 			dst += sizeof(IdentifierId);
 
 			memcpy(dst, &is_mut, sizeof(bool));
@@ -2264,7 +2391,7 @@ static bool opcodes_from_expression(CoreData* core, AstNode* node, bool expects_
 
 		const OpcodeBinaryArithmeticOpKind kind = static_cast<OpcodeBinaryArithmeticOpKind>(static_cast<u8>(tag) - static_cast<u8>(AstTag::OpAdd));
 
-		emit_opcode(core, Opcode::BinaryArithmeticOp, expects_write_ctx, node, kind);
+		emit_opcode(core, Opcode::BinaryArithmeticOp, expects_write_ctx, node, kind, TypeId::INVALID);
 
 		return true;
 	}
@@ -2377,7 +2504,7 @@ static bool opcodes_from_expression(CoreData* core, AstNode* node, bool expects_
 
 		const OpcodeCompareKind kind = static_cast<OpcodeCompareKind>(static_cast<u8>(tag) - static_cast<u8>(AstTag::OpCmpLT));
 
-		emit_opcode(core, Opcode::Compare, expects_write_ctx, node, kind);
+		emit_opcode(core, Opcode::Compare, expects_write_ctx, node, kind, TypeId::INVALID);
 
 		return true;
 	}
@@ -2455,7 +2582,7 @@ static bool opcodes_from_expression(CoreData* core, AstNode* node, bool expects_
 
 			const OpcodeBinaryArithmeticOpKind kind = static_cast<OpcodeBinaryArithmeticOpKind>(static_cast<u8>(tag) - static_cast<u8>(AstTag::OpSetAdd));
 
-			emit_opcode(core, Opcode::BinaryArithmeticOp, true, node, kind);
+			emit_opcode(core, Opcode::BinaryArithmeticOp, true, node, kind, TypeId::INVALID);
 		}
 
 		if (expects_write_ctx)
@@ -2848,6 +2975,8 @@ static bool complete_fixups(CoreData* core) noexcept
 		byte* const fixup_dst = reinterpret_cast<byte*>(core->opcodes.codes.begin()) + static_cast<u32>(fixup.dst_id);
 		memcpy(fixup_dst, &fixup_code_id, sizeof(OpcodeId));
 
+		record_relocation(core, fixup_dst, OpcodeRelocationKind::CodeId);
+
 		if (!complete_fixup(core, fixup))
 			return false;
 
@@ -2875,7 +3004,7 @@ MemoryRequirements opcode_pool_memory_requirements([[maybe_unused]] const Config
 	reqs.count = 2;
 	reqs.ranges[0].size = OPCODES_RESERVE_SIZE;
 	reqs.ranges[0].max_offset = UINT32_MAX;
-	reqs.ranges[1].size = SOURCES_RESERVE_SIZE + FIXUPS_RESERVE_SIZE;
+	reqs.ranges[1].size = SOURCES_RESERVE_SIZE + FIXUPS_RESERVE_SIZE + RELOCATIONS_RESERVE_SIZE;
 	reqs.ranges[1].max_offset = UINT64_MAX;
 
 	return reqs;
@@ -2885,7 +3014,7 @@ void opcode_pool_init(CoreData* core, MemoryAllocation allocation) noexcept
 {
 	ASSERT_OR_IGNORE(allocation.ranges[0].count() == OPCODES_RESERVE_SIZE);
 
-	ASSERT_OR_IGNORE(allocation.ranges[1].count() == SOURCES_RESERVE_SIZE + FIXUPS_RESERVE_SIZE);
+	ASSERT_OR_IGNORE(allocation.ranges[1].count() == SOURCES_RESERVE_SIZE + FIXUPS_RESERVE_SIZE + RELOCATIONS_RESERVE_SIZE);
 
 	OpcodePool* const opcodes = &core->opcodes;
 
@@ -2895,13 +3024,17 @@ void opcode_pool_init(CoreData* core, MemoryAllocation allocation) noexcept
 
 	opcodes->fixups.init(allocation.ranges[1].mut_subrange(SOURCES_RESERVE_SIZE, FIXUPS_RESERVE_SIZE), FIXUPS_COMMIT_INCREMENT_COUNT);
 
+	opcodes->relocations.init(allocation.ranges[1].mut_subrange(SOURCES_RESERVE_SIZE + FIXUPS_RESERVE_SIZE, RELOCATIONS_RESERVE_SIZE), RELOCATIONS_COMMIT_INCREMENT_COUNT);
+
+	opcodes->records_relocations = core->config->opcode_cache.enabled;
+
 	// Reserve `OpcodeId::INVALID`.
 	(void) opcodes->codes.reserve();
 }
 
 
 
-const Maybe<Opcode*> opcodes_from_file_member_ast(CoreData* core, AstNode* node, SourceFileId file_id, u16 rank) noexcept
+static Maybe<Opcode*> opcodes_from_file_member_ast_uninstrumented(CoreData* core, AstNode* node, SourceFileId file_id, u16 rank) noexcept
 {
 	core->opcodes.state.values_diff = 0;
 	core->opcodes.state.scopes_diff = 0;
@@ -2966,6 +3099,17 @@ const Maybe<Opcode*> opcodes_from_file_member_ast(CoreData* core, AstNode* node,
 	return some(first_opcode);
 }
 
+const Maybe<Opcode*> opcodes_from_file_member_ast(CoreData* core, AstNode* node, SourceFileId file_id, u16 rank) noexcept
+{
+	instrumentation_enter_phase(core, InstrumentationPhase::EmitOpcodes);
+
+	const Maybe<Opcode*> rst = opcodes_from_file_member_ast_uninstrumented(core, node, file_id, rank);
+
+	instrumentation_leave_phase(core);
+
+	return rst;
+}
+
 OpcodeId opcode_id_from_builtin(CoreData* core, Builtin builtin) noexcept
 {
 	core->opcodes.state.values_diff = 0;
@@ -3210,6 +3354,34 @@ bool return_type_opcodes_equal([[maybe_unused]] CoreData* core, const Opcode* a_
 		case Opcode::Definition:
 		case Opcode::TypeType:
 		case Opcode::CompleteCircularDefinition:
+		case Opcode::AddS:
+		case Opcode::AddU:
+		case Opcode::SubS:
+		case Opcode::SubU:
+		case Opcode::MulS:
+		case Opcode::MulU:
+		case Opcode::DivS:
+		case Opcode::DivU:
+		case Opcode::AddTCS:
+		case Opcode::AddTCU:
+		case Opcode::SubTCS:
+		case Opcode::SubTCU:
+		case Opcode::MulTCS:
+		case Opcode::MulTCU:
+		case Opcode::ModS:
+		case Opcode::ModU:
+		case Opcode::CmpLtS:
+		case Opcode::CmpLtU:
+		case Opcode::CmpGtS:
+		case Opcode::CmpGtU:
+		case Opcode::CmpLeS:
+		case Opcode::CmpLeU:
+		case Opcode::CmpGeS:
+		case Opcode::CmpGeU:
+		case Opcode::CmpNeS:
+		case Opcode::CmpNeU:
+		case Opcode::CmpEqS:
+		case Opcode::CmpEqU:
 			TODO("Implement `return_type_opcodes_equal(%)`.", tag_name(a));
 
 		case Opcode::INVALID:
@@ -3233,6 +3405,787 @@ bool return_type_opcodes_equal([[maybe_unused]] CoreData* core, const Opcode* a_
 	}
 }
 
+
+
+// Layout of an opcode cache file:
+//
+// - `OpcodeCacheHeader`
+// - `member_count` `u32`s, holding the offset of each file member's
+//   initializer from the beginning of the cached opcodes.
+// - `source_count` pairs of `u32`s, holding the `SourceMapping`s of the cached
+//   opcodes. Their `code_begin` is relative to the beginning of the cached
+//   opcodes, and their `source` is relative to the file's `source_id_base`
+//   plus one, with `0` representing `SourceId::INVALID`.
+// - `relocation_count` `OpcodeRelocation`s.
+// - `identifier_count` `u32`s, holding the end offset of each identifier in
+//   the identifier character table.
+// - `string_count` `u32`s, holding the end offset of each string in the
+//   string character table.
+// - `code_bytes` bytes of opcodes. Relocated attachments hold the following:
+//   - `CodeId`: The offset from the beginning of the cached opcodes.
+//   - `Identifier`: An index into the identifier table.
+//   - `File`: `0` for the cached file itself, `1` for the prelude.
+//   - `String`: An index into the string table, with the string's `TypeId`
+//     set to `TypeId::INVALID`.
+// - `identifier_bytes` bytes of identifier characters.
+// - `string_bytes` bytes of string characters.
+//
+// `magic` is written only after the rest of the file is complete, so that
+// partially written files are not mistaken for valid ones.
+struct OpcodeCacheHeader
+{
+	u32 magic;
+
+	u32 version;
+
+	u64 content_hash;
+
+	u64 prelude_hash;
+
+	u32 member_count;
+
+	u32 code_bytes;
+
+	u32 source_count;
+
+	u32 relocation_count;
+
+	u32 identifier_count;
+
+	u32 identifier_bytes;
+
+	u32 string_count;
+
+	u32 string_bytes;
+};
+
+static_assert(sizeof(OpcodeCacheHeader) % sizeof(u64) == 0);
+
+static constexpr u32 OPCODE_CACHE_MAGIC = 0x504F4345; // "ECOP"
+
+// Must be incremented whenever the opcode encoding or the opcodes emitted for
+// a given AST change.
+static constexpr u32 OPCODE_CACHE_VERSION = 1;
+
+struct OpcodeCacheLayout
+{
+	u64 member_offsets_offset;
+
+	u64 sources_offset;
+
+	u64 relocations_offset;
+
+	u64 identifier_ends_offset;
+
+	u64 string_ends_offset;
+
+	u64 codes_offset;
+
+	u64 identifier_chars_offset;
+
+	u64 string_chars_offset;
+
+	u64 total_bytes;
+};
+
+struct OpcodeCacheIdentifierSlot
+{
+	IdentifierId id;
+
+	u32 local_index;
+};
+
+static OpcodeCacheLayout opcode_cache_layout_from_header(const OpcodeCacheHeader* header) noexcept
+{
+	OpcodeCacheLayout layout;
+	layout.member_offsets_offset = sizeof(OpcodeCacheHeader);
+	layout.sources_offset = layout.member_offsets_offset + static_cast<u64>(header->member_count) * sizeof(u32);
+	layout.relocations_offset = layout.sources_offset + static_cast<u64>(header->source_count) * 2 * sizeof(u32);
+	layout.identifier_ends_offset = layout.relocations_offset + static_cast<u64>(header->relocation_count) * sizeof(OpcodeRelocation);
+	layout.string_ends_offset = layout.identifier_ends_offset + static_cast<u64>(header->identifier_count) * sizeof(u32);
+	layout.codes_offset = layout.string_ends_offset + static_cast<u64>(header->string_count) * sizeof(u32);
+	layout.identifier_chars_offset = layout.codes_offset + header->code_bytes;
+	layout.string_chars_offset = layout.identifier_chars_offset + header->identifier_bytes;
+	layout.total_bytes = layout.string_chars_offset + header->string_bytes;
+
+	return layout;
+}
+
+static u32 opcode_relocation_bytes(OpcodeRelocationKind kind) noexcept
+{
+	switch (kind)
+	{
+	case OpcodeRelocationKind::CodeId:
+		return sizeof(OpcodeId);
+
+	case OpcodeRelocationKind::Identifier:
+		return sizeof(IdentifierId);
+
+	case OpcodeRelocationKind::File:
+		return sizeof(SourceFileId);
+
+	case OpcodeRelocationKind::String:
+		return sizeof(void*) + sizeof(u32) + sizeof(TypeId);
+
+	case OpcodeRelocationKind::INVALID:
+		; // Fallthrough to unreachable.
+	}
+
+	ASSERT_UNREACHABLE;
+}
+
+static bool opcode_cache_prelude_hash(CoreData* core, u64* out) noexcept
+{
+	if (core->lex.prelude_file_id == SourceFileId::INVALID)
+		return false;
+
+	*out = source_file_from_id(core, core->lex.prelude_file_id)->content_hash;
+
+	return true;
+}
+
+static u32 opcode_cache_path(CoreData* core, u64 content_hash, u64 prelude_hash, MutRange<char8> out) noexcept
+{
+	const Range<char8> directory = core->config->opcode_cache.directory;
+
+	// '/' + 16 hex digits + '-' + 16 hex digits + '-v' + 8 hex digits + ".ops"
+	//
+	// As with the AST cache, `OPCODE_CACHE_VERSION` is part of the name so
+	// that files written in an older format do not shadow their replacement.
+	constexpr u32 name_bytes = 48;
+
+	if (directory.count() + name_bytes > out.count())
+		return 0;
+
+	memcpy(out.begin(), directory.begin(), directory.count());
+
+	char8* curr = out.begin() + directory.count();
+
+	*curr++ = '/';
+
+	for (u32 i = 0; i != 16; ++i)
+		*curr++ = "0123456789abcdef"[(content_hash >> (60 - i * 4)) & 0xF];
+
+	*curr++ = '-';
+
+	for (u32 i = 0; i != 16; ++i)
+		*curr++ = "0123456789abcdef"[(prelude_hash >> (60 - i * 4)) & 0xF];
+
+	*curr++ = '-';
+	*curr++ = 'v';
+
+	for (u32 i = 0; i != 8; ++i)
+		*curr++ = "0123456789abcdef"[(OPCODE_CACHE_VERSION >> (28 - i * 4)) & 0xF];
+
+	memcpy(curr, ".ops", 4);
+	curr += 4;
+
+	return static_cast<u32>(curr - out.begin());
+}
+
+static bool opcode_cache_validate_ends(const u32* ends, u32 count, u32 total_bytes) noexcept
+{
+	u32 prev_end = 0;
+
+	for (u32 i = 0; i != count; ++i)
+	{
+		if (ends[i] < prev_end)
+			return false;
+
+		prev_end = ends[i];
+	}
+
+	return prev_end == total_bytes;
+}
+
+static bool opcode_cache_validate(const OpcodeCacheHeader* header, const byte* file, const OpcodeCacheLayout* layout) noexcept
+{
+	const u32* const member_offsets = reinterpret_cast<const u32*>(file + layout->member_offsets_offset);
+
+	for (u32 i = 0; i != header->member_count; ++i)
+	{
+		if (member_offsets[i] >= header->code_bytes)
+			return false;
+	}
+
+	const u32* const sources = reinterpret_cast<const u32*>(file + layout->sources_offset);
+
+	for (u32 i = 0; i != header->source_count; ++i)
+	{
+		if (sources[i * 2] >= header->code_bytes || (i != 0 && sources[i * 2] < sources[i * 2 - 2]))
+			return false;
+	}
+
+	const OpcodeRelocation* const relocations = reinterpret_cast<const OpcodeRelocation*>(file + layout->relocations_offset);
+
+	const byte* const codes = file + layout->codes_offset;
+
+	for (u32 i = 0; i != header->relocation_count; ++i)
+	{
+		const OpcodeRelocation relocation = relocations[i];
+
+		if (relocation.kind != OpcodeRelocationKind::CodeId
+		 && relocation.kind != OpcodeRelocationKind::Identifier
+		 && relocation.kind != OpcodeRelocationKind::File
+		 && relocation.kind != OpcodeRelocationKind::String)
+			return false;
+
+		if (static_cast<u64>(relocation.offset) + opcode_relocation_bytes(relocation.kind) > header->code_bytes)
+			return false;
+
+		u64 value = 0;
+
+		memcpy(&value, codes + relocation.offset, relocation.kind == OpcodeRelocationKind::String ? sizeof(u64) : sizeof(u32));
+
+		const u64 limit = relocation.kind == OpcodeRelocationKind::CodeId ? header->code_bytes
+		                : relocation.kind == OpcodeRelocationKind::Identifier ? header->identifier_count
+		                : relocation.kind == OpcodeRelocationKind::File ? 2
+		                : header->string_count;
+
+		if (value >= limit)
+			return false;
+	}
+
+	return opcode_cache_validate_ends(reinterpret_cast<const u32*>(file + layout->identifier_ends_offset), header->identifier_count, header->identifier_bytes)
+	    && opcode_cache_validate_ends(reinterpret_cast<const u32*>(file + layout->string_ends_offset), header->string_count, header->string_bytes);
+}
+
+static bool opcode_cache_load_from_image(CoreData* core, const byte* file, u64 file_bytes, SourceFileId file_id, u16 member_count, OpcodeId* out_initializer_ids) noexcept
+{
+	const OpcodeCacheHeader* const header = reinterpret_cast<const OpcodeCacheHeader*>(file);
+
+	const SourceFile* const source_file = source_file_from_id(core, file_id);
+
+	u64 prelude_hash;
+
+	if (!opcode_cache_prelude_hash(core, &prelude_hash))
+		return false;
+
+	if (header->magic != OPCODE_CACHE_MAGIC
+	 || header->version != OPCODE_CACHE_VERSION
+	 || header->content_hash != source_file->content_hash
+	 || header->prelude_hash != prelude_hash
+	 || header->member_count != member_count)
+		return false;
+
+	const OpcodeCacheLayout layout = opcode_cache_layout_from_header(header);
+
+	if (layout.total_bytes != file_bytes || !opcode_cache_validate(header, file, &layout))
+		return false;
+
+	const u32* const identifier_ends = reinterpret_cast<const u32*>(file + layout.identifier_ends_offset);
+
+	const char8* const identifier_chars = reinterpret_cast<const char8*>(file + layout.identifier_chars_offset);
+
+	const u32* const string_ends = reinterpret_cast<const u32*>(file + layout.string_ends_offset);
+
+	const byte* const string_chars = file + layout.string_chars_offset;
+
+	IdentifierId* const identifier_ids = static_cast<IdentifierId*>(malloc((header->identifier_count + 1) * sizeof(IdentifierId)));
+
+	if (identifier_ids == nullptr)
+		return false;
+
+	u32 identifier_begin = 0;
+
+	for (u32 i = 0; i != header->identifier_count; ++i)
+	{
+		identifier_ids[i] = id_from_identifier(core, Range<char8>{ identifier_chars + identifier_begin, identifier_chars + identifier_ends[i] });
+
+		identifier_begin = identifier_ends[i];
+	}
+
+	const u32 base = core->opcodes.codes.used();
+
+	byte* const codes = reinterpret_cast<byte*>(core->opcodes.codes.reserve(header->code_bytes));
+
+	memcpy(codes, file + layout.codes_offset, header->code_bytes);
+
+	const OpcodeRelocation* const relocations = reinterpret_cast<const OpcodeRelocation*>(file + layout.relocations_offset);
+
+	const TypeId u8_type_id = type_create_numeric(core, TypeTag::Integer, NumericType{ 8, false });
+
+	for (u32 i = 0; i != header->relocation_count; ++i)
+	{
+		byte* const dst = codes + relocations[i].offset;
+
+		switch (relocations[i].kind)
+		{
+		case OpcodeRelocationKind::CodeId:
+		{
+			u32 offset;
+
+			memcpy(&offset, dst, sizeof(u32));
+
+			const OpcodeId code_id = static_cast<OpcodeId>(base + offset);
+
+			memcpy(dst, &code_id, sizeof(OpcodeId));
+
+			break;
+		}
+
+		case OpcodeRelocationKind::Identifier:
+		{
+			u32 index;
+
+			memcpy(&index, dst, sizeof(u32));
+
+			memcpy(dst, identifier_ids + index, sizeof(IdentifierId));
+
+			break;
+		}
+
+		case OpcodeRelocationKind::File:
+		{
+			u32 index;
+
+			memcpy(&index, dst, sizeof(u32));
+
+			const SourceFileId relocated_file_id = index == 0 ? file_id : core->lex.prelude_file_id;
+
+			memcpy(dst, &relocated_file_id, sizeof(SourceFileId));
+
+			break;
+		}
+
+		case OpcodeRelocationKind::String:
+		{
+			u64 index;
+
+			memcpy(&index, dst, sizeof(u64));
+
+			const u32 begin = index == 0 ? 0 : string_ends[index - 1];
+
+			const u32 bytes = string_ends[index] - begin;
+
+			const TypeId string_type_id = type_create_array(core, TypeTag::Array, ArrayType{ bytes, some(u8_type_id) });
+
+			const Maybe<void*> allocation = comp_heap_alloc(core, bytes, 1);
+
+			if (is_none(allocation))
+				panic("Failed to allocate % bytes of compile-time heap memory for string literal.\n", bytes);
+
+			memcpy(get(allocation), string_chars + begin, bytes);
+
+			void* const value_begin = get(allocation);
+
+			memcpy(dst, &value_begin, sizeof(void*));
+
+			memcpy(dst + sizeof(void*), &bytes, sizeof(u32));
+
+			memcpy(dst + sizeof(void*) + sizeof(u32), &string_type_id, sizeof(TypeId));
+
+			break;
+		}
+
+		case OpcodeRelocationKind::INVALID:
+			ASSERT_UNREACHABLE;
+		}
+	}
+
+	free(identifier_ids);
+
+	const u32* const sources = reinterpret_cast<const u32*>(file + layout.sources_offset);
+
+	const u32 source_id_base = static_cast<u32>(source_file->source_id_base);
+
+	for (u32 i = 0; i != header->source_count; ++i)
+	{
+		const SourceId source_id = sources[i * 2 + 1] == 0
+			? SourceId::INVALID
+			: static_cast<SourceId>(source_id_base + sources[i * 2 + 1] - 1);
+
+		core->opcodes.sources.append(SourceMapping{ static_cast<OpcodeId>(base + sources[i * 2]), source_id });
+	}
+
+	const u32* const member_offsets = reinterpret_cast<const u32*>(file + layout.member_offsets_offset);
+
+	for (u16 i = 0; i != member_count; ++i)
+		out_initializer_ids[i] = static_cast<OpcodeId>(base + member_offsets[i]);
+
+	return true;
+}
+
+static u32 opcode_cache_identifier_slot(const OpcodeCacheIdentifierSlot* slots, u32 slot_count, IdentifierId id) noexcept
+{
+	u32 slot_index = (static_cast<u32>(id) * 2654435761u) & (slot_count - 1);
+
+	while (slots[slot_index].id != IdentifierId::INVALID && slots[slot_index].id != id)
+		slot_index = (slot_index + 1) & (slot_count - 1);
+
+	return slot_index;
+}
+
+static bool opcode_cache_build_image(CoreData* core, SourceFileId file_id, u16 member_count, const OpcodeId* initializer_ids, u64 prelude_hash, byte** out_image, u64* out_image_bytes) noexcept
+{
+	const SourceFile* const source_file = source_file_from_id(core, file_id);
+
+	const u32 begin = static_cast<u32>(initializer_ids[0]);
+
+	const u32 end = core->opcodes.codes.used();
+
+	const byte* const codes = reinterpret_cast<const byte*>(core->opcodes.codes.begin());
+
+	u32 first_source = core->opcodes.sources.used();
+
+	while (first_source != 0 && static_cast<u32>(core->opcodes.sources.begin()[first_source - 1].code_begin) >= begin)
+		first_source -= 1;
+
+	if (first_source == core->opcodes.sources.used() || static_cast<u32>(core->opcodes.sources.begin()[first_source].code_begin) != begin)
+		return false;
+
+	const OpcodeRelocation* const relocations = core->opcodes.relocations.begin();
+
+	const u32 relocation_count = core->opcodes.relocations.used();
+
+	u32 string_count = 0;
+
+	u32 string_bytes = 0;
+
+	for (u32 i = 0; i != relocation_count; ++i)
+	{
+		if (relocations[i].offset < begin || relocations[i].offset >= end)
+			return false;
+
+		if (relocations[i].kind == OpcodeRelocationKind::String)
+		{
+			u32 bytes;
+
+			memcpy(&bytes, codes + relocations[i].offset + sizeof(void*), sizeof(u32));
+
+			string_count += 1;
+
+			string_bytes += bytes;
+		}
+	}
+
+	u32 slot_count = 16;
+
+	while (slot_count < relocation_count * 2)
+		slot_count *= 2;
+
+	OpcodeCacheIdentifierSlot* const slots = static_cast<OpcodeCacheIdentifierSlot*>(calloc(slot_count, sizeof(OpcodeCacheIdentifierSlot)));
+
+	IdentifierId* const local_identifiers = static_cast<IdentifierId*>(malloc((relocation_count + 1) * sizeof(IdentifierId)));
+
+	if (slots == nullptr || local_identifiers == nullptr)
+	{
+		free(slots);
+
+		free(local_identifiers);
+
+		return false;
+	}
+
+	static_assert(static_cast<u32>(IdentifierId::INVALID) == 0);
+
+	u32 identifier_count = 0;
+
+	u32 identifier_bytes = 0;
+
+	for (u32 i = 0; i != relocation_count; ++i)
+	{
+		if (relocations[i].kind != OpcodeRelocationKind::Identifier)
+			continue;
+
+		IdentifierId id;
+
+		memcpy(&id, codes + relocations[i].offset, sizeof(IdentifierId));
+
+		const u32 slot_index = opcode_cache_identifier_slot(slots, slot_count, id);
+
+		if (slots[slot_index].id == IdentifierId::INVALID)
+		{
+			slots[slot_index].id = id;
+			slots[slot_index].local_index = identifier_count;
+
+			local_identifiers[identifier_count] = id;
+
+			identifier_count += 1;
+
+			identifier_bytes += static_cast<u32>(identifier_name_from_id(core, id).count());
+		}
+	}
+
+	OpcodeCacheHeader header;
+	header.magic = 0;
+	header.version = OPCODE_CACHE_VERSION;
+	header.content_hash = source_file->content_hash;
+	header.prelude_hash = prelude_hash;
+	header.member_count = member_count;
+	header.code_bytes = end - begin;
+	header.source_count = core->opcodes.sources.used() - first_source;
+	header.relocation_count = relocation_count;
+	header.identifier_count = identifier_count;
+	header.identifier_bytes = identifier_bytes;
+	header.string_count = string_count;
+	header.string_bytes = string_bytes;
+
+	const OpcodeCacheLayout layout = opcode_cache_layout_from_header(&header);
+
+	byte* const image = static_cast<byte*>(malloc(layout.total_bytes));
+
+	if (image == nullptr)
+	{
+		free(slots);
+
+		free(local_identifiers);
+
+		return false;
+	}
+
+	memcpy(image, &header, sizeof(header));
+
+	u32* const member_offsets = reinterpret_cast<u32*>(image + layout.member_offsets_offset);
+
+	for (u16 i = 0; i != member_count; ++i)
+		member_offsets[i] = static_cast<u32>(initializer_ids[i]) - begin;
+
+	u32* const sources = reinterpret_cast<u32*>(image + layout.sources_offset);
+
+	const u32 source_id_base = static_cast<u32>(source_file->source_id_base);
+
+	for (u32 i = 0; i != header.source_count; ++i)
+	{
+		const SourceMapping mapping = core->opcodes.sources.begin()[first_source + i];
+
+		sources[i * 2] = static_cast<u32>(mapping.code_begin) - begin;
+		sources[i * 2 + 1] = mapping.source == SourceId::INVALID ? 0 : static_cast<u32>(mapping.source) - source_id_base + 1;
+	}
+
+	memcpy(image + layout.relocations_offset, relocations, relocation_count * sizeof(OpcodeRelocation));
+
+	OpcodeRelocation* const image_relocations = reinterpret_cast<OpcodeRelocation*>(image + layout.relocations_offset);
+
+	byte* const image_codes = image + layout.codes_offset;
+
+	memcpy(image_codes, codes + begin, end - begin);
+
+	u32* const identifier_ends = reinterpret_cast<u32*>(image + layout.identifier_ends_offset);
+
+	char8* const identifier_chars = reinterpret_cast<char8*>(image + layout.identifier_chars_offset);
+
+	u32 identifier_end = 0;
+
+	for (u32 i = 0; i != identifier_count; ++i)
+	{
+		const Range<char8> name = identifier_name_from_id(core, local_identifiers[i]);
+
+		memcpy(identifier_chars + identifier_end, name.begin(), name.count());
+
+		identifier_end += static_cast<u32>(name.count());
+
+		identifier_ends[i] = identifier_end;
+	}
+
+	u32* const string_ends = reinterpret_cast<u32*>(image + layout.string_ends_offset);
+
+	byte* const string_chars = image + layout.string_chars_offset;
+
+	u64 string_index = 0;
+
+	u32 string_end = 0;
+
+	bool is_ok = true;
+
+	for (u32 i = 0; i != relocation_count; ++i)
+	{
+		image_relocations[i].offset -= begin;
+
+		byte* const dst = image_codes + image_relocations[i].offset;
+
+		switch (image_relocations[i].kind)
+		{
+		case OpcodeRelocationKind::CodeId:
+		{
+			u32 code_id;
+
+			memcpy(&code_id, dst, sizeof(u32));
+
+			// Opcodes referring to code outside of the file cannot be
+			// cached, as there would be no telling where it ends up.
+			if (code_id < begin || code_id >= end)
+				is_ok = false;
+
+			const u32 offset = code_id - begin;
+
+			memcpy(dst, &offset, sizeof(u32));
+
+			break;
+		}
+
+		case OpcodeRelocationKind::Identifier:
+		{
+			IdentifierId id;
+
+			memcpy(&id, dst, sizeof(IdentifierId));
+
+			const u32 local_index = slots[opcode_cache_identifier_slot(slots, slot_count, id)].local_index;
+
+			memcpy(dst, &local_index, sizeof(u32));
+
+			break;
+		}
+
+		case OpcodeRelocationKind::File:
+		{
+			SourceFileId referenced_file_id;
+
+			memcpy(&referenced_file_id, dst, sizeof(SourceFileId));
+
+			// Globals can only be bound to the file itself or the prelude.
+			if (referenced_file_id != file_id && referenced_file_id != core->lex.prelude_file_id)
+				is_ok = false;
+
+			const u32 index = referenced_file_id == file_id ? 0 : 1;
+
+			memcpy(dst, &index, sizeof(u32));
+
+			break;
+		}
+
+		case OpcodeRelocationKind::String:
+		{
+			void* value_begin;
+
+			memcpy(&value_begin, dst, sizeof(void*));
+
+			u32 bytes;
+
+			memcpy(&bytes, dst + sizeof(void*), sizeof(u32));
+
+			memcpy(string_chars + string_end, value_begin, bytes);
+
+			string_end += bytes;
+
+			string_ends[string_index] = string_end;
+
+			memcpy(dst, &string_index, sizeof(u64));
+
+			const TypeId invalid_type_id = TypeId::INVALID;
+
+			memcpy(dst + sizeof(void*) + sizeof(u32), &invalid_type_id, sizeof(TypeId));
+
+			string_index += 1;
+
+			break;
+		}
+
+		case OpcodeRelocationKind::INVALID:
+			ASSERT_UNREACHABLE;
+		}
+	}
+
+	free(slots);
+
+	free(local_identifiers);
+
+	if (!is_ok)
+	{
+		free(image);
+
+		return false;
+	}
+
+	*out_image = image;
+
+	*out_image_bytes = layout.total_bytes;
+
+	return true;
+}
+
+bool opcode_cache_load(CoreData* core, SourceFileId file_id, u16 member_count, OpcodeId* out_initializer_ids) noexcept
+{
+	if (!core->opcodes.records_relocations)
+		return false;
+
+	// Drop relocations left over from previous files, so that those recorded
+	// from here on belong to `file_id` in case it has to be generated.
+	core->opcodes.relocations.reset();
+
+	// There is nothing to load for files without members, so these are not
+	// counted as lookups.
+	if (member_count == 0)
+		return false;
+
+	bool is_loaded = false;
+
+	u64 prelude_hash;
+
+	char8 path_buf[4096];
+
+	const u32 path_bytes = opcode_cache_prelude_hash(core, &prelude_hash)
+		? opcode_cache_path(core, source_file_from_id(core, file_id)->content_hash, prelude_hash, MutRange{ path_buf })
+		: 0;
+
+	minos::FileHandle file;
+
+	if (path_bytes != 0 && minos::file_create(Range{ path_buf, path_bytes }, minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+	{
+		minos::FileInfo fileinfo;
+
+		// The image is read into a temporary buffer rather than mapped, since
+		// unmapping has to shoot down the TLB entries of all threads in the
+		// process, which is noticeably slower than the copy while source
+		// prefetching is active.
+
+		if (minos::file_get_info(file, &fileinfo) && !fileinfo.is_directory && fileinfo.bytes >= sizeof(OpcodeCacheHeader) && fileinfo.bytes <= UINT32_MAX)
+		{
+			byte* const buffer = static_cast<byte*>(malloc(fileinfo.bytes));
+
+			u32 bytes_read;
+
+			if (buffer != nullptr && minos::file_read(file, MutRange<byte>{ buffer, fileinfo.bytes }, 0, &bytes_read) && bytes_read == fileinfo.bytes)
+				is_loaded = opcode_cache_load_from_image(core, buffer, fileinfo.bytes, file_id, member_count, out_initializer_ids);
+
+			free(buffer);
+		}
+
+		minos::file_close(file);
+	}
+
+	instrumentation_count_opcode_cache_load(core, is_loaded);
+
+	return is_loaded;
+}
+
+void opcode_cache_store(CoreData* core, SourceFileId file_id, u16 member_count, const OpcodeId* initializer_ids) noexcept
+{
+	if (!core->opcodes.records_relocations)
+		return;
+
+	u64 prelude_hash;
+
+	byte* image;
+
+	u64 image_bytes;
+
+	const bool has_image = member_count != 0
+	                    && opcode_cache_prelude_hash(core, &prelude_hash)
+	                    && opcode_cache_build_image(core, file_id, member_count, initializer_ids, prelude_hash, &image, &image_bytes);
+
+	core->opcodes.relocations.reset();
+
+	if (!has_image)
+		return;
+
+	// Failing to write the cache is not an error, as it only costs us the
+	// opcode generation on the next run.
+
+	(void) minos::directory_create(core->config->opcode_cache.directory);
+
+	char8 path_buf[4096];
+
+	const u32 path_bytes = opcode_cache_path(core, source_file_from_id(core, file_id)->content_hash, prelude_hash, MutRange{ path_buf });
+
+	if (path_bytes != 0)
+		(void) cache_file_write(Range{ path_buf, path_bytes }, Range<byte>{ image, image_bytes }, offsetof(OpcodeCacheHeader, magic), OPCODE_CACHE_MAGIC);
+
+	free(image);
+}
+
+
+
 const char8* tag_name(Opcode op) noexcept
 {
 	static constexpr const char8* TAG_NAMES[] = {
@@ -3314,6 +4267,34 @@ const char8* tag_name(Opcode op) noexcept
 		"Definition",
 		"TypeType",
 		"CompleteCircularDefinition",
+		"AddS",
+		"AddU",
+		"SubS",
+		"SubU",
+		"MulS",
+		"MulU",
+		"DivS",
+		"DivU",
+		"AddTCS",
+		"AddTCU",
+		"SubTCS",
+		"SubTCU",
+		"MulTCS",
+		"MulTCU",
+		"ModS",
+		"ModU",
+		"CmpLtS",
+		"CmpLtU",
+		"CmpGtS",
+		"CmpGtU",
+		"CmpLeS",
+		"CmpLeU",
+		"CmpGeS",
+		"CmpGeU",
+		"CmpNeS",
+		"CmpNeU",
+		"CmpEqS",
+		"CmpEqU",
 	};
 
 	u8 ordinal = static_cast<u8>(op);
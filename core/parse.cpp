@@ -13,6 +13,14 @@
 #include <csetjmp>
 #include <errno.h>
 
+#if defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+
+	#define PARSE_HAS_SSE2 1
+#else
+	#define PARSE_HAS_SSE2 0
+#endif
+
 static constexpr u32 MAX_STRING_LITERAL_BYTES = 4096;
 
 enum class Token : u8
@@ -290,6 +298,83 @@ static constexpr AttachmentRange<char8, u8> KEYWORDS[] = {
 	range::from_literal_string("_comp_defines",           static_cast<u8>(Builtin::CompDefines)),
 };
 
+static constexpr u32 KEYWORD_HASH_SLOT_BITS = 8;
+
+// Maps no two `KEYWORDS` to the same slot of `KeywordHash::slots`. It is the
+// first odd number from `0x9E37'79B1` upwards that does so. Searching for it
+// at compile time would exceed the constant evaluation step limits of Clang
+// and MSVC, so when `KEYWORDS` changes and the check on `KEYWORD_HASH`
+// fails, a new one has to be searched for the same way and put here.
+static constexpr u32 KEYWORD_HASH_MULTIPLIER = 0x9E37'7D93;
+
+// Perfect hash over `KEYWORDS`, which lets the lexer recognise keywords and
+// builtins without going through the `IdentifierPool`. `slots` holds one more
+// than the index into `KEYWORDS` of the keyword hashing to the slot, or `0`
+// if there is none.
+struct KeywordHash
+{
+	bool has_collision;
+
+	u8 slots[static_cast<u32>(1) << KEYWORD_HASH_SLOT_BITS];
+};
+
+// Keywords are told apart by their length along with their first, second,
+// middle and last characters, which are scrambled by a multiplication with
+// `KEYWORD_HASH_MULTIPLIER`. `count` must be at least `2`.
+static constexpr u32 keyword_hash_slot(const char8* chars, u32 count) noexcept
+{
+	const u32 key = static_cast<u32>(static_cast<u8>(chars[0]))
+	              | static_cast<u32>(static_cast<u8>(chars[1])) << 8
+	              | static_cast<u32>(static_cast<u8>(chars[count >> 1])) << 16
+	              | static_cast<u32>(static_cast<u8>(chars[count - 1])) << 24;
+
+	return ((key ^ count) * KEYWORD_HASH_MULTIPLIER) >> (32 - KEYWORD_HASH_SLOT_BITS);
+}
+
+// Fills in the slots of all `KEYWORDS`. If two of them map to the same slot,
+// `has_collision` is set.
+static constexpr KeywordHash create_keyword_hash() noexcept
+{
+	KeywordHash hash{};
+
+	for (u32 i = 0; i != array_count(KEYWORDS); ++i)
+	{
+		u8* const slot = hash.slots + keyword_hash_slot(KEYWORDS[i].begin(), KEYWORDS[i].count());
+
+		if (*slot != 0)
+			hash.has_collision = true;
+
+		*slot = static_cast<u8>(i + 1);
+	}
+
+	return hash;
+}
+
+static constexpr u32 keyword_length_bound(bool is_max) noexcept
+{
+	u32 bound = KEYWORDS[0].count();
+
+	for (const AttachmentRange<char8, u8> keyword : KEYWORDS)
+	{
+		if (is_max ? keyword.count() > bound : keyword.count() < bound)
+			bound = keyword.count();
+	}
+
+	return bound;
+}
+
+static constexpr KeywordHash KEYWORD_HASH = create_keyword_hash();
+
+static constexpr u32 KEYWORD_MIN_LENGTH = keyword_length_bound(false);
+
+static constexpr u32 KEYWORD_MAX_LENGTH = keyword_length_bound(true);
+
+static_assert(!KEYWORD_HASH.has_collision, "KEYWORD_HASH_MULTIPLIER maps two KEYWORDS to the same slot. Search for a new one.");
+
+static_assert(KEYWORD_MIN_LENGTH >= 2, "keyword_hash_slot requires keywords to have at least two characters.");
+
+static_assert(array_count(KEYWORDS) < 256, "KeywordHash::slots cannot index more than 255 keywords.");
+
 // Operator Description Tuple. Consists of:
 //  - `AstTag` with the node type
 //  - `AstFlag` with the node flags
@@ -427,6 +512,175 @@ static u8 hex_char_value(char8 c) noexcept
 		return INVALID_HEX_CHAR_VALUE;
 }
 
+// Bulk scans over the source in blocks of 16 characters, each returning the
+// first character at or after `curr` that ends the respective construct. If
+// no such character is found in the complete blocks before `end`, the first
+// character not yet examined is returned instead. Callers always finish the
+// scan character by character, so these only skip what is certain not to
+// matter, and leave everything else - including the handling of errors - to
+// the scalar code.
+// As `end` points to the `'\0'` terminating the source, blocks never extend
+// past it.
+// Whitespace and identifiers are usually too short for this to pay off, so
+// they are only scanned in bulk once they have reached
+// `BULK_SCAN_MIN_RUN_LENGTH` characters.
+static constexpr u32 BULK_SCAN_MIN_RUN_LENGTH = 8;
+
+#if PARSE_HAS_SSE2
+	static __m128i load_block(const char8* curr) noexcept
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(curr));
+	}
+
+	static __m128i block_equals(__m128i block, char8 c) noexcept
+	{
+		return _mm_cmpeq_epi8(block, _mm_set1_epi8(c));
+	}
+
+	static __m128i block_in_range(__m128i block, char8 lo, char8 hi) noexcept
+	{
+		// Comparisons are signed, which is fine as long as `lo` and `hi` are
+		// ASCII, since all non-ASCII characters then compare as less than
+		// `lo`.
+		return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8(hi + 1)));
+	}
+
+	static u16 block_mask(__m128i block) noexcept
+	{
+		return static_cast<u16>(_mm_movemask_epi8(block));
+	}
+
+	static const char8* bulk_skip_whitespace(const char8* curr, const char8* end) noexcept
+	{
+		while (end - curr >= 16)
+		{
+			const __m128i block = load_block(curr);
+
+			const __m128i whitespace = _mm_or_si128(
+				_mm_or_si128(block_equals(block, ' '), block_equals(block, '\t')),
+				_mm_or_si128(block_equals(block, '\n'), block_equals(block, '\r'))
+			);
+
+			const u16 mask = block_mask(whitespace);
+
+			if (mask != 0xFFFF)
+				return curr + count_trailing_ones_assume_zero(mask);
+
+			curr += 16;
+		}
+
+		return curr;
+	}
+
+	static const char8* bulk_skip_line_comment(const char8* curr, const char8* end) noexcept
+	{
+		while (end - curr >= 16)
+		{
+			const __m128i block = load_block(curr);
+
+			const u16 mask = block_mask(_mm_or_si128(block_equals(block, '\n'), block_equals(block, '\0')));
+
+			if (mask != 0)
+				return curr + count_trailing_zeros_assume_one(mask);
+
+			curr += 16;
+		}
+
+		return curr;
+	}
+
+	static const char8* bulk_skip_block_comment(const char8* curr, const char8* end) noexcept
+	{
+		while (end - curr >= 16)
+		{
+			const __m128i block = load_block(curr);
+
+			const u16 mask = block_mask(_mm_or_si128(
+				_mm_or_si128(block_equals(block, '/'), block_equals(block, '*')),
+				block_equals(block, '\0')
+			));
+
+			if (mask != 0)
+				return curr + count_trailing_zeros_assume_one(mask);
+
+			curr += 16;
+		}
+
+		return curr;
+	}
+
+	static const char8* bulk_skip_identifier(const char8* curr, const char8* end) noexcept
+	{
+		while (end - curr >= 16)
+		{
+			const __m128i block = load_block(curr);
+
+			// Setting bit 5 maps upper case letters to lower case ones, while
+			// moving no other character into `'a'` to `'z'`.
+			const __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+
+			const __m128i identifier = _mm_or_si128(
+				_mm_or_si128(block_in_range(lower, 'a', 'z'), block_in_range(block, '0', '9')),
+				block_equals(block, '_')
+			);
+
+			const u16 mask = block_mask(identifier);
+
+			if (mask != 0xFFFF)
+				return curr + count_trailing_ones_assume_zero(mask);
+
+			curr += 16;
+		}
+
+		return curr;
+	}
+
+	static const char8* bulk_skip_string(const char8* curr, const char8* end) noexcept
+	{
+		while (end - curr >= 16)
+		{
+			const __m128i block = load_block(curr);
+
+			const u16 mask = block_mask(_mm_or_si128(
+				_mm_or_si128(block_equals(block, '"'), block_equals(block, '\\')),
+				_mm_or_si128(block_equals(block, '\n'), block_equals(block, '\0'))
+			));
+
+			if (mask != 0)
+				return curr + count_trailing_zeros_assume_one(mask);
+
+			curr += 16;
+		}
+
+		return curr;
+	}
+#else
+	static const char8* bulk_skip_whitespace(const char8* curr, [[maybe_unused]] const char8* end) noexcept
+	{
+		return curr;
+	}
+
+	static const char8* bulk_skip_line_comment(const char8* curr, [[maybe_unused]] const char8* end) noexcept
+	{
+		return curr;
+	}
+
+	static const char8* bulk_skip_block_comment(const char8* curr, [[maybe_unused]] const char8* end) noexcept
+	{
+		return curr;
+	}
+
+	static const char8* bulk_skip_identifier(const char8* curr, [[maybe_unused]] const char8* end) noexcept
+	{
+		return curr;
+	}
+
+	static const char8* bulk_skip_string(const char8* curr, [[maybe_unused]] const char8* end) noexcept
+	{
+		return curr;
+	}
+#endif
+
 
 
 NORETURN static void parse_error_fatal(CoreData* core, SourceId source_id, CompileError error) noexcept
@@ -455,6 +709,8 @@ static void skip_block_comment(CoreData* core) noexcept
 
 	while (comment_nesting != 0)
 	{
+		curr = bulk_skip_block_comment(curr, core->parser.end);
+
 		const char8 c = *curr;
 
 		if (c == '/')
@@ -504,14 +760,23 @@ static void skip_whitespace(CoreData* core) noexcept
 
 	while (true)
 	{
+		u32 run_length = 0;
+
 		while (is_whitespace(*curr))
+		{
 			curr += 1;
 
+			run_length += 1;
+
+			if (run_length == BULK_SCAN_MIN_RUN_LENGTH)
+				curr = bulk_skip_whitespace(curr, core->parser.end);
+		}
+
 		if (*curr == '/')
 		{
 			if (curr[1] == '/')
 			{
-				curr += 2;
+				curr = bulk_skip_line_comment(curr + 2, core->parser.end);
 
 				while (*curr != '\n' && *curr != '\0')
 					curr += 1;
@@ -538,29 +803,58 @@ static void skip_whitespace(CoreData* core) noexcept
 	core->parser.curr = curr;
 }
 
+// Returns the attachment of the entry in `KEYWORDS` matching `identifier`, or
+// `0` if there is none.
+static u8 keyword_attachment_from_identifier(Range<char8> identifier) noexcept
+{
+	if (identifier.count() < KEYWORD_MIN_LENGTH || identifier.count() > KEYWORD_MAX_LENGTH)
+		return 0;
+
+	const u32 count = static_cast<u32>(identifier.count());
+
+	const u8 slot = KEYWORD_HASH.slots[keyword_hash_slot(identifier.begin(), count)];
+
+	if (slot == 0)
+		return 0;
+
+	const AttachmentRange<char8, u8> keyword = KEYWORDS[slot - 1];
+
+	if (keyword.count() != count || memcmp(keyword.begin(), identifier.begin(), count) != 0)
+		return 0;
+
+	return keyword.attachment();
+}
+
 static Lexeme scan_identifier_token(CoreData* core, bool is_builtin) noexcept
 {
 	const char8* curr = core->parser.curr;
 
 	const char8* const token_begin = curr - 1;
 
+	u32 run_length = 0;
+
 	while (is_identifier_continuation_char(*curr))
+	{
 		curr += 1;
 
+		run_length += 1;
+
+		if (run_length == BULK_SCAN_MIN_RUN_LENGTH)
+			curr = bulk_skip_identifier(curr, core->parser.end);
+	}
+
 	core->parser.curr = curr;
 
 	const Range<char8> identifier_bytes{ token_begin, curr };
 
-	u8 identifier_attachment;
-
-	const IdentifierId identifier_id = id_and_attachment_from_identifier(core, identifier_bytes, &identifier_attachment);
+	const u8 keyword_attachment = keyword_attachment_from_identifier(identifier_bytes);
 
 	if (is_builtin)
 	{
-		const Builtin builtin = static_cast<Builtin>(identifier_attachment);
+		const Builtin builtin = static_cast<Builtin>(keyword_attachment);
 
 		if (builtin == Builtin::INVALID)
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexBuiltinUnknown);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexBuiltinUnknown);
 
 		Lexeme rst;
 		rst.token = Token::Builtin;
@@ -568,13 +862,19 @@ static Lexeme scan_identifier_token(CoreData* core, bool is_builtin) noexcept
 
 		return rst;
 	}
-	else
+	else if (keyword_attachment != 0)
 	{
-		const Token token = identifier_attachment == 0 ? Token::Ident : static_cast<Token>(identifier_attachment);
+		Lexeme rst;
+		rst.token = static_cast<Token>(keyword_attachment);
+		rst.identifier_id = IdentifierId::INVALID;
 
+		return rst;
+	}
+	else
+	{
 		Lexeme rst;
-		rst.token = token;
-		rst.identifier_id = token == Token::Ident ? identifier_id : IdentifierId::INVALID;
+		rst.token = Token::Ident;
+		rst.identifier_id = id_from_identifier(core, identifier_bytes);
 
 		return rst;
 	}
@@ -626,10 +926,10 @@ static Lexeme scan_number_token_with_base(CoreData* core, char8 base) noexcept
 	}
 
 	if (curr == token_begin + 1)
-		parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexNumberWithBaseMissingDigits);
+		parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexNumberWithBaseMissingDigits);
 
 	if (is_identifier_continuation_char(*curr))
-		parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexNumberUnexpectedCharacterAfterInteger);
+		parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexNumberUnexpectedCharacterAfterInteger);
 
 	core->parser.curr = curr;
 
@@ -651,7 +951,7 @@ static u32 scan_utf8_char_surrogates(CoreData* core, u32 leader_value, u32 surro
 		const char8 surrogate = curr[i + 1];
 
 		if ((surrogate & 0xC0) != 0x80)
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterBadSurrogateCodeUnit);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterBadSurrogateCodeUnit);
 
 		codepoint |= (surrogate & 0x3F) << (6 * (surrogate_count - i - 1));
 	}
@@ -686,7 +986,7 @@ static u32 scan_utf8_char(CoreData* core) noexcept
 	}
 	else
 	{
-		parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterBadLeadCodeUnit);
+		parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterBadLeadCodeUnit);
 	}
 }
 
@@ -705,12 +1005,12 @@ static u32 scan_escape_char(CoreData* core) noexcept
 		const u8 hi = hex_char_value(curr[2]);
 
 		if (hi == INVALID_HEX_CHAR_VALUE)
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterEscapeSequenceLowerXBadChar);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterEscapeSequenceLowerXBadChar);
 
 		const u8 lo = hex_char_value(curr[3]);
 
 		if (lo == INVALID_HEX_CHAR_VALUE)
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterEscapeSequenceLowerXBadChar);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterEscapeSequenceLowerXBadChar);
 
 		curr += 2;
 
@@ -728,13 +1028,13 @@ static u32 scan_escape_char(CoreData* core) noexcept
 			const u8 char_value = hex_char_value(curr[i + 2]);
 
 			if (char_value == INVALID_HEX_CHAR_VALUE)
-				parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterEscapeSequenceUpperXInvalidChar);
+				parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterEscapeSequenceUpperXInvalidChar);
 
 			codepoint = codepoint * 16 + char_value;
 		}
 
 		if (codepoint > 0x10FFFF)
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterEscapeSequenceUpperXCodepointTooLarge);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterEscapeSequenceUpperXCodepointTooLarge);
 
 		curr += 6;
 
@@ -748,7 +1048,7 @@ static u32 scan_escape_char(CoreData* core) noexcept
 			const char8 c = curr[i + 2];
 
 			if (c < '0' || c > '9')
-				parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterEscapeSequenceUInvalidChar);
+				parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterEscapeSequenceUInvalidChar);
 
 			codepoint = codepoint * 10 + c - '0';
 		}
@@ -797,7 +1097,7 @@ static u32 scan_escape_char(CoreData* core) noexcept
 		break;
 
 	default:
-		parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterEscapeSequenceUnknown);
+		parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterEscapeSequenceUnknown);
 	}
 
 	core->parser.curr = curr + 2;
@@ -825,7 +1125,7 @@ static Lexeme scan_number_token(CoreData* core, char8 first) noexcept
 		curr += 1;
 
 		if (!is_numeric_char(*curr))
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexNumberUnexpectedCharacterAfterDecimalPoint);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexNumberUnexpectedCharacterAfterDecimalPoint);
 
 		while (is_numeric_char(*curr))
 			curr += 1;
@@ -842,7 +1142,7 @@ static Lexeme scan_number_token(CoreData* core, char8 first) noexcept
 		}
 
 		if (is_alphabetic_char(*curr) || *curr == '_')
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexNumberUnexpectedCharacterAfterFloat);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexNumberUnexpectedCharacterAfterFloat);
 
 		char8* strtod_end;
 
@@ -853,7 +1153,7 @@ static Lexeme scan_number_token(CoreData* core, char8 first) noexcept
 		ASSERT_OR_IGNORE(strtod_end == curr);
 
 		if (errno == ERANGE)
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexNumberFloatTooLarge);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexNumberFloatTooLarge);
 
 		core->parser.curr = curr;
 
@@ -866,7 +1166,7 @@ static Lexeme scan_number_token(CoreData* core, char8 first) noexcept
 	else
 	{
 		if (is_alphabetic_char(*curr) || *curr == '_')
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexNumberUnexpectedCharacterAfterFloat);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexNumberUnexpectedCharacterAfterFloat);
 
 		core->parser.curr = curr;
 
@@ -888,7 +1188,7 @@ static Lexeme scan_char_token(CoreData* core) noexcept
 		codepoint = scan_utf8_char(core);
 
 	if (*core->parser.curr != '\'')
-		parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCharacterExpectedEnd);
+		parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCharacterExpectedEnd);
 
 	core->parser.curr += 1;
 
@@ -905,9 +1205,9 @@ static Lexeme scan_string_token(CoreData* core) noexcept
 
 	u32 buffer_index = 0;
 
-	const char8* curr = core->parser.curr;
+	const char8* curr = bulk_skip_string(core->parser.curr, core->parser.end);
 
-	const char8* copy_begin = curr;
+	const char8* copy_begin = core->parser.curr;
 
 	while (*curr != '"')
 	{
@@ -916,7 +1216,7 @@ static Lexeme scan_string_token(CoreData* core) noexcept
 			const u32 bytes_to_copy = static_cast<u32>(curr - copy_begin);
 
 			if (buffer_index + bytes_to_copy > sizeof(buffer))
-				parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexStringTooLong);
+				parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexStringTooLong);
 
 			memcpy(buffer + buffer_index, copy_begin, bytes_to_copy);
 
@@ -931,7 +1231,7 @@ static Lexeme scan_string_token(CoreData* core) noexcept
 			if (codepoint <= 0x7F)
 			{
 				if (buffer_index + 1 > sizeof(buffer))
-					parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexStringTooLong);
+					parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexStringTooLong);
 
 				buffer[buffer_index] = static_cast<char8>(codepoint);
 
@@ -940,7 +1240,7 @@ static Lexeme scan_string_token(CoreData* core) noexcept
 			else if (codepoint <= 0x7FF)
 			{
 				if (buffer_index + 2 > sizeof(buffer))
-					parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexStringTooLong);
+					parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexStringTooLong);
 
 				buffer[buffer_index] = static_cast<char8>((codepoint >> 6) | 0xC0);
 
@@ -951,7 +1251,7 @@ static Lexeme scan_string_token(CoreData* core) noexcept
 			else if (codepoint == 0x10000)
 			{
 				if (buffer_index + 3 > sizeof(buffer))
-					parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexStringTooLong);
+					parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexStringTooLong);
 
 				buffer[buffer_index] = static_cast<char8>((codepoint >> 12) | 0xE0);
 
@@ -966,7 +1266,7 @@ static Lexeme scan_string_token(CoreData* core) noexcept
 				ASSERT_OR_IGNORE(codepoint <= 0x10FFFF);
 
 				if (buffer_index + 4 > sizeof(buffer))
-					parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexStringTooLong);
+					parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexStringTooLong);
 
 				buffer[buffer_index] = static_cast<char8>((codepoint >> 18) | 0xE0);
 
@@ -979,26 +1279,26 @@ static Lexeme scan_string_token(CoreData* core) noexcept
 				buffer_index += 4;
 			}
 
-			copy_begin = buffer + buffer_index;
+			copy_begin = curr;
 		}
 		else if (*curr == '\n')
 		{
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexStringCrossesNewline);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexStringCrossesNewline);
 		}
 		else if (*curr == '\0')
 		{
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexStringMissingEnd);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexStringMissingEnd);
 		}
 		else
 		{
-			curr += 1;
+			curr = bulk_skip_string(curr + 1, core->parser.end);
 		}
 	}
 
 	const u32 bytes_to_copy = static_cast<u32>(curr - copy_begin);
 
 	if (buffer_index + bytes_to_copy > sizeof(buffer))
-		parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexStringTooLong);
+		parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexStringTooLong);
 
 	memcpy(buffer + buffer_index, copy_begin, bytes_to_copy);
 
@@ -1009,7 +1309,7 @@ static Lexeme scan_string_token(CoreData* core) noexcept
 	const Maybe<void*> allocation = comp_heap_alloc(core, buffer_index, 1);
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for string literal.\n", buffer_index);
 
 	memcpy(get(allocation), buffer, buffer_index);
 
@@ -1064,7 +1364,7 @@ static Lexeme next_without_source(CoreData* core) noexcept
 		if (is_identifier_continuation_char(second))
 		{
 			if (!core->parser.is_std)
-				parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexIdentifierInitialUnderscore);
+				parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexIdentifierInitialUnderscore);
 
 			return scan_identifier_token(core, true);
 		}
@@ -1158,7 +1458,7 @@ static Lexeme next_without_source(CoreData* core) noexcept
 		}
 		else if (second == '/')
 		{
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexCommentMismatchedEnd);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexCommentMismatchedEnd);
 		}
 		else
 		{
@@ -1436,30 +1736,23 @@ static Lexeme next_without_source(CoreData* core) noexcept
 		core->parser.curr -= 1;
 
 		if (core->parser.curr != core->parser.end)
-			parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexNullCharacter);
+			parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexNullCharacter);
 
 		return { Token::END_OF_SOURCE };
 
 	default:
-		parse_error_fatal(core, core->parser.peek.source_id, CompileError::LexUnexpectedCharacter);
+		parse_error_fatal(core, core->parser.lexeme_source_id, CompileError::LexUnexpectedCharacter);
 	}
 }
 
-static Lexeme next(CoreData* core) noexcept
+static Lexeme scan_lexeme(CoreData* core) noexcept
 {
-	if (core->parser.peek.token != Token::EMPTY)
-	{
-		const Lexeme rst = core->parser.peek;
-
-		core->parser.peek.token = Token::EMPTY;
-
-		return rst;
-	}
-
 	skip_whitespace(core);
 
 	const SourceId source_id = static_cast<SourceId>(core->parser.source_id_base + static_cast<u32>(core->parser.curr - core->parser.begin));
 
+	core->parser.lexeme_source_id = source_id;
+
 	Lexeme rst = next_without_source(core);
 
 	rst.source_id = source_id;
@@ -1467,34 +1760,59 @@ static Lexeme next(CoreData* core) noexcept
 	return rst;
 }
 
-static Lexeme peek(CoreData* core) noexcept
+// `Parser::lookahead` is indexed by masking, which requires its size to be a
+// power of two.
+static_assert(is_pow2(sizeof(Parser::lookahead) / sizeof(Lexeme)));
+
+static void scan_ahead(CoreData* core) noexcept
 {
-	if (core->parser.peek.token == Token::EMPTY)
-		core->parser.peek = next(core);
+	Parser* const parser = &core->parser;
+
+	ASSERT_OR_IGNORE(parser->lookahead_count != array_count(parser->lookahead));
+
+	const u8 index = (parser->lookahead_begin + parser->lookahead_count) & (array_count(parser->lookahead) - 1);
 
-	return core->parser.peek;
+	parser->lookahead[index] = scan_lexeme(core);
+
+	parser->lookahead_count += 1;
 }
 
-static Lexeme peek_n(CoreData* core, u32 n) noexcept
+static Lexeme next(CoreData* core) noexcept
 {
-	ASSERT_OR_IGNORE(n != 0);
+	Parser* const parser = &core->parser;
 
-	const Lexeme remembered_peek = peek(core);
+	if (parser->lookahead_count == 0)
+		return scan_lexeme(core);
 
-	const char8* const remembered_curr = core->parser.curr;
+	const Lexeme rst = parser->lookahead[parser->lookahead_begin];
 
-	core->parser.peek.token = Token::EMPTY;
+	parser->lookahead_begin = (parser->lookahead_begin + 1) & (array_count(parser->lookahead) - 1);
 
-	Lexeme result = remembered_peek;
+	parser->lookahead_count -= 1;
 
-	for (u32 i = 0; i != n; ++i)
-		result = next(core);
+	return rst;
+}
 
-	core->parser.curr = remembered_curr;
+static Lexeme peek(CoreData* core) noexcept
+{
+	Parser* const parser = &core->parser;
+
+	if (parser->lookahead_count == 0)
+		scan_ahead(core);
+
+	return parser->lookahead[parser->lookahead_begin];
+}
+
+static Lexeme peek_n(CoreData* core, u32 n) noexcept
+{
+	Parser* const parser = &core->parser;
 
-	core->parser.peek = remembered_peek;
+	ASSERT_OR_IGNORE(n < array_count(parser->lookahead));
 
-	return result;
+	while (parser->lookahead_count <= n)
+		scan_ahead(core);
+
+	return parser->lookahead[(parser->lookahead_begin + n) & (array_count(parser->lookahead) - 1)];
 }
 
 static void skip(CoreData* core) noexcept
@@ -2895,9 +3213,6 @@ void parser_init(CoreData* core, [[maybe_unused]] MemoryAllocation allocation) n
 
 	parser->u8_type_id = type_create_numeric(core, TypeTag::Integer, NumericType{ 8, false });
 	parser->suppress_errors = false;
-
-	for (const AttachmentRange keyword : KEYWORDS)
-		identifier_set_attachment(core, keyword.range(), keyword.attachment());
 }
 
 
@@ -2910,7 +3225,8 @@ Maybe<AstNode*> parse(CoreData* core, Range<char8> content, SourceId source_id_b
 	core->parser.end = content.end() - 1;
 	core->parser.curr = content.begin();
 	core->parser.source_id_base = static_cast<u32>(source_id_base);
-	core->parser.peek.token = Token::EMPTY;
+	core->parser.lookahead_begin = 0;
+	core->parser.lookahead_count = 0;
 	core->parser.is_std = is_std;
 	core->parser.has_errors = false;
 
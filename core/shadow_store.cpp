@@ -80,6 +80,63 @@ struct ShadowStoreEntry
 
 
 
+// The shadow store keeps an address-ordered index of the addresses it holds
+// entries for, so that range operations (`shadow_copy` and `shadow_clear`)
+// only need to probe `address_map` for addresses that actually might have
+// an entry.
+// The index maps each `SHADOW_PAGE_BYTES`-sized page containing at least one
+// entry to a 64-bit mask with one bit per `SHADOW_CHUNK_BYTES`-sized chunk of
+// that page. A bit is set exactly when its chunk contains at least one entry.
+// Alongside the mask, each page keeps the number of entries in each of its
+// chunks, so that removing an entry only has to decrement that count instead
+// of probing `address_map` for the other addresses in its chunk.
+static constexpr u8 SHADOW_PAGE_BYTES_LOG2 = 12;
+
+static constexpr u8 SHADOW_CHUNK_BYTES_LOG2 = SHADOW_PAGE_BYTES_LOG2 - 6;
+
+static constexpr u64 SHADOW_CHUNK_BYTES = static_cast<u64>(1) << SHADOW_CHUNK_BYTES_LOG2;
+
+struct ShadowPageKey
+{
+	u64 page;
+};
+
+struct ShadowPageEntry
+{
+	union
+	{
+		struct
+		{
+			u64 key_page;
+
+			u64 chunk_mask;
+
+			u8 chunk_counts[64];
+		} data;
+
+		struct
+		{
+			u64 zero_padding_;
+
+			Maybe<ShadowPageEntry*> next;
+		} freelist;
+	};
+
+	bool is_equal_to_key(ShadowPageKey key, [[maybe_unused]] u32 key_hash) const noexcept
+	{
+		return data.key_page == key.page;
+	}
+
+	u32 hash() const noexcept
+	{
+		return fnv1a(range::from_object_bytes(&data.key_page));
+	}
+};
+
+static_assert(sizeof(ShadowPageEntry) == 80);
+
+
+
 struct ShadowLayoutKey
 {
 	ShadowLayout* layout;
@@ -179,6 +236,190 @@ ShadowLayoutEntry* ShadowLayoutIterator::next() noexcept
 
 
 
+ShadowPageEntry* ShadowPageAlloc::value_from_id(u32 id) noexcept
+{
+	ASSERT_OR_IGNORE(id < core->shadow.page_entries.used());
+
+	ShadowPageEntry* const value = core->shadow.page_entries.begin() + id;
+
+	ASSERT_OR_IGNORE(value->data.key_page != 0);
+
+	return value;
+}
+
+const ShadowPageEntry* ShadowPageAlloc::value_from_id(u32 id) const noexcept
+{
+	ASSERT_OR_IGNORE(id < core->shadow.page_entries.used());
+
+	ShadowPageEntry* const value = core->shadow.page_entries.begin() + id;
+
+	ASSERT_OR_IGNORE(value->data.key_page != 0);
+
+	return value;
+}
+
+u32 ShadowPageAlloc::id_from_value(const ShadowPageEntry* value) const noexcept
+{
+	ASSERT_OR_IGNORE(value >= core->shadow.page_entries.begin() && value < core->shadow.page_entries.end());
+
+	ASSERT_OR_IGNORE(value->data.key_page != 0);
+
+	return static_cast<u32>(value - core->shadow.page_entries.begin());
+}
+
+ShadowPageIterator ShadowPageAlloc::values() noexcept
+{
+	ShadowPageEntry* const entries = core->shadow.page_entries.begin();
+
+	const u32 end = core->shadow.page_entries.used();
+
+	u32 curr = 0;
+
+	while (curr != end && entries[curr].data.key_page == 0)
+		curr += 1;
+
+	ShadowPageIterator it;
+	it.core = core;
+	it.curr = curr;
+	it.end = end;
+
+	return it;
+}
+
+ShadowPageEntry* ShadowPageAlloc::alloc(ShadowPageKey key, [[maybe_unused]] u32 key_hash) noexcept
+{
+	ASSERT_OR_IGNORE(key.page != 0);
+
+	ShadowPageEntry* entry;
+
+	if (is_some(core->shadow.page_entries_freelist_head))
+	{
+		entry = get(core->shadow.page_entries_freelist_head);
+
+		core->shadow.page_entries_freelist_head = entry->freelist.next;
+	}
+	else
+	{
+		entry = core->shadow.page_entries.reserve();
+	}
+
+	entry->data.key_page = key.page;
+	entry->data.chunk_mask = 0;
+
+	memset(entry->data.chunk_counts, 0, sizeof(entry->data.chunk_counts));
+
+	return entry;
+}
+
+void ShadowPageAlloc::dealloc(u32 id) noexcept
+{
+	ASSERT_OR_IGNORE(id < core->shadow.page_entries.used());
+
+	ShadowPageEntry* const entry = core->shadow.page_entries.begin() + id;
+
+	entry->freelist.zero_padding_ = 0;
+	entry->freelist.next = core->shadow.page_entries_freelist_head;
+
+	core->shadow.page_entries_freelist_head = some(entry);
+}
+
+
+
+bool ShadowPageIterator::has_next() const noexcept
+{
+	ASSERT_OR_IGNORE(curr <= end);
+
+	return curr != end;
+}
+
+ShadowPageEntry* ShadowPageIterator::next() noexcept
+{
+	ASSERT_OR_IGNORE(curr < end);
+
+	ShadowPageEntry* const entries = core->shadow.page_entries.begin();
+
+	ShadowPageEntry* const result = entries + curr;
+
+	u32 next = curr + 1;
+
+	while (next != end && entries[next].data.key_page == 0)
+		next += 1;
+
+	curr = next;
+
+	return result;
+}
+
+
+
+static u32 hash_shadow_address(const void* address) noexcept
+{
+	return fnv1a(range::from_object_bytes(&address));
+}
+
+static u32 hash_shadow_page(u64 page) noexcept
+{
+	return fnv1a(range::from_object_bytes(&page));
+}
+
+static u8 shadow_chunk_index(u64 address) noexcept
+{
+	return static_cast<u8>((address >> SHADOW_CHUNK_BYTES_LOG2) & 63);
+}
+
+static u64 shadow_chunk_bit(u64 address) noexcept
+{
+	return static_cast<u64>(1) << shadow_chunk_index(address);
+}
+
+static void shadow_index_insert(CoreData* core, const void* address) noexcept
+{
+	const u64 address_bits = reinterpret_cast<u64>(address);
+
+	const ShadowPageKey key{ address_bits >> SHADOW_PAGE_BYTES_LOG2 };
+
+	ShadowPageEntry* const page = core->shadow.page_map.value_from(key, hash_shadow_page(key.page));
+
+	u8* const chunk_count = page->data.chunk_counts + shadow_chunk_index(address_bits);
+
+	ASSERT_OR_IGNORE(*chunk_count < SHADOW_CHUNK_BYTES);
+
+	*chunk_count += 1;
+
+	page->data.chunk_mask |= shadow_chunk_bit(address_bits);
+}
+
+static void shadow_index_remove(CoreData* core, const void* address) noexcept
+{
+	const u64 address_bits = reinterpret_cast<u64>(address);
+
+	const ShadowPageKey key{ address_bits >> SHADOW_PAGE_BYTES_LOG2 };
+
+	const u32 page_hash = hash_shadow_page(key.page);
+
+	const Maybe<ShadowPageEntry*> opt_page = core->shadow.page_map.try_value_from(key, page_hash);
+
+	ASSERT_OR_IGNORE(is_some(opt_page));
+
+	ShadowPageEntry* const page = get(opt_page);
+
+	u8* const chunk_count = page->data.chunk_counts + shadow_chunk_index(address_bits);
+
+	ASSERT_OR_IGNORE(*chunk_count != 0);
+
+	*chunk_count -= 1;
+
+	if (*chunk_count != 0)
+		return;
+
+	page->data.chunk_mask &= ~shadow_chunk_bit(address_bits);
+
+	if (page->data.chunk_mask == 0)
+		core->shadow.page_map.remove(page);
+}
+
+
+
 ShadowStoreEntry* ShadowStoreAlloc::value_from_id(u32 id) noexcept
 {
 	ASSERT_OR_IGNORE(id < core->shadow.address_entries.used());
@@ -247,12 +488,16 @@ ShadowStoreEntry* ShadowStoreAlloc::alloc(ShadowStoreKey key, [[maybe_unused]] u
 	const Maybe<void*> allocation = comp_heap_alloc(core, key.attach_size, key.attach_align);
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for shadow data.\n", key.attach_size);
 
 	entry->data.key_address = key.address;
 	entry->data.attach_layout_id = key.layout_id;
 	entry->data.attach_id = core_id_from_address(core, get(allocation));
 
+	shadow_index_insert(core, key.address);
+
+	core->shadow.address_count += 1;
+
 	return entry;
 }
 
@@ -262,6 +507,12 @@ void ShadowStoreAlloc::dealloc(u32 id) noexcept
 
 	ShadowStoreEntry* const entry = core->shadow.address_entries.begin() + id;
 
+	ASSERT_OR_IGNORE(core->shadow.address_count != 0);
+
+	core->shadow.address_count -= 1;
+
+	shadow_index_remove(core, entry->data.key_address);
+
 	entry->freelist.null_padding_ = nullptr;
 	entry->freelist.next = core->shadow.address_entries_freelist_head;
 
@@ -345,6 +596,112 @@ static u32 shadow_layout_offset(ShadowLayout* layout, u16 rank) noexcept
 
 
 
+// Cursor over the entries in `address_map` whose addresses lie in an
+// inclusive range of addresses. This uses `page_map` to skip over pages and
+// chunks not containing any entries, so that only addresses that might
+// actually have an entry are probed.
+// Entries are returned in ascending order of their addresses.
+struct ShadowRangeCursor
+{
+	u64 first;
+
+	u64 last;
+
+	u64 curr;
+
+	u64 chunk_end;
+
+	u64 page;
+
+	u64 pending_chunks;
+};
+
+static u64 shadow_range_page_chunks(CoreData* core, u64 page, u64 first, u64 last) noexcept
+{
+	const ShadowPageKey key{ page };
+
+	const Maybe<ShadowPageEntry*> opt_page = core->shadow.page_map.try_value_from(key, hash_shadow_page(page));
+
+	if (is_none(opt_page))
+		return 0;
+
+	u64 chunks = get(opt_page)->data.chunk_mask;
+
+	if (page == first >> SHADOW_PAGE_BYTES_LOG2)
+		chunks &= ~(shadow_chunk_bit(first) - 1);
+
+	if (page == last >> SHADOW_PAGE_BYTES_LOG2)
+		chunks &= shadow_chunk_bit(last) | (shadow_chunk_bit(last) - 1);
+
+	return chunks;
+}
+
+static ShadowRangeCursor shadow_range_cursor(CoreData* core, const byte* first, const byte* last) noexcept
+{
+	ASSERT_OR_IGNORE(first <= last);
+
+	ShadowRangeCursor cursor;
+	cursor.first = reinterpret_cast<u64>(first);
+	cursor.last = reinterpret_cast<u64>(last);
+	cursor.curr = cursor.first;
+	cursor.chunk_end = cursor.first;
+	cursor.page = cursor.first >> SHADOW_PAGE_BYTES_LOG2;
+	cursor.pending_chunks = core->shadow.address_count == 0
+		? 0
+		: shadow_range_page_chunks(core, cursor.page, cursor.first, cursor.last);
+
+	return cursor;
+}
+
+static Maybe<ShadowStoreEntry*> shadow_range_next(CoreData* core, ShadowRangeCursor* cursor) noexcept
+{
+	// Nothing to find if the store is empty. This is by far the most common
+	// case, so avoid walking the index at all.
+	if (core->shadow.address_count == 0)
+		return none<ShadowStoreEntry*>();
+
+	ShadowStoreKey key{};
+
+	while (true)
+	{
+		while (cursor->curr != cursor->chunk_end)
+		{
+			key.address = reinterpret_cast<void*>(cursor->curr);
+
+			cursor->curr += 1;
+
+			const Maybe<ShadowStoreEntry*> entry = core->shadow.address_map.try_value_from(key, hash_shadow_address(key.address));
+
+			if (is_some(entry))
+				return entry;
+		}
+
+		while (cursor->pending_chunks == 0)
+		{
+			if (cursor->page == cursor->last >> SHADOW_PAGE_BYTES_LOG2)
+				return none<ShadowStoreEntry*>();
+
+			cursor->page += 1;
+
+			cursor->pending_chunks = shadow_range_page_chunks(core, cursor->page, cursor->first, cursor->last);
+		}
+
+		const u8 chunk_index = count_trailing_zeros_assume_one(cursor->pending_chunks);
+
+		cursor->pending_chunks &= cursor->pending_chunks - 1;
+
+		const u64 chunk_begin = (cursor->page << SHADOW_PAGE_BYTES_LOG2) + (static_cast<u64>(chunk_index) << SHADOW_CHUNK_BYTES_LOG2);
+
+		const u64 chunk_end = chunk_begin + SHADOW_CHUNK_BYTES;
+
+		cursor->curr = chunk_begin < cursor->first ? cursor->first : chunk_begin;
+
+		cursor->chunk_end = chunk_end > cursor->last ? cursor->last + 1 : chunk_end;
+	}
+}
+
+
+
 static u64 calc_address_lookups_size(const Config* config, u64 page_size) noexcept
 {
 	u64 lookups_count = next_pow2(config->shadow_store.addresses.reserve * 3 / 2);
@@ -368,6 +725,29 @@ static u64 calc_address_entries_size(const Config* config, u64 page_size) noexce
 	return (config->shadow_store.addresses.reserve * sizeof(ShadowStoreEntry) + page_mask) & ~page_mask;
 }
 
+static u64 calc_page_lookups_size(const Config* config, u64 page_size) noexcept
+{
+	u64 lookups_count = next_pow2(config->shadow_store.addresses.reserve * 3 / 2);
+
+	if (lookups_count < 1024)
+		lookups_count = 1024;
+
+	ASSERT_OR_IGNORE(lookups_count <= UINT32_MAX);
+
+	const u64 size = decltype(ShadowStore::page_map)::lookups_memory_size(static_cast<u32>(lookups_count));
+
+	return size < page_size
+		? page_size
+		: size;
+}
+
+static u64 calc_page_entries_size(const Config* config, u64 page_size) noexcept
+{
+	const u64 page_mask = page_size - 1;
+
+	return (config->shadow_store.addresses.reserve * sizeof(ShadowPageEntry) + page_mask) & ~page_mask;
+}
+
 static u64 calc_layout_lookups_size(const Config* config, u64 page_size) noexcept
 {
 	u64 lookups_count = next_pow2(config->shadow_store.layouts.reserve * 3 / 2);
@@ -377,7 +757,7 @@ static u64 calc_layout_lookups_size(const Config* config, u64 page_size) noexcep
 
 	ASSERT_OR_IGNORE(lookups_count <= UINT32_MAX);
 
-	const u64 size = decltype(ShadowStore::address_map)::lookups_memory_size(static_cast<u32>(lookups_count));
+	const u64 size = decltype(ShadowStore::layout_map)::lookups_memory_size(static_cast<u32>(lookups_count));
 
 	return size < page_size
 		? page_size
@@ -420,6 +800,8 @@ MemoryRequirements shadow_store_memory_requirements(const Config* config) noexce
 	reqs.count = 1;
 	reqs.ranges[0].size = calc_address_lookups_size(config, page_size)
 	                    + calc_address_entries_size(config, page_size)
+	                    + calc_page_lookups_size(config, page_size)
+	                    + calc_page_entries_size(config, page_size)
 	                    + calc_layout_lookups_size(config, page_size)
 	                    + calc_layout_entries_size(config, page_size);
 
@@ -438,11 +820,15 @@ void shadow_store_init(CoreData* core, MemoryAllocation allocation) noexcept
 
 	const u64 address_entries_size = calc_address_entries_size(core->config, page_size);
 
+	const u64 page_lookups_size = calc_page_lookups_size(core->config, page_size);
+
+	const u64 page_entries_size = calc_page_entries_size(core->config, page_size);
+
 	const u64 layout_lookups_size = calc_layout_lookups_size(core->config, page_size);
 
 	const u64 layout_entries_size = calc_layout_entries_size(core->config, page_size);
 
-	ASSERT_OR_IGNORE(allocation.ranges[0].count() == address_lookups_size + address_entries_size + layout_lookups_size + layout_entries_size);
+	ASSERT_OR_IGNORE(allocation.ranges[0].count() == address_lookups_size + address_entries_size + page_lookups_size + page_entries_size + layout_lookups_size + layout_entries_size);
 
 	const u32 address_entries_commit_increment = static_cast<u32>((core->config->shadow_store.addresses.commit_increment + page_mask) & ~page_mask);
 
@@ -455,6 +841,12 @@ void shadow_store_init(CoreData* core, MemoryAllocation allocation) noexcept
 	core->shadow.address_entries.init(allocation.ranges[0].mut_subrange(offset, address_entries_size), address_entries_commit_increment);
 	offset += address_entries_size;
 
+	core->shadow.page_map.init(allocation.ranges[0].mut_subrange(offset, page_lookups_size), 512, ShadowPageAlloc{ core });
+	offset += page_lookups_size;
+
+	core->shadow.page_entries.init(allocation.ranges[0].mut_subrange(offset, page_entries_size), address_entries_commit_increment);
+	offset += page_entries_size;
+
 	core->shadow.layout_map.init(allocation.ranges[0].mut_subrange(offset, layout_lookups_size), 512, ShadowLayoutAlloc{ core });
 	offset += layout_lookups_size;
 
@@ -464,6 +856,10 @@ void shadow_store_init(CoreData* core, MemoryAllocation allocation) noexcept
 	ASSERT_OR_IGNORE(allocation.ranges[0].count() == offset);
 
 	core->shadow.address_entries_freelist_head = none<ShadowStoreEntry*>();
+
+	core->shadow.page_entries_freelist_head = none<ShadowPageEntry*>();
+
+	core->shadow.address_count = 0;
 }
 
 
@@ -475,7 +871,7 @@ ShadowLayoutId shadow_create_layout(CoreData* core, Range<ShadowLayoutMemberInit
 	const Maybe<void*> allocation = comp_heap_alloc(core, size, alignof(ShadowLayout));
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for shadow layout.\n", size);
 
 	ShadowLayout* const layout = static_cast<ShadowLayout*>(get(allocation));
 
@@ -525,7 +921,7 @@ byte* shadow_get(CoreData* core, byte* address, ShadowLayoutId layout_id, u16 ra
 	key.attach_align = layout->header.align;
 	key.layout_id = layout_id;
 
-	ShadowStoreEntry* const entry = core->shadow.address_map.value_from(key, fnv1a(range::from_object_bytes(&address)));
+	ShadowStoreEntry* const entry = core->shadow.address_map.value_from(key, hash_shadow_address(address));
 
 	byte* shadow_base;
 
@@ -534,7 +930,7 @@ byte* shadow_get(CoreData* core, byte* address, ShadowLayoutId layout_id, u16 ra
 		const Maybe<void*> allocation = comp_heap_alloc(core, layout->header.size, layout->header.align);
 
 		if (is_none(allocation))
-			TODO("Implement GC traversal.");
+			panic("Failed to allocate % bytes of compile-time heap memory for shadow data.\n", layout->header.size);
 
 		entry->data.attach_layout_id = layout_id;
 		entry->data.attach_id = core_id_from_address(core, get(allocation));
@@ -553,10 +949,13 @@ byte* shadow_get(CoreData* core, byte* address, ShadowLayoutId layout_id, u16 ra
 
 Maybe<byte*> shadow_try_get(CoreData* core, byte* address, ShadowLayoutId layout_id, u16 rank) noexcept
 {
+	if (core->shadow.address_count == 0)
+		return none<byte*>();
+
 	ShadowStoreKey key{};
 	key.address = address;
 
-	const Maybe<ShadowStoreEntry*> maybe_entry = core->shadow.address_map.try_value_from(key, fnv1a(range::from_object_bytes(&address)));
+	const Maybe<ShadowStoreEntry*> maybe_entry = core->shadow.address_map.try_value_from(key, hash_shadow_address(address));
 
 	if (is_none(maybe_entry) || get(maybe_entry)->data.attach_layout_id != layout_id)
 		return none<byte*>();
@@ -576,28 +975,28 @@ void shadow_copy(CoreData* core, MutRange<byte> dst, MutRange<byte> src) noexcep
 {
 	ASSERT_OR_IGNORE(dst.count() == src.count());
 
-	ShadowStoreKey existing_key{};
+	ShadowRangeCursor cursor = shadow_range_cursor(core, src.begin(), src.end());
 
-	for (u64 i = 0; i != src.count() + 1; ++i)
+	while (true)
 	{
-		existing_key.address = src.begin() + i;
-
-		const Maybe<ShadowStoreEntry*> opt_existing_entry = core->shadow.address_map.try_value_from(existing_key, fnv1a(range::from_object_bytes(&existing_key.address)));
+		const Maybe<ShadowStoreEntry*> opt_existing_entry = shadow_range_next(core, &cursor);
 
 		if (is_none(opt_existing_entry))
-			continue;
+			break;
 
 		ShadowStoreEntry* const existing_entry = get(opt_existing_entry);
 
 		ShadowLayout* const layout = static_cast<ShadowLayout*>(address_from_core_id(core, static_cast<CoreId>(existing_entry->data.attach_layout_id)));
 
+		const u64 offset = static_cast<byte*>(existing_entry->data.key_address) - src.begin();
+
 		ShadowStoreKey new_key{};
-		new_key.address = dst.begin() + i;
+		new_key.address = dst.begin() + offset;
 		new_key.attach_align = layout->header.align;
 		new_key.layout_id = existing_entry->data.attach_layout_id;
 		new_key.attach_size = layout->header.size;
 
-		ShadowStoreEntry* const new_entry = core->shadow.address_map.value_from(new_key, fnv1a(range::from_object_bytes(&new_key.address)));
+		ShadowStoreEntry* const new_entry = core->shadow.address_map.value_from(new_key, hash_shadow_address(new_key.address));
 
 		void* dst_value;
 
@@ -606,7 +1005,7 @@ void shadow_copy(CoreData* core, MutRange<byte> dst, MutRange<byte> src) noexcep
 			const Maybe<void*> allocation = comp_heap_alloc(core, layout->header.size, layout->header.align);
 
 			if (is_none(allocation))
-				TODO("Implement GC traversal.");
+				panic("Failed to allocate % bytes of compile-time heap memory for shadow data.\n", layout->header.size);
 
 			new_entry->data.attach_layout_id = existing_entry->data.attach_layout_id;
 			new_entry->data.attach_id = core_id_from_address(core, get(allocation));
@@ -624,10 +1023,29 @@ void shadow_copy(CoreData* core, MutRange<byte> dst, MutRange<byte> src) noexcep
 	}
 }
 
-void shadow_clear(CoreData* core, byte* address) noexcept
+void shadow_clear(CoreData* core, MutRange<byte> memory) noexcept
 {
-	ShadowStoreKey key{};
-	key.address = address;
+	ShadowRangeCursor cursor = shadow_range_cursor(core, memory.begin(), memory.end());
+
+	while (true)
+	{
+		const Maybe<ShadowStoreEntry*> entry = shadow_range_next(core, &cursor);
+
+		if (is_none(entry))
+			break;
+
+		core->shadow.address_map.remove(get(entry));
+	}
+}
+
+bool shadow_contains(CoreData* core, MutRange<byte> memory) noexcept
+{
+	ShadowRangeCursor cursor = shadow_range_cursor(core, memory.begin(), memory.end());
 
-	(void) core->shadow.address_map.try_remove(key, fnv1a(range::from_object_bytes(&address)));
+	return is_some(shadow_range_next(core, &cursor));
+}
+
+Range<byte> shadow_address_entry_memory(CoreData* core) noexcept
+{
+	return Range<byte>{ reinterpret_cast<const byte*>(core->shadow.address_entries.begin()), core->shadow.address_entries.reserved() * sizeof(ShadowStoreEntry) };
 }
@@ -30,6 +30,10 @@ struct alignas(8) SourceFileByPathEntry
 
 	u32 id_entry_index;
 
+	// Index of the `SourceFilePrefetch` submitted for this path in
+	// `SourceReader.prefetches`, or `0` if there is none.
+	u32 prefetch_index;
+
 	#if COMPILER_GCC
 		#pragma GCC diagnostic push
 		#pragma GCC diagnostic ignored "-Wpedantic" // ISO C++ forbids flexible array member
@@ -61,6 +65,27 @@ struct alignas(8) SourceFileByIdEntry
 
 	u32 path_entry_index;
 
+	// Contents of the file. These are kept resident after the initial read so
+	// that `SourceId`s can be mapped to `SourceLocation`s without re-reading
+	// the file. Depending on `Config.sources.map_files`, this is either a
+	// read-only mapping of the file or a heap-allocated copy of it, as
+	// indicated by `is_mapped`. They are released by `source_reader_release`.
+	const char8* content;
+
+	u32 content_bytes;
+
+	bool is_mapped;
+
+	// Index of the first entry belonging to this file in
+	// `SourceReader.line_begins`.
+	u32 line_begins_index;
+
+	// Number of entries belonging to this file in `SourceReader.line_begins`.
+	// Since every file has at least one line, this is `0` if and only if the
+	// line index has not been built yet. This happens lazily when the first
+	// `SourceLocation` in the file is requested.
+	u32 line_count;
+
 	SourceFile data;
 
 	u32 hash() const noexcept
@@ -74,6 +99,44 @@ struct alignas(8) SourceFileByIdEntry
 	}
 };
 
+enum class PrefetchState : u32
+{
+	Pending,
+	Done,
+	Failed,
+};
+
+// Read of a source file that is performed on one of the reader's prefetch
+// threads. These are submitted by `prefetch_imports` for every path that looks
+// like it is imported by a newly read file, and consumed by `read_source_file`
+// once the file is actually imported.
+struct SourceFilePrefetch
+{
+	// `PrefetchState` of the read. This is written by the prefetch thread
+	// that claimed the read, and waited on by `read_source_file`.
+	std::atomic<PrefetchState> state;
+
+	// Whether the read has been consumed by `read_source_file`. This is only
+	// accessed by the thread owning the `CoreData`.
+	bool is_consumed;
+
+	bool is_mapped;
+
+	// Path of the file. This points into the associated
+	// `SourceFileByPathEntry`, and is thus stable.
+	const char8* path;
+
+	u32 path_bytes;
+
+	// The following are only valid once `state` is `PrefetchState::Done`.
+
+	minos::FileHandle file;
+
+	minos::FileInfo fileinfo;
+
+	const char8* content;
+};
+
 static constexpr u64 KNOWN_FILES_BY_PATH_LOOKUP_RESERVE = decltype(SourceReader::known_files_by_path)::lookups_memory_size(1 << 20);
 
 static constexpr u32 KNOWN_FILES_BY_PATH_LOOKUP_INITIAL_COMMIT_COUNT = static_cast<u32>(1) << 10;
@@ -90,6 +153,14 @@ static constexpr u32 KNOWN_FILES_BY_IDENTITY_VALUES_RESERVE = (static_cast<u32>(
 
 static constexpr u32 KNOWN_FILES_BY_IDENTITY_VALUES_COMMIT_INCREMENT_COUNT = static_cast<u32>(1) << 11;
 
+static constexpr u32 LINE_BEGINS_RESERVE = (static_cast<u32>(1) << 24) * sizeof(u32);
+
+static constexpr u32 LINE_BEGINS_COMMIT_INCREMENT_COUNT = static_cast<u32>(1) << 12;
+
+static constexpr u32 PREFETCHES_RESERVE = (static_cast<u32>(1) << 16) * sizeof(SourceFilePrefetch);
+
+static constexpr u32 PREFETCHES_COMMIT_INCREMENT_COUNT = static_cast<u32>(1) << 8;
+
 
 bool SourceFileByPathIterator::has_next() const noexcept
 {
@@ -164,6 +235,7 @@ SourceFileByPathEntry* SourceFileByPathAlloc::alloc(Range<char8> key, u32 key_ha
 	result->m_hash = key_hash;
 	result->path_bytes = static_cast<u32>(key.count());
 	result->id_entry_index = 0;
+	result->prefetch_index = 0;
 	memcpy(result->path, key.begin(), key.count());
 
 	return result;
@@ -238,6 +310,7 @@ SourceFileByIdEntry* SourceFileByIdAlloc::alloc(minos::FileIdentity key, [[maybe
 	SourceFileByIdEntry* const result = core->reader.id_entries.reserve();
 	result->device_id = key.volume_serial;
 	result->file_id = key.index;
+	result->content = nullptr;
 
 	return result;
 }
@@ -314,24 +387,47 @@ static Range<char8> source_file_path(CoreData* core, SourceFile* source_file) no
 	return Range{ path_entry->path, path_entry->path_bytes };
 }
 
-static SourceLocation build_source_location(Range<char8> filepath, Range<char8> content, u32 offset) noexcept
+// Builds the line index of `id_entry`, storing the offset of the first byte of
+// each line in its file into `SourceReader.line_begins`.
+static void build_line_index(CoreData* core, SourceFileByIdEntry* id_entry) noexcept
 {
-	ASSERT_OR_IGNORE(offset <= content.count());
+	ASSERT_OR_IGNORE(id_entry->line_count == 0);
+
+	id_entry->line_begins_index = core->reader.line_begins.used();
+
+	u32* const first_line_begin = core->reader.line_begins.reserve();
+
+	*first_line_begin = 0;
 
-	u32 line_begin = 0;
+	const char8* const begin = id_entry->content;
 
-	u32 line_number = 1;
+	const char8* const end = begin + id_entry->content_bytes;
 
-	for (u32 i = 0; i != offset; ++i)
+	const char8* curr = begin;
+
+	// `memchr` is vectorized on all relevant platforms, so this is a lot
+	// faster than checking byte by byte.
+	while (true)
 	{
-		if (content[i] == '\n')
-		{
-			line_begin = i + 1;
+		const char8* const newline = static_cast<const char8*>(memchr(curr, '\n', end - curr));
 
-			line_number += 1;
-		}
+		if (newline == nullptr)
+			break;
+
+		curr = newline + 1;
+
+		u32* const line_begin = core->reader.line_begins.reserve();
+
+		*line_begin = static_cast<u32>(curr - begin);
 	}
 
+	id_entry->line_count = core->reader.line_begins.used() - id_entry->line_begins_index;
+}
+
+static SourceLocation build_source_location(Range<char8> filepath, Range<char8> content, u32 line_begin, u32 line_number, u32 offset) noexcept
+{
+	ASSERT_OR_IGNORE(line_begin <= offset && offset <= content.count());
+
 	u32 line_end = line_begin;
 
 	while (line_end < content.count() && content[line_end] != '\n' && content[line_end] != '\r')
@@ -365,28 +461,300 @@ static SourceLocation build_source_location(Range<char8> filepath, Range<char8>
 
 static SourceLocation source_location_from_source_file_and_source_id(CoreData* core, SourceFile* source_file, SourceId source_id) noexcept
 {
-	minos::FileInfo fileinfo;
+	SourceFileByIdEntry* const id_entry = reinterpret_cast<SourceFileByIdEntry*>(reinterpret_cast<byte*>(source_file) - offsetof(SourceFileByIdEntry, data));
 
-	Range<char8> filepath = source_file_path(core, source_file);
+	if (id_entry->line_count == 0)
+		build_line_index(core, id_entry);
 
-	if (!minos::file_get_info(get(source_file->file), &fileinfo))
-		panic("Could not get info on source file % while trying to re-read it for error reporting (0x%[|X])\n", filepath, minos::last_error());
+	const u32 offset = static_cast<u32>(source_id) - static_cast<u32>(source_file->source_id_base);
 
-	char8* const buffer = static_cast<char8*>(malloc(fileinfo.bytes));
+	const u32* const line_begins = core->reader.line_begins.begin() + id_entry->line_begins_index;
+
+	// Find the last line beginning at or before `offset`. Since the first
+	// line always begins at `0`, this always exists.
+	u32 lo = 0;
+
+	u32 hi = id_entry->line_count - 1;
+
+	while (lo < hi)
+	{
+		const u32 mid = lo + ((hi - lo + 1) >> 1);
+
+		if (line_begins[mid] <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return build_source_location(source_file_path(core, source_file), Range{ id_entry->content, id_entry->content_bytes }, line_begins[lo], lo + 1, offset);
+}
+
+
+
+// Reads the `bytes` bytes of `file` and returns them followed by a `'\0'`.
+// If `map_files` is set, the file is mapped instead of being copied. The
+// terminating `'\0'` is then supplied by the zero-filled tail of the
+// mapping's last page. If there is no such tail, which is the case for empty
+// files and files whose size is a multiple of the page size, or if the mapping
+// fails, this falls back to reading the file into a heap buffer.
+// `*out_is_mapped` receives which of the two happened. On failure, `nullptr`
+// is returned.
+// As this is also called from prefetch threads, it must not touch any state
+// in `CoreData`.
+static const char8* try_read_source_content(minos::FileHandle file, u64 bytes, bool map_files, bool* out_is_mapped) noexcept
+{
+	if (map_files && (bytes & (minos::page_bytes() - 1)) != 0)
+	{
+		const void* const mapping = minos::file_map_readonly(file, bytes);
+
+		if (mapping != nullptr)
+		{
+			*out_is_mapped = true;
+
+			return static_cast<const char8*>(mapping);
+		}
+	}
+
+	*out_is_mapped = false;
+
+	char8* const content = static_cast<char8*>(malloc(bytes + 1));
+
+	if (content == nullptr)
+		return nullptr;
+
+	content[bytes] = '\0';
 
 	u32 bytes_read;
 
-	if (!minos::file_read(get(source_file->file), MutRange{ buffer, fileinfo.bytes }.as_mut_byte_range(), 0, &bytes_read))
-		panic("Could not read source file % while trying to re-read it for error reporting (0x%[|X])\n", filepath, minos::last_error());
+	if (!minos::file_read(file, MutRange{ content, bytes }.as_mut_byte_range(), 0, &bytes_read) || bytes_read != bytes)
+	{
+		free(content);
 
-	if (bytes_read != fileinfo.bytes)
-		panic("Could only read % out of % bytes from source file % while trying to re-read it for error reporting (0x%[|X])\n", bytes_read, fileinfo.bytes, filepath, minos::last_error());
+		return nullptr;
+	}
 
-	SourceLocation location = build_source_location(filepath, Range{ buffer, fileinfo.bytes }, static_cast<u32>(source_id) - static_cast<u32>(source_file->source_id_base));
+	return content;
+}
 
-	free(buffer);
+static void release_source_content(const char8* content, u64 bytes, bool is_mapped) noexcept
+{
+	if (is_mapped)
+		minos::file_unmap(content, bytes);
+	else
+		free(const_cast<char8*>(content));
+}
 
-	return location;
+static void run_prefetch(SourceFilePrefetch* prefetch, bool map_files) noexcept
+{
+	PrefetchState state = PrefetchState::Failed;
+
+	if (minos::file_create(Range{ prefetch->path, prefetch->path_bytes }, minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &prefetch->file))
+	{
+		if (minos::file_get_info(prefetch->file, &prefetch->fileinfo) && !prefetch->fileinfo.is_directory && prefetch->fileinfo.bytes <= UINT32_MAX)
+			prefetch->content = try_read_source_content(prefetch->file, prefetch->fileinfo.bytes, map_files, &prefetch->is_mapped);
+		else
+			prefetch->content = nullptr;
+
+		if (prefetch->content != nullptr)
+		{
+			// Fault in the mapping, so that the parser does not end up
+			// waiting for the disk after all.
+			if (prefetch->is_mapped)
+			{
+				const u32 page_bytes = minos::page_bytes();
+
+				u8 touched = 0;
+
+				for (u64 i = 0; i < prefetch->fileinfo.bytes; i += page_bytes)
+					touched ^= static_cast<u8>(static_cast<const volatile char8*>(prefetch->content)[i]);
+
+				(void) touched;
+			}
+
+			state = PrefetchState::Done;
+		}
+		else
+		{
+			minos::file_close(prefetch->file);
+		}
+	}
+
+	prefetch->state.store(state, std::memory_order_release);
+
+	minos::address_wake_all(&prefetch->state);
+}
+
+static u32 THREAD_PROC prefetch_thread_proc(void* param) noexcept
+{
+	CoreData* const core = static_cast<CoreData*>(param);
+
+	SourceReader* const reader = &core->reader;
+
+	const bool map_files = core->config->sources.map_files;
+
+	while (true)
+	{
+		// Read the generation before checking for work, so that submissions
+		// and shutdown requests made after the check cause the wait below to
+		// return immediately.
+		const u32 generation = reader->prefetch_generation.load(std::memory_order_acquire);
+
+		u32 claimed = reader->prefetch_claimed.load(std::memory_order_relaxed);
+
+		while (claimed != reader->prefetch_submitted.load(std::memory_order_acquire))
+		{
+			if (reader->prefetch_claimed.compare_exchange_weak(claimed, claimed + 1, std::memory_order_relaxed))
+			{
+				run_prefetch(reader->prefetches.begin() + claimed, map_files);
+
+				claimed = reader->prefetch_claimed.load(std::memory_order_relaxed);
+			}
+		}
+
+		if (reader->prefetch_is_shutting_down.load(std::memory_order_acquire))
+			return 0;
+
+		minos::address_wait(&reader->prefetch_generation, &generation, sizeof(generation));
+	}
+}
+
+static void submit_prefetch(CoreData* core, Range<char8> path) noexcept
+{
+	SourceReader* const reader = &core->reader;
+
+	SourceFileByPathEntry* const path_entry = reader->known_files_by_path.value_from(path, fnv1a(path.as_byte_range()));
+
+	if (path_entry->id_entry_index != 0 || path_entry->prefetch_index != 0)
+		return;
+
+	if (reader->prefetch_thread_count == 0)
+	{
+		const u32 thread_count = static_cast<u32>(core->config->sources.prefetch_threads);
+
+		for (u32 i = 0; i != thread_count; ++i)
+		{
+			if (!minos::thread_create(prefetch_thread_proc, core, range::from_literal_string("source prefetch"), some(&reader->prefetch_threads[i])))
+				panic("Could not create source prefetch thread (0x%[|X])\n", minos::last_error());
+
+			reader->prefetch_thread_count += 1;
+		}
+	}
+
+	const u32 index = reader->prefetches.used();
+
+	SourceFilePrefetch* const prefetch = reader->prefetches.reserve();
+	prefetch->state.store(PrefetchState::Pending, std::memory_order_relaxed);
+	prefetch->is_consumed = false;
+	prefetch->path = path_entry->path;
+	prefetch->path_bytes = path_entry->path_bytes;
+
+	path_entry->prefetch_index = index;
+
+	reader->prefetch_submitted.store(index + 1, std::memory_order_release);
+
+	reader->prefetch_generation.fetch_add(1, std::memory_order_release);
+
+	minos::address_wake_single(&reader->prefetch_generation);
+}
+
+// Scans `content`, which was read from `filepath`, for calls of the form
+// `import("path"` or `_import("path"` and submits reads of the referenced
+// files to the prefetch threads. This is purely speculative, as imports are
+// only resolved during evaluation; Paths that are never actually imported
+// just waste a read.
+// Paths are resolved relative to the directory containing `filepath`,
+// matching `builtin_import`, so that `read_source_file` finds the prefetch
+// under the same path later on.
+static void prefetch_imports(CoreData* core, Range<char8> filepath, Range<char8> content) noexcept
+{
+	if (core->config->sources.prefetch_threads == 0)
+		return;
+
+	const char8* const begin = content.begin();
+
+	const char8* const end = content.end();
+
+	const char8* curr = begin;
+
+	char8 directory_buf[8192];
+
+	u32 directory_chars = 0;
+
+	while (true)
+	{
+		const char8* const paren = static_cast<const char8*>(memchr(curr, '(', end - curr));
+
+		if (paren == nullptr)
+			break;
+
+		curr = paren + 1;
+
+		if (paren - begin < 6 || memcmp(paren - 6, "import", 6) != 0 || curr == end || *curr != '"')
+			continue;
+
+		const char8* const path_begin = curr + 1;
+
+		const char8* path_end = path_begin;
+
+		// Skip paths with escape sequences, as these would need to be
+		// unescaped first.
+		while (path_end != end && *path_end != '"' && *path_end != '\\' && *path_end != '\n')
+			path_end += 1;
+
+		if (path_end == end || *path_end != '"' || path_end == path_begin)
+			continue;
+
+		curr = path_end + 1;
+
+		if (directory_chars == 0)
+		{
+			directory_chars = minos::path_to_absolute_directory(filepath, MutRange{ directory_buf });
+
+			if (directory_chars == 0 || directory_chars > array_count(directory_buf))
+				return;
+		}
+
+		char8 absolute_path_buf[8192];
+
+		const u32 absolute_path_chars = minos::path_to_absolute_relative_to(Range{ path_begin, path_end }, Range{ directory_buf, directory_chars }, MutRange{ absolute_path_buf });
+
+		if (absolute_path_chars == 0 || absolute_path_chars > array_count(absolute_path_buf))
+			continue;
+
+		submit_prefetch(core, Range{ absolute_path_buf, absolute_path_chars });
+	}
+}
+
+// Waits for the prefetch associated with `path_entry` to complete. If it
+// succeeded, its results are stored into `*out_file`, `*out_fileinfo`,
+// `*out_content` and `*out_is_mapped`, and `true` is returned. Otherwise
+// `false` is returned, and the file has to be read directly.
+static bool consume_prefetch(CoreData* core, SourceFileByPathEntry* path_entry, minos::FileHandle* out_file, minos::FileInfo* out_fileinfo, const char8** out_content, bool* out_is_mapped) noexcept
+{
+	SourceFilePrefetch* const prefetch = core->reader.prefetches.begin() + path_entry->prefetch_index;
+
+	path_entry->prefetch_index = 0;
+
+	prefetch->is_consumed = true;
+
+	PrefetchState state = prefetch->state.load(std::memory_order_acquire);
+
+	while (state == PrefetchState::Pending)
+	{
+		minos::address_wait(&prefetch->state, &state, sizeof(state));
+
+		state = prefetch->state.load(std::memory_order_acquire);
+	}
+
+	if (state != PrefetchState::Done)
+		return false;
+
+	*out_file = prefetch->file;
+	*out_fileinfo = prefetch->fileinfo;
+	*out_content = prefetch->content;
+	*out_is_mapped = prefetch->is_mapped;
+
+	return true;
 }
 
 
@@ -403,7 +771,9 @@ MemoryRequirements source_reader_memory_requirements([[maybe_unused]] const Conf
 	reqs.ranges[0].size = KNOWN_FILES_BY_PATH_LOOKUP_RESERVE
 	                    + KNOWN_FILES_BY_PATH_VALUES_RESERVE
 	                    + KNOWN_FILES_BY_IDENTITY_LOOKUP_RESERVE
-	                    + KNOWN_FILES_BY_IDENTITY_VALUES_RESERVE;
+	                    + KNOWN_FILES_BY_IDENTITY_VALUES_RESERVE
+	                    + LINE_BEGINS_RESERVE
+	                    + PREFETCHES_RESERVE;
 	reqs.ranges[0].max_offset = UINT64_MAX;
 
 	return reqs;
@@ -411,7 +781,7 @@ MemoryRequirements source_reader_memory_requirements([[maybe_unused]] const Conf
 
 void source_reader_init(CoreData* core, MemoryAllocation allocation) noexcept
 {
-	ASSERT_OR_IGNORE(allocation.ranges[0].count() == KNOWN_FILES_BY_PATH_LOOKUP_RESERVE + KNOWN_FILES_BY_PATH_VALUES_RESERVE + KNOWN_FILES_BY_IDENTITY_LOOKUP_RESERVE + KNOWN_FILES_BY_IDENTITY_VALUES_RESERVE);
+	ASSERT_OR_IGNORE(allocation.ranges[0].count() == KNOWN_FILES_BY_PATH_LOOKUP_RESERVE + KNOWN_FILES_BY_PATH_VALUES_RESERVE + KNOWN_FILES_BY_IDENTITY_LOOKUP_RESERVE + KNOWN_FILES_BY_IDENTITY_VALUES_RESERVE + LINE_BEGINS_RESERVE + PREFETCHES_RESERVE);
 
 	SourceReader* const reader = &core->reader;
 
@@ -429,17 +799,196 @@ void source_reader_init(CoreData* core, MemoryAllocation allocation) noexcept
 	const MutRange<byte> by_identity_values_memory = allocation.ranges[0].mut_subrange(offset, KNOWN_FILES_BY_IDENTITY_VALUES_RESERVE);
 	offset += KNOWN_FILES_BY_IDENTITY_VALUES_RESERVE;
 
+	const MutRange<byte> line_begins_memory = allocation.ranges[0].mut_subrange(offset, LINE_BEGINS_RESERVE);
+	offset += LINE_BEGINS_RESERVE;
+
+	const MutRange<byte> prefetches_memory = allocation.ranges[0].mut_subrange(offset, PREFETCHES_RESERVE);
+	offset += PREFETCHES_RESERVE;
+
 	ASSERT_OR_IGNORE(allocation.ranges[0].count() == offset);
 
 	reader->known_files_by_path.init(by_path_lookup_memory, KNOWN_FILES_BY_PATH_LOOKUP_INITIAL_COMMIT_COUNT, SourceFileByPathAlloc{ core });
 	reader->known_files_by_identity.init(by_identity_lookup_memory, KNOWN_FILES_BY_IDENTITY_LOOKUP_INITIAL_COMMIT_COUNT, SourceFileByIdAlloc{ core });
 	reader->path_entries.init(by_path_values_memory, KNOWN_FILES_BY_PATH_VALUES_COMMIT_INCREMENT_COUNT);
 	reader->id_entries.init(by_identity_values_memory, KNOWN_FILES_BY_IDENTITY_VALUES_COMMIT_INCREMENT_COUNT);
+	reader->line_begins.init(line_begins_memory, LINE_BEGINS_COMMIT_INCREMENT_COUNT);
+	reader->prefetches.init(prefetches_memory, PREFETCHES_COMMIT_INCREMENT_COUNT);
 	reader->curr_source_id_base = 1;
 	reader->source_file_count = 0;
+	reader->prefetch_thread_count = 0;
+	reader->prefetch_submitted.store(1, std::memory_order_relaxed);
+	reader->prefetch_claimed.store(1, std::memory_order_relaxed);
+	reader->prefetch_generation.store(0, std::memory_order_relaxed);
+	reader->prefetch_is_shutting_down.store(false, std::memory_order_relaxed);
 
 	(void) reader->path_entries.reserve(alignof(SourceFileByPathEntry));
 	(void) reader->id_entries.reserve();
+	(void) reader->prefetches.reserve();
+}
+
+void source_reader_release(CoreData* core) noexcept
+{
+	SourceReader* const reader = &core->reader;
+
+	for (SourceFileByIdEntry* id_entry = reader->id_entries.begin() + 1; id_entry != reader->id_entries.end(); ++id_entry)
+	{
+		if (id_entry->content != nullptr)
+			release_source_content(id_entry->content, id_entry->content_bytes, id_entry->is_mapped);
+
+		if (is_some(id_entry->data.file))
+			minos::file_close(get(id_entry->data.file));
+	}
+
+	if (reader->prefetch_thread_count == 0)
+		return;
+
+	reader->prefetch_is_shutting_down.store(true, std::memory_order_release);
+
+	reader->prefetch_generation.fetch_add(1, std::memory_order_release);
+
+	minos::address_wake_all(&reader->prefetch_generation);
+
+	for (u32 i = 0; i != reader->prefetch_thread_count; ++i)
+	{
+		minos::thread_wait(reader->prefetch_threads[i], none<u32*>());
+
+		minos::thread_close(reader->prefetch_threads[i]);
+	}
+
+	// Release reads that were prefetched but never imported. All submitted
+	// prefetches have been run, as the threads only exit once they run out of
+	// work.
+	for (SourceFilePrefetch* prefetch = reader->prefetches.begin() + 1; prefetch != reader->prefetches.end(); ++prefetch)
+	{
+		if (prefetch->is_consumed || prefetch->state.load(std::memory_order_relaxed) != PrefetchState::Done)
+			continue;
+
+		release_source_content(prefetch->content, prefetch->fileinfo.bytes, prefetch->is_mapped);
+
+		minos::file_close(prefetch->file);
+	}
+}
+
+
+void source_reader_prepare_snapshot(CoreData* core) noexcept
+{
+	SourceReader* const reader = &core->reader;
+
+	// Let all outstanding prefetches run to completion, so that the prefetch
+	// threads do not modify `reader` while it is being copied.
+	for (SourceFilePrefetch* prefetch = reader->prefetches.begin() + 1; prefetch != reader->prefetches.end(); ++prefetch)
+	{
+		PrefetchState state = prefetch->state.load(std::memory_order_acquire);
+
+		while (state == PrefetchState::Pending)
+		{
+			minos::address_wait(&prefetch->state, &state, sizeof(state));
+
+			state = prefetch->state.load(std::memory_order_acquire);
+		}
+	}
+
+	// Record the content hash of every file that has been read, so that
+	// `source_reader_restore` can tell whether it still matches the snapshot.
+	for (SourceFileByIdEntry* id_entry = reader->id_entries.begin() + 1; id_entry != reader->id_entries.end(); ++id_entry)
+	{
+		if (is_some(id_entry->data.file) && id_entry->data.content_hash == 0)
+			id_entry->data.content_hash = fnv1a_64(Range{ id_entry->content, id_entry->content_bytes }.as_byte_range());
+	}
+}
+
+// Re-acquires the file handle and content of `id_entry` after restoring a
+// snapshot. Returns `false` if the file can no longer be read or its content
+// has changed since the snapshot was taken.
+static bool restore_source_file(CoreData* core, SourceFileByIdEntry* id_entry) noexcept
+{
+	const SourceFileByPathEntry* const path_entry = core->reader.known_files_by_path.value_from(id_entry->path_entry_index);
+
+	minos::FileHandle file;
+
+	if (!minos::file_create(Range{ path_entry->path, path_entry->path_bytes }, minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+		return false;
+
+	minos::FileInfo fileinfo;
+
+	bool is_mapped;
+
+	const char8* const content = minos::file_get_info(file, &fileinfo) && fileinfo.bytes == id_entry->content_bytes
+		? try_read_source_content(file, fileinfo.bytes, core->config->sources.map_files, &is_mapped)
+		: nullptr;
+
+	if (content == nullptr)
+	{
+		minos::file_close(file);
+
+		return false;
+	}
+
+	if (fnv1a_64(Range{ content, fileinfo.bytes }.as_byte_range()) != id_entry->data.content_hash)
+	{
+		release_source_content(content, fileinfo.bytes, is_mapped);
+
+		minos::file_close(file);
+
+		return false;
+	}
+
+	id_entry->data.file = some(file);
+
+	id_entry->content = content;
+
+	id_entry->is_mapped = is_mapped;
+
+	return true;
+}
+
+bool source_reader_restore(CoreData* core) noexcept
+{
+	SourceReader* const reader = &core->reader;
+
+	// Prefetch threads did not survive the snapshot, and neither did the
+	// results of reads they performed without those being consumed.
+	reader->prefetch_thread_count = 0;
+	reader->prefetch_submitted.store(1, std::memory_order_relaxed);
+	reader->prefetch_claimed.store(1, std::memory_order_relaxed);
+	reader->prefetch_generation.store(0, std::memory_order_relaxed);
+	reader->prefetch_is_shutting_down.store(false, std::memory_order_relaxed);
+	reader->prefetches.pop_to(1);
+
+	SourceFileByPathIterator it = SourceFileByPathAlloc{ core }.values();
+
+	while (it.has_next())
+		it.next()->prefetch_index = 0;
+
+	// File handles and contents are process-local, so they have to be
+	// re-acquired. If a file has changed since the snapshot was taken, the
+	// state derived from it is stale, and the snapshot cannot be used.
+	// The contents left over from the snapshotted process are forgotten
+	// first, so that only the ones acquired here get released on failure.
+	for (SourceFileByIdEntry* id_entry = reader->id_entries.begin() + 1; id_entry != reader->id_entries.end(); ++id_entry)
+		id_entry->content = nullptr;
+
+	for (SourceFileByIdEntry* id_entry = reader->id_entries.begin() + 1; id_entry != reader->id_entries.end(); ++id_entry)
+	{
+		if (is_none(id_entry->data.file))
+			continue;
+
+		id_entry->data.file = none<minos::FileHandle>();
+
+		if (!restore_source_file(core, id_entry))
+		{
+			// Forget the snapshotted process's handles of the files that
+			// have not been reached yet as well.
+			for (SourceFileByIdEntry* unrestored = id_entry + 1; unrestored != reader->id_entries.end(); ++unrestored)
+				unrestored->data.file = none<minos::FileHandle>();
+
+			source_reader_release(core);
+
+			return false;
+		}
+	}
+
+	return true;
 }
 
 
@@ -462,31 +1011,50 @@ SourceFileRead read_source_file(CoreData* core, Range<char8> filepath) noexcept
 
 	minos::FileHandle file;
 
-	if (!minos::file_create(filepath, minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
-		panic("Could not open source file % for reading (0x%[|X])\n", filepath, minos::last_error());
-
 	minos::FileInfo fileinfo;
 
-	if (!minos::file_get_info(file, &fileinfo))
-		panic("Could not get info on source file % (0x%[|X])\n", filepath, minos::last_error());
+	const char8* content = nullptr;
 
-	if (fileinfo.bytes > UINT32_MAX)
-		panic("Could not read source file % as its size % exceeds the supported maximum of % bytes (< 4gb)\n", filepath, fileinfo.bytes, UINT32_MAX);
+	bool is_mapped;
+
+	if (path_entry->prefetch_index == 0 || !consume_prefetch(core, path_entry, &file, &fileinfo, &content, &is_mapped))
+	{
+		if (!minos::file_create(filepath, minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+			panic("Could not open source file % for reading (0x%[|X])\n", filepath, minos::last_error());
+
+		if (!minos::file_get_info(file, &fileinfo))
+			panic("Could not get info on source file % (0x%[|X])\n", filepath, minos::last_error());
+
+		if (fileinfo.bytes > UINT32_MAX)
+			panic("Could not read source file % as its size % exceeds the supported maximum of % bytes (< 4gb)\n", filepath, fileinfo.bytes, UINT32_MAX);
+	}
 
 	SourceFileByIdEntry* const id_entry = core->reader.known_files_by_identity.value_from(fileinfo.identity, hash_file_identity(fileinfo.identity.index, fileinfo.identity.volume_serial));
 
 	path_entry->id_entry_index = core->reader.known_files_by_identity.id_from(id_entry);
 
 	if (is_some(id_entry->data.file))
+	{
+		// The file was prefetched under a different path. Drop the duplicate.
+		if (content != nullptr)
+		{
+			release_source_content(content, fileinfo.bytes, is_mapped);
+
+			minos::file_close(file);
+		}
+
 		return SourceFileRead{ &id_entry->data, {} };
+	}
 
 	// File has not been read in yet. Do so.
 
 	id_entry->path_entry_index = core->reader.known_files_by_path.id_from(path_entry);
+	id_entry->line_count = 0;
 	id_entry->data.file = some(file);
 	id_entry->data.ast = AstNodeId::INVALID;
 	id_entry->data.type = TypeId::INVALID;
 	id_entry->data.source_id_base = SourceId{ core->reader.curr_source_id_base };
+	id_entry->data.content_hash = 0;
 	id_entry->data.has_error = false;
 
 	if (fileinfo.bytes + core->reader.curr_source_id_base > UINT32_MAX)
@@ -498,34 +1066,34 @@ SourceFileRead read_source_file(CoreData* core, Range<char8> filepath) noexcept
 
 	core->reader.source_file_count += 1;
 
-	char8* const content = static_cast<char8*>(malloc(fileinfo.bytes + 1));
-
 	if (content == nullptr)
-		panic("Could not allocate buffer for reading source file % (0x%[|X])\n", filepath, minos::last_error());
-
-	content[fileinfo.bytes] = '\0';
+	{
+		content = try_read_source_content(file, fileinfo.bytes, core->config->sources.map_files, &is_mapped);
 
-	u32 bytes_read;
+		if (content == nullptr)
+			panic("Could not read source file % (0x%[|X])\n", filepath, minos::last_error());
+	}
 
-	if (!minos::file_read(file, MutRange{ content, fileinfo.bytes }.as_mut_byte_range(), 0, &bytes_read))
-		panic("Could not read source file % (0x%[|X])\n", filepath, minos::last_error());
+	id_entry->content = content;
+	id_entry->content_bytes = static_cast<u32>(fileinfo.bytes);
+	id_entry->is_mapped = is_mapped;
 
-	if (bytes_read != fileinfo.bytes)
-		panic("Could only read % out of % bytes from source file % (0x%[|X])\n", bytes_read, fileinfo.bytes, filepath, minos::last_error());
+	prefetch_imports(core, filepath, Range{ content, fileinfo.bytes });
 
 	return SourceFileRead{ &id_entry->data, Range{ content, fileinfo.bytes + 1 } };
 }
 
-void release_read([[maybe_unused]] CoreData* core, SourceFileRead read) noexcept
+void release_read([[maybe_unused]] CoreData* core, [[maybe_unused]] SourceFileRead read) noexcept
 {
-	free(const_cast<char8*>(read.content.begin()));
+	// Nothing to do, as the contents are kept resident for diagnostics until
+	// `source_reader_release`.
 }
 
 SourceLocation source_location_from_source_id(CoreData* core, SourceId source_id) noexcept
 {
 	if (source_id == SourceId::INVALID)
 	{
-		return build_source_location(range::from_literal_string("<prelude>"), {}, 0);
+		return build_source_location(range::from_literal_string("<prelude>"), {}, 0, 1, 0);
 	}
 	else
 	{
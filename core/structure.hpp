@@ -7,11 +7,13 @@
 #include "../infra/range.hpp"
 #include "../infra/hash.hpp"
 #include "../infra/container/id_map.hpp"
+#include "../infra/container/group_id_map.hpp"
 #include "../infra/container/reserved_vec.hpp"
 #include "../infra/minos/minos.hpp"
 
 #include <cstddef>
 #include <csetjmp>
+#include <atomic>
 
 struct AstPool
 {
@@ -77,7 +79,7 @@ struct IdentifierAlloc
 
 struct IdentifierPool
 {
-	IdMap<Range<char8>, IdentifierEntry, IdentifierAlloc> map;
+	GroupIdMap<Range<char8>, IdentifierEntry, IdentifierAlloc> map;
 
 	ReservedVec<byte> entries;
 };
@@ -147,6 +149,10 @@ struct Interpreter
 
 	CoreId config_defines_value;
 
+	// Number of dynamic libraries loaded by `std.foreign_function`. The
+	// addresses taken from these are only valid in the current process.
+	u32 foreign_library_count;
+
 	bool is_ok;
 
 	BuiltinInfo builtin_infos[static_cast<u8>(Builtin::MAX) - 1];
@@ -193,6 +199,10 @@ struct Fixup;
 
 struct SourceMapping;
 
+enum class OpcodeRelocationKind : u8;
+
+struct OpcodeRelocation;
+
 struct OpcodeEffects
 {
 	s32 values_diff;
@@ -228,6 +238,10 @@ struct OpcodePool
 	ReservedVec<SourceMapping> sources;
 
 	ReservedVec<Fixup> fixups;
+
+	ReservedVec<OpcodeRelocation> relocations;
+
+	bool records_relocations;
 };
 
 
@@ -279,7 +293,18 @@ struct Parser
 
 	const char8* end;
 
-	Lexeme peek;
+	// Lexemes that have already been scanned but not yet consumed, starting
+	// at index `lookahead_begin` and wrapping around. This allows the parser
+	// to look ahead without scanning the same lexemes repeatedly.
+	Lexeme lookahead[4];
+
+	u8 lookahead_begin;
+
+	u8 lookahead_count;
+
+	// `SourceId` of the lexeme currently being scanned, to which any errors
+	// encountered while scanning it are attributed.
+	SourceId lexeme_source_id;
 
 	u32 source_id_base;
 
@@ -333,6 +358,10 @@ struct SourceFileByPathAlloc
 
 struct SourceFileByIdEntry;
 
+struct SourceFilePrefetch;
+
+static constexpr u32 MAX_SOURCE_PREFETCH_THREADS = 16;
+
 struct SourceFileByIdIterator
 {
 	CoreData* core;
@@ -373,9 +402,31 @@ struct SourceReader
 
 	ReservedVec<SourceFileByIdEntry> id_entries;
 
+	ReservedVec<u32> line_begins;
+
+	ReservedVec<SourceFilePrefetch> prefetches;
+
 	u32 curr_source_id_base;
 
 	u32 source_file_count;
+
+	u32 prefetch_thread_count;
+
+	// Index one past the last prefetch in `prefetches` that is available to
+	// the prefetch threads.
+	std::atomic<u32> prefetch_submitted;
+
+	// Index one past the last prefetch in `prefetches` that has been claimed
+	// by a prefetch thread.
+	std::atomic<u32> prefetch_claimed;
+
+	// Incremented whenever there is new work for the prefetch threads, or they
+	// are asked to shut down. The threads wait on this when idle.
+	std::atomic<u32> prefetch_generation;
+
+	std::atomic<bool> prefetch_is_shutting_down;
+
+	minos::ThreadHandle prefetch_threads[MAX_SOURCE_PREFETCH_THREADS];
 };
 
 
@@ -420,7 +471,7 @@ struct HolotypeAlloc
 
 struct TypePool
 {
-	IdMap<HolotypeInit, Holotype, HolotypeAlloc> holotypes;
+	GroupIdMap<HolotypeInit, Holotype, HolotypeAlloc> holotypes;
 
 	ReservedVec<Holotype> holotype_entries;
 
@@ -439,6 +490,25 @@ static constexpr u64 COMP_HEAP_MAX_FREELIST_SIZE = 1 << COMP_HEAP_MAX_FREELIST_S
 
 static constexpr u64 COMP_HEAP_ZERO_ADDRESS_MASK = COMP_HEAP_MIN_ALLOCATION_SIZE - 1;
 
+// Free memory is kept in one freelist per size class. Classes are spaced
+// `COMP_HEAP_MIN_ALLOCATION_SIZE` bytes apart up to
+// `COMP_HEAP_DENSE_SIZE_CLASS_LIMIT` bytes. Beyond that, each power of two
+// is split into `1 << COMP_HEAP_SIZE_CLASS_STEPS_LOG2` evenly spaced classes,
+// up to `COMP_HEAP_MAX_FREELIST_SIZE`.
+static constexpr u8 COMP_HEAP_DENSE_SIZE_CLASS_LIMIT_LOG2 = 10;
+
+static constexpr u64 COMP_HEAP_DENSE_SIZE_CLASS_LIMIT = 1 << COMP_HEAP_DENSE_SIZE_CLASS_LIMIT_LOG2;
+
+static constexpr u8 COMP_HEAP_SIZE_CLASS_STEPS_LOG2 = 2;
+
+static constexpr u32 COMP_HEAP_DENSE_SIZE_CLASS_COUNT = COMP_HEAP_DENSE_SIZE_CLASS_LIMIT / COMP_HEAP_MIN_ALLOCATION_SIZE;
+
+static constexpr u32 COMP_HEAP_SIZE_CLASS_COUNT = COMP_HEAP_DENSE_SIZE_CLASS_COUNT + ((COMP_HEAP_MAX_FREELIST_SIZE_LOG2 - COMP_HEAP_DENSE_SIZE_CLASS_LIMIT_LOG2) << COMP_HEAP_SIZE_CLASS_STEPS_LOG2);
+
+// Number of summary levels above `CompHeap::begin_bitmap`. Four levels
+// reduce the largest possible heap's bitmap to a single qword.
+static constexpr u32 COMP_HEAP_BEGIN_SUMMARY_LEVEL_COUNT = 4;
+
 struct CompHeap
 {
 	byte* memory;
@@ -455,11 +525,68 @@ struct CompHeap
 
 	u64* begin_bitmap;
 
+	// Summaries of `begin_bitmap`, forming a tree of bitmaps with a fanout of
+	// 64. Each bit on the first level is set if and only if the corresponding
+	// qword of `begin_bitmap` is non-zero, and likewise for each further
+	// level and its predecessor. This allows finding the allocation
+	// containing an address in a constant number of steps, no matter how far
+	// into the allocation it is.
+	u64* begin_summaries[COMP_HEAP_BEGIN_SUMMARY_LEVEL_COUNT];
+
 	u64* header_bitmap;
 
 	u64* gc_bitmap;
 
-	u32 freelists[COMP_HEAP_MAX_FREELIST_SIZE_LOG2 - COMP_HEAP_MIN_ALLOCATION_SIZE_LOG2];
+	// Marks the headers of allocations obtained from
+	// `comp_heap_alloc_collectable`, which are the only ones the garbage
+	// collector ever frees.
+	u64* collectable_bitmap;
+
+	// Collectable allocations at or beyond this offset from `memory` form the
+	// young generation, having been allocated since the last collection.
+	// They are always taken from the end of the heap rather than from the
+	// freelists, so the young generation is a bump-allocated nursery.
+	u64 nursery_begin;
+
+	// Number of bytes of young collectable allocations after which the next
+	// one triggers a minor collection, taken from `heap.nursery-size`.
+	u64 nursery_size;
+
+	// Number of bytes of young collectable allocations.
+	u64 nursery_allocated;
+
+	// Number of bytes promoted to the old generation after which the next
+	// collection is a full one, taken from `heap.full-gc-threshold`.
+	u64 full_gc_threshold;
+
+	// Number of bytes promoted to the old generation since the last full
+	// collection.
+	u64 promoted;
+
+	// Offset from `memory` below which the old generation is write-protected
+	// by `write_watch`, meaning that only granules marked in `card_bitmap`
+	// may have been written since the last collection. Old memory from here
+	// to `nursery_begin` is always considered written. This is `0` if
+	// `write_watch` could not be registered.
+	u64 protected_end;
+
+	// Remembered set for minor collections. Records writes to the old
+	// generation in `card_bitmap`, one bit per `write_watch.granule_bytes`
+	// bytes, since only written memory can refer to the young generation.
+	minos::WriteWatch write_watch;
+
+	bool is_write_watched;
+
+	u64* card_bitmap;
+
+	// Heads of the freelists of each size class, given as slot indices
+	// relative to `memory`, with `0` meaning the list is empty. Each entry
+	// holds the index of the next one in its first `u32`.
+	u32 freelists[COMP_HEAP_SIZE_CLASS_COUNT];
+
+	// Bitmap of the size classes whose freelists are not empty, allowing the
+	// smallest suitable non-empty one to be found in constant time.
+	u64 nonempty_freelists[(COMP_HEAP_SIZE_CLASS_COUNT + 63) >> 6];
 };
 
 
@@ -505,6 +632,40 @@ struct ShadowStoreAlloc
 	void dealloc(u32 id) noexcept;
 };
 
+struct ShadowPageKey;
+
+struct ShadowPageEntry;
+
+struct ShadowPageIterator
+{
+	CoreData* core;
+
+	u32 curr;
+
+	u32 end;
+
+	bool has_next() const noexcept;
+
+	ShadowPageEntry* next() noexcept;
+};
+
+struct ShadowPageAlloc
+{
+	CoreData* core;
+
+	ShadowPageEntry* value_from_id(u32 id) noexcept;
+
+	const ShadowPageEntry* value_from_id(u32 id) const noexcept;
+
+	u32 id_from_value(const ShadowPageEntry* value) const noexcept;
+
+	ShadowPageIterator values() noexcept;
+
+	ShadowPageEntry* alloc(ShadowPageKey key, u32 key_hash) noexcept;
+
+	void dealloc(u32 id) noexcept;
+};
+
 struct ShadowLayoutKey;
 
 struct ShadowLayoutEntry;
@@ -541,19 +702,145 @@ struct ShadowLayoutAlloc
 
 struct ShadowStore
 {
-	IdMap<ShadowStoreKey, ShadowStoreEntry, ShadowStoreAlloc> address_map;
+	GroupIdMap<ShadowStoreKey, ShadowStoreEntry, ShadowStoreAlloc> address_map;
 
 	IdMap<ShadowLayoutKey, ShadowLayoutEntry, ShadowLayoutAlloc> layout_map;
 
+	IdMap<ShadowPageKey, ShadowPageEntry, ShadowPageAlloc> page_map;
+
 	Maybe<ShadowStoreEntry*> address_entries_freelist_head;
 
+	Maybe<ShadowPageEntry*> page_entries_freelist_head;
+
 	ReservedVec<ShadowStoreEntry> address_entries;
 
+	ReservedVec<ShadowPageEntry> page_entries;
+
+	u32 address_count;
+
 	ReservedVec<CoreId> layout_ids;
 };
 
 
 
+struct InstrumentationProfileEntry;
+
+struct InstrumentationProfileIterator
+{
+	CoreData* core;
+
+	u32 curr;
+
+	u32 end;
+
+	bool has_next() const noexcept;
+
+	InstrumentationProfileEntry* next() noexcept;
+};
+
+struct InstrumentationProfileAlloc
+{
+	CoreData* core;
+
+	InstrumentationProfileEntry* value_from_id(u32 id) noexcept;
+
+	const InstrumentationProfileEntry* value_from_id(u32 id) const noexcept;
+
+	u32 id_from_value(const InstrumentationProfileEntry* value) const noexcept;
+
+	InstrumentationProfileIterator values() noexcept;
+
+	InstrumentationProfileEntry* alloc(Range<SourceId> key, u32 key_hash) noexcept;
+
+	void dealloc(u32 id) noexcept;
+};
+
+struct InstrumentationImport
+{
+	SourceId source_id_base;
+
+	u64 wall_ticks;
+
+	u64 cpu_ticks;
+};
+
+struct Instrumentation
+{
+	bool enabled;
+
+	bool tracing;
+
+	// Whether any trace event has been written yet, which determines whether
+	// the next one needs to be preceded by a separator.
+	bool has_trace_events;
+
+	PrintSink sink;
+
+	PrintSink trace_sink;
+
+	// Wall time that trace event timestamps are relative to.
+	u64 trace_begin_wall;
+
+	bool profiling;
+
+	PrintSink profile_sink;
+
+	u32 profile_sample_interval;
+
+	// Number of opcodes left to execute until the next sample is taken.
+	u32 profile_countdown;
+
+	// Wall and CPU time at which the innermost phase was last entered or
+	// resumed.
+	InstrumentationTimestamps phase_begin;
+
+	u64 phase_wall_ticks[static_cast<u8>(InstrumentationPhase::MAX)];
+
+	u64 phase_cpu_ticks[static_cast<u8>(InstrumentationPhase::MAX)];
+
+	// Counts indexed by the ordinal of the executed `Opcode`, without the
+	// flag indicating that it consumes a write context.
+	u64 opcode_counts[128];
+
+	u64 type_intern_hits;
+
+	u64 type_intern_misses;
+
+	u64 ast_cache_hits;
+
+	u64 ast_cache_misses;
+
+	u64 opcode_cache_hits;
+
+	u64 opcode_cache_misses;
+
+	u64 heap_alloc_count;
+
+	u64 heap_alloc_bytes;
+
+	u64 heap_gc_count;
+
+	u64 heap_minor_gc_count;
+
+	u64 heap_gc_bytes;
+
+	// Stack of currently active phases. The bottom element is always
+	// `InstrumentationPhase::Other`.
+	ReservedVec<InstrumentationPhase> phases;
+
+	ReservedVec<InstrumentationImport> imports;
+
+	// Sampled call stacks, each mapped to the number of times it was sampled.
+	IdMap<Range<SourceId>, InstrumentationProfileEntry, InstrumentationProfileAlloc> profile_map;
+
+	ReservedVec<byte> profile_entries;
+
+	// Scratch space for the call stack being sampled.
+	ReservedVec<SourceId> profile_frames;
+};
+
+
+
 struct CoreData
 {
 	u64 allocation_size;
@@ -583,6 +870,8 @@ struct CoreData
 	ShadowStore shadow;
 
 	LexicalAnalyser lex;
+
+	Instrumentation instrumentation;
 };
 
 
@@ -8,7 +8,7 @@
 #include "../infra/range.hpp"
 #include "../infra/hash.hpp"
 #include "../infra/inplace_sort.hpp"
-#include "../infra/container/id_map.hpp"
+#include "../infra/container/group_id_map.hpp"
 #include "../infra/container/reserved_vec.hpp"
 
 #include <cstring>
@@ -416,8 +416,14 @@ static TypeStructure* composite_realloc(CoreData* core, TypeStructure* indirecti
 
 	const CompositeInfo new_info = composite_info(new_composite);
 
+	const u16 new_member_capacity = new_composite->member_capacity;
+
 	memcpy(new_composite, old_composite, sizeof(CompositeType) + old_composite->extra_data_size + old_member_capacity * sizeof(IdentifierId));
 
+	// The copied header still holds the old capacity, which `composite_info`
+	// would then use to locate the member types and offsets copied below.
+	new_composite->member_capacity = new_member_capacity;
+
 	memcpy(new_info.member_types, old_info.member_types, old_member_capacity * sizeof(CompositeMember));
 
 	if (is_some(old_info.member_offsets))
@@ -669,6 +675,8 @@ static TypeId holotype_id_from_interned_type_structure(CoreData* core, TypeStruc
 
 	const TypeId holotype_id = holotype->m_holotype_id;
 
+	instrumentation_count_type_intern(core, holotype_id != structure_id);
+
 	structure->holotype_id = holotype_id;
 
 	if (holotype_id != structure_id && delete_duplicate)
@@ -700,6 +708,8 @@ static TypeId holotype_id_from_attachment(CoreData* core, TypeTag tag, Range<byt
 
 	const TypeId holotype_id = holotype->m_holotype_id;
 
+	instrumentation_count_type_intern(core, holotype_id != structure_id);
+
 	if (holotype_id == structure_id)
 	{
 		structure->holotype_id = holotype_id;
@@ -1885,7 +1895,7 @@ static TypeStructure* make_structure_nohash(CoreData* core, TypeTag tag, Range<b
 	const Maybe<void*> allocation = comp_heap_alloc(core, sizeof(TypeStructure) + reserve_size, 16);
 
 	if (is_none(allocation))
-		TODO("Implement GC traversal.");
+		panic("Failed to allocate % bytes of compile-time heap memory for type structure.\n", sizeof(TypeStructure) + reserve_size);
 
 	TypeStructure* const structure = static_cast<TypeStructure*>(get(allocation));
 	structure->tag = tag;
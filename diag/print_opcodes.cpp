@@ -387,7 +387,7 @@ static PrintResult follow_ref_impl(PrintSink sink, CoreData* core, const Opcode*
 
 	case Opcode::BinaryArithmeticOp:
 	{
-		return PrintResult{ code + sizeof(OpcodeBinaryArithmeticOpKind), 0 };
+		return PrintResult{ code + sizeof(OpcodeBinaryArithmeticOpKind) + sizeof(TypeId), 0 };
 	}
 
 	case Opcode::Shift:
@@ -402,7 +402,39 @@ static PrintResult follow_ref_impl(PrintSink sink, CoreData* core, const Opcode*
 
 	case Opcode::Compare:
 	{
-		return PrintResult{ code + sizeof(OpcodeCompareKind), 0 };
+		return PrintResult{ code + sizeof(OpcodeCompareKind) + sizeof(TypeId), 0 };
+	}
+
+	case Opcode::AddS:
+	case Opcode::AddU:
+	case Opcode::SubS:
+	case Opcode::SubU:
+	case Opcode::MulS:
+	case Opcode::MulU:
+	case Opcode::DivS:
+	case Opcode::DivU:
+	case Opcode::AddTCS:
+	case Opcode::AddTCU:
+	case Opcode::SubTCS:
+	case Opcode::SubTCU:
+	case Opcode::MulTCS:
+	case Opcode::MulTCU:
+	case Opcode::ModS:
+	case Opcode::ModU:
+	case Opcode::CmpLtS:
+	case Opcode::CmpLtU:
+	case Opcode::CmpGtS:
+	case Opcode::CmpGtU:
+	case Opcode::CmpLeS:
+	case Opcode::CmpLeU:
+	case Opcode::CmpGeS:
+	case Opcode::CmpGeU:
+	case Opcode::CmpNeS:
+	case Opcode::CmpNeU:
+	case Opcode::CmpEqS:
+	case Opcode::CmpEqU:
+	{
+		return PrintResult{ code + sizeof(u8) + sizeof(TypeId), 0 };
 	}
 
 	case Opcode::ReferenceType:
@@ -1297,6 +1329,8 @@ static PrintResult print_opcode_impl(PrintSink sink, CoreData* core, const Opcod
 		else
 			ASSERT_UNREACHABLE;
 
+		code += sizeof(TypeId);
+
 		const s64 written = print(sink, " %", kind_name);
 
 		if (written < 0)
@@ -1376,6 +1410,8 @@ static PrintResult print_opcode_impl(PrintSink sink, CoreData* core, const Opcod
 		else
 			ASSERT_UNREACHABLE;
 
+		code += sizeof(TypeId);
+
 		const s64 written = print(sink, " %", kind_name);
 
 		if (written < 0)
@@ -1384,6 +1420,51 @@ static PrintResult print_opcode_impl(PrintSink sink, CoreData* core, const Opcod
 		return PrintResult{ code, header_written + written };
 	}
 
+	case Opcode::AddS:
+	case Opcode::AddU:
+	case Opcode::SubS:
+	case Opcode::SubU:
+	case Opcode::MulS:
+	case Opcode::MulU:
+	case Opcode::DivS:
+	case Opcode::DivU:
+	case Opcode::AddTCS:
+	case Opcode::AddTCU:
+	case Opcode::SubTCS:
+	case Opcode::SubTCU:
+	case Opcode::MulTCS:
+	case Opcode::MulTCU:
+	case Opcode::ModS:
+	case Opcode::ModU:
+	case Opcode::CmpLtS:
+	case Opcode::CmpLtU:
+	case Opcode::CmpGtS:
+	case Opcode::CmpGtU:
+	case Opcode::CmpLeS:
+	case Opcode::CmpLeU:
+	case Opcode::CmpGeS:
+	case Opcode::CmpGeU:
+	case Opcode::CmpNeS:
+	case Opcode::CmpNeU:
+	case Opcode::CmpEqS:
+	case Opcode::CmpEqU:
+	{
+		u8 operand_bytes;
+
+		code = code_attach(code, &operand_bytes);
+
+		TypeId type_id;
+
+		code = code_attach(code, &type_id);
+
+		const s64 written = print(sink, " bits=% type=TypeId<%>", operand_bytes * 8, static_cast<u32>(type_id));
+
+		if (written < 0)
+			return PrintResult{ nullptr, -1 };
+
+		return PrintResult{ code, header_written + written };
+	}
+
 	case Opcode::ReferenceType:
 	{
 		OpcodeReferenceTypeFlags flags;
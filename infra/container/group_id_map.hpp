@@ -0,0 +1,682 @@
+#ifndef GROUP_ID_MAP_INCLUDE_GUARD
+#define GROUP_ID_MAP_INCLUDE_GUARD
+
+#include "../types.hpp"
+#include "../assert.hpp"
+#include "../panic.hpp"
+#include "../math.hpp"
+#include "../minos/minos.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GROUP_ID_MAP_HAS_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define GROUP_ID_MAP_HAS_SSE2 0
+#endif
+
+// Maps `K`s to `V`s, which get interned in `Alloc`, just like `IdMap`, with
+// which it shares its interface (including the requirements on `K`, `V` and
+// `Alloc`).
+//
+// Instead of Robin Hood hashing, lookups are organized into cache-line-sized
+// groups of `GROUP_SLOTS` slots, each of which is described by a control
+// byte. A control byte is either `CONTROL_EMPTY`, `CONTROL_DELETED`, or
+// `CONTROL_FULL_BIT` combined with the top 7 bits of the slot's key hash. All
+// control bytes of a group are compared against a hash at once (using SSE2
+// where available), so that the common lookup touches a single cache line
+// before reaching its value.
+// Groups are probed triangularly, meaning every group is eventually visited,
+// so that badly clustered hashes only degrade performance instead of causing
+// a panic like `IdMap`'s exceeded maximum probe sequence length.
+//
+// Growing is incremental in the same way as for `IdMap`, with
+// `MIGRATION_STEP` groups being migrated by every call to `id_from` or
+// `remove`. Migrated slots are marked as `CONTROL_DELETED` in the old table,
+// which receives no further insertions. Tables with many `CONTROL_DELETED`
+// slots are instead cleaned up by rebuilding them in place, all at once.
+//
+// To allow switching between `IdMap` and `GroupIdMap`, capacities and
+// commits are given in the same units as for `IdMap`, resulting in the same
+// memory footprint. Each group takes the space of `LOOKUPS_PER_GROUP` of
+// `IdMap`'s lookups while providing `GROUP_SLOTS` slots.
+template<typename K, typename V, typename Alloc>
+struct GroupIdMap
+{
+private:
+
+	static constexpr u32 GROUP_SLOTS = 12;
+
+	static constexpr u32 GROUP_CONTROLS = 16;
+
+	static constexpr u32 GROUP_SLOT_MASK = (1 << GROUP_SLOTS) - 1;
+
+	static constexpr u32 LOOKUPS_PER_GROUP = 8;
+
+	static constexpr u8 CONTROL_EMPTY = 0x00;
+
+	static constexpr u8 CONTROL_DELETED = 0x01;
+
+	static constexpr u8 CONTROL_FULL_BIT = 0x80;
+
+	static constexpr u8 CONTROL_HASH_SHIFT = 25;
+
+	// Growing starts at a load of seven eighths, leaving the new table room
+	// for more insertions than the old one has groups, so any positive step
+	// size finishes migration in time. Larger steps shorten the time during
+	// which misses have to search both tables.
+	static constexpr u32 MIGRATION_STEP = 8;
+
+	// `controls[GROUP_SLOTS]` to `controls[GROUP_CONTROLS - 1]` are never
+	// written and thus remain `CONTROL_EMPTY`. They are masked out of all
+	// matches via `GROUP_SLOT_MASK`.
+	struct alignas(64) Group
+	{
+		u8 controls[GROUP_CONTROLS];
+
+		u32 data_ids[GROUP_SLOTS];
+	};
+
+	static_assert(sizeof(Group) == 64);
+
+	struct GroupTable
+	{
+		Group* groups;
+
+		// Number of slots that are not `CONTROL_EMPTY`, meaning this
+		// includes `CONTROL_DELETED` slots, as they lengthen probe sequences
+		// just as occupied ones do.
+		u32 used;
+
+		// Number of slots holding a value.
+		u32 live;
+
+		u32 commit;
+	};
+
+	Group* m_group_base;
+
+	GroupTable m_curr;
+
+	// Table that is being migrated into `m_curr`. `m_old.groups` is
+	// `nullptr` if no migration is in progress.
+	GroupTable m_old;
+
+	// Index of the next group in `m_old` to be migrated.
+	u32 m_migrate_index;
+
+	// Maximum value of `m_curr.commit`.
+	u32 m_group_capacity;
+
+	Alloc m_alloc;
+
+	static u8 create_control(u32 key_hash) noexcept
+	{
+		return static_cast<u8>(CONTROL_FULL_BIT | (key_hash >> CONTROL_HASH_SHIFT));
+	}
+
+	static u32 match_control(const Group* group, u8 control) noexcept
+	{
+		#if GROUP_ID_MAP_HAS_SSE2
+			const __m128i controls = _mm_load_si128(reinterpret_cast<const __m128i*>(group->controls));
+
+			const __m128i matches = _mm_cmpeq_epi8(controls, _mm_set1_epi8(static_cast<char>(control)));
+
+			return static_cast<u32>(_mm_movemask_epi8(matches)) & GROUP_SLOT_MASK;
+		#else
+			u32 mask = 0;
+
+			for (u32 i = 0; i != GROUP_SLOTS; ++i)
+			{
+				if (group->controls[i] == control)
+					mask |= 1 << i;
+			}
+
+			return mask;
+		#endif
+	}
+
+	static u32 match_empty(const Group* group) noexcept
+	{
+		return match_control(group, CONTROL_EMPTY);
+	}
+
+	static u32 match_empty_or_deleted(const Group* group) noexcept
+	{
+		#if GROUP_ID_MAP_HAS_SSE2
+			const __m128i controls = _mm_load_si128(reinterpret_cast<const __m128i*>(group->controls));
+
+			// Full slots are exactly those with their top bit set.
+			return ~static_cast<u32>(_mm_movemask_epi8(controls)) & GROUP_SLOT_MASK;
+		#else
+			u32 mask = 0;
+
+			for (u32 i = 0; i != GROUP_SLOTS; ++i)
+			{
+				if ((group->controls[i] & CONTROL_FULL_BIT) == 0)
+					mask |= 1 << i;
+			}
+
+			return mask;
+		#endif
+	}
+
+	u32 create_value(K key, u32 key_hash) noexcept
+	{
+		V* const value = m_alloc.alloc(key, key_hash);
+
+		return m_alloc.id_from_value(value);
+	}
+
+	bool is_migrating() const noexcept
+	{
+		return m_old.groups != nullptr;
+	}
+
+	GroupTable commit_table(u32 commit) noexcept
+	{
+		if (commit > m_group_capacity)
+			panic("Could not rehash GroupIdMap lookup as no additional capacity was available\n");
+
+		Group* const groups = m_group_base + commit;
+
+		const u64 groups_size = static_cast<u64>(commit) * sizeof(Group);
+
+		if (!minos::mem_commit(groups, groups_size))
+			panic("Could not commit % bytes of memory for GroupIdMap lookups (0x%[|X])\n", groups_size, minos::last_error());
+
+		GroupTable table;
+		table.groups = groups;
+		table.used = 0;
+		table.live = 0;
+		table.commit = commit;
+
+		return table;
+	}
+
+	// Decommits the pages lying entirely inside `table`. Tables are never
+	// placed at the same offset as a larger one, so any partially covered
+	// pages at its ends can be left alone.
+	static void release_table(GroupTable table) noexcept
+	{
+		const u64 page_mask = minos::page_bytes() - 1;
+
+		const u64 begin = (reinterpret_cast<u64>(table.groups) + page_mask) & ~page_mask;
+
+		const u64 end = reinterpret_cast<u64>(table.groups + table.commit) & ~page_mask;
+
+		if (begin < end)
+			minos::mem_decommit(reinterpret_cast<void*>(begin), end - begin);
+	}
+
+	// Makes room for further insertions, either by starting to migrate
+	// `m_curr` into a table twice its size or, if it is mostly filled by
+	// `CONTROL_DELETED` slots, by rebuilding it in place from
+	// `m_alloc.values()`. Any previous migration is completed first.
+	void grow() noexcept
+	{
+		if (is_migrating())
+			finish_migration();
+
+		if (m_curr.live * 2 >= m_curr.commit * GROUP_SLOTS)
+		{
+			const GroupTable grown = commit_table(m_curr.commit * 2);
+
+			m_old = m_curr;
+
+			m_curr = grown;
+
+			m_migrate_index = 0;
+
+			return;
+		}
+
+		memset(m_curr.groups, 0, static_cast<u64>(m_curr.commit) * sizeof(Group));
+
+		m_curr.used = 0;
+
+		m_curr.live = 0;
+
+		auto iterator = m_alloc.values();
+
+		while (iterator.has_next())
+		{
+			const V* const to_insert = iterator.next();
+
+			const u32 data_id = m_alloc.id_from_value(to_insert);
+
+			insert_into_lookups(&m_curr, data_id, to_insert->hash());
+		}
+	}
+
+	void migrate_step() noexcept
+	{
+		if (!is_migrating())
+			return;
+
+		const u32 end = m_old.commit - m_migrate_index < MIGRATION_STEP
+			? m_old.commit
+			: m_migrate_index + MIGRATION_STEP;
+
+		while (m_migrate_index != end)
+		{
+			Group* const group = m_old.groups + m_migrate_index;
+
+			u32 full = ~match_empty_or_deleted(group) & GROUP_SLOT_MASK;
+
+			while (full != 0)
+			{
+				const u32 slot = count_trailing_zeros_assume_one(full);
+
+				const u32 data_id = group->data_ids[slot];
+
+				group->controls[slot] = CONTROL_DELETED;
+
+				m_old.live -= 1;
+
+				insert_into_lookups(&m_curr, data_id, m_alloc.value_from_id(data_id)->hash());
+
+				full &= full - 1;
+			}
+
+			m_migrate_index += 1;
+		}
+
+		if (m_migrate_index == m_old.commit)
+		{
+			ASSERT_OR_IGNORE(m_old.live == 0);
+
+			release_table(m_old);
+
+			m_old = GroupTable{};
+		}
+	}
+
+	void finish_migration() noexcept
+	{
+		while (is_migrating())
+			migrate_step();
+	}
+
+	static void insert_into_lookups(GroupTable* table, u32 data_id, u32 key_hash) noexcept
+	{
+		u32 group_index = key_hash & (table->commit - 1);
+
+		u32 stride = 0;
+
+		while (true)
+		{
+			Group* const group = table->groups + group_index;
+
+			const u32 free = match_empty_or_deleted(group);
+
+			if (free != 0)
+			{
+				const u32 slot = count_trailing_zeros_assume_one(free);
+
+				if (group->controls[slot] == CONTROL_EMPTY)
+					table->used += 1;
+
+				table->live += 1;
+
+				group->controls[slot] = create_control(key_hash);
+
+				group->data_ids[slot] = data_id;
+
+				return;
+			}
+
+			stride += 1;
+
+			ASSERT_OR_IGNORE(stride != table->commit);
+
+			group_index = (group_index + stride) & (table->commit - 1);
+		}
+	}
+
+	bool find_in_table(const GroupTable* table, K key, u32 key_hash, Group** out_group, u32* out_slot) const noexcept
+	{
+		const u8 control = create_control(key_hash);
+
+		u32 group_index = key_hash & (table->commit - 1);
+
+		u32 stride = 0;
+
+		while (true)
+		{
+			Group* const group = table->groups + group_index;
+
+			u32 matches = match_control(group, control);
+
+			while (matches != 0)
+			{
+				const u32 slot = count_trailing_zeros_assume_one(matches);
+
+				const V* const value = m_alloc.value_from_id(group->data_ids[slot]);
+
+				if (value->is_equal_to_key(key, key_hash))
+				{
+					*out_group = group;
+
+					*out_slot = slot;
+
+					return true;
+				}
+
+				matches &= matches - 1;
+			}
+
+			if (match_empty(group) != 0)
+				return false;
+
+			stride += 1;
+
+			if (stride == table->commit)
+				return false;
+
+			group_index = (group_index + stride) & (table->commit - 1);
+		}
+	}
+
+	bool find_by_key(K key, u32 key_hash, GroupTable** out_table, Group** out_group, u32* out_slot) noexcept
+	{
+		if (find_in_table(&m_curr, key, key_hash, out_group, out_slot))
+		{
+			*out_table = &m_curr;
+
+			return true;
+		}
+
+		if (is_migrating() && find_in_table(&m_old, key, key_hash, out_group, out_slot))
+		{
+			*out_table = &m_old;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool find_by_key(K key, u32 key_hash, Group** out_group, u32* out_slot) const noexcept
+	{
+		return find_in_table(&m_curr, key, key_hash, out_group, out_slot)
+		    || (is_migrating() && find_in_table(&m_old, key, key_hash, out_group, out_slot));
+	}
+
+	static bool find_id_in_table(const GroupTable* table, u32 data_id, u32 key_hash, Group** out_group, u32* out_slot) noexcept
+	{
+		const u8 control = create_control(key_hash);
+
+		u32 group_index = key_hash & (table->commit - 1);
+
+		u32 stride = 0;
+
+		while (true)
+		{
+			Group* const group = table->groups + group_index;
+
+			u32 matches = match_control(group, control);
+
+			while (matches != 0)
+			{
+				const u32 slot = count_trailing_zeros_assume_one(matches);
+
+				if (group->data_ids[slot] == data_id)
+				{
+					*out_group = group;
+
+					*out_slot = slot;
+
+					return true;
+				}
+
+				matches &= matches - 1;
+			}
+
+			if (match_empty(group) != 0)
+				return false;
+
+			stride += 1;
+
+			if (stride == table->commit)
+				return false;
+
+			group_index = (group_index + stride) & (table->commit - 1);
+		}
+	}
+
+	void find_by_value(const V* value, GroupTable** out_table, Group** out_group, u32* out_slot) noexcept
+	{
+		const u32 key_hash = value->hash();
+
+		const u32 data_id = m_alloc.id_from_value(value);
+
+		if (find_id_in_table(&m_curr, data_id, key_hash, out_group, out_slot))
+		{
+			*out_table = &m_curr;
+
+			return;
+		}
+
+		ASSERT_OR_IGNORE(is_migrating());
+
+		if (!find_id_in_table(&m_old, data_id, key_hash, out_group, out_slot))
+			ASSERT_UNREACHABLE;
+
+		*out_table = &m_old;
+	}
+
+	static void remove_from_lookups(GroupTable* table, Group* group, u32 slot) noexcept
+	{
+		ASSERT_OR_IGNORE((group->controls[slot] & CONTROL_FULL_BIT) != 0);
+
+		table->live -= 1;
+
+		// If the group still has an empty slot, no probe sequence can have
+		// continued past it, so the slot can become empty as well. Otherwise
+		// a tombstone is needed to keep later groups reachable.
+		if (match_empty(group) != 0)
+		{
+			group->controls[slot] = CONTROL_EMPTY;
+
+			table->used -= 1;
+		}
+		else
+		{
+			group->controls[slot] = CONTROL_DELETED;
+		}
+	}
+
+public:
+
+	static constexpr u64 lookups_memory_size(u32 lookup_capacity) noexcept
+	{
+		ASSERT_OR_IGNORE(is_pow2(lookup_capacity) && lookup_capacity >= LOOKUPS_PER_GROUP);
+
+		return 2 * static_cast<u64>(lookup_capacity / LOOKUPS_PER_GROUP) * sizeof(Group);
+	}
+
+	void init(MutRange<byte> lookup_memory, u32 lookup_commit, Alloc alloc) noexcept
+	{
+		ASSERT_OR_IGNORE(lookup_memory.count() % (2 * sizeof(Group)) == 0);
+
+		ASSERT_OR_IGNORE(is_pow2(lookup_memory.count() / (2 * sizeof(Group))));
+
+		ASSERT_OR_IGNORE(is_pow2(lookup_commit) && lookup_commit >= LOOKUPS_PER_GROUP);
+
+		ASSERT_OR_IGNORE(lookup_memory.count() / (2 * sizeof(Group)) >= lookup_commit / LOOKUPS_PER_GROUP);
+
+		ASSERT_OR_IGNORE((reinterpret_cast<u64>(lookup_memory.begin()) & (alignof(Group) - 1)) == 0);
+
+		m_group_base = reinterpret_cast<Group*>(lookup_memory.begin());
+		m_group_capacity = static_cast<u32>(lookup_memory.count() / (2 * sizeof(Group)));
+		m_alloc = alloc;
+		m_curr = commit_table(lookup_commit / LOOKUPS_PER_GROUP);
+		m_old = GroupTable{};
+		m_migrate_index = 0;
+	}
+
+	u32 id_from(K key, u32 key_hash) noexcept
+	{
+		migrate_step();
+
+		Group* group;
+
+		u32 slot;
+
+		if (find_by_key(key, key_hash, &group, &slot))
+			return group->data_ids[slot];
+
+		if ((m_curr.used + m_old.live) * 8 >= m_curr.commit * GROUP_SLOTS * 7)
+			grow();
+
+		const u32 data_id = create_value(key, key_hash);
+
+		insert_into_lookups(&m_curr, data_id, key_hash);
+
+		return data_id;
+	}
+
+	u32 id_from(const V* value) const noexcept
+	{
+		return m_alloc.id_from_value(value);
+	}
+
+	V* value_from(K key, u32 key_hash) noexcept
+	{
+		const u32 id = id_from(key, key_hash);
+
+		return value_from(id);
+	}
+
+	V* value_from(u32 id) noexcept
+	{
+		return m_alloc.value_from_id(id);
+	}
+
+	bool try_id_from(K key, u32 key_hash, u32* out) noexcept
+	{
+		Group* group;
+
+		u32 slot;
+
+		if (!find_by_key(key, key_hash, &group, &slot))
+			return false;
+
+		*out = group->data_ids[slot];
+
+		return true;
+	}
+
+	Maybe<V*> try_value_from(K key, u32 key_hash) noexcept
+	{
+		Group* group;
+
+		u32 slot;
+
+		if (!find_by_key(key, key_hash, &group, &slot))
+			return none<V*>();
+
+		V* const value = m_alloc.value_from_id(group->data_ids[slot]);
+
+		return some(value);
+	}
+
+	Maybe<const V*> try_value_from(K key, u32 key_hash) const noexcept
+	{
+		Group* group;
+
+		u32 slot;
+
+		if (!find_by_key(key, key_hash, &group, &slot))
+			return none<const V*>();
+
+		const V* const value = m_alloc.value_from_id(group->data_ids[slot]);
+
+		return some(value);
+	}
+
+	const V* value_from(u32 id) const noexcept
+	{
+		return m_alloc.value_from_id(id);
+	}
+
+	void remove(K key, u32 key_hash) noexcept
+	{
+		migrate_step();
+
+		GroupTable* table;
+
+		Group* group;
+
+		u32 slot;
+
+		if (!find_by_key(key, key_hash, &table, &group, &slot))
+			ASSERT_UNREACHABLE;
+
+		m_alloc.dealloc(group->data_ids[slot]);
+
+		remove_from_lookups(table, group, slot);
+	}
+
+	void remove(u32 id) noexcept
+	{
+		migrate_step();
+
+		const V* const value = m_alloc.value_from_id(id);
+
+		GroupTable* table;
+
+		Group* group;
+
+		u32 slot;
+
+		find_by_value(value, &table, &group, &slot);
+
+		m_alloc.dealloc(id);
+
+		remove_from_lookups(table, group, slot);
+	}
+
+	void remove(V* value) noexcept
+	{
+		migrate_step();
+
+		const u32 id = m_alloc.id_from_value(value);
+
+		GroupTable* table;
+
+		Group* group;
+
+		u32 slot;
+
+		find_by_value(value, &table, &group, &slot);
+
+		m_alloc.dealloc(id);
+
+		remove_from_lookups(table, group, slot);
+	}
+
+	bool try_remove(K key, u32 key_hash) noexcept
+	{
+		migrate_step();
+
+		GroupTable* table;
+
+		Group* group;
+
+		u32 slot;
+
+		if (!find_by_key(key, key_hash, &table, &group, &slot))
+			return false;
+
+		m_alloc.dealloc(group->data_ids[slot]);
+
+		remove_from_lookups(table, group, slot);
+
+		return true;
+	}
+};
+
+#endif // GROUP_ID_MAP_INCLUDE_GUARD
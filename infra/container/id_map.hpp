@@ -26,6 +26,17 @@
 //                static constexpr bool allows_dealloc() noexcept;
 // AllocIterator: bool has_next() const noexcept;
 //                V* next() noexcept;
+//
+// Rehashing is incremental. Once the lookups become too full, a table of
+// twice the size is committed, and every following call to `id_from` or
+// `remove` migrates `MIGRATION_STEP` buckets of the old table into it. Until
+// the old table is empty, both tables are searched. Lookups through
+// `try_id_from` and `try_value_from` never migrate, so that they can safely
+// be performed from inside `Alloc::dealloc`.
+// To keep the two tables from overlapping, a table with a commit of `n`
+// lookups lives at an offset of `n` lookups into the lookup memory, which
+// thus has to provide twice the requested capacity (see
+// `lookups_memory_size`).
 template<typename K, typename V, typename Alloc>
 struct IdMap
 {
@@ -42,16 +53,39 @@ private:
 
 	static_assert(sizeof(LookupEntry) == 8);
 
+	struct LookupTable
+	{
+		LookupEntry* lookups;
+
+		u32 used;
+
+		u32 commit;
+	};
+
 	static constexpr u8 HASH_FINGERPRINT_SHIFT = 8;
 
 	static constexpr u8 MAX_PSL = 64;
 
-	LookupEntry* m_lookups;
+	// Migration starts when the old table is three quarters full, leaving
+	// the new one room for as many insertions as there are buckets in the
+	// old one before it needs to grow in turn. As any step size above one
+	// thus finishes migration in time, this only trades per-call latency
+	// against how long both tables have to be searched.
+	static constexpr u32 MIGRATION_STEP = 8;
+
+	LookupEntry* m_lookup_base;
 
-	u32 m_lookup_used;
+	LookupTable m_curr;
 
-	u32 m_lookup_commit;
+	// Table that is being migrated into `m_curr`. `m_old.lookups` is
+	// `nullptr` if no migration is in progress.
+	LookupTable m_old;
 
+	// Index of the next bucket in `m_old` to be migrated. All buckets below
+	// it are empty.
+	u32 m_migrate_index;
+
+	// Maximum value of `m_curr.commit`.
 	u32 m_lookup_capacity;
 
 	Alloc m_alloc;
@@ -88,19 +122,127 @@ private:
 		return m_alloc.id_from_value(value);
 	}
 
-	void rehash() noexcept
+	bool is_migrating() const noexcept
+	{
+		return m_old.lookups != nullptr;
+	}
+
+	LookupTable commit_table(u32 commit) noexcept
 	{
-		if (m_lookup_commit == m_lookup_capacity)
+		if (commit > m_lookup_capacity)
 			panic("Could not rehash IdMap lookup as no additional capacity was available\n");
 
-		const u32 lookups_size = m_lookup_commit * sizeof(*m_lookups);
+		LookupEntry* const lookups = m_lookup_base + commit;
+
+		const u64 lookups_size = static_cast<u64>(commit) * sizeof(LookupEntry);
+
+		if (!minos::mem_commit(lookups, lookups_size))
+			panic("Could not commit % bytes of memory for IdMap lookups (0x%[|X])\n", lookups_size, minos::last_error());
+
+		LookupTable table;
+		table.lookups = lookups;
+		table.used = 0;
+		table.commit = commit;
+
+		return table;
+	}
+
+	// Decommits the pages lying entirely inside `table`. Tables are never
+	// placed at the same offset twice, so any partially covered pages at its
+	// ends can be left alone.
+	static void release_table(LookupTable table) noexcept
+	{
+		const u64 page_mask = minos::page_bytes() - 1;
+
+		const u64 begin = (reinterpret_cast<u64>(table.lookups) + page_mask) & ~page_mask;
+
+		const u64 end = reinterpret_cast<u64>(table.lookups + table.commit) & ~page_mask;
+
+		if (begin < end)
+			minos::mem_decommit(reinterpret_cast<void*>(begin), end - begin);
+	}
+
+	// Starts migrating `m_curr` into a table of twice its size. Any previous
+	// migration is completed first.
+	void grow() noexcept
+	{
+		if (is_migrating())
+			finish_migration();
+
+		const LookupTable grown = commit_table(m_curr.commit * 2);
+
+		m_old = m_curr;
+
+		m_curr = grown;
 
-		if (!minos::mem_commit(reinterpret_cast<byte*>(m_lookups) + lookups_size, lookups_size))
-			panic("Could not commit additional memory for IdMap lookups and offsets (0x%[|X])\n", minos::last_error());
+		m_migrate_index = 0;
+	}
+
+	void migrate_step() noexcept
+	{
+		if (!is_migrating())
+			return;
 
-		memset(m_lookups, 0, m_lookup_commit * sizeof(*m_lookups));
+		const u32 end = m_old.commit - m_migrate_index < MIGRATION_STEP
+			? m_old.commit
+			: m_migrate_index + MIGRATION_STEP;
+
+		while (m_migrate_index != end)
+		{
+			LookupEntry* const lookup = m_old.lookups + m_migrate_index;
 
-		m_lookup_commit *= 2;
+			// Removing the entry shifts the rest of its cluster back by one,
+			// so keep going until the bucket stays empty. This never touches
+			// buckets below `m_migrate_index`, as those are already empty.
+			while (!is_empty_lookup(*lookup))
+			{
+				const u32 data_id = lookup->data_id;
+
+				remove_from_lookups(&m_old, lookup);
+
+				if (!insert_into_lookups(&m_curr, data_id, m_alloc.value_from_id(data_id)->hash()))
+				{
+					rebuild();
+
+					return;
+				}
+			}
+
+			m_migrate_index += 1;
+		}
+
+		if (m_migrate_index == m_old.commit)
+		{
+			ASSERT_OR_IGNORE(m_old.used == 0);
+
+			release_table(m_old);
+
+			m_old = LookupTable{};
+		}
+	}
+
+	void finish_migration() noexcept
+	{
+		while (is_migrating())
+			migrate_step();
+	}
+
+	// Replaces all lookups with a table twice the size of `m_curr`, into
+	// which all of `m_alloc`'s values are inserted at once. This is only
+	// necessary if the maximum probe sequence length is exceeded, as the
+	// entry displaced last is then in neither table.
+	void rebuild() noexcept
+	{
+		const LookupTable rebuilt = commit_table(m_curr.commit * 2);
+
+		if (is_migrating())
+			release_table(m_old);
+
+		release_table(m_curr);
+
+		m_old = LookupTable{};
+
+		m_curr = rebuilt;
 
 		auto iterator = m_alloc.values();
 
@@ -110,62 +252,68 @@ private:
 
 			const u32 data_id = m_alloc.id_from_value(to_insert);
 
-			reinsert_value_into_lookup(data_id, to_insert->hash());
+			if (!insert_into_lookups(&m_curr, data_id, to_insert->hash()))
+				panic("Could not insert IdMap entry, as the maximum proble sequence length was exceeded");
 		}
 	}
 
-	void reinsert_value_into_lookup(u32 offset_to_insert, u32 key_hash) noexcept
+	// Returns `false` if the maximum probe sequence length was exceeded. In
+	// this case, the entry that was displaced last is not present in
+	// `table`.
+	static bool insert_into_lookups(LookupTable* table, u32 data_id, u32 key_hash) noexcept
 	{
-		u32 i = key_hash & (m_lookup_commit - 1);
+		table->used += 1;
+
+		u32 i = key_hash & (table->commit - 1);
 
 		LookupEntry wanted_lookup = create_lookup(key_hash);
-		wanted_lookup.data_id = offset_to_insert;
+		wanted_lookup.data_id = data_id;
 
 		while (true)
 		{
-			const LookupEntry curr_lookup = m_lookups[i];
+			const LookupEntry curr_lookup = table->lookups[i];
 
 			if (is_empty_lookup(curr_lookup))
 			{
-				m_lookups[i] = wanted_lookup;
+				table->lookups[i] = wanted_lookup;
 
-				return;
+				return true;
 			}
 			else if (curr_lookup.psl < wanted_lookup.psl)
 			{
-				m_lookups[i] = wanted_lookup;
+				table->lookups[i] = wanted_lookup;
 
 				wanted_lookup = curr_lookup;
 			}
 
-			if (i == m_lookup_commit - 1)
+			if (i == table->commit - 1)
 				i = 0;
 			else
 				i += 1;
 
 			if (wanted_lookup.psl == MAX_PSL)
-				panic("Could not insert IdMap entry, as the maximum proble sequence length was exceeded");
+				return false;
 
 			wanted_lookup.psl += 1;
 		}
 	}
 
-	bool find_by_key(K key, u32 key_hash, LookupEntry** out_lookup) noexcept
+	bool find_in_table(const LookupTable* table, K key, u32 key_hash, LookupEntry** out_lookup) const noexcept
 	{
 		LookupEntry to_find = create_lookup(key_hash);
 
-		u32 i = key_hash & (m_lookup_commit - 1);
+		u32 i = key_hash & (table->commit - 1);
 
 		while (true)
 		{
-			const LookupEntry existing = m_lookups[i];
+			const LookupEntry existing = table->lookups[i];
 
 			if (is_empty_lookup(existing) || existing.psl < to_find.psl)
 				return false;
 
 			if (is_equal_lookup(existing, to_find, key, key_hash))
 			{
-				*out_lookup = m_lookups + i;
+				*out_lookup = table->lookups + i;
 
 				return true;
 			}
@@ -177,65 +325,113 @@ private:
 
 			i += 1;
 
-			if (i == m_lookup_commit)
+			if (i == table->commit)
 				i = 0;
 		}
 	}
 
-	LookupEntry* find_by_value(const V* value) noexcept
+	bool find_by_key(K key, u32 key_hash, LookupTable** out_table, LookupEntry** out_lookup) noexcept
 	{
-		const u32 hash = value->hash();
+		if (find_in_table(&m_curr, key, key_hash, out_lookup))
+		{
+			*out_table = &m_curr;
+
+			return true;
+		}
+
+		if (is_migrating() && find_in_table(&m_old, key, key_hash, out_lookup))
+		{
+			*out_table = &m_old;
+
+			return true;
+		}
+
+		return false;
+	}
 
+	bool find_by_key(K key, u32 key_hash, LookupEntry** out_lookup) const noexcept
+	{
+		return find_in_table(&m_curr, key, key_hash, out_lookup)
+		    || (is_migrating() && find_in_table(&m_old, key, key_hash, out_lookup));
+	}
+
+	bool find_value_in_table(const LookupTable* table, const V* value, u32 hash, LookupEntry** out_lookup) noexcept
+	{
 		LookupEntry to_find = create_lookup(hash);
 
-		u32 i = hash & (m_lookup_commit - 1);
+		u32 i = hash & (table->commit - 1);
 
 		while (true)
 		{
-			const LookupEntry existing = m_lookups[i];
+			const LookupEntry existing = table->lookups[i];
 
-			ASSERT_OR_IGNORE(!is_empty_lookup(existing) && existing.psl >= to_find.psl);
+			if (is_empty_lookup(existing) || existing.psl < to_find.psl)
+				return false;
 
 			if (existing.psl == to_find.psl && m_alloc.value_from_id(existing.data_id) == value)
-				return m_lookups + i;
+			{
+				*out_lookup = table->lookups + i;
+
+				return true;
+			}
 
-			ASSERT_OR_IGNORE(to_find.psl != MAX_PSL);
+			if (to_find.psl == MAX_PSL)
+				return false;
 
 			to_find.psl += 1;
 
 			i += 1;
 
-			if (i == m_lookup_commit)
+			if (i == table->commit)
 				i = 0;
 		}
 	}
 
-	void remove_from_lookups(LookupEntry* to_remove) noexcept
+	void find_by_value(const V* value, LookupTable** out_table, LookupEntry** out_lookup) noexcept
+	{
+		const u32 hash = value->hash();
+
+		if (find_value_in_table(&m_curr, value, hash, out_lookup))
+		{
+			*out_table = &m_curr;
+
+			return;
+		}
+
+		ASSERT_OR_IGNORE(is_migrating());
+
+		if (!find_value_in_table(&m_old, value, hash, out_lookup))
+			ASSERT_UNREACHABLE;
+
+		*out_table = &m_old;
+	}
+
+	static void remove_from_lookups(LookupTable* table, LookupEntry* to_remove) noexcept
 	{
-		m_lookup_used -= 1;
+		table->used -= 1;
 
-		u32 prev_i = static_cast<u32>(to_remove - m_lookups) & (m_lookup_commit - 1);
+		u32 prev_i = static_cast<u32>(to_remove - table->lookups) & (table->commit - 1);
 
-		u32 curr_i = (prev_i + 1) & (m_lookup_commit - 1);
+		u32 curr_i = (prev_i + 1) & (table->commit - 1);
 
-		ASSERT_OR_IGNORE(!is_empty_lookup(m_lookups[prev_i]));
+		ASSERT_OR_IGNORE(!is_empty_lookup(table->lookups[prev_i]));
 
-		while (m_lookups[curr_i].psl != 0)
+		while (table->lookups[curr_i].psl != 0)
 		{
-			LookupEntry curr = m_lookups[curr_i];
+			LookupEntry curr = table->lookups[curr_i];
 			curr.psl -= 1;
 
-			m_lookups[prev_i] = curr;
+			table->lookups[prev_i] = curr;
 
 			prev_i = curr_i;
 
 			curr_i += 1;
 
-			if (curr_i == m_lookup_commit)
+			if (curr_i == table->commit)
 				curr_i = 0;
 		}
 
-		m_lookups[prev_i] = LookupEntry{};
+		table->lookups[prev_i] = LookupEntry{};
 	}
 
 public:
@@ -244,100 +440,45 @@ public:
 	{
 		ASSERT_OR_IGNORE(is_pow2(lookup_capacity));
 
-		return lookup_capacity * sizeof(*m_lookups);
+		return 2 * static_cast<u64>(lookup_capacity) * sizeof(LookupEntry);
 	}
 
 	void init(MutRange<byte> lookup_memory, u32 lookup_commit, Alloc alloc) noexcept
 	{
-		ASSERT_OR_IGNORE(lookup_memory.count() % sizeof(*m_lookups) == 0);
+		ASSERT_OR_IGNORE(lookup_memory.count() % (2 * sizeof(LookupEntry)) == 0);
 
-		ASSERT_OR_IGNORE(is_pow2(lookup_memory.count() / sizeof(*m_lookups)));
+		ASSERT_OR_IGNORE(is_pow2(lookup_memory.count() / (2 * sizeof(LookupEntry))));
 
-		ASSERT_OR_IGNORE(lookup_memory.count() / sizeof(*m_lookups) >= lookup_commit);
+		ASSERT_OR_IGNORE(lookup_memory.count() / (2 * sizeof(LookupEntry)) >= lookup_commit);
 
 		ASSERT_OR_IGNORE(is_pow2(lookup_commit));
 
-		const u64 lookup_commit_bytes = static_cast<u64>(lookup_commit) * sizeof(*m_lookups);
-
-		if (!minos::mem_commit(lookup_memory.begin(), lookup_commit_bytes))
-			panic("Could not commit initial % bytes of memory for IdMap lookups and offsets (0x%[|X])\n", lookup_commit_bytes, minos::last_error());
-
-		m_lookups = reinterpret_cast<LookupEntry*>(lookup_memory.begin());
-		m_lookup_used = 0;
-		m_lookup_commit = lookup_commit;
-		m_lookup_capacity = static_cast<u32>(lookup_memory.count() / sizeof(*m_lookups));
+		m_lookup_base = reinterpret_cast<LookupEntry*>(lookup_memory.begin());
+		m_lookup_capacity = static_cast<u32>(lookup_memory.count() / (2 * sizeof(LookupEntry)));
 		m_alloc = alloc;
+		m_curr = commit_table(lookup_commit);
+		m_old = LookupTable{};
+		m_migrate_index = 0;
 	}
 
 	u32 id_from(K key, u32 key_hash) noexcept
 	{
-		if (m_lookup_used * 4 > m_lookup_commit * 3)
-			rehash();
-
-		LookupEntry to_insert = create_lookup(key_hash);
-
-		u32 i = key_hash & (m_lookup_commit - 1);
-
-		bool needs_allocation = true;
-
-		// This initial value does not matter, as it is always overwritten in
-		// the loop before being used, as it is tied to the value of
-		// `needs_allocation`.
-		u32 new_data_offset = 0; 
-
-		while (true)
-		{
-			const LookupEntry existing = m_lookups[i];
-
-			if (is_empty_lookup(existing))
-			{
-				if (needs_allocation)
-				{
-					new_data_offset = create_value(key, key_hash);
+		migrate_step();
 
-					to_insert.data_id = new_data_offset;
-				}
-
-				m_lookups[i] = to_insert;
-
-				return new_data_offset;
-			}
-			else if (is_equal_lookup(existing, to_insert, key, key_hash))
-			{
-				return existing.data_id;
-			}
-			else if (existing.psl < to_insert.psl)
-			{
-				if (needs_allocation)
-				{
-					needs_allocation = false;
-
-					new_data_offset = create_value(key, key_hash);
+		LookupEntry* lookup;
 
-					to_insert.data_id = new_data_offset;
-				}
+		if (find_by_key(key, key_hash, &lookup))
+			return lookup->data_id;
 
-				m_lookups[i] = to_insert;
+		if ((m_curr.used + m_old.used) * 4 > m_curr.commit * 3)
+			grow();
 
-				to_insert = existing;
-			}
+		const u32 data_id = create_value(key, key_hash);
 
-			if (to_insert.psl == MAX_PSL)
-			{
-				rehash();
+		if (!insert_into_lookups(&m_curr, data_id, key_hash))
+			rebuild();
 
-				return needs_allocation
-					? id_from(key, key_hash)
-					: new_data_offset;
-			}
-
-			to_insert.psl += 1;
-			
-			i += 1;
-
-			if (i == m_lookup_commit)
-				i = 0;
-		}
+		return data_id;
 	}
 
 	u32 id_from(const V* value) const noexcept
@@ -400,48 +541,68 @@ public:
 
 	void remove(K key, u32 key_hash) noexcept
 	{
+		migrate_step();
+
+		LookupTable* table;
+
 		LookupEntry* lookup;
 
-		if (!find_by_key(key, key_hash, &lookup))
+		if (!find_by_key(key, key_hash, &table, &lookup))
 			ASSERT_UNREACHABLE;
 
 		m_alloc.dealloc(lookup->data_id);
-		
-		remove_from_lookups(lookup);
+
+		remove_from_lookups(table, lookup);
 	}
 
 	void remove(u32 id) noexcept
 	{
+		migrate_step();
+
 		const V* const value = m_alloc.value_from_id(id);
 
-		LookupEntry* const lookup = find_by_value(value);
+		LookupTable* table;
+
+		LookupEntry* lookup;
+
+		find_by_value(value, &table, &lookup);
 
 		m_alloc.dealloc(id);
 
-		remove_from_lookups(lookup);
+		remove_from_lookups(table, lookup);
 	}
 
 	void remove(V* value) noexcept
 	{
+		migrate_step();
+
 		const u32 id = m_alloc.id_from_value(value);
 
-		LookupEntry* const lookup = find_by_value(value);
+		LookupTable* table;
+
+		LookupEntry* lookup;
+
+		find_by_value(value, &table, &lookup);
 
 		m_alloc.dealloc(id);
 
-		remove_from_lookups(lookup);
+		remove_from_lookups(table, lookup);
 	}
 
 	bool try_remove(K key, u32 key_hash) noexcept
 	{
+		migrate_step();
+
+		LookupTable* table;
+
 		LookupEntry* lookup;
 
-		if (!find_by_key(key, key_hash, &lookup))
+		if (!find_by_key(key, key_hash, &table, &lookup))
 			return false;
 
 		m_alloc.dealloc(lookup->data_id);
-		
-		remove_from_lookups(lookup);
+
+		remove_from_lookups(table, lookup);
 
 		return true;
 	}
@@ -177,11 +177,18 @@ public:
 		if (preserved_commit >= m_committed)
 			return;
 
-		const u32 page_bytes = minos::page_bytes();
+		const u64 page_bytes = minos::page_bytes();
 
-		const u32 target_commit = (preserved_commit + page_bytes - 1) & ~(page_bytes - 1);
+		// `preserved_commit` counts elements, while decommitting works on whole
+		// pages, so round up in bytes.
+		const u64 target_commit_bytes = (static_cast<u64>(preserved_commit) * sizeof(T) + page_bytes - 1) & ~(page_bytes - 1);
 
-		minos::mem_decommit(reinterpret_cast<byte*>(m_memory) + target_commit, m_committed - target_commit);
+		const Index target_commit = static_cast<Index>(target_commit_bytes / sizeof(T));
+
+		if (target_commit >= m_committed)
+			return;
+
+		minos::mem_decommit(reinterpret_cast<byte*>(m_memory) + target_commit_bytes, (m_committed - target_commit) * sizeof(T));
 
 		m_committed = target_commit;
 	}
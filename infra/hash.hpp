@@ -1,9 +1,12 @@
 #ifndef HASH_INCLUDE_GUARD
 #define HASH_INCLUDE_GUARD
 
+#include "host_compiler.hpp"
 #include "types.hpp"
 #include "range.hpp"
 
+#include <cstring>
+
 static constexpr u32 FNV1A_SEED = 2166136261;
 
 static inline u32 fnv1a_step(u32 seed, byte next) noexcept
@@ -31,4 +34,144 @@ static inline u32 fnv1a(Range<byte> data) noexcept
 	return fnv1a_step(FNV1A_SEED, data);
 }
 
+static constexpr u64 FNV1A_64_SEED = 14695981039346656037ull;
+
+static inline u64 fnv1a_64_step(u64 seed, Range<byte> next) noexcept
+{
+	u64 hash = seed;
+
+	for (const byte c : next)
+		hash = (hash ^ c) * 1099511628211ull;
+
+	return hash;
+}
+
+static inline u64 fnv1a_64(Range<byte> data) noexcept
+{
+	return fnv1a_64_step(FNV1A_64_SEED, data);
+}
+
+// Word-at-a-time hash following the structure of wyhash, though with a
+// reduced finalization that does not reproduce its outputs. Unlike `fnv1a`,
+// this consumes up to 16 bytes per multiplication, and hashes keys of up to
+// 16 bytes - which covers nearly all identifiers - with a single
+// multiplication regardless of their length.
+
+static constexpr u64 WYHASH_SECRET_0 = 0xA076'1D64'78BD'642Full;
+
+static constexpr u64 WYHASH_SECRET_1 = 0xE703'7ED1'A0B4'28DBull;
+
+#if !defined(COMPILER_MSVC)
+	// `__extension__` keeps `-Wpedantic` from complaining about `__int128`.
+	__extension__ typedef unsigned __int128 wyhash_u128;
+#endif
+
+static inline void wyhash_mum(u64* a, u64* b) noexcept
+{
+	#if defined(COMPILER_MSVC)
+		u64 high;
+
+		const u64 low = _umul128(*a, *b, &high);
+
+		*a = low;
+
+		*b = high;
+	#else
+		const wyhash_u128 product = static_cast<wyhash_u128>(*a) * *b;
+
+		*a = static_cast<u64>(product);
+
+		*b = static_cast<u64>(product >> 64);
+	#endif
+}
+
+static inline u64 wyhash_mix(u64 a, u64 b) noexcept
+{
+	wyhash_mum(&a, &b);
+
+	return a ^ b;
+}
+
+static inline u64 wyhash_read_8(const byte* p) noexcept
+{
+	u64 value;
+
+	memcpy(&value, p, sizeof(value));
+
+	return value;
+}
+
+static inline u64 wyhash_read_4(const byte* p) noexcept
+{
+	u32 value;
+
+	memcpy(&value, p, sizeof(value));
+
+	return value;
+}
+
+static inline u64 wyhash_64(Range<byte> data) noexcept
+{
+	const byte* p = data.begin();
+
+	const u64 count = data.count();
+
+	u64 seed = WYHASH_SECRET_0 ^ wyhash_mix(WYHASH_SECRET_0, WYHASH_SECRET_1);
+
+	u64 a;
+
+	u64 b;
+
+	if (count <= 16)
+	{
+		if (count >= 4)
+		{
+			// Two pairs of possibly overlapping 4-byte reads cover all bytes.
+			const u64 offset = (count >> 3) << 2;
+
+			a = (wyhash_read_4(p) << 32) | wyhash_read_4(p + offset);
+
+			b = (wyhash_read_4(p + count - 4) << 32) | wyhash_read_4(p + count - 4 - offset);
+		}
+		else if (count != 0)
+		{
+			a = (static_cast<u64>(p[0]) << 16) | (static_cast<u64>(p[count >> 1]) << 8) | p[count - 1];
+
+			b = 0;
+		}
+		else
+		{
+			a = 0;
+
+			b = 0;
+		}
+	}
+	else
+	{
+		u64 remaining = count;
+
+		while (remaining > 16)
+		{
+			seed = wyhash_mix(wyhash_read_8(p) ^ WYHASH_SECRET_1, wyhash_read_8(p + 8) ^ seed);
+
+			p += 16;
+
+			remaining -= 16;
+		}
+
+		// Read the last 16 bytes, overlapping with the ones already consumed
+		// if fewer than that are left.
+		a = wyhash_read_8(p + remaining - 16);
+
+		b = wyhash_read_8(p + remaining - 8);
+	}
+
+	return wyhash_mix(a ^ WYHASH_SECRET_1 ^ count, b ^ seed);
+}
+
+static inline u32 wyhash(Range<byte> data) noexcept
+{
+	return static_cast<u32>(wyhash_64(data));
+}
+
 #endif // HASH_INCLUDE_GUARD
@@ -146,6 +146,11 @@ namespace minos
 		INVALID = 0,
 	};
 
+	enum class SocketHandle : u64
+	{
+		INVALID = 0,
+	};
+
 	struct FileIdentity
 	{
 		u32 volume_serial;
@@ -245,6 +250,12 @@ namespace minos
 	// any physical memory, instead only reserving virtual address space.
 	[[nodiscard]] void* mem_reserve(u64 bytes) noexcept;
 
+	// Behaves like `minos::mem_reserve`, but places the reservation exactly at
+	// `address`, which must be aligned to `minos::page_bytes`. If any part of
+	// the range from `address` to `address + bytes` is already in use, nullptr
+	// is returned.
+	[[nodiscard]] void* mem_reserve_at(void* address, u64 bytes) noexcept;
+
 	// Makes `bytes` bytes of previously reserved memory starting from `ptr`
 	// readable and writable.
 	// In case the operation succeeds, `true` is returned, otherwise `false`.
@@ -263,6 +274,14 @@ namespace minos
 	// also effectively decommitted as part of this call.
 	void mem_unreserve(void* ptr, u64 bytes) noexcept;
 
+	// Retrieves the subranges of the `bytes` bytes of reserved memory starting
+	// at `ptr` that are currently committed, in ascending order of address.
+	// Adjacent committed pages are reported as a single subrange.
+	// If there are more than `out_ranges.count()` subranges, or the query
+	// fails, `false` is returned. Otherwise, the number of subranges is
+	// stored in `*out_count` and `true` is returned.
+	[[nodiscard]] bool mem_query_committed(void* ptr, u64 bytes, MutRange<MutRange<byte>> out_ranges, u32* out_count) noexcept;
+
 	// Frees the physical memory allocated by a previous call to
 	// `minos::mem_commit` back to the OS. The underlying memory reservation
 	// however remains untouched.
@@ -274,6 +293,61 @@ namespace minos
 	// This is guaranteed to be a power of two.
 	[[nodiscard]] u32 page_bytes() noexcept;
 
+	// Records which parts of a range of committed memory are written to.
+	// Memory is divided into granules of `granule_bytes` bytes, starting from
+	// `begin`. After a granule has been protected via
+	// `minos::write_watch_protect`, the first write to it sets its bit in
+	// `dirty_bitmap` and lifts the protection again, so that further writes
+	// proceed at full speed.
+	struct WriteWatch
+	{
+		// Beginning of the watched memory. This must be aligned to
+		// `minos::page_bytes`.
+		byte* begin;
+
+		// Number of watched bytes.
+		u64 bytes;
+
+		// Size of the granules at which writes are recorded. This must be a
+		// multiple of `minos::page_bytes`.
+		u64 granule_bytes;
+
+		// Bitmap holding one bit per granule. Bits are only ever set by
+		// minos, so clearing them is up to the owner of the `WriteWatch`.
+		u64* dirty_bitmap;
+
+		// Number of bytes from `begin` that may currently be protected. This
+		// is maintained by minos and must be initialized to `0`.
+		u64 protected_bytes;
+	};
+
+	// Registers `watch`, so that writes to its protected memory are recorded
+	// instead of being reported as access violations. `watch` must stay at
+	// the same address until it is passed to `minos::write_watch_unregister`.
+	// At most a small, fixed number of watches can be registered at a time.
+	// In case the operation succeeds, `true` is returned, otherwise `false`.
+	[[nodiscard]] bool write_watch_register(WriteWatch* watch) noexcept;
+
+	// Unregisters a `watch` previously registered via
+	// `minos::write_watch_register`. Its memory must not be protected
+	// anymore, or must be released right after this call.
+	void write_watch_unregister(WriteWatch* watch) noexcept;
+
+	// Write-protects the `bytes` bytes starting at `ptr`, which must be
+	// aligned to `watch->granule_bytes` relative to `watch->begin` and lie
+	// within the watched memory. The memory must remain committed while it
+	// is protected.
+	// If the protection has to be lifted from some granule but the operation
+	// fails, all of `watch`'s memory is made writable again and marked as
+	// dirty.
+	// In case the operation succeeds, `true` is returned, otherwise `false`.
+	[[nodiscard]] bool write_watch_protect(WriteWatch* watch, void* ptr, u64 bytes) noexcept;
+
+	// Lifts the protection from all of `watch`'s memory, leaving
+	// `watch->dirty_bitmap` untouched.
+	// In case the operation succeeds, `true` is returned, otherwise `false`.
+	[[nodiscard]] bool write_watch_unprotect(WriteWatch* watch) noexcept;
+
 	// Blocks the calling thread until `bytes` bytes starting at `*address`
 	// are different from those starting at `*undesired` and a call to
 	// `minos::address_wake_single` or `minos:.address_wake_all` occurs.
@@ -317,6 +391,13 @@ namespace minos
 	// thrashing in the OS scheduler.
 	[[nodiscard]] u32 logical_processor_count() noexcept;
 
+	// Retrieves the memory reserved for the calling thread's stack, from its
+	// lowest address to one past its highest one. As stacks grow downwards on
+	// all supported platforms, the portion currently in use extends from the
+	// stack pointer to `out->end()`.
+	// In case the operation succeeds, `true` is returned, otherwise `false`.
+	[[nodiscard]] bool thread_stack_bounds(MutRange<byte>* out) noexcept;
+
 	// Creates a new OS thread running `proc`, with `param` as its argument.
 	// In case the thread is successfully created, `true` is returned, `false` otherwise
 	// If `thread_name` is non-empty (`thread_name.count() != 0`), the thread's
@@ -402,6 +483,12 @@ namespace minos
 
 	[[nodiscard]] FileHandle standard_file_handle(StdFileName name) noexcept;
 
+	// Makes `handle` the process's standard file `name`, so that subsequent
+	// calls to `minos::standard_file_handle(name)` as well as any output
+	// written to it by other means refer to the file underlying `handle`.
+	// `handle` itself remains open and must still be closed separately.
+	[[nodiscard]] bool standard_file_handle_redirect(StdFileName name, FileHandle handle) noexcept;
+
 	[[nodiscard]] bool file_read(FileHandle handle, MutRange<byte>, u64 offset, u32* out_bytes_read) noexcept;
 
 	[[nodiscard]] bool file_read_async(FileHandle handle, MutRange<byte> buffer, Overlapped* overlapped) noexcept;
@@ -416,6 +503,19 @@ namespace minos
 
 	[[nodiscard]] bool file_resize(FileHandle handle, u64 new_bytes) noexcept;
 
+	// Maps the first `bytes` bytes of the file referred to by `handle`, which
+	// must have been opened with `Access::Read`, into memory for reading.
+	// `bytes` must be nonzero and must not exceed the file's size. Bytes
+	// between the end of the file and the end of the page containing its last
+	// byte read as zero.
+	// On success, the mapping's address is returned and must be freed by
+	// calling `minos::file_unmap`. On failure, `nullptr` is returned.
+	[[nodiscard]] const void* file_map_readonly(FileHandle handle, u64 bytes) noexcept;
+
+	// Unmaps a mapping created by `minos::file_map_readonly`. `bytes` must be
+	// the same as that passed to the call that created the mapping.
+	void file_unmap(const void* address, u64 bytes) noexcept;
+
 	[[nodiscard]] bool event_create(EventHandle* out) noexcept;
 
 	void event_close(EventHandle handle) noexcept;
@@ -442,6 +542,51 @@ namespace minos
 
 	[[nodiscard]] bool process_wait_timeout(ProcessHandle handle, u32 milliseconds, Maybe<u32*> opt_out_result) noexcept;
 
+	// Creates a copy-on-write duplicate of the calling process that continues
+	// execution by returning from this call, with `*out_is_child` set to
+	// `true`. In the calling process, `*out_is_child` is set to `false`.
+	// Only the calling thread is duplicated, so the child must not rely on
+	// any other threads or on locks they might have held.
+	// The child is detached from the caller, meaning that it is cleaned up by
+	// the OS once it exits and can not be waited on.
+	// This is not supported on Windows, where `false` is always returned.
+	[[nodiscard]] bool process_fork_detached(bool* out_is_child) noexcept;
+
+	// Creates a stream socket that is bound to the filesystem path `path` and
+	// listens for connections on it. If a file already exists at `path`, it
+	// is replaced, as it is assumed to be left over from a previous listener.
+	// Connections are accepted via `minos::local_socket_accept`.
+	// This is not supported on Windows, where `false` is always returned.
+	[[nodiscard]] bool local_socket_listen(Range<char8> path, SocketHandle* out) noexcept;
+
+	// Blocks until a client connects to `listener`, which must have been
+	// created by `minos::local_socket_listen`, and returns a handle to the
+	// connection.
+	[[nodiscard]] bool local_socket_accept(SocketHandle listener, SocketHandle* out) noexcept;
+
+	// Connects to the listener bound to `path`. If there is no such listener,
+	// `false` is returned.
+	// This is not supported on Windows, where `false` is always returned.
+	[[nodiscard]] bool local_socket_connect(Range<char8> path, SocketHandle* out) noexcept;
+
+	// Closes a handle obtained from `minos::local_socket_listen`,
+	// `minos::local_socket_accept` or `minos::local_socket_connect`.
+	void local_socket_close(SocketHandle handle) noexcept;
+
+	// Sends all of `data` over the connection `handle`, along with duplicates
+	// of the files referred to by `handles`, which are received by the peer's
+	// corresponding call to `minos::local_socket_receive`.
+	[[nodiscard]] bool local_socket_send(SocketHandle handle, Range<byte> data, Range<FileHandle> handles) noexcept;
+
+	// Receives exactly `buffer.count()` bytes from the connection `handle`
+	// into `buffer`. Up to `out_handles.count()` file handles sent along with
+	// the data are stored in `out_handles`, and their number is stored in
+	// `*out_handle_count`. The received handles must be freed by calls to
+	// `minos::file_close`.
+	// If the peer closes the connection before all of `buffer` has been
+	// filled, `false` is returned.
+	[[nodiscard]] bool local_socket_receive(SocketHandle handle, MutRange<byte> buffer, MutRange<FileHandle> out_handles, u32* out_handle_count) noexcept;
+
 	[[nodiscard]] bool shm_create(Access access, u64 bytes, ShmHandle* out) noexcept;
 
 	void shm_close(ShmHandle handle) noexcept;
@@ -474,12 +619,22 @@ namespace minos
 
 	[[nodiscard]] bool path_remove_directory(Range<char8> path) noexcept;
 
+	// Atomically moves the file at `old_path` to `new_path`, replacing any
+	// file already present at `new_path`. Both paths must reside on the same
+	// volume.
+	[[nodiscard]] bool path_rename(Range<char8> old_path, Range<char8> new_path) noexcept;
+
 	[[nodiscard]] bool path_is_directory(Range<char8> path) noexcept;
 
 	[[nodiscard]] bool path_is_file(Range<char8> path) noexcept;
 
 	[[nodiscard]] u32 working_directory(MutRange<char8> out_buf) noexcept;
 
+	// Retrieves the absolute path of the executable the calling process was
+	// started from. This follows the conventions of
+	// `minos::working_directory`.
+	[[nodiscard]] u32 executable_path(MutRange<char8> out_buf) noexcept;
+
 	[[nodiscard]] u32 path_to_absolute(Range<char8> path, MutRange<char8> out_buf) noexcept;
 
 	[[nodiscard]] u32 path_to_absolute_relative_to(Range<char8> path, Range<char8> base, MutRange<char8> out_buf) noexcept;
@@ -496,6 +651,10 @@ namespace minos
 
 	[[nodiscard]] u64 exact_timestamp_ticks_per_second() noexcept;
 
+	[[nodiscard]] u64 exact_thread_cpu_time() noexcept;
+
+	[[nodiscard]] u64 exact_thread_cpu_time_ticks_per_second() noexcept;
+
 	[[nodiscard]] bool has_debugger_attached() noexcept;
 
 	[[nodiscard]] bool dynamic_library_create(Range<char8> library_path, LibraryHandle* out) noexcept;
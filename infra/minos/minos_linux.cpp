@@ -34,6 +34,9 @@
 #include <signal.h>
 #include <dirent.h>
 #include <dlfcn.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 
 
@@ -783,6 +786,29 @@ void* minos::mem_reserve(u64 bytes) noexcept
 	return ptr == MAP_FAILED ? nullptr : ptr;
 }
 
+void* minos::mem_reserve_at(void* address, u64 bytes) noexcept
+{
+	ASSERT_OR_IGNORE((reinterpret_cast<u64>(address) & (page_bytes() - 1)) == 0);
+
+	void* const ptr = mmap(address, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+	if (ptr == MAP_FAILED)
+		return nullptr;
+
+	// Kernels predating `MAP_FIXED_NOREPLACE` treat it as a mere hint, and may
+	// thus place the mapping elsewhere.
+	if (ptr != address)
+	{
+		munmap(ptr, bytes);
+
+		errno = EEXIST;
+
+		return nullptr;
+	}
+
+	return ptr;
+}
+
 bool minos::mem_commit(void* ptr, u64 bytes) noexcept
 {
 	const u64 page_mask = ~static_cast<u64>(page_bytes() - 1);
@@ -800,6 +826,163 @@ void minos::mem_unreserve(void* ptr, u64 bytes) noexcept
 		panic("munmap failed (0x%[|X] - %)\n", last_error(), strerror(last_error()));
 }
 
+static bool parse_maps_hex(const char8** inout_curr, const char8* end, char8 terminator, u64* out) noexcept
+{
+	const char8* curr = *inout_curr;
+
+	u64 value = 0;
+
+	while (curr != end && *curr != terminator)
+	{
+		const char8 c = *curr;
+
+		u8 digit;
+
+		if (c >= '0' && c <= '9')
+			digit = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else
+			return false;
+
+		value = (value << 4) | digit;
+
+		curr += 1;
+	}
+
+	if (curr == end)
+		return false;
+
+	*inout_curr = curr + 1;
+
+	*out = value;
+
+	return true;
+}
+
+bool minos::mem_query_committed(void* ptr, u64 bytes, MutRange<MutRange<byte>> out_ranges, u32* out_count) noexcept
+{
+	// Committed memory is exactly the memory that `mem_commit` made readable,
+	// which shows up as separate mappings in `/proc/self/maps`.
+
+	const s32 fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+
+	if (fd == -1)
+		return false;
+
+	u64 buffer_bytes = 1 << 16;
+
+	char8* buffer = static_cast<char8*>(malloc(buffer_bytes));
+
+	u64 used = 0;
+
+	while (buffer != nullptr)
+	{
+		if (used == buffer_bytes)
+		{
+			buffer_bytes *= 2;
+
+			char8* const grown_buffer = static_cast<char8*>(realloc(buffer, buffer_bytes));
+
+			if (grown_buffer == nullptr)
+				free(buffer);
+
+			buffer = grown_buffer;
+
+			continue;
+		}
+
+		const ssize_t result = read(fd, buffer + used, buffer_bytes - used);
+
+		if (result == -1 && errno == EINTR)
+			continue;
+
+		if (result <= 0)
+		{
+			if (result == -1)
+			{
+				free(buffer);
+
+				buffer = nullptr;
+			}
+
+			break;
+		}
+
+		used += static_cast<u64>(result);
+	}
+
+	close(fd);
+
+	if (buffer == nullptr)
+		return false;
+
+	const u64 query_begin = reinterpret_cast<u64>(ptr);
+
+	const u64 query_end = query_begin + bytes;
+
+	const char8* curr = buffer;
+
+	const char8* const end = buffer + used;
+
+	u32 count = 0;
+
+	bool is_ok = true;
+
+	while (curr != end)
+	{
+		u64 begin;
+
+		u64 map_end;
+
+		if (!parse_maps_hex(&curr, end, '-', &begin) || !parse_maps_hex(&curr, end, ' ', &map_end) || end - curr < 2)
+		{
+			is_ok = false;
+
+			break;
+		}
+
+		const bool is_committed = curr[0] == 'r' && curr[1] == 'w';
+
+		const char8* const line_end = static_cast<const char8*>(memchr(curr, '\n', end - curr));
+
+		curr = line_end == nullptr ? end : line_end + 1;
+
+		if (!is_committed || map_end <= query_begin || begin >= query_end)
+			continue;
+
+		if (begin < query_begin)
+			begin = query_begin;
+
+		if (map_end > query_end)
+			map_end = query_end;
+
+		if (count != 0 && out_ranges[count - 1].end() == reinterpret_cast<byte*>(begin))
+		{
+			out_ranges[count - 1] = MutRange{ out_ranges[count - 1].begin(), reinterpret_cast<byte*>(map_end) };
+
+			continue;
+		}
+
+		if (count == out_ranges.count())
+		{
+			is_ok = false;
+
+			break;
+		}
+
+		out_ranges[count] = MutRange{ reinterpret_cast<byte*>(begin), reinterpret_cast<byte*>(map_end) };
+
+		count += 1;
+	}
+
+	free(buffer);
+
+	*out_count = count;
+
+	return is_ok;
+}
+
 void minos::mem_decommit(void* ptr, u64 bytes) noexcept
 {
 	ASSERT_OR_IGNORE((reinterpret_cast<u64>(ptr) & (page_bytes() - 1)) == 0);
@@ -815,6 +998,190 @@ u32 minos::page_bytes() noexcept
 	return static_cast<u32>(getpagesize());
 }
 
+static constexpr u32 MINOS_WRITE_WATCH_MAX_COUNT = 64;
+
+struct MinosGlobalWriteWatches
+{
+	std::atomic<minos::WriteWatch*> watches[MINOS_WRITE_WATCH_MAX_COUNT];
+
+	// `0` if the `SIGSEGV` handler has not been installed yet, `1` while it
+	// is being installed, and `2` once it has been.
+	std::atomic<u32> handler_state;
+
+	struct sigaction previous_action;
+};
+
+MinosGlobalWriteWatches g_write_watches;
+
+// Makes all of `watch`'s protected memory writable and marks it as dirty.
+// This is the fallback for when the protection cannot be lifted from a single
+// granule, which happens once splitting the underlying mapping would exceed
+// the kernel's limit on the number of mappings. Unprotecting everything
+// merges these mappings again.
+static bool write_watch_dirty_all(minos::WriteWatch* watch) noexcept
+{
+	if (mprotect(watch->begin, watch->protected_bytes, PROT_READ | PROT_WRITE) != 0)
+		return false;
+
+	const u64 granule_count = watch->protected_bytes / watch->granule_bytes;
+
+	for (u64 i = 0; i != granule_count; ++i)
+		__atomic_fetch_or(watch->dirty_bitmap + (i >> 6), static_cast<u64>(1) << (i & 63), __ATOMIC_RELAXED);
+
+	watch->protected_bytes = 0;
+
+	return true;
+}
+
+static bool write_watch_handle_fault(byte* address) noexcept
+{
+	for (std::atomic<minos::WriteWatch*>& slot : g_write_watches.watches)
+	{
+		minos::WriteWatch* const watch = slot.load(std::memory_order_acquire);
+
+		// Protected memory is always committed, so any access violation in it
+		// must be a write to a protected granule.
+		if (watch == nullptr || address < watch->begin || address >= watch->begin + watch->protected_bytes)
+			continue;
+
+		const u64 granule = static_cast<u64>(address - watch->begin) / watch->granule_bytes;
+
+		if (mprotect(watch->begin + granule * watch->granule_bytes, watch->granule_bytes, PROT_READ | PROT_WRITE) != 0)
+			return write_watch_dirty_all(watch);
+
+		__atomic_fetch_or(watch->dirty_bitmap + (granule >> 6), static_cast<u64>(1) << (granule & 63), __ATOMIC_RELAXED);
+
+		return true;
+	}
+
+	return false;
+}
+
+static void write_watch_signal_handler(s32 signal_number, siginfo_t* info, void* context) noexcept
+{
+	if (write_watch_handle_fault(static_cast<byte*>(info->si_addr)))
+		return;
+
+	const struct sigaction* const previous = &g_write_watches.previous_action;
+
+	if ((previous->sa_flags & SA_SIGINFO) != 0)
+	{
+		previous->sa_sigaction(signal_number, info, context);
+	}
+	else if (previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN)
+	{
+		previous->sa_handler(signal_number);
+	}
+	else
+	{
+		// Restore the default disposition, so that the faulting instruction
+		// terminates the process as usual once it is retried.
+		signal(signal_number, SIG_DFL);
+	}
+}
+
+static bool write_watch_install_handler() noexcept
+{
+	u32 state = 0;
+
+	if (g_write_watches.handler_state.compare_exchange_strong(state, 1, std::memory_order_acquire))
+	{
+		struct sigaction action{};
+		action.sa_sigaction = write_watch_signal_handler;
+		action.sa_flags = SA_SIGINFO | SA_RESTART;
+		sigemptyset(&action.sa_mask);
+
+		if (sigaction(SIGSEGV, &action, &g_write_watches.previous_action) != 0)
+		{
+			g_write_watches.handler_state.store(0, std::memory_order_release);
+
+			return false;
+		}
+
+		g_write_watches.handler_state.store(2, std::memory_order_release);
+
+		return true;
+	}
+
+	while (state == 1)
+	{
+		minos::thread_yield();
+
+		state = g_write_watches.handler_state.load(std::memory_order_acquire);
+	}
+
+	return state == 2;
+}
+
+bool minos::write_watch_register(WriteWatch* watch) noexcept
+{
+	ASSERT_OR_IGNORE((reinterpret_cast<u64>(watch->begin) & (page_bytes() - 1)) == 0);
+
+	ASSERT_OR_IGNORE(watch->granule_bytes != 0 && (watch->granule_bytes & (page_bytes() - 1)) == 0);
+
+	ASSERT_OR_IGNORE(watch->protected_bytes == 0);
+
+	if (!write_watch_install_handler())
+		return false;
+
+	for (std::atomic<WriteWatch*>& slot : g_write_watches.watches)
+	{
+		WriteWatch* expected = nullptr;
+
+		if (slot.compare_exchange_strong(expected, watch, std::memory_order_release))
+			return true;
+	}
+
+	errno = ENOSPC;
+
+	return false;
+}
+
+void minos::write_watch_unregister(WriteWatch* watch) noexcept
+{
+	for (std::atomic<WriteWatch*>& slot : g_write_watches.watches)
+	{
+		WriteWatch* expected = watch;
+
+		if (slot.compare_exchange_strong(expected, nullptr, std::memory_order_release))
+			return;
+	}
+
+	ASSERT_UNREACHABLE;
+}
+
+bool minos::write_watch_protect(WriteWatch* watch, void* ptr, u64 bytes) noexcept
+{
+	const u64 offset = static_cast<byte*>(ptr) - watch->begin;
+
+	ASSERT_OR_IGNORE(offset % watch->granule_bytes == 0 && bytes % watch->granule_bytes == 0);
+
+	ASSERT_OR_IGNORE(offset + bytes <= watch->bytes);
+
+	if (bytes == 0)
+		return true;
+
+	// Extend the range in which faults are handled before protecting
+	// anything, so that no write can slip through in between.
+	if (offset + bytes > watch->protected_bytes)
+		watch->protected_bytes = offset + bytes;
+
+	return mprotect(ptr, bytes, PROT_READ) == 0;
+}
+
+bool minos::write_watch_unprotect(WriteWatch* watch) noexcept
+{
+	if (watch->protected_bytes == 0)
+		return true;
+
+	if (mprotect(watch->begin, watch->protected_bytes, PROT_READ | PROT_WRITE) != 0)
+		return false;
+
+	watch->protected_bytes = 0;
+
+	return true;
+}
+
 static s64 syscall_futex(const u32* address, s32 futex_op, u32 undesired_value_or_wakeup, const timespec* timeout) noexcept
 {
 	return syscall(SYS_futex, const_cast<u32*>(address), futex_op, undesired_value_or_wakeup, timeout, nullptr /* uaddr2 */, 0 /* val3 */);
@@ -958,6 +1325,29 @@ static void* trampoline_thread_proc(void* param) noexcept
 	return reinterpret_cast<void*>(data.proc(data.param));
 }
 
+bool minos::thread_stack_bounds(MutRange<byte>* out) noexcept
+{
+	pthread_attr_t attr;
+
+	if (pthread_getattr_np(pthread_self(), &attr) != 0)
+		return false;
+
+	void* stack_begin;
+
+	size_t stack_bytes;
+
+	const bool is_ok = pthread_attr_getstack(&attr, &stack_begin, &stack_bytes) == 0;
+
+	pthread_attr_destroy(&attr);
+
+	if (!is_ok)
+		return false;
+
+	*out = MutRange<byte>{ static_cast<byte*>(stack_begin), stack_bytes };
+
+	return true;
+}
+
 bool minos::thread_create(thread_proc proc, void* param, Range<char8> thread_name, Maybe<ThreadHandle*> opt_out) noexcept
 {
 	pthread_t thread;
@@ -992,10 +1382,14 @@ bool minos::thread_create(thread_proc proc, void* param, Range<char8> thread_nam
 
 		name_buf[name_chars] = '\0';
 
-		// Even though it seemingly isn't documented, ENOENT appears to mean
-		// that the thread has already exited.
-		if (pthread_setname_np(thread, name_buf) != 0 && errno != ENOENT)
-			panic("pthread_setname_np failed (0x%[|X] - %)\n", last_error(), strerror(last_error()));
+		// `pthread_setname_np` returns its error instead of setting `errno`.
+		// Even though it seemingly isn't documented, ENOENT and ESRCH appear
+		// to mean that the thread has already exited, which short-lived
+		// threads may well have done by now.
+		const s32 name_result = pthread_setname_np(thread, name_buf);
+
+		if (name_result != 0 && name_result != ENOENT && name_result != ESRCH)
+			panic("pthread_setname_np failed (0x%[|X] - %)\n", name_result, strerror(name_result));
 	}
 
 	return true;
@@ -1178,6 +1572,13 @@ minos::FileHandle minos::standard_file_handle(StdFileName name) noexcept
 	}
 }
 
+bool minos::standard_file_handle_redirect(StdFileName name, FileHandle handle) noexcept
+{
+	const s32 target_fd = static_cast<s32>(static_cast<u64>(standard_file_handle(name)));
+
+	return dup2(static_cast<s32>(static_cast<u64>(handle)), target_fd) == target_fd;
+}
+
 bool minos::file_read(FileHandle handle, MutRange<byte> buffer, u64 offset, u32* out_bytes_read) noexcept
 {
 	ASSERT_OR_IGNORE((static_cast<u64>(handle)) >> 32 == 0);
@@ -1277,6 +1678,24 @@ bool minos::file_resize(FileHandle handle, u64 new_bytes) noexcept
 	return ftruncate(static_cast<s32>(static_cast<u64>(handle)), new_bytes) == 0;
 }
 
+const void* minos::file_map_readonly(FileHandle handle, u64 bytes) noexcept
+{
+	ASSERT_OR_IGNORE(bytes != 0);
+
+	void* const address = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, static_cast<s32>(static_cast<u64>(handle)), 0);
+
+	if (address == MAP_FAILED)
+		return nullptr;
+
+	return address;
+}
+
+void minos::file_unmap(const void* address, u64 bytes) noexcept
+{
+	if (munmap(const_cast<void*>(address), bytes) != 0)
+		panic("munmap(file) failed (0x%[|X] - %)\n", last_error(), strerror(last_error()));
+}
+
 static s32 event_create_impl(bool is_semaphore, u32 initial_value) noexcept
 {
 	return eventfd(initial_value, EFD_CLOEXEC | EFD_NONBLOCK | (is_semaphore ? EFD_SEMAPHORE : 0));
@@ -1681,6 +2100,268 @@ bool minos::process_wait_timeout(ProcessHandle handle, u32 milliseconds, Maybe<u
 	return process_wait_impl(handle, &ts, opt_out_result);
 }
 
+bool minos::process_fork_detached(bool* out_is_child) noexcept
+{
+	// Fork twice, with the intermediate process exiting immediately. This
+	// reparents the actual child to init, which takes care of reaping it, so
+	// that the caller neither has to wait on it nor ignore `SIGCHLD`, which
+	// would interfere with `minos::process_wait`.
+
+	const pid_t intermediate_pid = fork();
+
+	if (intermediate_pid == -1)
+		return false;
+
+	if (intermediate_pid == 0)
+	{
+		const pid_t child_pid = fork();
+
+		if (child_pid != 0)
+			_exit(child_pid == -1 ? EXIT_FAILURE : EXIT_SUCCESS);
+
+		*out_is_child = true;
+
+		return true;
+	}
+
+	s32 intermediate_status;
+
+	while (waitpid(intermediate_pid, &intermediate_status, 0) == -1)
+	{
+		if (errno != EINTR)
+			panic("waitpid(intermediate fork) failed (0x%[|X] - %)\n", last_error(), strerror(last_error()));
+	}
+
+	*out_is_child = false;
+
+	return WIFEXITED(intermediate_status) && WEXITSTATUS(intermediate_status) == EXIT_SUCCESS;
+}
+
+static bool local_socket_address(Range<char8> path, sockaddr_un* out) noexcept
+{
+	if (path.count() >= sizeof(out->sun_path))
+	{
+		errno = ENAMETOOLONG;
+
+		return false;
+	}
+
+	memset(out, 0, sizeof(*out));
+
+	out->sun_family = AF_UNIX;
+
+	memcpy(out->sun_path, path.begin(), path.count());
+
+	return true;
+}
+
+bool minos::local_socket_listen(Range<char8> path, SocketHandle* out) noexcept
+{
+	sockaddr_un address;
+
+	if (!local_socket_address(path, &address))
+		return false;
+
+	const s32 fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd == -1)
+		return false;
+
+	if (unlink(address.sun_path) != 0 && errno != ENOENT)
+	{
+		close(fd);
+
+		return false;
+	}
+
+	if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+	{
+		close(fd);
+
+		return false;
+	}
+
+	*out = static_cast<SocketHandle>(fd);
+
+	return true;
+}
+
+bool minos::local_socket_accept(SocketHandle listener, SocketHandle* out) noexcept
+{
+	while (true)
+	{
+		const s32 fd = accept4(static_cast<s32>(static_cast<u64>(listener)), nullptr, nullptr, SOCK_CLOEXEC);
+
+		if (fd != -1)
+		{
+			*out = static_cast<SocketHandle>(fd);
+
+			return true;
+		}
+
+		if (errno != EINTR && errno != ECONNABORTED)
+			return false;
+	}
+}
+
+bool minos::local_socket_connect(Range<char8> path, SocketHandle* out) noexcept
+{
+	sockaddr_un address;
+
+	if (!local_socket_address(path, &address))
+		return false;
+
+	const s32 fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd == -1)
+		return false;
+
+	if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		close(fd);
+
+		return false;
+	}
+
+	*out = static_cast<SocketHandle>(fd);
+
+	return true;
+}
+
+void minos::local_socket_close(SocketHandle handle) noexcept
+{
+	if (close(static_cast<s32>(static_cast<u64>(handle))) != 0)
+		panic("close(socketfd) failed (0x%[|X] - %)\n", last_error(), strerror(last_error()));
+}
+
+static constexpr u32 LOCAL_SOCKET_MAX_HANDLES = 8;
+
+bool minos::local_socket_send(SocketHandle handle, Range<byte> data, Range<FileHandle> handles) noexcept
+{
+	ASSERT_OR_IGNORE(data.count() != 0 && handles.count() <= LOCAL_SOCKET_MAX_HANDLES);
+
+	alignas(cmsghdr) byte control[CMSG_SPACE(LOCAL_SOCKET_MAX_HANDLES * sizeof(s32))];
+
+	u64 sent = 0;
+
+	while (sent != data.count())
+	{
+		iovec iov;
+		iov.iov_base = const_cast<byte*>(data.begin() + sent);
+		iov.iov_len = data.count() - sent;
+
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+
+		// Handles are only attached to the first chunk, so that they are
+		// delivered exactly once.
+		if (sent == 0 && handles.count() != 0)
+		{
+			msg.msg_control = control;
+			msg.msg_controllen = CMSG_SPACE(handles.count() * sizeof(s32));
+
+			cmsghdr* const cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_RIGHTS;
+			cmsg->cmsg_len = CMSG_LEN(handles.count() * sizeof(s32));
+
+			for (u64 i = 0; i != handles.count(); ++i)
+			{
+				const s32 fd = static_cast<s32>(static_cast<u64>(handles[i]));
+
+				memcpy(CMSG_DATA(cmsg) + i * sizeof(s32), &fd, sizeof(s32));
+			}
+		}
+
+		const ssize_t result = sendmsg(static_cast<s32>(static_cast<u64>(handle)), &msg, MSG_NOSIGNAL);
+
+		if (result == -1)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return false;
+		}
+
+		sent += static_cast<u64>(result);
+	}
+
+	return true;
+}
+
+bool minos::local_socket_receive(SocketHandle handle, MutRange<byte> buffer, MutRange<FileHandle> out_handles, u32* out_handle_count) noexcept
+{
+	ASSERT_OR_IGNORE(buffer.count() != 0);
+
+	alignas(cmsghdr) byte control[CMSG_SPACE(LOCAL_SOCKET_MAX_HANDLES * sizeof(s32))];
+
+	u32 handle_count = 0;
+
+	u64 received = 0;
+
+	bool is_ok = true;
+
+	while (received != buffer.count())
+	{
+		iovec iov;
+		iov.iov_base = buffer.begin() + received;
+		iov.iov_len = buffer.count() - received;
+
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		const ssize_t result = recvmsg(static_cast<s32>(static_cast<u64>(handle)), &msg, MSG_CMSG_CLOEXEC);
+
+		if (result == -1 && errno == EINTR)
+			continue;
+
+		if (result <= 0)
+		{
+			is_ok = false;
+
+			break;
+		}
+
+		for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+				continue;
+
+			const u64 fd_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(s32);
+
+			for (u64 i = 0; i != fd_count; ++i)
+			{
+				s32 fd;
+
+				memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(s32), sizeof(s32));
+
+				// Surplus handles are closed right away, as the caller has no
+				// way of knowing about them.
+				if (handle_count < out_handles.count())
+				{
+					out_handles[handle_count] = static_cast<FileHandle>(fd);
+
+					handle_count += 1;
+				}
+				else
+				{
+					close(fd);
+				}
+			}
+		}
+
+		received += static_cast<u64>(result);
+	}
+
+	*out_handle_count = handle_count;
+
+	return is_ok;
+}
+
 bool minos::shm_create([[maybe_unused]] Access access, u64 bytes, ShmHandle* out) noexcept
 {
 	const s32 fd = memfd_create("minos_memfd", MFD_CLOEXEC);
@@ -1947,6 +2628,30 @@ bool minos::path_remove_directory(Range<char8> path) noexcept
 	return rmdir(terminated_path) == 0;
 }
 
+bool minos::path_rename(Range<char8> old_path, Range<char8> new_path) noexcept
+{
+	char8 terminated_old_path[PATH_MAX + 1];
+
+	char8 terminated_new_path[PATH_MAX + 1];
+
+	if (old_path.count() > array_count(terminated_old_path) - 1 || new_path.count() > array_count(terminated_new_path) - 1)
+	{
+		errno = ENAMETOOLONG;
+
+		return false;
+	}
+
+	memcpy(terminated_old_path, old_path.begin(), old_path.count());
+
+	terminated_old_path[old_path.count()] = '\0';
+
+	memcpy(terminated_new_path, new_path.begin(), new_path.count());
+
+	terminated_new_path[new_path.count()] = '\0';
+
+	return rename(terminated_old_path, terminated_new_path) == 0;
+}
+
 bool minos::path_is_directory(Range<char8> path) noexcept
 {
 	char8 terminated_path[PATH_MAX + 1];
@@ -2101,6 +2806,21 @@ static u32 append_relative_path(Range<char8> path, MutRange<char8> out_buf, u64
 	return out_index;
 }
 
+u32 minos::executable_path(MutRange<char8> out_buf) noexcept
+{
+	char8 buf[PATH_MAX + 1];
+
+	const ssize_t chars = readlink("/proc/self/exe", buf, sizeof(buf));
+
+	if (chars <= 0 || chars == sizeof(buf))
+		return 0;
+
+	if (static_cast<u64>(chars) <= out_buf.count())
+		memcpy(out_buf.begin(), buf, chars);
+
+	return static_cast<u32>(chars);
+}
+
 u32 minos::path_to_absolute(Range<char8> path, MutRange<char8> out_buf) noexcept
 {
 	if (path.count() > 0 && path[0] == '/')
@@ -2201,6 +2921,21 @@ u64 minos::exact_timestamp_ticks_per_second() noexcept
 	return static_cast<u64>(1'000'000'000);
 }
 
+u64 minos::exact_thread_cpu_time() noexcept
+{
+	timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		panic("clock_gettime failed (0x%[|X] - %)\n", last_error(), strerror(last_error()));
+
+	return static_cast<u64>(ts.tv_nsec) + static_cast<u64>(ts.tv_sec) * static_cast<u64>(1'000'000'000);
+}
+
+u64 minos::exact_thread_cpu_time_ticks_per_second() noexcept
+{
+	return static_cast<u64>(1'000'000'000);
+}
+
 bool minos::has_debugger_attached() noexcept
 {
 	// This is really just a quick-and-dirty check. For instance, we only check
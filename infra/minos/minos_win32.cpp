@@ -193,11 +193,60 @@ void* minos::mem_reserve(u64 bytes) noexcept
 	return VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_READWRITE);
 }
 
+void* minos::mem_reserve_at(void* address, u64 bytes) noexcept
+{
+	return VirtualAlloc(address, bytes, MEM_RESERVE, PAGE_READWRITE);
+}
+
 bool minos::mem_commit(void* ptr, u64 bytes) noexcept
 {
 	return VirtualAlloc(ptr, bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
 }
 
+bool minos::mem_query_committed(void* ptr, u64 bytes, MutRange<MutRange<byte>> out_ranges, u32* out_count) noexcept
+{
+	byte* curr = static_cast<byte*>(ptr);
+
+	byte* const end = curr + bytes;
+
+	u32 count = 0;
+
+	while (curr < end)
+	{
+		MEMORY_BASIC_INFORMATION info;
+
+		if (VirtualQuery(curr, &info, sizeof(info)) == 0)
+			return false;
+
+		byte* const region_end = static_cast<byte*>(info.BaseAddress) + info.RegionSize < end
+			? static_cast<byte*>(info.BaseAddress) + info.RegionSize
+			: end;
+
+		if (info.State == MEM_COMMIT)
+		{
+			if (count != 0 && out_ranges[count - 1].end() == curr)
+			{
+				out_ranges[count - 1] = MutRange{ out_ranges[count - 1].begin(), region_end };
+			}
+			else
+			{
+				if (count == out_ranges.count())
+					return false;
+
+				out_ranges[count] = MutRange{ curr, region_end };
+
+				count += 1;
+			}
+		}
+
+		curr = region_end;
+	}
+
+	*out_count = count;
+
+	return true;
+}
+
 void minos::mem_unreserve(void* ptr, [[maybe_unused]] u64 bytes) noexcept
 {
 	if (VirtualFree(ptr, 0, MEM_RELEASE) == 0)
@@ -223,6 +272,155 @@ u32 minos::page_bytes() noexcept
 	return sysinfo.dwPageSize;
 }
 
+static constexpr u32 MINOS_WRITE_WATCH_MAX_COUNT = 64;
+
+struct MinosGlobalWriteWatches
+{
+	std::atomic<minos::WriteWatch*> watches[MINOS_WRITE_WATCH_MAX_COUNT];
+
+	std::atomic<PVOID> handler;
+};
+
+MinosGlobalWriteWatches g_write_watches;
+
+// Makes all of `watch`'s protected memory writable and marks it as dirty.
+// This is the fallback for when the protection cannot be lifted from a single
+// granule.
+static bool write_watch_dirty_all(minos::WriteWatch* watch) noexcept
+{
+	DWORD old_protect;
+
+	if (!VirtualProtect(watch->begin, watch->protected_bytes, PAGE_READWRITE, &old_protect))
+		return false;
+
+	const u64 granule_count = watch->protected_bytes / watch->granule_bytes;
+
+	for (u64 i = 0; i != granule_count; ++i)
+		InterlockedOr64(reinterpret_cast<LONG64*>(watch->dirty_bitmap + (i >> 6)), static_cast<LONG64>(static_cast<u64>(1) << (i & 63)));
+
+	watch->protected_bytes = 0;
+
+	return true;
+}
+
+static LONG CALLBACK write_watch_exception_handler(EXCEPTION_POINTERS* exception) noexcept
+{
+	const EXCEPTION_RECORD* const record = exception->ExceptionRecord;
+
+	// The first parameter of an access violation is `1` for writes.
+	if (record->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || record->NumberParameters < 2 || record->ExceptionInformation[0] != 1)
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	byte* const address = reinterpret_cast<byte*>(record->ExceptionInformation[1]);
+
+	for (std::atomic<minos::WriteWatch*>& slot : g_write_watches.watches)
+	{
+		minos::WriteWatch* const watch = slot.load(std::memory_order_acquire);
+
+		// Protected memory is always committed, so any write violation in it
+		// must be a write to a protected granule.
+		if (watch == nullptr || address < watch->begin || address >= watch->begin + watch->protected_bytes)
+			continue;
+
+		const u64 granule = static_cast<u64>(address - watch->begin) / watch->granule_bytes;
+
+		DWORD old_protect;
+
+		if (!VirtualProtect(watch->begin + granule * watch->granule_bytes, watch->granule_bytes, PAGE_READWRITE, &old_protect))
+			return write_watch_dirty_all(watch) ? EXCEPTION_CONTINUE_EXECUTION : EXCEPTION_CONTINUE_SEARCH;
+
+		InterlockedOr64(reinterpret_cast<LONG64*>(watch->dirty_bitmap + (granule >> 6)), static_cast<LONG64>(static_cast<u64>(1) << (granule & 63)));
+
+		return EXCEPTION_CONTINUE_EXECUTION;
+	}
+
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
+bool minos::write_watch_register(WriteWatch* watch) noexcept
+{
+	ASSERT_OR_IGNORE((reinterpret_cast<u64>(watch->begin) & (page_bytes() - 1)) == 0);
+
+	ASSERT_OR_IGNORE(watch->granule_bytes != 0 && (watch->granule_bytes & (page_bytes() - 1)) == 0);
+
+	ASSERT_OR_IGNORE(watch->protected_bytes == 0);
+
+	if (g_write_watches.handler.load(std::memory_order_acquire) == nullptr)
+	{
+		const PVOID handler = AddVectoredExceptionHandler(1, write_watch_exception_handler);
+
+		if (handler == nullptr)
+			return false;
+
+		PVOID expected = nullptr;
+
+		// Another thread might have raced us to installing the handler.
+		if (!g_write_watches.handler.compare_exchange_strong(expected, handler, std::memory_order_acq_rel))
+			RemoveVectoredExceptionHandler(handler);
+	}
+
+	for (std::atomic<WriteWatch*>& slot : g_write_watches.watches)
+	{
+		WriteWatch* expected = nullptr;
+
+		if (slot.compare_exchange_strong(expected, watch, std::memory_order_release))
+			return true;
+	}
+
+	SetLastError(ERROR_TOO_MANY_NAMES);
+
+	return false;
+}
+
+void minos::write_watch_unregister(WriteWatch* watch) noexcept
+{
+	for (std::atomic<WriteWatch*>& slot : g_write_watches.watches)
+	{
+		WriteWatch* expected = watch;
+
+		if (slot.compare_exchange_strong(expected, nullptr, std::memory_order_release))
+			return;
+	}
+
+	ASSERT_UNREACHABLE;
+}
+
+bool minos::write_watch_protect(WriteWatch* watch, void* ptr, u64 bytes) noexcept
+{
+	const u64 offset = static_cast<byte*>(ptr) - watch->begin;
+
+	ASSERT_OR_IGNORE(offset % watch->granule_bytes == 0 && bytes % watch->granule_bytes == 0);
+
+	ASSERT_OR_IGNORE(offset + bytes <= watch->bytes);
+
+	if (bytes == 0)
+		return true;
+
+	// Extend the range in which faults are handled before protecting
+	// anything, so that no write can slip through in between.
+	if (offset + bytes > watch->protected_bytes)
+		watch->protected_bytes = offset + bytes;
+
+	DWORD old_protect;
+
+	return VirtualProtect(ptr, bytes, PAGE_READONLY, &old_protect);
+}
+
+bool minos::write_watch_unprotect(WriteWatch* watch) noexcept
+{
+	if (watch->protected_bytes == 0)
+		return true;
+
+	DWORD old_protect;
+
+	if (!VirtualProtect(watch->begin, watch->protected_bytes, PAGE_READWRITE, &old_protect))
+		return false;
+
+	watch->protected_bytes = 0;
+
+	return true;
+}
+
 void minos::address_wait(const void* address, const void* undesired, u32 bytes) noexcept
 {
 	ASSERT_OR_IGNORE(bytes == 1 || bytes == 2 || bytes == 4);
@@ -271,6 +469,19 @@ u32 minos::logical_processor_count() noexcept
 	return si.dwNumberOfProcessors;
 }
 
+bool minos::thread_stack_bounds(MutRange<byte>* out) noexcept
+{
+	ULONG_PTR stack_begin;
+
+	ULONG_PTR stack_end;
+
+	GetCurrentThreadStackLimits(&stack_begin, &stack_end);
+
+	*out = MutRange<byte>{ reinterpret_cast<byte*>(stack_begin), reinterpret_cast<byte*>(stack_end) };
+
+	return true;
+}
+
 bool minos::thread_create(thread_proc proc, void* param, Range<char8> thread_name, Maybe<ThreadHandle*> opt_out) noexcept
 {
 	static constexpr u32 MAX_THREAD_NAME_CHARS = 255;
@@ -490,6 +701,31 @@ minos::FileHandle minos::standard_file_handle(StdFileName name) noexcept
 	return native_as<FileHandle>(handle);
 }
 
+bool minos::standard_file_handle_redirect(StdFileName name, FileHandle handle) noexcept
+{
+	DWORD native_name;
+
+	switch (name)
+	{
+	case StdFileName::StdIn:
+		native_name = STD_INPUT_HANDLE;
+		break;
+
+	case StdFileName::StdOut:
+		native_name = STD_OUTPUT_HANDLE;
+		break;
+
+	case StdFileName::StdErr:
+		native_name = STD_ERROR_HANDLE;
+		break;
+
+	default:
+		ASSERT_UNREACHABLE;
+	}
+
+	return SetStdHandle(native_name, as_native_handle(handle));
+}
+
 bool minos::file_read(FileHandle handle, MutRange<byte> buffer, u64 offset, u32* out_bytes_read) noexcept
 {
 	DWORD bytes_read;
@@ -607,6 +843,31 @@ bool minos::file_resize(FileHandle handle, u64 new_bytes) noexcept
 	return SetEndOfFile(as_native_handle(handle));
 }
 
+const void* minos::file_map_readonly(FileHandle handle, u64 bytes) noexcept
+{
+	ASSERT_OR_IGNORE(bytes != 0);
+
+	const HANDLE mapping = CreateFileMappingW(as_native_handle(handle), nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mapping == nullptr)
+		return nullptr;
+
+	const void* const address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, bytes);
+
+	// The view keeps the mapping object alive, so there is no need to hold on
+	// to its handle.
+	if (!CloseHandle(mapping))
+		panic("CloseHandle(file mapping) failed (0x%[|X])\n", last_error());
+
+	return address;
+}
+
+void minos::file_unmap(const void* address, [[maybe_unused]] u64 bytes) noexcept
+{
+	if (!UnmapViewOfFile(address))
+		panic("UnmapViewOfFile(file) failed (0x%[|X])\n", last_error());
+}
+
 bool minos::event_create(EventHandle* out) noexcept
 {
 	SECURITY_ATTRIBUTES security_attributes{ sizeof(SECURITY_ATTRIBUTES), nullptr, true };
@@ -982,6 +1243,50 @@ bool minos::process_wait_timeout(ProcessHandle handle, u32 milliseconds, Maybe<u
 	panic("WaitForSingleObject(ProcessHandle, timeout) failed with 0x%[|X] (0x%[|X])\n", wait_result, last_error());
 }
 
+bool minos::process_fork_detached([[maybe_unused]] bool* out_is_child) noexcept
+{
+	SetLastError(ERROR_NOT_SUPPORTED);
+
+	return false;
+}
+
+// Local sockets are only used to talk to forked compilation servers, which
+// Windows has no equivalent of. They are hence not supported either.
+
+bool minos::local_socket_listen([[maybe_unused]] Range<char8> path, [[maybe_unused]] SocketHandle* out) noexcept
+{
+	SetLastError(ERROR_NOT_SUPPORTED);
+
+	return false;
+}
+
+bool minos::local_socket_accept([[maybe_unused]] SocketHandle listener, [[maybe_unused]] SocketHandle* out) noexcept
+{
+	ASSERT_UNREACHABLE;
+}
+
+bool minos::local_socket_connect([[maybe_unused]] Range<char8> path, [[maybe_unused]] SocketHandle* out) noexcept
+{
+	SetLastError(ERROR_NOT_SUPPORTED);
+
+	return false;
+}
+
+void minos::local_socket_close([[maybe_unused]] SocketHandle handle) noexcept
+{
+	ASSERT_UNREACHABLE;
+}
+
+bool minos::local_socket_send([[maybe_unused]] SocketHandle handle, [[maybe_unused]] Range<byte> data, [[maybe_unused]] Range<FileHandle> handles) noexcept
+{
+	ASSERT_UNREACHABLE;
+}
+
+bool minos::local_socket_receive([[maybe_unused]] SocketHandle handle, [[maybe_unused]] MutRange<byte> buffer, [[maybe_unused]] MutRange<FileHandle> out_handles, [[maybe_unused]] u32* out_handle_count) noexcept
+{
+	ASSERT_UNREACHABLE;
+}
+
 bool minos::shm_create(Access access, u64 bytes, ShmHandle* out) noexcept
 {
 	u32 native_access = 0;
@@ -1266,6 +1571,21 @@ bool minos::path_remove_directory(Range<char8> path) noexcept
 	return RemoveDirectoryW(path_utf16);
 }
 
+bool minos::path_rename(Range<char8> old_path, Range<char8> new_path) noexcept
+{
+	char16 old_path_utf16[MAX_PATH_CHARS + 1];
+
+	if (!map_path(old_path, MutRange{ old_path_utf16 }))
+		return false;
+
+	char16 new_path_utf16[MAX_PATH_CHARS + 1];
+
+	if (!map_path(new_path, MutRange{ new_path_utf16 }))
+		return false;
+
+	return MoveFileExW(old_path_utf16, new_path_utf16, MOVEFILE_REPLACE_EXISTING);
+}
+
 bool minos::path_is_directory(Range<char8> path) noexcept
 {
 	char16 path_utf16[MAX_PATH_CHARS + 1];
@@ -1290,6 +1610,28 @@ bool minos::path_is_file(Range<char8> path) noexcept
 	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
 }
 
+u32 minos::executable_path(MutRange<char8> out_buf) noexcept
+{
+	char16 path_utf16[MAX_PATH_CHARS + 1];
+
+	const u32 path_utf16_chars = GetModuleFileNameW(nullptr, path_utf16, static_cast<u32>(array_count(path_utf16)));
+
+	if (path_utf16_chars == 0 || path_utf16_chars == array_count(path_utf16))
+		return 0;
+
+	const s32 chars = WideCharToMultiByte(CP_UTF8, 0, path_utf16, static_cast<s32>(path_utf16_chars), out_buf.begin(), static_cast<s32>(out_buf.count()), nullptr, nullptr);
+
+	if (chars == 0)
+	{
+		if (GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+			return WideCharToMultiByte(CP_UTF8, 0, path_utf16, static_cast<s32>(path_utf16_chars), nullptr, 0, nullptr, nullptr);
+
+		return 0;
+	}
+
+	return chars;
+}
+
 u32 minos::working_directory(MutRange<char8> out_buf) noexcept
 {
 	char16 path_utf16[MAX_PATH_CHARS + 1];
@@ -1496,6 +1838,32 @@ u64 minos::exact_timestamp_ticks_per_second() noexcept
 	return result.QuadPart;
 }
 
+u64 minos::exact_thread_cpu_time() noexcept
+{
+	FILETIME creation_time;
+
+	FILETIME exit_time;
+
+	FILETIME kernel_time;
+
+	FILETIME user_time;
+
+	if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+		ASSERT_UNREACHABLE;
+
+	const u64 kernel_ticks = kernel_time.dwLowDateTime | (static_cast<u64>(kernel_time.dwHighDateTime) << 32);
+
+	const u64 user_ticks = user_time.dwLowDateTime | (static_cast<u64>(user_time.dwHighDateTime) << 32);
+
+	return kernel_ticks + user_ticks;
+}
+
+u64 minos::exact_thread_cpu_time_ticks_per_second() noexcept
+{
+	// `FILETIME`s are in units of 100 nanoseconds.
+	return static_cast<u64>(10'000'000);
+}
+
 bool minos::has_debugger_attached() noexcept
 {
 	return static_cast<bool>(IsDebuggerPresent());
@@ -259,27 +259,27 @@ public:
 		return m_begin[i];
 	}
 
-	const T* begin() const noexcept
+	constexpr const T* begin() const noexcept
 	{
 		return m_begin;
 	}
 
-	const T* end() const noexcept
+	constexpr const T* end() const noexcept
 	{
 		return m_begin + m_count;
 	}
 
-	u32 count() const noexcept
+	constexpr u32 count() const noexcept
 	{
 		return m_count;
 	}
 
-	Attach attachment() const noexcept
+	constexpr Attach attachment() const noexcept
 	{
 		return m_attachment;
 	}
 
-	Range<T> range() const noexcept
+	constexpr Range<T> range() const noexcept
 	{
 		return { m_begin, m_count };
 	}
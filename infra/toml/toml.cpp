@@ -257,11 +257,17 @@ static bool next(TomlParser* parser, TomlToken* out) noexcept
 			if (parser->curr == token_beg + 2)
 				return toml_line_error(parser, parser->line, static_cast<u32>(1 + token_beg - parser->line_begin), "Expected at least one digit in integer literal.\n");
 		}
-		else
+		else if (is_dec_digit(*parser->curr))
 		{
-			while (is_dec_digit(*parser->curr))
-				parser->curr += 1;
+			return toml_line_error(parser, parser->line, static_cast<u32>(1 + token_beg - parser->line_begin), "Leading zeros are not allowed in integer literals.\n");
 		}
+
+		if (is_alpha(*parser->curr))
+			return toml_line_error(parser, parser->line, static_cast<u32>(1 + token_beg - parser->line_begin), "Unexpected character after integer literal.\n");
+
+		*out = TomlToken{ TomlTokenTag::Integer, Range<char8>{ token_beg, parser->curr }, token_line, token_column };
+
+		return true;
 	}
 	else if (is_dec_digit(first))
 	{
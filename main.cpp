@@ -6,6 +6,13 @@
 #include <cstdlib>
 #include <cstring>
 
+static s32 print_usage(const char8* invocation) noexcept
+{
+	print(minos::standard_file_handle(minos::StdFileName::StdErr), "Usage: % ( -help | -config <filepath> [ -serve <socketpath> | -server <socketpath> ] )\n", invocation);
+
+	return EXIT_FAILURE;
+}
+
 s32 main(s32 argc, const char8** argv)
 {
 	if (argc == 0)
@@ -20,8 +27,22 @@ s32 main(s32 argc, const char8** argv)
 
 		return EXIT_SUCCESS;
 	}
-	else if (argc == 3 && strcmp(argv[1] , "-config") == 0)
+	else if ((argc == 3 || argc == 5) && strcmp(argv[1] , "-config") == 0)
 	{
+		const bool is_server = argc == 5 && strcmp(argv[3], "-serve") == 0;
+
+		const bool is_client = argc == 5 && strcmp(argv[3], "-server") == 0;
+
+		if (argc == 5 && !is_server && !is_client)
+			return print_usage(argv[0]);
+
+		// Fall back to compiling locally if the server is not reachable, so
+		// that callers do not need to care whether it has been started.
+		u32 server_exit_code;
+
+		if (is_client && request_compilation(range::from_cstring(argv[4]), range::from_cstring(argv[2]), &server_exit_code))
+			return static_cast<s32>(server_exit_code);
+
 		Config config;
 
 		TreeSchemaAllocator ts_alloc;
@@ -29,9 +50,41 @@ s32 main(s32 argc, const char8** argv)
 		if (!config_from_toml_file(range::from_cstring(argv[2]), print_make_sink(minos::standard_file_handle(minos::StdFileName::StdErr)), &config, &ts_alloc))
 			return EXIT_FAILURE;
 
-		CoreData* const core = create_core_data(&config);
+		if (is_server)
+		{
+			(void) run_compilation_server(&config, range::from_cstring(argv[4]));
+
+			ts_allocator_release(ts_alloc);
+
+			return EXIT_FAILURE;
+		}
+
+		CoreData* core = nullptr;
+
+		bool is_ok = true;
+
+		if (config.prelude_snapshot.enabled)
+		{
+			core = create_core_data_from_snapshot(&config, config.prelude_snapshot.filepath);
+
+			// The snapshot is missing or stale, so it is rewritten once the
+			// prelude has been imported the slow way.
+			if (core == nullptr)
+			{
+				core = create_core_data(&config);
+
+				is_ok = import_prelude(core, config.std.prelude.filepath);
 
-		if (run_compilation(core, false))
+				if (is_ok && !core_data_snapshot(core, config.prelude_snapshot.filepath))
+					print(minos::standard_file_handle(minos::StdFileName::StdErr), "Failed to write prelude snapshot to `%` (0x%[|X])\n", config.prelude_snapshot.filepath, minos::last_error());
+			}
+		}
+		else
+		{
+			core = create_core_data(&config);
+		}
+
+		if (is_ok && run_compilation(core, false))
 		{
 			print(minos::standard_file_handle(minos::StdFileName::StdErr), "Success\n");
 
@@ -56,8 +109,6 @@ s32 main(s32 argc, const char8** argv)
 	}
 	else
 	{
-		print(minos::standard_file_handle(minos::StdFileName::StdErr), "Usage: % ( -help | -config <filepath> )\n", argv[0]);
-
-		return EXIT_FAILURE;
+		return print_usage(argv[0]);
 	}
 }
@@ -0,0 +1,386 @@
+#include "test_helpers.hpp"
+
+#include "../infra/types.hpp"
+#include "../infra/assert.hpp"
+#include "../infra/panic.hpp"
+#include "../infra/hash.hpp"
+#include "../infra/range.hpp"
+#include "../infra/minos/minos.hpp"
+#include "../infra/container/group_id_map.hpp"
+
+#include <cstdlib>
+
+static constexpr u32 TEST_ENTRY_CAPACITY = 4096;
+
+static constexpr u32 TEST_NO_ID = ~static_cast<u32>(0);
+
+struct TestEntry
+{
+	u32 key;
+
+	u32 key_hash;
+
+	bool is_live;
+
+	u32 hash() const noexcept
+	{
+		return key_hash;
+	}
+
+	bool is_equal_to_key(u32 other_key, u32 other_key_hash) const noexcept
+	{
+		return key_hash == other_key_hash && key == other_key;
+	}
+};
+
+// Backing storage for the `TestEntry`s of a `GroupIdMap`. Ids of removed
+// entries are reused by later insertions, as they would be by an allocator
+// with a freelist.
+struct TestEntryPool
+{
+	TestEntry entries[TEST_ENTRY_CAPACITY];
+
+	u32 free_ids[TEST_ENTRY_CAPACITY];
+
+	u32 free_count;
+
+	u32 used;
+
+	// Number of calls to `TestEntryAlloc::values`, which `GroupIdMap` only
+	// makes when rebuilding its table in place.
+	u32 rebuild_count;
+};
+
+struct TestEntryIterator
+{
+	TestEntryPool* pool;
+
+	u32 curr;
+
+	bool has_next() const noexcept
+	{
+		for (u32 i = curr; i != pool->used; ++i)
+		{
+			if (pool->entries[i].is_live)
+				return true;
+		}
+
+		return false;
+	}
+
+	TestEntry* next() noexcept
+	{
+		while (!pool->entries[curr].is_live)
+			curr += 1;
+
+		TestEntry* const entry = pool->entries + curr;
+
+		curr += 1;
+
+		return entry;
+	}
+};
+
+struct TestEntryAlloc
+{
+	TestEntryPool* pool;
+
+	TestEntry* value_from_id(u32 id) noexcept
+	{
+		return pool->entries + id;
+	}
+
+	const TestEntry* value_from_id(u32 id) const noexcept
+	{
+		return pool->entries + id;
+	}
+
+	u32 id_from_value(const TestEntry* value) const noexcept
+	{
+		return static_cast<u32>(value - pool->entries);
+	}
+
+	TestEntryIterator values() noexcept
+	{
+		pool->rebuild_count += 1;
+
+		return TestEntryIterator{ pool, 0 };
+	}
+
+	TestEntry* alloc(u32 key, u32 key_hash) noexcept
+	{
+		u32 id;
+
+		if (pool->free_count != 0)
+		{
+			pool->free_count -= 1;
+
+			id = pool->free_ids[pool->free_count];
+		}
+		else
+		{
+			if (pool->used == TEST_ENTRY_CAPACITY)
+				panic("Exceeded capacity of GroupIdMap test entries.\n");
+
+			id = pool->used;
+
+			pool->used += 1;
+		}
+
+		TestEntry* const entry = pool->entries + id;
+		entry->key = key;
+		entry->key_hash = key_hash;
+		entry->is_live = true;
+
+		return entry;
+	}
+
+	void dealloc(u32 id) noexcept
+	{
+		ASSERT_OR_IGNORE(pool->entries[id].is_live);
+
+		pool->entries[id].is_live = false;
+
+		pool->free_ids[pool->free_count] = id;
+
+		pool->free_count += 1;
+	}
+};
+
+using TestMap = GroupIdMap<u32, TestEntry, TestEntryAlloc>;
+
+// Map under test together with a reference of the ids it is expected to
+// hold, indexed by key. Keys that are not in the map have `TEST_NO_ID`.
+struct TestMapFixture
+{
+	TestMap map;
+
+	TestEntryPool* pool;
+
+	void* lookup_memory;
+
+	u64 lookup_bytes;
+
+	u32 (*hash_key)(u32 key) noexcept;
+
+	u32 reference_ids[TEST_ENTRY_CAPACITY];
+};
+
+static u32 well_mixed_hash(u32 key) noexcept
+{
+	return fnv1a(range::from_object_bytes(&key));
+}
+
+// Keeps the low 16 bits of all hashes zero, so that every key starts probing
+// at the first group. This fills groups along a single probe sequence, so
+// that removals leave tombstones instead of empty slots.
+static u32 colliding_hash(u32 key) noexcept
+{
+	return fnv1a(range::from_object_bytes(&key)) & 0xFFFF'0000;
+}
+
+// Starts out with a single group, so that tables of a few hundred slots have
+// already gone through several migrations.
+static TestMapFixture* create_fixture(u32 (*hash_key)(u32 key) noexcept) noexcept
+{
+	TestMapFixture* const fixture = static_cast<TestMapFixture*>(malloc(sizeof(TestMapFixture)));
+
+	TestEntryPool* const pool = static_cast<TestEntryPool*>(malloc(sizeof(TestEntryPool)));
+
+	if (fixture == nullptr || pool == nullptr)
+		panic("Failed to allocate GroupIdMap test fixture.\n");
+
+	pool->free_count = 0;
+	pool->used = 0;
+	pool->rebuild_count = 0;
+
+	fixture->pool = pool;
+	fixture->hash_key = hash_key;
+	fixture->lookup_bytes = TestMap::lookups_memory_size(1 << 16);
+	fixture->lookup_memory = minos::mem_reserve(fixture->lookup_bytes);
+
+	if (fixture->lookup_memory == nullptr)
+		panic("Failed to reserve GroupIdMap test lookup memory (0x%[|X]).\n", minos::last_error());
+
+	for (u32 i = 0; i != TEST_ENTRY_CAPACITY; ++i)
+		fixture->reference_ids[i] = TEST_NO_ID;
+
+	fixture->map.init(MutRange{ static_cast<byte*>(fixture->lookup_memory), fixture->lookup_bytes }, 8, TestEntryAlloc{ pool });
+
+	return fixture;
+}
+
+static void release_fixture(TestMapFixture* fixture) noexcept
+{
+	minos::mem_unreserve(fixture->lookup_memory, fixture->lookup_bytes);
+
+	free(fixture->pool);
+
+	free(fixture);
+}
+
+static void fixture_insert(TestMapFixture* fixture, u32 key) noexcept
+{
+	ASSERT_OR_IGNORE(fixture->reference_ids[key] == TEST_NO_ID);
+
+	fixture->reference_ids[key] = fixture->map.id_from(key, fixture->hash_key(key));
+}
+
+static void fixture_remove(TestMapFixture* fixture, u32 key) noexcept
+{
+	ASSERT_OR_IGNORE(fixture->reference_ids[key] != TEST_NO_ID);
+
+	fixture->map.remove(key, fixture->hash_key(key));
+
+	fixture->reference_ids[key] = TEST_NO_ID;
+}
+
+// Looks up each of the keys below `key_count` with `try_id_from`, returning
+// the number of keys for which the result differs from the reference.
+static u32 count_mismatches(TestMapFixture* fixture, u32 key_count) noexcept
+{
+	u32 mismatch_count = 0;
+
+	for (u32 key = 0; key != key_count; ++key)
+	{
+		u32 id;
+
+		const bool is_found = fixture->map.try_id_from(key, fixture->hash_key(key), &id);
+
+		const u32 expected_id = fixture->reference_ids[key];
+
+		if (expected_id == TEST_NO_ID)
+		{
+			if (is_found)
+				mismatch_count += 1;
+		}
+		else if (!is_found || id != expected_id || fixture->map.value_from(id)->key != key)
+		{
+			mismatch_count += 1;
+		}
+	}
+
+	return mismatch_count;
+}
+
+
+
+static void group_id_map_with_interleaved_removals_matches_reference_across_migrations() noexcept
+{
+	TEST_BEGIN;
+
+	static constexpr u32 KEY_COUNT = 2048;
+
+	TestMapFixture* const fixture = create_fixture(well_mixed_hash);
+
+	// Growing from a single group to hold `KEY_COUNT` keys takes at least
+	// eight migrations. Removing every other key as soon as its successor is
+	// inserted also exercises removals while a migration is in progress.
+	for (u32 key = 0; key != KEY_COUNT; ++key)
+	{
+		fixture_insert(fixture, key);
+
+		TEST_EQUAL(count_mismatches(fixture, KEY_COUNT), 0);
+
+		if (key % 3 == 2)
+		{
+			fixture_remove(fixture, key - 1);
+
+			TEST_EQUAL(count_mismatches(fixture, KEY_COUNT), 0);
+		}
+	}
+
+	for (u32 key = 0; key != KEY_COUNT; ++key)
+	{
+		if (key % 8 == 0 || fixture->reference_ids[key] == TEST_NO_ID)
+			continue;
+
+		fixture_remove(fixture, key);
+
+		TEST_EQUAL(count_mismatches(fixture, KEY_COUNT), 0);
+	}
+
+	for (u32 key = 0; key != KEY_COUNT; ++key)
+	{
+		if (fixture->reference_ids[key] != TEST_NO_ID)
+			continue;
+
+		fixture_insert(fixture, key);
+
+		TEST_EQUAL(count_mismatches(fixture, KEY_COUNT), 0);
+	}
+
+	release_fixture(fixture);
+
+	TEST_END;
+}
+
+static void group_id_map_with_tombstones_matches_reference_across_rebuilds() noexcept
+{
+	TEST_BEGIN;
+
+	static constexpr u32 KEY_COUNT = 768;
+
+	TestMapFixture* const fixture = create_fixture(colliding_hash);
+
+	u32 live_count = 0;
+
+	// Alternate between filling the table and removing most of its keys, so
+	// that the table repeatedly reaches its load limit while mostly holding
+	// tombstones, which is resolved by a rebuild rather than a migration.
+	for (u32 round = 0; round != 4; ++round)
+	{
+		for (u32 key = 0; key != KEY_COUNT && live_count != KEY_COUNT / 2 + round * (KEY_COUNT / 8); ++key)
+		{
+			if (fixture->reference_ids[key] != TEST_NO_ID)
+				continue;
+
+			fixture_insert(fixture, key);
+
+			live_count += 1;
+
+			TEST_EQUAL(count_mismatches(fixture, KEY_COUNT), 0);
+		}
+
+		for (u32 key = 0; key != KEY_COUNT && live_count > KEY_COUNT / 16; ++key)
+		{
+			if (fixture->reference_ids[key] == TEST_NO_ID)
+				continue;
+
+			fixture_remove(fixture, key);
+
+			live_count -= 1;
+
+			TEST_EQUAL(count_mismatches(fixture, KEY_COUNT), 0);
+		}
+	}
+
+	for (u32 key = 0; key != KEY_COUNT; ++key)
+	{
+		if (fixture->reference_ids[key] != TEST_NO_ID)
+			continue;
+
+		fixture_insert(fixture, key);
+
+		TEST_EQUAL(count_mismatches(fixture, KEY_COUNT), 0);
+	}
+
+	TEST_UNEQUAL(fixture->pool->rebuild_count, 0);
+
+	release_fixture(fixture);
+
+	TEST_END;
+}
+
+
+
+void group_id_map_tests() noexcept
+{
+	TEST_MODULE_BEGIN;
+
+	group_id_map_with_interleaved_removals_matches_reference_across_migrations();
+
+	group_id_map_with_tombstones_matches_reference_across_rebuilds();
+
+	TEST_MODULE_END;
+}
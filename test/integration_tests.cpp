@@ -5,6 +5,8 @@
 #include "../infra/range.hpp"
 #include "../core/core.hpp"
 
+#include <cstring>
+
 #ifdef _WIN32
 	#ifdef _NDEBUG
 		#define FFI_TEST_LIBRARY_SUBPATH "Release/ffi-test.dll"
@@ -190,6 +192,46 @@ static Config dummy_config(Range<char8> filepath, bool expect_failure, TreeSchem
 	return config;
 }
 
+// Compiles `closed-over-value.evl` with the `ConfigPrintSink` returned by
+// `select_sink` writing to the file at `filepath`, which is removed again
+// afterwards. `select_sink` may also adjust other settings in the `Config` it
+// is passed.
+// The file's contents are stored in `out_buf`, followed by a terminating
+// `'\0'`, and their size in `*out_bytes`. Returns whether compilation
+// succeeded.
+static bool run_with_sink_to_file(Range<char8> filepath, ConfigPrintSink* (*select_sink)(Config* config) noexcept, MutRange<char8> out_buf, u32* out_bytes) noexcept
+{
+	minos::FileHandle file;
+
+	if (!minos::file_create(filepath, minos::Access::Read | minos::Access::Write, minos::ExistsMode::Truncate, minos::NewMode::Create, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file))
+		panic("Failed to create test output file `%` (0x%[|X]).\n", filepath, minos::last_error());
+
+	TreeSchemaAllocator ts_alloc = ts_allocator_create(4096, 4096);
+
+	Config config = dummy_config(range::from_literal_string("integration-test-sources/closed-over-value.evl"), false, &ts_alloc);
+
+	*select_sink(&config) = ConfigPrintSink{ { filepath, true }, print_make_sink(file) };
+
+	CoreData* const core = create_core_data(&config);
+
+	const bool is_ok = run_compilation(core, false);
+
+	release_core_data(core);
+
+	if (!minos::file_read(file, out_buf.mut_subrange(0, out_buf.count() - 1).as_mut_byte_range(), 0, out_bytes))
+		panic("Failed to read test output file `%` (0x%[|X]).\n", filepath, minos::last_error());
+
+	out_buf[*out_bytes] = '\0';
+
+	minos::file_close(file);
+
+	(void) minos::path_remove_file(filepath);
+
+	ts_allocator_release(ts_alloc);
+
+	return is_ok;
+}
+
 static void run_integration_test(Range<char8> filepath) noexcept
 {
 	const IntegrationTestExpectation expectation = parse_integration_test_header(filepath);
@@ -241,6 +283,442 @@ static void run_integration_test(Range<char8> filepath) noexcept
 	TEST_END;
 }
 
+// Counts the files in `directory`, removing them if `remove` is `true`.
+// Subdirectories are ignored.
+static u32 count_files(Range<char8> directory, bool remove) noexcept
+{
+	minos::DirectoryEnumerationHandle dir;
+
+	minos::DirectoryEnumerationResult rst;
+
+	minos::DirectoryEnumerationStatus status = minos::directory_enumeration_create(directory, &dir, &rst);
+
+	u32 file_count = 0;
+
+	while (status == minos::DirectoryEnumerationStatus::Ok)
+	{
+		if (!rst.is_directory)
+		{
+			file_count += 1;
+
+			if (remove)
+			{
+				char8 path_bytes[4096];
+
+				MutRange<char8> path_buf = MutRange{ path_bytes };
+
+				const Range<char8> filename = range::from_cstring(rst.filename);
+
+				range::mem_copy(path_buf.mut_subrange(0, directory.count()), directory);
+
+				path_buf[directory.count()] = '/';
+
+				range::mem_copy(path_buf.mut_subrange(directory.count() + 1, filename.count()), filename);
+
+				if (!minos::path_remove_file(path_buf.subrange(0, directory.count() + 1 + filename.count())))
+					panic("Failed to remove file `%` from `%` (0x%[|X]).\n", filename, directory, minos::last_error());
+			}
+		}
+
+		status = minos::directory_enumeration_next(dir, &rst);
+	}
+
+	if (status == minos::DirectoryEnumerationStatus::NoMoreFiles)
+		minos::directory_enumeration_close(dir);
+
+	return file_count;
+}
+
+static u64 print_sink_write_discard([[maybe_unused]] void* attach, Range<char8> data) noexcept
+{
+	return data.count();
+}
+
+// Enables instrumentation in `config` without writing its report anywhere, so
+// that tests can inspect `instrumentation_summary` instead.
+static void enable_instrumentation(Config* config) noexcept
+{
+	PrintSink discard_sink{};
+	discard_sink.write_func = print_sink_write_discard;
+
+	config->logging.stats_sink = ConfigPrintSink{ { range::from_literal_string("discard"), true }, discard_sink };
+}
+
+// Results of compiling the same configuration twice, first against an empty
+// cache directory and then against the one populated by the first run.
+struct ColdAndWarmRun
+{
+	bool cold_is_ok;
+
+	bool warm_is_ok;
+
+	u32 cold_file_count;
+
+	u32 warm_file_count;
+
+	InstrumentationSummary cold_summary;
+
+	InstrumentationSummary warm_summary;
+};
+
+// Runs `config` once against an emptied `cache_directory` and once more
+// against the files written by the first run, removing them afterwards.
+// `config` must have a cache writing to `cache_directory` enabled.
+static ColdAndWarmRun run_cold_and_warm(Config* config, Range<char8> cache_directory) noexcept
+{
+	(void) count_files(cache_directory, true);
+
+	enable_instrumentation(config);
+
+	ColdAndWarmRun result;
+
+	CoreData* const cold_core = create_core_data(config);
+
+	result.cold_is_ok = run_compilation(cold_core, false);
+
+	result.cold_summary = instrumentation_summary(cold_core);
+
+	release_core_data(cold_core);
+
+	result.cold_file_count = count_files(cache_directory, false);
+
+	CoreData* const warm_core = create_core_data(config);
+
+	result.warm_is_ok = run_compilation(warm_core, false);
+
+	result.warm_summary = instrumentation_summary(warm_core);
+
+	release_core_data(warm_core);
+
+	result.warm_file_count = count_files(cache_directory, true);
+
+	(void) minos::path_remove_directory(cache_directory);
+
+	return result;
+}
+
+static void compilation_with_prefetched_imports_succeeds() noexcept
+{
+	TEST_BEGIN;
+
+	TreeSchemaAllocator ts_alloc = ts_allocator_create(4096, 4096);
+
+	// Prefetching is off by default, so enable it explicitly. The prelude's
+	// import of `std.evl` is then read by a prefetch thread.
+	Config config = dummy_config(range::from_literal_string("integration-test-sources/closed-over-value.evl"), false, &ts_alloc);
+	config.sources.prefetch_threads = 4;
+
+	CoreData* const core = create_core_data(&config);
+
+	TEST_EQUAL(run_compilation(core, false), true);
+
+	release_core_data(core);
+
+	ts_allocator_release(ts_alloc);
+
+	TEST_END;
+}
+
+static void ast_cache_populated_by_cold_run_is_used_by_warm_run() noexcept
+{
+	TEST_BEGIN;
+
+	const Range<char8> cache_directory = range::from_literal_string("ast-cache-test-data");
+
+	TreeSchemaAllocator ts_alloc = ts_allocator_create(4096, 4096);
+
+	Config config = dummy_config(range::from_literal_string("integration-test-sources/closed-over-value.evl"), false, &ts_alloc);
+	config.ast_cache.enabled = true;
+	config.ast_cache.directory = cache_directory;
+
+	const ColdAndWarmRun run = run_cold_and_warm(&config, cache_directory);
+
+	TEST_EQUAL(run.cold_is_ok, true);
+
+	TEST_EQUAL(run.warm_is_ok, true);
+
+	TEST_EQUAL(run.cold_summary.ast_cache_hits, 0);
+
+	TEST_UNEQUAL(run.cold_summary.ast_cache_misses, 0);
+
+	TEST_EQUAL(run.cold_file_count, run.cold_summary.ast_cache_misses);
+
+	TEST_EQUAL(run.warm_summary.ast_cache_hits, run.cold_summary.ast_cache_misses);
+
+	TEST_EQUAL(run.warm_summary.ast_cache_misses, 0);
+
+	TEST_EQUAL(run.warm_file_count, run.cold_file_count);
+
+	ts_allocator_release(ts_alloc);
+
+	TEST_END;
+}
+
+static void opcode_cache_populated_by_cold_run_is_used_by_warm_run() noexcept
+{
+	TEST_BEGIN;
+
+	const Range<char8> cache_directory = range::from_literal_string("opcode-cache-test-data");
+
+	TreeSchemaAllocator ts_alloc = ts_allocator_create(4096, 4096);
+
+	Config config = dummy_config(range::from_literal_string("integration-test-sources/closed-over-value.evl"), false, &ts_alloc);
+	config.opcode_cache.enabled = true;
+	config.opcode_cache.directory = cache_directory;
+
+	const ColdAndWarmRun run = run_cold_and_warm(&config, cache_directory);
+
+	TEST_EQUAL(run.cold_is_ok, true);
+
+	TEST_EQUAL(run.warm_is_ok, true);
+
+	TEST_EQUAL(run.cold_summary.opcode_cache_hits, 0);
+
+	TEST_UNEQUAL(run.cold_summary.opcode_cache_misses, 0);
+
+	TEST_EQUAL(run.cold_file_count, run.cold_summary.opcode_cache_misses);
+
+	TEST_EQUAL(run.warm_summary.opcode_cache_hits, run.cold_summary.opcode_cache_misses);
+
+	TEST_EQUAL(run.warm_summary.opcode_cache_misses, 0);
+
+	TEST_EQUAL(run.warm_file_count, run.cold_file_count);
+
+	ts_allocator_release(ts_alloc);
+
+	TEST_END;
+}
+
+static void prelude_snapshot_written_by_cold_run_is_restored_by_warm_run() noexcept
+{
+	TEST_BEGIN;
+
+	const Range<char8> snapshot_filepath = range::from_literal_string("prelude-snapshot-test-data.snapshot");
+
+	TreeSchemaAllocator ts_alloc = ts_allocator_create(4096, 4096);
+
+	Config config = dummy_config(range::from_literal_string("integration-test-sources/closed-over-value.evl"), false, &ts_alloc);
+
+	CoreData* const cold_core = create_core_data(&config);
+
+	TEST_EQUAL(import_prelude(cold_core, config.std.prelude.filepath), true);
+
+	TEST_EQUAL(core_data_snapshot(cold_core, snapshot_filepath), true);
+
+	release_core_data(cold_core);
+
+	CoreData* const warm_core = create_core_data_from_snapshot(&config, snapshot_filepath);
+
+	TEST_UNEQUAL(warm_core, nullptr);
+
+	if (warm_core != nullptr)
+	{
+		TEST_EQUAL(run_compilation(warm_core, false), true);
+
+		release_core_data(warm_core);
+	}
+
+	// A snapshot must not be restored under a configuration that would have
+	// produced a different state.
+	config.heap.commit_increment *= 2;
+
+	TEST_EQUAL(create_core_data_from_snapshot(&config, snapshot_filepath), nullptr);
+
+	(void) minos::path_remove_file(snapshot_filepath);
+
+	ts_allocator_release(ts_alloc);
+
+	TEST_END;
+}
+
+static void prelude_snapshot_is_refused_after_foreign_library_load() noexcept
+{
+	TEST_BEGIN;
+
+	const Range<char8> snapshot_filepath = range::from_literal_string("prelude-snapshot-ffi-test-data.snapshot");
+
+	TreeSchemaAllocator ts_alloc = ts_allocator_create(4096, 4096);
+
+	const Config config = dummy_config(range::from_literal_string("integration-test-sources/ffi-no-args.evl"), false, &ts_alloc);
+
+	CoreData* const core = create_core_data(&config);
+
+	TEST_EQUAL(run_compilation(core, false), true);
+
+	TEST_EQUAL(core_data_snapshot(core, snapshot_filepath), false);
+
+	TEST_EQUAL(minos::path_is_file(snapshot_filepath), false);
+
+	(void) minos::path_remove_file(snapshot_filepath);
+
+	release_core_data(core);
+
+	ts_allocator_release(ts_alloc);
+
+	TEST_END;
+}
+
+static ConfigPrintSink* select_stats_sink(Config* config) noexcept
+{
+	return &config->logging.stats_sink;
+}
+
+static void instrumentation_reports_phase_times_and_opcode_counts() noexcept
+{
+	TEST_BEGIN;
+
+	char8 stats_buf[16384];
+
+	u32 stats_bytes;
+
+	TEST_EQUAL(run_with_sink_to_file(range::from_literal_string("instrumentation-test-data.json"), select_stats_sink, MutRange{ stats_buf }, &stats_bytes), true);
+
+	TEST_EQUAL(stats_buf[0], '{');
+
+	TEST_UNEQUAL(strstr(stats_buf, "\"name\": \"interpret\""), nullptr);
+
+	TEST_UNEQUAL(strstr(stats_buf, "closed-over-value.evl\""), nullptr);
+
+	TEST_UNEQUAL(strstr(stats_buf, "\"Call\": "), nullptr);
+
+	TEST_END;
+}
+
+static ConfigPrintSink* select_trace_sink(Config* config) noexcept
+{
+	return &config->logging.trace_sink;
+}
+
+static void trace_records_balanced_import_call_and_builtin_spans() noexcept
+{
+	TEST_BEGIN;
+
+	char8 trace_buf[65536];
+
+	u32 trace_bytes;
+
+	TEST_EQUAL(run_with_sink_to_file(range::from_literal_string("trace-test-data.json"), select_trace_sink, MutRange{ trace_buf }, &trace_bytes), true);
+
+	TEST_EQUAL(trace_buf[0], '[');
+
+	TEST_UNEQUAL(strstr(trace_buf, "\"cat\": \"import\", \"name\": \"integration-test-sources/closed-over-value.evl\""), nullptr);
+
+	TEST_UNEQUAL(strstr(trace_buf, "\"cat\": \"call\""), nullptr);
+
+	TEST_UNEQUAL(strstr(trace_buf, "\"cat\": \"builtin\""), nullptr);
+
+	u32 begin_count = 0;
+
+	for (const char8* curr = strstr(trace_buf, "\"ph\": \"B\""); curr != nullptr; curr = strstr(curr + 1, "\"ph\": \"B\""))
+		begin_count += 1;
+
+	u32 end_count = 0;
+
+	for (const char8* curr = strstr(trace_buf, "\"ph\": \"E\""); curr != nullptr; curr = strstr(curr + 1, "\"ph\": \"E\""))
+		end_count += 1;
+
+	TEST_UNEQUAL(begin_count, 0);
+
+	TEST_EQUAL(begin_count, end_count);
+
+	TEST_END;
+}
+
+// Samples every executed opcode, so that even the short-running
+// `closed-over-value.evl` yields samples at each of its call sites.
+static ConfigPrintSink* select_profile_sink(Config* config) noexcept
+{
+	config->profile.sample_interval = 1;
+
+	return &config->profile.sink;
+}
+
+static void profile_attributes_samples_to_call_sites() noexcept
+{
+	TEST_BEGIN;
+
+	char8 profile_buf[65536];
+
+	u32 profile_bytes;
+
+	TEST_EQUAL(run_with_sink_to_file(range::from_literal_string("profile-test-data.txt"), select_profile_sink, MutRange{ profile_buf }, &profile_bytes), true);
+
+	TEST_UNEQUAL(profile_bytes, 0);
+
+	TEST_EQUAL(profile_buf[profile_bytes - 1], '\n');
+
+	// `g` is called from line 8 of `f`, which is in turn called from line 11.
+	TEST_UNEQUAL(strstr(profile_buf, "closed-over-value.evl:11:10;integration-test-sources/closed-over-value.evl:8:3;"), nullptr);
+
+	TEST_END;
+}
+
+// Runs `gc-unreachable-closures.evl` with the given collection thresholds,
+// returning whether compilation succeeded.
+static bool run_gc_unreachable_closures(u64 nursery_size, u64 full_gc_threshold, InstrumentationSummary* out_summary) noexcept
+{
+	TreeSchemaAllocator ts_alloc = ts_allocator_create(4096, 4096);
+
+	Config config = dummy_config(range::from_literal_string("integration-test-sources/gc-unreachable-closures.evl"), false, &ts_alloc);
+	config.heap.nursery_size = nursery_size;
+	config.heap.full_gc_threshold = full_gc_threshold;
+
+	enable_instrumentation(&config);
+
+	CoreData* const core = create_core_data(&config);
+
+	const bool is_ok = run_compilation(core, false);
+
+	*out_summary = instrumentation_summary(core);
+
+	release_core_data(core);
+
+	ts_allocator_release(ts_alloc);
+
+	return is_ok;
+}
+
+static void gc_collects_unreachable_closures() noexcept
+{
+	TEST_BEGIN;
+
+	InstrumentationSummary summary;
+
+	// Use a nursery holding a handful of closures, so that the ones created
+	// by earlier calls are dead by the time it fills up. A closure that is
+	// still alive when collecting is promoted, and can thus only be freed by
+	// a full collection, of which there are none here.
+	TEST_EQUAL(run_gc_unreachable_closures(1024, static_cast<u64>(1) << 31, &summary), true);
+
+	TEST_UNEQUAL(summary.heap_gc_count, 0);
+
+	TEST_EQUAL(summary.heap_minor_gc_count, summary.heap_gc_count);
+
+	TEST_UNEQUAL(summary.heap_gc_bytes, 0);
+
+	TEST_END;
+}
+
+static void full_gc_collects_unreachable_closures() noexcept
+{
+	TEST_BEGIN;
+
+	InstrumentationSummary summary;
+
+	// Collect before every allocation of a compile-time value. Each minor
+	// collection promotes the closure created by the previous call, making
+	// the next collection a full one that frees it.
+	TEST_EQUAL(run_gc_unreachable_closures(0, 0, &summary), true);
+
+	TEST_UNEQUAL(summary.heap_gc_count, 0);
+
+	TEST_UNEQUAL(summary.heap_gc_count, summary.heap_minor_gc_count);
+
+	TEST_UNEQUAL(summary.heap_gc_bytes, 0);
+
+	TEST_END;
+}
+
 void integration_tests() noexcept
 {
 	TEST_MODULE_BEGIN;
@@ -295,5 +773,25 @@ void integration_tests() noexcept
 	if (status == minos::DirectoryEnumerationStatus::Error)
 		panic("Failed to enumerate integration test directory `%` (0x%[|X]).\n", test_directory, minos::last_error());
 
+	compilation_with_prefetched_imports_succeeds();
+
+	ast_cache_populated_by_cold_run_is_used_by_warm_run();
+
+	opcode_cache_populated_by_cold_run_is_used_by_warm_run();
+
+	prelude_snapshot_written_by_cold_run_is_restored_by_warm_run();
+
+	prelude_snapshot_is_refused_after_foreign_library_load();
+
+	instrumentation_reports_phase_times_and_opcode_counts();
+
+	trace_records_balanced_import_call_and_builtin_spans();
+
+	profile_attributes_samples_to_call_sites();
+
+	gc_collects_unreachable_closures();
+
+	full_gc_collects_unreachable_closures();
+
 	TEST_MODULE_END;
 }
@@ -269,6 +269,52 @@ static void mem_decommit_on_aligned_pointer_and_exact_size_succeeds() noexcept
 }
 
 
+static void write_watch_records_writes_to_protected_granules() noexcept
+{
+	MINOS_TEST_BEGIN;
+
+	const u64 granule_bytes = minos::page_bytes();
+
+	const u64 bytes = 4 * granule_bytes;
+
+	byte* const memory = static_cast<byte*>(minos::mem_reserve(bytes));
+
+	TEST_EQUAL(minos::mem_commit(memory, bytes), true);
+
+	u64 dirty_bitmap = 0;
+
+	minos::WriteWatch watch{ memory, bytes, granule_bytes, &dirty_bitmap, 0 };
+
+	TEST_EQUAL(minos::write_watch_register(&watch), true);
+
+	TEST_EQUAL(minos::write_watch_protect(&watch, memory, 3 * granule_bytes), true);
+
+	memory[granule_bytes + 17] = 0x5E;
+
+	memory[granule_bytes + 18] = 0xA5;
+
+	memory[3 * granule_bytes] = 0x11;
+
+	TEST_EQUAL(dirty_bitmap, 0b0010);
+
+	TEST_EQUAL(memory[granule_bytes + 17], 0x5E);
+
+	TEST_EQUAL(memory[granule_bytes + 18], 0xA5);
+
+	TEST_EQUAL(minos::write_watch_unprotect(&watch), true);
+
+	memory[0] = 0x22;
+
+	TEST_EQUAL(dirty_bitmap, 0b0010);
+
+	minos::write_watch_unregister(&watch);
+
+	minos::mem_unreserve(memory, bytes);
+
+	MINOS_TEST_END;
+}
+
+
 static void page_bytes_returns_nonzero_power_of_two() noexcept
 {
 	MINOS_TEST_BEGIN;
@@ -292,6 +338,21 @@ static void logical_processor_count_returns_nonzero() noexcept
 	MINOS_TEST_END;
 }
 
+static void thread_stack_bounds_contains_local_variable() noexcept
+{
+	MINOS_TEST_BEGIN;
+
+	byte local = 0;
+
+	MutRange<byte> stack;
+
+	TEST_EQUAL(minos::thread_stack_bounds(&stack), true);
+
+	TEST_EQUAL(stack.begin() <= &local && &local < stack.end(), true);
+
+	MINOS_TEST_END;
+}
+
 
 static u32 THREAD_PROC thread_test_proc(void* param) noexcept
 {
@@ -1537,6 +1598,38 @@ static void file_resize_to_empty_file_succeeds() noexcept
 	MINOS_TEST_END;
 }
 
+static void file_map_readonly_maps_file_contents_and_zero_fills_page_tail() noexcept
+{
+	MINOS_TEST_BEGIN;
+
+	minos::FileHandle file;
+
+	TEST_EQUAL(minos::file_create(
+			range::from_literal_string("minos_fs_data/short_file"),
+			minos::Access::Read,
+			minos::ExistsMode::Open,
+			minos::NewMode::Fail,
+			minos::AccessPattern::Sequential,
+			none<const minos::CompletionInitializer*>(),
+			false,
+			&file
+		), true);
+
+	const char8* const mapping = static_cast<const char8*>(minos::file_map_readonly(file, 14));
+
+	TEST_UNEQUAL(mapping, nullptr);
+
+	TEST_MEM_EQUAL(mapping, "abcdefghijklmn", 14);
+
+	TEST_EQUAL(mapping[14], '\0');
+
+	minos::file_unmap(mapping, 14);
+
+	minos::file_close(file);
+
+	MINOS_TEST_END;
+}
+
 
 struct EventThreadParams
 {
@@ -2116,6 +2209,86 @@ static void process_wait_on_exited_process_still_works() noexcept
 }
 
 
+static void local_socket_send_transfers_data_and_file_handles_to_accepted_connection() noexcept
+{
+	MINOS_TEST_BEGIN;
+
+	const Range<char8> socket_path = range::from_literal_string(TEST_DIRECTORY "/DELETEME_socket");
+
+	minos::SocketHandle listener;
+
+	#ifdef _WIN32
+		TEST_EQUAL(minos::local_socket_listen(socket_path, &listener), false);
+	#else
+		TEST_EQUAL(minos::local_socket_listen(socket_path, &listener), true);
+
+		minos::SocketHandle client;
+
+		TEST_EQUAL(minos::local_socket_connect(socket_path, &client), true);
+
+		minos::SocketHandle server;
+
+		TEST_EQUAL(minos::local_socket_accept(listener, &server), true);
+
+		minos::FileHandle file;
+
+		TEST_EQUAL(minos::file_create(
+				range::from_literal_string("minos_fs_data/short_file"),
+				minos::Access::Read,
+				minos::ExistsMode::Open,
+				minos::NewMode::Fail,
+				minos::AccessPattern::Sequential,
+				none<const minos::CompletionInitializer*>(),
+				false,
+				&file
+			), true);
+
+		const u32 sent_data = 0x1234'5678;
+
+		TEST_EQUAL(minos::local_socket_send(client, Range{ &sent_data, 1 }.as_byte_range(), Range{ &file, 1 }), true);
+
+		minos::file_close(file);
+
+		u32 received_data;
+
+		minos::FileHandle received_files[2];
+
+		u32 received_file_count;
+
+		TEST_EQUAL(minos::local_socket_receive(server, MutRange{ &received_data, 1 }.as_mut_byte_range(), MutRange{ received_files }, &received_file_count), true);
+
+		TEST_EQUAL(received_data, sent_data);
+
+		TEST_EQUAL(received_file_count, 1);
+
+		char8 buf[14];
+
+		u32 bytes_read;
+
+		TEST_EQUAL(minos::file_read(received_files[0], MutRange{ buf }.as_mut_byte_range(), 0, &bytes_read), true);
+
+		TEST_EQUAL(bytes_read, 14);
+
+		TEST_MEM_EQUAL(buf, "abcdefghijklmn", 14);
+
+		minos::file_close(received_files[0]);
+
+		minos::local_socket_close(client);
+
+		// Receiving from a connection the peer has closed must fail rather
+		// than block.
+		TEST_EQUAL(minos::local_socket_receive(server, MutRange{ &received_data, 1 }.as_mut_byte_range(), MutRange{ received_files }, &received_file_count), false);
+
+		minos::local_socket_close(server);
+
+		minos::local_socket_close(listener);
+
+		TEST_EQUAL(minos::path_remove_file(socket_path), true);
+	#endif
+
+	MINOS_TEST_END;
+}
+
 static void shm_create_with_small_requst_succeeds() noexcept
 {
 	MINOS_TEST_BEGIN;
@@ -2738,6 +2911,70 @@ static void path_remove_file_on_nonexistent_path_fails() noexcept
 }
 
 
+static void path_rename_on_file_path_moves_file() noexcept
+{
+	MINOS_TEST_BEGIN;
+
+	minos::FileHandle file;
+
+	TEST_EQUAL(minos::file_create(range::from_literal_string(TEST_DIRECTORY "/DELETEME_L"), minos::Access::Write, minos::ExistsMode::Fail, minos::NewMode::Create, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file), true);
+
+	minos::file_close(file);
+
+	TEST_EQUAL(minos::path_rename(range::from_literal_string(TEST_DIRECTORY "/DELETEME_L"), range::from_literal_string(TEST_DIRECTORY "/DELETEME_M")), true);
+
+	TEST_EQUAL(minos::path_is_file(range::from_literal_string(TEST_DIRECTORY "/DELETEME_L")), false);
+
+	TEST_EQUAL(minos::path_is_file(range::from_literal_string(TEST_DIRECTORY "/DELETEME_M")), true);
+
+	MINOS_TEST_END;
+}
+
+static void path_rename_onto_existing_file_replaces_it() noexcept
+{
+	MINOS_TEST_BEGIN;
+
+	minos::FileHandle file;
+
+	TEST_EQUAL(minos::file_create(range::from_literal_string(TEST_DIRECTORY "/DELETEME_N"), minos::Access::Write, minos::ExistsMode::Fail, minos::NewMode::Create, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file), true);
+
+	minos::file_close(file);
+
+	TEST_EQUAL(minos::file_create(range::from_literal_string(TEST_DIRECTORY "/DELETEME_O"), minos::Access::Write, minos::ExistsMode::Fail, minos::NewMode::Create, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file), true);
+
+	const u32 data = 0x12345678;
+
+	TEST_EQUAL(minos::file_write_at(file, Range<byte>{ reinterpret_cast<const byte*>(&data), sizeof(data) }, 0), true);
+
+	minos::file_close(file);
+
+	TEST_EQUAL(minos::path_rename(range::from_literal_string(TEST_DIRECTORY "/DELETEME_O"), range::from_literal_string(TEST_DIRECTORY "/DELETEME_N")), true);
+
+	TEST_EQUAL(minos::path_is_file(range::from_literal_string(TEST_DIRECTORY "/DELETEME_O")), false);
+
+	TEST_EQUAL(minos::file_create(range::from_literal_string(TEST_DIRECTORY "/DELETEME_N"), minos::Access::Read, minos::ExistsMode::Open, minos::NewMode::Fail, minos::AccessPattern::Sequential, none<const minos::CompletionInitializer*>(), false, &file), true);
+
+	minos::FileInfo info;
+
+	TEST_EQUAL(minos::file_get_info(file, &info), true);
+
+	TEST_EQUAL(info.bytes, sizeof(data));
+
+	minos::file_close(file);
+
+	MINOS_TEST_END;
+}
+
+static void path_rename_on_nonexistent_path_fails() noexcept
+{
+	MINOS_TEST_BEGIN;
+
+	TEST_EQUAL(minos::path_rename(range::from_literal_string("minos_fs_data/nonexistent_path"), range::from_literal_string(TEST_DIRECTORY "/DELETEME_P")), false);
+
+	MINOS_TEST_END;
+}
+
+
 static void path_remove_directory_on_directory_path_succeeds() noexcept
 {
 	MINOS_TEST_BEGIN;
@@ -3230,6 +3467,10 @@ static void prepare_minos_tests() noexcept
 		AttachmentRange{ range::from_literal_string("DELETEME_I"), false },
 		AttachmentRange{ range::from_literal_string("DELETEME_J"), false },
 		AttachmentRange{ range::from_literal_string("DELETEME_K"), false },
+		AttachmentRange{ range::from_literal_string("DELETEME_L"), false },
+		AttachmentRange{ range::from_literal_string("DELETEME_M"), false },
+		AttachmentRange{ range::from_literal_string("DELETEME_N"), false },
+		AttachmentRange{ range::from_literal_string("DELETEME_O"), false },
 		AttachmentRange{ range::from_literal_string("DELETEME_empty_dir"), true },
 		AttachmentRange{ range::from_literal_string("DELETEME_DIR_A"), true },
 		AttachmentRange{ range::from_literal_string("DELETEME_DIR_B"), true },
@@ -3297,12 +3538,16 @@ void minos_tests() noexcept
 
 	mem_decommit_on_aligned_pointer_and_exact_size_succeeds();
 
+	write_watch_records_writes_to_protected_granules();
+
 
 	page_bytes_returns_nonzero_power_of_two();
 
 
 	logical_processor_count_returns_nonzero();
 
+	thread_stack_bounds_contains_local_variable();
+
 
 	thread_create_and_thread_wait_work();
 
@@ -3385,6 +3630,9 @@ void minos_tests() noexcept
 	file_resize_to_empty_file_succeeds();
 
 
+	file_map_readonly_maps_file_contents_and_zero_fills_page_tail();
+
+
 	event_create_creates_an_event();
 
 	event_wake_allows_wait();
@@ -3424,6 +3672,9 @@ void minos_tests() noexcept
 	process_wait_on_exited_process_still_works();
 
 
+	local_socket_send_transfers_data_and_file_handles_to_accepted_connection();
+
+
 	shm_create_with_small_requst_succeeds();
 
 	shm_create_with_large_requst_succeeds();
@@ -3485,6 +3736,13 @@ void minos_tests() noexcept
 	path_remove_file_on_nonexistent_path_fails();
 
 
+	path_rename_on_file_path_moves_file();
+
+	path_rename_onto_existing_file_replaces_it();
+
+	path_rename_on_nonexistent_path_fails();
+
+
 	path_remove_directory_on_directory_path_succeeds();
 
 	path_remove_directory_on_file_path_fails();
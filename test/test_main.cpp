@@ -17,6 +17,8 @@ const char8* g_curr_module;
 
 void minos_tests() noexcept;
 
+void group_id_map_tests() noexcept;
+
 void ast_tests() noexcept;
 
 void type_pool_tests() noexcept;
@@ -609,6 +611,8 @@ s32 main(s32 argc, const char8** argv) noexcept
 
 	if (invocation.run_core_tests)
 	{
+		group_id_map_tests();
+
 		ast_tests();
 
 		type_pool_tests();